@@ -0,0 +1,563 @@
+#include "AABBTree.h"
+#include <algorithm>
+#include <cmath>
+#include <bit>
+
+using namespace DirectX;
+using namespace SpatialMath;
+
+// Annonymous namespace to hold helpers only used in this file
+namespace
+{
+	// Proportional to surface area, which is all the insertion cost needs
+	float Area(const BoundingBox& box)
+	{
+		return box.Extents.x * box.Extents.y + box.Extents.y * box.Extents.z + box.Extents.z * box.Extents.x;
+	}
+}
+
+/// <summary>
+/// Adds an entity, or moves it if it is already in the tree
+/// </summary>
+/// <param name="entity">Entity the leaf belongs to</param>
+/// <param name="box">Tight world space bounds</param>
+void AABBTree::Insert(Entity entity, const BoundingBox& box)
+{
+	if (Contains(entity))
+	{
+		Update(entity, box);
+		return;
+	}
+
+	unsigned int slot = EntityIndex(entity);
+	if (slot >= leaves.size())
+		leaves.resize(slot + 1, AABB_NULL_NODE);
+
+	int leaf = AllocateNode();
+	Node& node = nodes[leaf];
+	node.box = box;
+	node.box.Extents.x += AABB_FAT_MARGIN;
+	node.box.Extents.y += AABB_FAT_MARGIN;
+	node.box.Extents.z += AABB_FAT_MARGIN;
+	node.entity = entity;
+	node.height = 0;
+
+	leaves[slot] = leaf;
+	leafCount++;
+	InsertLeaf(leaf);
+}
+
+void AABBTree::Remove(Entity entity)
+{
+	if (!Contains(entity))
+		return;
+
+	int& leaf = leaves[EntityIndex(entity)];
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	leaf = AABB_NULL_NODE;
+	leafCount--;
+}
+
+/// <summary>
+/// Moves an entity's leaf if it has left its fattened box
+/// </summary>
+/// <param name="entity">Entity that moved</param>
+/// <param name="box">New tight world space bounds</param>
+/// <returns>True if the leaf had to be reinserted</returns>
+bool AABBTree::Update(Entity entity, const BoundingBox& box)
+{
+	if (!Contains(entity))
+	{
+		Insert(entity, box);
+		return true;
+	}
+
+	int leaf = leaves[EntityIndex(entity)];
+	if (ContainsBox(nodes[leaf].box, box))
+		return false;
+
+	RemoveLeaf(leaf);
+	nodes[leaf].box = box;
+	nodes[leaf].box.Extents.x += AABB_FAT_MARGIN;
+	nodes[leaf].box.Extents.y += AABB_FAT_MARGIN;
+	nodes[leaf].box.Extents.z += AABB_FAT_MARGIN;
+	InsertLeaf(leaf);
+	return true;
+}
+
+bool AABBTree::Contains(Entity entity)
+{
+	unsigned int slot = EntityIndex(entity);
+	return slot < leaves.size() &&
+		leaves[slot] != AABB_NULL_NODE &&
+		nodes[leaves[slot]].entity == entity;
+}
+
+void AABBTree::Clear()
+{
+	nodes.clear();
+	leaves.clear();
+	root = AABB_NULL_NODE;
+	freeList = AABB_NULL_NODE;
+	leafCount = 0;
+	nodeCount = 0;
+}
+
+/// <summary>
+/// Finds every leaf whose box, and every parent box above it, passes a test
+/// </summary>
+/// <param name="test">Must not reject a box that contains a passing box, true for convex volume tests</param>
+/// <param name="found">Called with each leaf's entity, and whether the test said it was fully inside</param>
+void AABBTree::Query(const std::function<ContainmentType(const BoundingBox&)>& test, const std::function<void(Entity entity, bool inside)>& found)
+{
+	if (root == AABB_NULL_NODE)
+		return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		int index = stack.back();
+		stack.pop_back();
+
+		ContainmentType result = test(nodes[index].box);
+		if (result == DISJOINT)
+			continue;
+
+		// Everything below is inside as well, so just collect the leaves
+		if (result == CONTAINS)
+		{
+			size_t base = stack.size();
+			stack.push_back(index);
+			while (stack.size() > base)
+			{
+				const Node& node = nodes[stack.back()];
+				stack.pop_back();
+
+				if (node.IsLeaf())
+				{
+					found(node.entity, true);
+				}
+				else
+				{
+					stack.push_back(node.child1);
+					stack.push_back(node.child2);
+				}
+			}
+			continue;
+		}
+
+		const Node& node = nodes[index];
+		if (node.IsLeaf())
+		{
+			found(node.entity, false);
+		}
+		else
+		{
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+/// <summary>
+/// Runs several tests down the tree in one walk, each node is only tested
+/// against the tests its parent partly overlapped
+/// </summary>
+/// <param name="testCount">Number of tests, at most 32</param>
+/// <param name="test">Gets the test's index and a box, same rules as Query()</param>
+/// <param name="found">Called with each leaf's entity, the tests it was fully inside and the ones still partial</param>
+void AABBTree::QueryMany(unsigned int testCount, const std::function<ContainmentType(unsigned int test, const BoundingBox&)>& test, const std::function<void(Entity entity, unsigned int inside, unsigned int partial)>& found)
+{
+	if (root == AABB_NULL_NODE || testCount == 0)
+		return;
+
+	manyStack.clear();
+	manyStack.push_back({ root, testCount >= 32 ? ~0u : (1u << testCount) - 1, 0 });
+	while (!manyStack.empty())
+	{
+		QueryEntry entry = manyStack.back();
+		manyStack.pop_back();
+
+		// Tests this node is fully inside move over, ones it misses drop out
+		const Node& node = nodes[entry.node];
+		for (unsigned int bits = entry.partial; bits != 0; bits &= bits - 1)
+		{
+			unsigned int t = std::countr_zero(bits);
+			ContainmentType result = test(t, node.box);
+			if (result != INTERSECTS)
+			{
+				entry.partial &= ~(1u << t);
+				if (result == CONTAINS)
+					entry.inside |= 1u << t;
+			}
+		}
+
+		if (entry.partial == 0 && entry.inside == 0)
+			continue;
+
+		// Inside every view it still touches, so just collect the leaves like Query() does
+		if (entry.partial == 0)
+		{
+			stack.clear();
+			stack.push_back(entry.node);
+			while (!stack.empty())
+			{
+				const Node& below = nodes[stack.back()];
+				stack.pop_back();
+
+				if (below.IsLeaf())
+				{
+					found(below.entity, entry.inside, 0);
+				}
+				else
+				{
+					stack.push_back(below.child1);
+					stack.push_back(below.child2);
+				}
+			}
+			continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			found(node.entity, entry.inside, entry.partial);
+		}
+		else
+		{
+			manyStack.push_back({ node.child1, entry.partial, entry.inside });
+			manyStack.push_back({ node.child2, entry.partial, entry.inside });
+		}
+	}
+}
+
+/// <summary>
+/// Walks every box along a ray
+/// </summary>
+/// <param name="origin">Start of the ray</param>
+/// <param name="direction">Normalized direction of the ray</param>
+/// <param name="maxDistance">Length of the ray</param>
+/// <param name="hit">Gets each leaf entity and the distance to its (fattened) box, returns the new ray length</param>
+void AABBTree::RayCast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, const std::function<float(Entity, float)>& hit)
+{
+	if (root == AABB_NULL_NODE)
+		return;
+
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		float distance;
+		if (!IntersectsRay(node.box, origin, direction, maxDistance, distance))
+			continue;
+
+		if (node.IsLeaf())
+		{
+			maxDistance = std::min(maxDistance, hit(node.entity, distance));
+			if (maxDistance <= 0.0f)
+				return;
+		}
+		else
+		{
+			// Visit the child further along the ray last, hits on the near
+			// side shorten the ray and let most of the far side be skipped
+			const XMFLOAT3& center1 = nodes[node.child1].box.Center;
+			const XMFLOAT3& center2 = nodes[node.child2].box.Center;
+			float along1 = (center1.x - origin.x) * direction.x + (center1.y - origin.y) * direction.y + (center1.z - origin.z) * direction.z;
+			float along2 = (center2.x - origin.x) * direction.x + (center2.y - origin.y) * direction.y + (center2.z - origin.z) * direction.z;
+			stack.push_back(along1 < along2 ? node.child2 : node.child1);
+			stack.push_back(along1 < along2 ? node.child1 : node.child2);
+		}
+	}
+}
+
+int AABBTree::GetHeight() { return root == AABB_NULL_NODE ? 0 : nodes[root].height; }
+unsigned int AABBTree::GetCount() { return leafCount; }
+unsigned int AABBTree::GetNodeCount() { return nodeCount; }
+
+// --------------------------------------------------------
+// Node pool, freed nodes are chained through their parent
+// --------------------------------------------------------
+int AABBTree::AllocateNode()
+{
+	int node;
+	if (freeList != AABB_NULL_NODE)
+	{
+		node = freeList;
+		freeList = nodes[node].parent;
+	}
+	else
+	{
+		node = (int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	nodes[node].entity = INVALID_ENTITY;
+	nodes[node].parent = AABB_NULL_NODE;
+	nodes[node].child1 = AABB_NULL_NODE;
+	nodes[node].child2 = AABB_NULL_NODE;
+	nodes[node].height = 0;
+	nodeCount++;
+	return node;
+}
+
+void AABBTree::FreeNode(int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+	nodeCount--;
+}
+
+// --------------------------------------------------------
+// Places a leaf next to the sibling that grows the tree's
+// total surface area the least, then refits and rebalances
+// every ancestor on the way back up
+// --------------------------------------------------------
+void AABBTree::InsertLeaf(int leaf)
+{
+	if (root == AABB_NULL_NODE)
+	{
+		root = leaf;
+		nodes[root].parent = AABB_NULL_NODE;
+		return;
+	}
+
+	// Find the best sibling
+	BoundingBox leafBox = nodes[leaf].box;
+	int index = root;
+	while (!nodes[index].IsLeaf())
+	{
+		const Node& node = nodes[index];
+		float area = Area(node.box);
+		float combinedArea = Area(Merge(node.box, leafBox));
+
+		// Cost of pairing the leaf with this node
+		float cost = 2.0f * combinedArea;
+
+		// Every ancestor grows if the leaf goes any lower
+		float inheritedCost = 2.0f * (combinedArea - area);
+
+		// Cost of going down each side
+		float childCost[2];
+		int children[2] = { node.child1, node.child2 };
+		for (int c = 0; c < 2; c++)
+		{
+			const Node& child = nodes[children[c]];
+			float merged = Area(Merge(child.box, leafBox));
+			childCost[c] = (child.IsLeaf() ? merged : merged - Area(child.box)) + inheritedCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		index = childCost[0] < childCost[1] ? children[0] : children[1];
+	}
+	int sibling = index;
+
+	// New parent for the sibling and the leaf
+	int oldParent = nodes[sibling].parent;
+	int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = Merge(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent != AABB_NULL_NODE)
+	{
+		if (nodes[oldParent].child1 == sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else
+	{
+		root = newParent;
+	}
+
+	// Refit ancestors
+	index = nodes[leaf].parent;
+	while (index != AABB_NULL_NODE)
+	{
+		index = Balance(index);
+
+		Node& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+		node.box = Merge(nodes[node.child1].box, nodes[node.child2].box);
+
+		index = node.parent;
+	}
+}
+
+// --------------------------------------------------------
+// Unhooks a leaf, its parent is freed and the sibling
+// takes the parent's place
+// --------------------------------------------------------
+void AABBTree::RemoveLeaf(int leaf)
+{
+	if (leaf == root)
+	{
+		root = AABB_NULL_NODE;
+		return;
+	}
+
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	if (grandParent == AABB_NULL_NODE)
+	{
+		root = sibling;
+		nodes[sibling].parent = AABB_NULL_NODE;
+		FreeNode(parent);
+		return;
+	}
+
+	// Connect the sibling to the grandparent
+	if (nodes[grandParent].child1 == parent)
+		nodes[grandParent].child1 = sibling;
+	else
+		nodes[grandParent].child2 = sibling;
+	nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	// Refit ancestors
+	int index = grandParent;
+	while (index != AABB_NULL_NODE)
+	{
+		index = Balance(index);
+
+		Node& node = nodes[index];
+		node.height = 1 + std::max(nodes[node.child1].height, nodes[node.child2].height);
+		node.box = Merge(nodes[node.child1].box, nodes[node.child2].box);
+
+		index = node.parent;
+	}
+}
+
+// --------------------------------------------------------
+// Rotates the taller child up if one side is more than one
+// level deeper than the other, returns the subtree's new root
+// --------------------------------------------------------
+int AABBTree::Balance(int iA)
+{
+	Node& A = nodes[iA];
+	if (A.IsLeaf() || A.height < 2)
+		return iA;
+
+	int iB = A.child1;
+	int iC = A.child2;
+	Node& B = nodes[iB];
+	Node& C = nodes[iC];
+
+	int balance = C.height - B.height;
+
+	// Rotate C up
+	if (balance > 1)
+	{
+		int iF = C.child1;
+		int iG = C.child2;
+		Node& F = nodes[iF];
+		Node& G = nodes[iG];
+
+		// Swap A and C
+		C.child1 = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+
+		if (C.parent != AABB_NULL_NODE)
+		{
+			if (nodes[C.parent].child1 == iA)
+				nodes[C.parent].child1 = iC;
+			else
+				nodes[C.parent].child2 = iC;
+		}
+		else
+		{
+			root = iC;
+		}
+
+		// Keep the taller of C's children under C
+		if (F.height > G.height)
+		{
+			C.child2 = iF;
+			A.child2 = iG;
+			G.parent = iA;
+			A.box = Merge(B.box, G.box);
+			C.box = Merge(A.box, F.box);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		}
+		else
+		{
+			C.child2 = iG;
+			A.child2 = iF;
+			F.parent = iA;
+			A.box = Merge(B.box, F.box);
+			C.box = Merge(A.box, G.box);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if (balance < -1)
+	{
+		int iD = B.child1;
+		int iE = B.child2;
+		Node& D = nodes[iD];
+		Node& E = nodes[iE];
+
+		// Swap A and B
+		B.child1 = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+
+		if (B.parent != AABB_NULL_NODE)
+		{
+			if (nodes[B.parent].child1 == iA)
+				nodes[B.parent].child1 = iB;
+			else
+				nodes[B.parent].child2 = iB;
+		}
+		else
+		{
+			root = iB;
+		}
+
+		// Keep the taller of B's children under B
+		if (D.height > E.height)
+		{
+			B.child2 = iD;
+			A.child1 = iE;
+			E.parent = iA;
+			A.box = Merge(C.box, E.box);
+			B.box = Merge(A.box, D.box);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		}
+		else
+		{
+			B.child2 = iE;
+			A.child1 = iD;
+			D.parent = iA;
+			A.box = Merge(C.box, D.box);
+			B.box = Merge(A.box, E.box);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
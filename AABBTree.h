@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "SpatialIndex.h"
+
+#define AABB_NULL_NODE -1
+
+// Extra room around each leaf so small movements don't touch the tree
+#define AABB_FAT_MARGIN 0.5f
+
+// Dynamic bounding volume hierarchy over entity bounds
+// - Leaves store a fattened box, entities only get reinserted once they
+//   leave it, so static and barely moving entities cost nothing
+// - Insert, remove and reinsert are O(log n), picking siblings by
+//   surface area and rotating on the way back up to keep the tree shallow
+// - Queries only descend into nodes whose box passes the test, so any
+//   convex test works (frustums, swept boxes, spheres), and stop testing
+//   once a node is fully inside
+// - Every move that leaves a fat box costs a reinsert, so scenes where
+//   most entities travel every frame are better off in a SpatialGrid
+class AABBTree : public ISpatialIndex
+{
+public:
+	AABBTree() = default;
+
+	// Tree maintenance, keyed by the entity's handle
+	void Insert(Entity entity, const DirectX::BoundingBox& box) override;
+	void Remove(Entity entity) override;
+	bool Update(Entity entity, const DirectX::BoundingBox& box) override;
+	bool Contains(Entity entity) override;
+	void Clear() override;
+	unsigned int GetCount() override;
+
+	// Queries
+	void Query(const std::function<DirectX::ContainmentType(const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, bool inside)>& found) override;
+	void QueryMany(unsigned int testCount, const std::function<DirectX::ContainmentType(unsigned int test, const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, unsigned int inside, unsigned int partial)>& found) override;
+	void RayCast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, const std::function<float(Entity, float)>& hit) override;
+
+	// Stats
+	int GetHeight();
+	unsigned int GetNodeCount();
+
+private:
+	struct Node
+	{
+		DirectX::BoundingBox box;
+		Entity entity;
+		int parent;
+		int child1;
+		int child2;
+		int height;
+
+		bool IsLeaf() const { return child1 == AABB_NULL_NODE; }
+	};
+
+	int AllocateNode();
+	void FreeNode(int node);
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+	int Balance(int node);
+
+	std::vector<Node> nodes;
+	int root = AABB_NULL_NODE;
+	int freeList = AABB_NULL_NODE;
+	unsigned int leafCount = 0;
+	unsigned int nodeCount = 0;
+
+	// Leaf node of each entity slot, AABB_NULL_NODE when not in the tree
+	std::vector<int> leaves;
+
+	// Node and which tests are still partial or already inside, for QueryMany()
+	struct QueryEntry
+	{
+		int node;
+		unsigned int partial;
+		unsigned int inside;
+	};
+
+	// Reused by queries so they don't allocate
+	std::vector<int> stack;
+	std::vector<QueryEntry> manyStack;
+};
@@ -0,0 +1,694 @@
+#include "BatchCull.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+#include <bit>
+
+// Vector kernels only exist on x86 and x64
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_HAS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CULL_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace DirectX;
+
+// Annonymous namespace to hold helpers only used in this file
+namespace
+{
+	unsigned int RoundUpToBatch(unsigned int count)
+	{
+		return (count + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE * CULL_BATCH_SIZE;
+	}
+
+	// Both the CPU and the OS have to support AVX, the OS part
+	// is whether it saves the wide registers on a thread switch
+	bool CpuHasAvx2()
+	{
+#if defined(CULL_HAS_X86) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		__cpuid(info, 1);
+		bool osSavesAvx = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+		if (!osSavesAvx)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif defined(CULL_HAS_X86)
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	void TestScalar(const BoundsSoA& bounds, const CullPlanes& planes, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		for (unsigned int i = start; i < end; i++)
+		{
+			bool inside = true;
+			for (unsigned int p = 0; p < planes.count && inside; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				float distance =
+					plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w +
+					fabsf(plane.x) * bounds.extentX[i] + fabsf(plane.y) * bounds.extentY[i] + fabsf(plane.z) * bounds.extentZ[i];
+
+				if (distance < 0.0f)
+					inside = false;
+			}
+
+			if (inside)
+				mask[(i - start) / 32] |= 1u << ((i - start) % 32);
+		}
+	}
+
+#ifdef CULL_HAS_X86
+	void TestSSE(const BoundsSoA& bounds, const CullPlanes& planes, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		for (unsigned int i = start; i < end; i += 4)
+		{
+			__m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+			__m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+			__m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+			__m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+			__m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+			__m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (unsigned int p = 0; p < planes.count; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				__m128 distance = _mm_mul_ps(_mm_set1_ps(plane.x), centerX);
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), centerY));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), centerZ));
+				distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.x)), extentX));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.y)), extentY));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.z)), extentZ));
+
+				// "Not less than" so a NaN distance passes, same as the scalar test
+				inside = _mm_and_ps(inside, _mm_cmpnlt_ps(distance, zero));
+				if (_mm_movemask_ps(inside) == 0)
+					break;
+			}
+
+			// Lanes past the end are padding
+			unsigned int bits = (unsigned int)_mm_movemask_ps(inside);
+			if (end - i < 4)
+				bits &= (1u << (end - i)) - 1;
+			mask[(i - start) / 32] |= bits << ((i - start) % 32);
+		}
+	}
+
+	CULL_TARGET_AVX2 void TestAVX2(const BoundsSoA& bounds, const CullPlanes& planes, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		for (unsigned int i = start; i < end; i += 8)
+		{
+			__m256 centerX = _mm256_loadu_ps(&bounds.centerX[i]);
+			__m256 centerY = _mm256_loadu_ps(&bounds.centerY[i]);
+			__m256 centerZ = _mm256_loadu_ps(&bounds.centerZ[i]);
+			__m256 extentX = _mm256_loadu_ps(&bounds.extentX[i]);
+			__m256 extentY = _mm256_loadu_ps(&bounds.extentY[i]);
+			__m256 extentZ = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (unsigned int p = 0; p < planes.count; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				__m256 distance = _mm256_mul_ps(_mm256_set1_ps(plane.x), centerX);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ));
+				distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.x)), extentX));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.y)), extentY));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.z)), extentZ));
+
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_NLT_UQ));
+				if (_mm256_movemask_ps(inside) == 0)
+					break;
+			}
+
+			unsigned int bits = (unsigned int)_mm256_movemask_ps(inside);
+			if (end - i < 8)
+				bits &= (1u << (end - i)) - 1;
+			mask[(i - start) / 32] |= bits << ((i - start) % 32);
+		}
+	}
+#endif
+
+	// Drift since the last full test is under turn * (reach + travel) + travel, so the margin is
+	// split between the two by how fast each is building up and neither runs out early
+	void UpdateLimitsScalar(const BoundsSoA& bounds, const CullPlanes& planes, const TemporalCamera& camera, unsigned int start, unsigned int end, const unsigned int* stale, TemporalLimits& limits)
+	{
+		for (unsigned int i = start; i < end; i++)
+		{
+			if (!((stale[(i - start) / 32] >> ((i - start) % 32)) & 1))
+				continue;
+
+			float inside = FLT_MAX;
+			float outside = 0.0f;
+			for (unsigned int p = 0; p < planes.count; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				float distance =
+					plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w +
+					fabsf(plane.x) * bounds.extentX[i] + fabsf(plane.y) * bounds.extentY[i] + fabsf(plane.z) * bounds.extentZ[i];
+				inside = std::min(inside, distance);
+				outside = std::max(outside, -distance);
+			}
+			bool visible = outside == 0.0f;
+			float margin = (visible ? inside : outside) - camera.epsilon;
+
+			float toX = bounds.centerX[i] - camera.eye.x;
+			float toY = bounds.centerY[i] - camera.eye.y;
+			float toZ = bounds.centerZ[i] - camera.eye.z;
+			float reach =
+				sqrtf(toX * toX + toY * toY + toZ * toZ) +
+				sqrtf(bounds.extentX[i] * bounds.extentX[i] + bounds.extentY[i] * bounds.extentY[i] + bounds.extentZ[i] * bounds.extentZ[i]);
+
+			float rate = camera.turnRate * reach + camera.travelRate;
+			float share = rate > 0.0f ? camera.travelRate / rate : 0.5f;
+			limits.travel[i] = camera.travel + share * margin;
+			limits.turn[i] = camera.turn + (1.0f - share) * margin / (reach + share * margin);
+
+			unsigned int& word = limits.visible[i / 32];
+			word = (word & ~(1u << (i % 32))) | (unsigned int)visible << (i % 32);
+		}
+	}
+
+	void TestStaleScalar(const TemporalLimits& limits, float turn, float travel, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		for (unsigned int i = start; i < end; i++)
+		{
+			unsigned int stale = (unsigned int)((turn >= limits.turn[i]) | (travel >= limits.travel[i]));
+			mask[(i - start) / 32] |= stale << ((i - start) % 32);
+		}
+	}
+
+#ifdef CULL_HAS_X86
+	void TestStaleSSE(const TemporalLimits& limits, float turn, float travel, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		const __m128 turnTotal = _mm_set1_ps(turn);
+		const __m128 travelTotal = _mm_set1_ps(travel);
+		for (unsigned int i = start; i < end; i += 4)
+		{
+			// Limits at or under the totals, a NaN limit is never stale, same as the scalar test
+			__m128 stale = _mm_or_ps(
+				_mm_cmple_ps(_mm_loadu_ps(&limits.turn[i]), turnTotal),
+				_mm_cmple_ps(_mm_loadu_ps(&limits.travel[i]), travelTotal));
+
+			unsigned int bits = (unsigned int)_mm_movemask_ps(stale);
+			if (end - i < 4)
+				bits &= (1u << (end - i)) - 1;
+			mask[(i - start) / 32] |= bits << ((i - start) % 32);
+		}
+	}
+
+	CULL_TARGET_AVX2 void TestStaleAVX2(const TemporalLimits& limits, float turn, float travel, unsigned int start, unsigned int end, unsigned int* mask)
+	{
+		const __m256 turnTotal = _mm256_set1_ps(turn);
+		const __m256 travelTotal = _mm256_set1_ps(travel);
+		for (unsigned int i = start; i < end; i += 8)
+		{
+			__m256 stale = _mm256_or_ps(
+				_mm256_cmp_ps(_mm256_loadu_ps(&limits.turn[i]), turnTotal, _CMP_LE_OQ),
+				_mm256_cmp_ps(_mm256_loadu_ps(&limits.travel[i]), travelTotal, _CMP_LE_OQ));
+
+			unsigned int bits = (unsigned int)_mm256_movemask_ps(stale);
+			if (end - i < 8)
+				bits &= (1u << (end - i)) - 1;
+			mask[(i - start) / 32] |= bits << ((i - start) % 32);
+		}
+	}
+
+	void UpdateLimitsSSE(const BoundsSoA& bounds, const CullPlanes& planes, const TemporalCamera& camera, unsigned int start, unsigned int end, const unsigned int* stale, TemporalLimits& limits)
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128i laneBits = _mm_setr_epi32(1, 2, 4, 8);
+		for (unsigned int i = start; i < end; i += 4)
+		{
+			// Groups with nothing stale are left alone, lanes past the end never are
+			unsigned int bits = (stale[(i - start) / 32] >> ((i - start) % 32)) & 0xF;
+			if (bits == 0)
+				continue;
+			__m128 write = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32((int)bits), laneBits), laneBits));
+
+			__m128 centerX = _mm_loadu_ps(&bounds.centerX[i]);
+			__m128 centerY = _mm_loadu_ps(&bounds.centerY[i]);
+			__m128 centerZ = _mm_loadu_ps(&bounds.centerZ[i]);
+			__m128 extentX = _mm_loadu_ps(&bounds.extentX[i]);
+			__m128 extentY = _mm_loadu_ps(&bounds.extentY[i]);
+			__m128 extentZ = _mm_loadu_ps(&bounds.extentZ[i]);
+
+			// Distance first so a NaN one is skipped, like std::min() and std::max() do
+			__m128 inside = _mm_set1_ps(FLT_MAX);
+			__m128 outside = zero;
+			for (unsigned int p = 0; p < planes.count; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				__m128 distance = _mm_mul_ps(_mm_set1_ps(plane.x), centerX);
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), centerY));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), centerZ));
+				distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.x)), extentX));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.y)), extentY));
+				distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(fabsf(plane.z)), extentZ));
+				inside = _mm_min_ps(distance, inside);
+				outside = _mm_max_ps(_mm_xor_ps(distance, sign), outside);
+			}
+			__m128 visible = _mm_cmpeq_ps(outside, zero);
+			__m128 margin = _mm_or_ps(_mm_and_ps(visible, inside), _mm_andnot_ps(visible, outside));
+			margin = _mm_sub_ps(margin, _mm_set1_ps(camera.epsilon));
+
+			__m128 toX = _mm_sub_ps(centerX, _mm_set1_ps(camera.eye.x));
+			__m128 toY = _mm_sub_ps(centerY, _mm_set1_ps(camera.eye.y));
+			__m128 toZ = _mm_sub_ps(centerZ, _mm_set1_ps(camera.eye.z));
+			__m128 toBox = _mm_add_ps(_mm_add_ps(_mm_mul_ps(toX, toX), _mm_mul_ps(toY, toY)), _mm_mul_ps(toZ, toZ));
+			__m128 extent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, extentX), _mm_mul_ps(extentY, extentY)), _mm_mul_ps(extentZ, extentZ));
+			__m128 reach = _mm_add_ps(_mm_sqrt_ps(toBox), _mm_sqrt_ps(extent));
+
+			__m128 travelRate = _mm_set1_ps(camera.travelRate);
+			__m128 rate = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(camera.turnRate), reach), travelRate);
+			__m128 moving = _mm_cmpgt_ps(rate, zero);
+			__m128 share = _mm_or_ps(_mm_and_ps(moving, _mm_div_ps(travelRate, rate)), _mm_andnot_ps(moving, _mm_set1_ps(0.5f)));
+			__m128 travelLimit = _mm_add_ps(_mm_set1_ps(camera.travel), _mm_mul_ps(share, margin));
+			__m128 turnLimit = _mm_add_ps(_mm_set1_ps(camera.turn), _mm_div_ps(
+				_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), share), margin),
+				_mm_add_ps(reach, _mm_mul_ps(share, margin))));
+
+			float* travel = &limits.travel[i];
+			float* turn = &limits.turn[i];
+			_mm_storeu_ps(travel, _mm_or_ps(_mm_and_ps(write, travelLimit), _mm_andnot_ps(write, _mm_loadu_ps(travel))));
+			_mm_storeu_ps(turn, _mm_or_ps(_mm_and_ps(write, turnLimit), _mm_andnot_ps(write, _mm_loadu_ps(turn))));
+
+			unsigned int& word = limits.visible[i / 32];
+			unsigned int visibleBits = (unsigned int)_mm_movemask_ps(visible) & bits;
+			word = (word & ~(bits << (i % 32))) | visibleBits << (i % 32);
+		}
+	}
+
+	CULL_TARGET_AVX2 void UpdateLimitsAVX2(const BoundsSoA& bounds, const CullPlanes& planes, const TemporalCamera& camera, unsigned int start, unsigned int end, const unsigned int* stale, TemporalLimits& limits)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 sign = _mm256_set1_ps(-0.0f);
+		const __m256i laneBits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+		for (unsigned int i = start; i < end; i += 8)
+		{
+			unsigned int bits = (stale[(i - start) / 32] >> ((i - start) % 32)) & 0xFF;
+			if (bits == 0)
+				continue;
+			__m256 write = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32((int)bits), laneBits), laneBits));
+
+			__m256 centerX = _mm256_loadu_ps(&bounds.centerX[i]);
+			__m256 centerY = _mm256_loadu_ps(&bounds.centerY[i]);
+			__m256 centerZ = _mm256_loadu_ps(&bounds.centerZ[i]);
+			__m256 extentX = _mm256_loadu_ps(&bounds.extentX[i]);
+			__m256 extentY = _mm256_loadu_ps(&bounds.extentY[i]);
+			__m256 extentZ = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+			__m256 inside = _mm256_set1_ps(FLT_MAX);
+			__m256 outside = zero;
+			for (unsigned int p = 0; p < planes.count; p++)
+			{
+				const XMFLOAT4& plane = planes.planes[p];
+				__m256 distance = _mm256_mul_ps(_mm256_set1_ps(plane.x), centerX);
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), centerY));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ));
+				distance = _mm256_add_ps(distance, _mm256_set1_ps(plane.w));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.x)), extentX));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.y)), extentY));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(fabsf(plane.z)), extentZ));
+				inside = _mm256_min_ps(distance, inside);
+				outside = _mm256_max_ps(_mm256_xor_ps(distance, sign), outside);
+			}
+			__m256 visible = _mm256_cmp_ps(outside, zero, _CMP_EQ_OQ);
+			__m256 margin = _mm256_sub_ps(_mm256_blendv_ps(outside, inside, visible), _mm256_set1_ps(camera.epsilon));
+
+			__m256 toX = _mm256_sub_ps(centerX, _mm256_set1_ps(camera.eye.x));
+			__m256 toY = _mm256_sub_ps(centerY, _mm256_set1_ps(camera.eye.y));
+			__m256 toZ = _mm256_sub_ps(centerZ, _mm256_set1_ps(camera.eye.z));
+			__m256 toBox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(toX, toX), _mm256_mul_ps(toY, toY)), _mm256_mul_ps(toZ, toZ));
+			__m256 extent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extentX, extentX), _mm256_mul_ps(extentY, extentY)), _mm256_mul_ps(extentZ, extentZ));
+			__m256 reach = _mm256_add_ps(_mm256_sqrt_ps(toBox), _mm256_sqrt_ps(extent));
+
+			__m256 travelRate = _mm256_set1_ps(camera.travelRate);
+			__m256 rate = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(camera.turnRate), reach), travelRate);
+			__m256 share = _mm256_blendv_ps(_mm256_set1_ps(0.5f), _mm256_div_ps(travelRate, rate), _mm256_cmp_ps(rate, zero, _CMP_GT_OQ));
+			__m256 travelLimit = _mm256_add_ps(_mm256_set1_ps(camera.travel), _mm256_mul_ps(share, margin));
+			__m256 turnLimit = _mm256_add_ps(_mm256_set1_ps(camera.turn), _mm256_div_ps(
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), share), margin),
+				_mm256_add_ps(reach, _mm256_mul_ps(share, margin))));
+
+			float* travel = &limits.travel[i];
+			float* turn = &limits.turn[i];
+			_mm256_storeu_ps(travel, _mm256_blendv_ps(_mm256_loadu_ps(travel), travelLimit, write));
+			_mm256_storeu_ps(turn, _mm256_blendv_ps(_mm256_loadu_ps(turn), turnLimit, write));
+
+			unsigned int& word = limits.visible[i / 32];
+			unsigned int visibleBits = (unsigned int)_mm256_movemask_ps(visible) & bits;
+			word = (word & ~(bits << (i % 32))) | visibleBits << (i % 32);
+		}
+	}
+#endif
+}
+
+void BoundsSoA::Reserve(unsigned int capacity)
+{
+	capacity = RoundUpToBatch(capacity);
+	for (std::vector<float>* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+		component->reserve(capacity);
+}
+
+/// <summary>
+/// Changes how many boxes there are, keeping the arrays padded to a whole batch
+/// </summary>
+/// <param name="newCount">Number of boxes</param>
+void BoundsSoA::Resize(unsigned int newCount)
+{
+	count = newCount;
+	unsigned int padded = RoundUpToBatch(newCount);
+	for (std::vector<float>* component : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+		component->resize(padded);
+}
+
+void BoundsSoA::Set(unsigned int index, const BoundingBox& box)
+{
+	centerX[index] = box.Center.x;
+	centerY[index] = box.Center.y;
+	centerZ[index] = box.Center.z;
+	extentX[index] = box.Extents.x;
+	extentY[index] = box.Extents.y;
+	extentZ[index] = box.Extents.z;
+}
+
+void BoundsSoA::Clear()
+{
+	Resize(0);
+}
+
+void TemporalLimits::Reserve(unsigned int capacity)
+{
+	capacity = RoundUpToBatch(capacity);
+	turn.reserve(capacity);
+	travel.reserve(capacity);
+	visible.reserve((capacity + 31) / 32);
+}
+
+/// <summary>
+/// Changes how many entries there are, new ones are stale and not visible
+/// </summary>
+/// <param name="newCount">Number of entries</param>
+void TemporalLimits::Resize(unsigned int newCount)
+{
+	unsigned int padded = RoundUpToBatch(newCount);
+	turn.resize(padded);
+	travel.resize(padded);
+	visible.resize((newCount + 31) / 32);
+
+	// Padding can hold limits from entries removed earlier, travel is never negative
+	for (unsigned int i = count; i < newCount; i++)
+	{
+		turn[i] = 0.0f;
+		travel[i] = -1.0f;
+	}
+	if (newCount % 32 != 0)
+		visible.back() &= (1u << (newCount % 32)) - 1;
+	count = newCount;
+}
+
+/// <summary>
+/// Copies one entry over another, for filling the hole a removed entity leaves
+/// </summary>
+void TemporalLimits::Move(unsigned int from, unsigned int to)
+{
+	turn[to] = turn[from];
+	travel[to] = travel[from];
+	unsigned int bit = (visible[from / 32] >> (from % 32)) & 1;
+	visible[to / 32] = (visible[to / 32] & ~(1u << (to % 32))) | bit << (to % 32);
+}
+
+void TemporalLimits::Clear()
+{
+	Resize(0);
+}
+
+void CullPlanes::Add(XMFLOAT4 plane)
+{
+	if (count < CULL_MAX_PLANES)
+		planes[count++] = plane;
+}
+
+/// <summary>
+/// Adds some or all of a frustum's planes
+/// </summary>
+/// <param name="frustum">Frustum to add</param>
+/// <param name="planeMask">Bit per plane to add, leaving one out makes the frustum endless that way</param>
+void CullPlanes::AddFrustum(const Frustum& frustum, unsigned int planeMask)
+{
+	for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+	{
+		if (planeMask & (1u << i))
+			Add(frustum.GetPlane(i));
+	}
+}
+
+/// <summary>
+/// Adds a frustum that passes boxes touching it anywhere along a sweep
+/// - Same idea as Frustum::IntersectsSwept(), a box is only outside a plane when both
+///   ends of the sweep are, so each plane is pushed back by however far the sweep
+///   carries a box towards its inside
+/// </summary>
+/// <param name="frustum">Frustum the moving boxes are tested against</param>
+/// <param name="sweep">Direction and distance the boxes travel</param>
+void CullPlanes::AddSweptFrustum(const Frustum& frustum, XMFLOAT3 sweep)
+{
+	for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+	{
+		XMFLOAT4 plane = frustum.GetPlane(i);
+		plane.w += std::max(0.0f, plane.x * sweep.x + plane.y * sweep.y + plane.z * sweep.z);
+		Add(plane);
+	}
+}
+
+/// <summary>
+/// Adds the volume shadow casters have to be in for their shadow to show up on screen
+/// </summary>
+/// <param name="light">Frustum of the light's shadow map projection</param>
+/// <param name="camera">Frustum of the camera the shadows are seen from</param>
+/// <param name="shadowSweep">Light direction scaled by how far shadows can fall</param>
+void CullPlanes::AddShadowCasters(const Frustum& light, const Frustum& camera, XMFLOAT3 shadowSweep)
+{
+	// Anything between the light and its volume still casts into it,
+	// so the near plane is left out to stretch the volume back to the light
+	AddFrustum(light, FRUSTUM_ALL_PLANES & ~(1u << FRUSTUM_NEAR));
+	AddSweptFrustum(camera, shadowSweep);
+}
+
+/// <summary>
+/// Classifies one box against every plane
+/// </summary>
+/// <param name="box">World space box</param>
+/// <returns>DISJOINT, INTERSECTS or CONTAINS</returns>
+ContainmentType CullPlanes::Contains(const BoundingBox& box) const
+{
+	ContainmentType result = CONTAINS;
+	for (unsigned int p = 0; p < count; p++)
+	{
+		const XMFLOAT4& plane = planes[p];
+		float center = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+		float radius = fabsf(plane.x) * box.Extents.x + fabsf(plane.y) * box.Extents.y + fabsf(plane.z) * box.Extents.z;
+
+		if (center + radius < 0.0f)
+			return DISJOINT;
+		if (center - radius < 0.0f)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+/// <summary>
+/// Sizes the masks for a number of views and entities and clears every bit
+/// </summary>
+/// <param name="views">Number of views</param>
+/// <param name="count">Number of entities</param>
+void ViewMasks::Reset(unsigned int views, unsigned int count)
+{
+	viewCount = views;
+	words = (count + 31) / 32;
+	bits.assign((size_t)views * words, 0);
+}
+
+unsigned int* ViewMasks::GetView(unsigned int view) { return &bits[(size_t)view * words]; }
+bool ViewMasks::IsVisible(unsigned int view, unsigned int index) const { return (bits[(size_t)view * words + index / 32] >> (index % 32)) & 1; }
+
+unsigned int ViewMasks::CountVisible(unsigned int view) const
+{
+	unsigned int total = 0;
+	for (unsigned int w = 0; w < words; w++)
+		total += std::popcount(bits[(size_t)view * words + w]);
+	return total;
+}
+
+/// <summary>
+/// Lists the entities one view can see
+/// </summary>
+/// <param name="view">View to list</param>
+/// <param name="indices">Filled with dense indices in order</param>
+void ViewMasks::GetIndices(unsigned int view, std::vector<unsigned int>& indices) const
+{
+	indices.clear();
+	for (unsigned int w = 0; w < words; w++)
+	{
+		for (unsigned int word = bits[(size_t)view * words + w]; word != 0; word &= word - 1)
+			indices.push_back(w * 32 + std::countr_zero(word));
+	}
+}
+
+/// <summary>
+/// Widest kernel this machine can run, checked once
+/// </summary>
+int BatchCull::GetBestKernel()
+{
+	static const int best =
+#ifdef CULL_HAS_X86
+		CpuHasAvx2() ? CULL_KERNEL_AVX2 : CULL_KERNEL_SSE;
+#else
+		CULL_KERNEL_SCALAR;
+#endif
+	return best;
+}
+
+bool BatchCull::IsKernelSupported(int kernel)
+{
+	return kernel >= CULL_KERNEL_SCALAR && kernel <= GetBestKernel();
+}
+
+const char* BatchCull::GetKernelName(int kernel)
+{
+	switch (kernel)
+	{
+	case CULL_KERNEL_AVX2: return "AVX2 (8 wide)";
+	case CULL_KERNEL_SSE: return "SSE (4 wide)";
+	default: return "Scalar";
+	}
+}
+
+/// <summary>
+/// Tests a range of boxes against every plane
+/// </summary>
+/// <param name="kernel">CULL_KERNEL_ type, falls back to the best supported one</param>
+/// <param name="bounds">Boxes to test</param>
+/// <param name="planes">Planes every passing box has to reach the inside of</param>
+/// <param name="start">First box to test</param>
+/// <param name="end">One past the last box to test</param>
+/// <param name="mask">Bit per box in the range, set when it passes</param>
+void BatchCull::Test(int kernel, const BoundsSoA& bounds, const CullPlanes& planes, unsigned int start, unsigned int end, unsigned int* mask)
+{
+	if (end <= start)
+		return;
+
+	memset(mask, 0, (end - start + 31) / 32 * sizeof(unsigned int));
+	if (!IsKernelSupported(kernel))
+		kernel = GetBestKernel();
+
+#ifdef CULL_HAS_X86
+	// Padding past the last box keeps the vector loads in bounds
+	if (kernel == CULL_KERNEL_AVX2)
+		TestAVX2(bounds, planes, start, end, mask);
+	else if (kernel == CULL_KERNEL_SSE)
+		TestSSE(bounds, planes, start, end, mask);
+	else
+#endif
+		TestScalar(bounds, planes, start, end, mask);
+}
+
+/// <summary>
+/// Tests a range of boxes against several sets of planes
+/// </summary>
+/// <param name="kernel">CULL_KERNEL_ type, falls back to the best supported one</param>
+/// <param name="bounds">Boxes to test</param>
+/// <param name="views">Planes of each view</param>
+/// <param name="viewCount">Number of views</param>
+/// <param name="start">First box to test, a multiple of 32</param>
+/// <param name="end">One past the last box to test</param>
+/// <param name="masks">Already sized for every view, only words in the range are written</param>
+void BatchCull::TestViews(int kernel, const BoundsSoA& bounds, const CullPlanes* views, unsigned int viewCount, unsigned int start, unsigned int end, ViewMasks& masks)
+{
+	for (unsigned int block = start; block < end; block += CULL_VIEW_BLOCK)
+	{
+		unsigned int blockEnd = std::min(block + CULL_VIEW_BLOCK, end);
+		for (unsigned int v = 0; v < viewCount; v++)
+			Test(kernel, bounds, views[v], block, blockEnd, masks.GetView(v) + block / 32);
+	}
+}
+
+/// <summary>
+/// Finds the entries the camera may have drifted far enough to change
+/// </summary>
+/// <param name="kernel">CULL_KERNEL_ type, falls back to the best supported one</param>
+/// <param name="limits">Limits of every entry</param>
+/// <param name="turn">Camera's turn total so far</param>
+/// <param name="travel">Camera's travel total so far</param>
+/// <param name="start">First entry to check, a multiple of CULL_BATCH_SIZE</param>
+/// <param name="end">One past the last entry to check</param>
+/// <param name="mask">Bit per entry in the range, set when it is stale</param>
+void BatchCull::TestStale(int kernel, const TemporalLimits& limits, float turn, float travel, unsigned int start, unsigned int end, unsigned int* mask)
+{
+	if (end <= start)
+		return;
+
+	memset(mask, 0, (end - start + 31) / 32 * sizeof(unsigned int));
+	if (!IsKernelSupported(kernel))
+		kernel = GetBestKernel();
+
+#ifdef CULL_HAS_X86
+	if (kernel == CULL_KERNEL_AVX2)
+		TestStaleAVX2(limits, turn, travel, start, end, mask);
+	else if (kernel == CULL_KERNEL_SSE)
+		TestStaleSSE(limits, turn, travel, start, end, mask);
+	else
+#endif
+		TestStaleScalar(limits, turn, travel, start, end, mask);
+}
+
+/// <summary>
+/// Works out the answer and new limits of every stale entry in a range
+/// </summary>
+/// <param name="kernel">CULL_KERNEL_ type, falls back to the best supported one</param>
+/// <param name="bounds">Boxes of the entries</param>
+/// <param name="planes">Frustum the entries are tested against</param>
+/// <param name="camera">Eye the frustum belongs to, and how it has been moving</param>
+/// <param name="start">First entry, a multiple of 32</param>
+/// <param name="end">One past the last entry</param>
+/// <param name="stale">Bit per entry in the range, only set ones are updated</param>
+/// <param name="limits">Limits and visible bits to update</param>
+void BatchCull::UpdateLimits(int kernel, const BoundsSoA& bounds, const CullPlanes& planes, const TemporalCamera& camera, unsigned int start, unsigned int end, const unsigned int* stale, TemporalLimits& limits)
+{
+	if (end <= start)
+		return;
+	if (!IsKernelSupported(kernel))
+		kernel = GetBestKernel();
+
+#ifdef CULL_HAS_X86
+	if (kernel == CULL_KERNEL_AVX2)
+		UpdateLimitsAVX2(bounds, planes, camera, start, end, stale, limits);
+	else if (kernel == CULL_KERNEL_SSE)
+		UpdateLimitsSSE(bounds, planes, camera, start, end, stale, limits);
+	else
+#endif
+		UpdateLimitsScalar(bounds, planes, camera, start, end, stale, limits);
+}
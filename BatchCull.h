@@ -0,0 +1,129 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "Frustum.h"
+
+// Boxes the widest kernel tests per step, arrays are padded to a multiple of this
+#define CULL_BATCH_SIZE 8
+
+// Most planes one test takes, enough for a frustum and a swept frustum
+#define CULL_MAX_PLANES 16
+
+// Most views one multi-view pass handles, and how many boxes each view tests in turn,
+// small enough that a block is still in cache when the next view gets to it
+#define CULL_MAX_VIEWS 8
+#define CULL_VIEW_BLOCK 1024
+
+// Ways of running the same test, GetBestKernel() picks the fastest the CPU supports
+#define CULL_KERNEL_SCALAR 0
+#define CULL_KERNEL_SSE 1
+#define CULL_KERNEL_AVX2 2
+
+// Boxes with each component in its own array (structure of arrays),
+// so a batch of boxes loads straight into vector registers
+// - Kept in step with the registry's dense bounds, index for index
+struct BoundsSoA
+{
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	unsigned int count = 0;
+
+	void Reserve(unsigned int capacity);
+	void Resize(unsigned int newCount);
+	void Set(unsigned int index, const DirectX::BoundingBox& box);
+	void Clear();
+};
+
+// How far the camera's turn and travel totals can get before each entity's last
+// temporal culling answer might change, laid out like BoundsSoA for the same reason
+// - Kept in step with the registry's dense arrays, new entries start out stale
+// - The answer for dense index i is bit i % 32 of visible[i / 32], bits past the end are clear
+struct TemporalLimits
+{
+	std::vector<float> turn, travel;
+	std::vector<unsigned int> visible;
+	unsigned int count = 0;
+
+	void Reserve(unsigned int capacity);
+	void Resize(unsigned int newCount);
+	void Move(unsigned int from, unsigned int to);
+	void Clear();
+};
+
+// Camera temporal limits are worked out for, its turn and travel totals since the
+// last full test, how much each grew over the last frame, and how much of each
+// margin is held back to cover float rounding
+struct TemporalCamera
+{
+	DirectX::XMFLOAT3 eye = {};
+	float turn = 0.0f;
+	float travel = 0.0f;
+	float turnRate = 0.0f;
+	float travelRate = 0.0f;
+	float epsilon = 0.0f;
+};
+
+// Planes a box has to reach the inside of, all of them, to pass
+// - Adding a second frustum intersects it with the first
+struct CullPlanes
+{
+	DirectX::XMFLOAT4 planes[CULL_MAX_PLANES] = {};
+	unsigned int count = 0;
+
+	void Add(DirectX::XMFLOAT4 plane);
+	void AddFrustum(const Frustum& frustum, unsigned int planeMask = FRUSTUM_ALL_PLANES);
+	void AddSweptFrustum(const Frustum& frustum, DirectX::XMFLOAT3 sweep);
+	void AddShadowCasters(const Frustum& light, const Frustum& camera, DirectX::XMFLOAT3 shadowSweep);
+
+	// Single box version for index queries, same math as Frustum::Contains()
+	DirectX::ContainmentType Contains(const DirectX::BoundingBox& box) const;
+};
+
+// A bit per entity for each of several views, view v's bit for dense index i
+// is bit i % 32 of word i / 32 in GetView(v), the same layout BatchCull::Test() fills
+struct ViewMasks
+{
+	std::vector<unsigned int> bits;
+	unsigned int viewCount = 0;
+	unsigned int words = 0;
+
+	void Reset(unsigned int views, unsigned int count);
+	unsigned int* GetView(unsigned int view);
+	bool IsVisible(unsigned int view, unsigned int index) const;
+	unsigned int CountVisible(unsigned int view) const;
+	void GetIndices(unsigned int view, std::vector<unsigned int>& indices) const;
+};
+
+// Box against plane tests over many boxes at once, 8 per step with AVX2,
+// 4 with SSE, or one at a time as the reference the others must match
+// - Every kernel adds up each plane distance in the same order as
+//   Frustum::Intersects() and never fuses multiplies into adds, so
+//   all three agree on every box down to the last bit
+namespace BatchCull
+{
+	int GetBestKernel();
+	bool IsKernelSupported(int kernel);
+	const char* GetKernelName(int kernel);
+
+	// Bit (i - start) % 32 of mask[(i - start) / 32] is set for each box i in
+	// [start, end) that passes, covered words are overwritten
+	// - start must be a multiple of CULL_BATCH_SIZE so loads stay inside the padding,
+	//   jobs splitting one mask should start on multiples of 32 so words aren't shared
+	void Test(int kernel, const BoundsSoA& bounds, const CullPlanes& planes, unsigned int start, unsigned int end, unsigned int* mask);
+
+	// Tests the same range against several sets of planes, block by block so each
+	// box is only pulled from memory once however many views there are
+	// - start must be a multiple of 32, view v's bits go to masks.GetView(v)
+	void TestViews(int kernel, const BoundsSoA& bounds, const CullPlanes* views, unsigned int viewCount, unsigned int start, unsigned int end, ViewMasks& masks);
+
+	// Same mask layout as Test(), a bit is set for each entry whose turn or travel
+	// limit the totals have reached, so its answer has to be worked out again
+	void TestStale(int kernel, const TemporalLimits& limits, float turn, float travel, unsigned int start, unsigned int end, unsigned int* mask);
+
+	// Tests each stale entry's box against the planes, sets its visible bit, and gives it
+	// new limits that keep the camera's drift under how far the box is from changing sides
+	// - Same math as Frustum::GetMargin() and the same order in every kernel,
+	//   stale is laid out like Test()'s mask and start must be a multiple of 32
+	void UpdateLimits(int kernel, const BoundsSoA& bounds, const CullPlanes& planes, const TemporalCamera& camera, unsigned int start, unsigned int end, const unsigned int* stale, TemporalLimits& limits);
+}
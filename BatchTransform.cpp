@@ -0,0 +1,119 @@
+#include "BatchTransform.h"
+#include "BatchCull.h"
+
+// Vector kernels only exist on x86 and x64
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_HAS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#define TRANSFORM_TARGET_AVX2
+#else
+#define TRANSFORM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+using namespace DirectX;
+
+// Annonymous namespace to hold the kernels
+namespace
+{
+	const float* Row(const XMFLOAT4X4* matrices, size_t stride, unsigned int i)
+	{
+		return &((const XMFLOAT4X4*)((const unsigned char*)matrices + i * stride))->m[0][0];
+	}
+
+	float* Row(XMFLOAT4X4* matrices, size_t stride, unsigned int i)
+	{
+		return &((XMFLOAT4X4*)((unsigned char*)matrices + i * stride))->m[0][0];
+	}
+
+	void MultiplyScalar(const XMFLOAT4X4* left, size_t leftStride, const XMFLOAT4X4& right, XMFLOAT4X4* out, size_t outStride, unsigned int count)
+	{
+		const float* b = &right.m[0][0];
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float* a = Row(left, leftStride, i);
+			float* o = Row(out, outStride, i);
+			for (unsigned int r = 0; r < 4; r++)
+			{
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					o[r * 4 + c] =
+						(a[r * 4 + 0] * b[0 + c] + a[r * 4 + 1] * b[4 + c]) +
+						(a[r * 4 + 2] * b[8 + c] + a[r * 4 + 3] * b[12 + c]);
+				}
+			}
+		}
+	}
+
+#ifdef TRANSFORM_HAS_X86
+	// Each row of the result is the right matrix's rows scaled by one row of the left
+	void MultiplySSE(const XMFLOAT4X4* left, size_t leftStride, const XMFLOAT4X4& right, XMFLOAT4X4* out, size_t outStride, unsigned int count)
+	{
+		const __m128 b0 = _mm_loadu_ps(right.m[0]);
+		const __m128 b1 = _mm_loadu_ps(right.m[1]);
+		const __m128 b2 = _mm_loadu_ps(right.m[2]);
+		const __m128 b3 = _mm_loadu_ps(right.m[3]);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float* a = Row(left, leftStride, i);
+			float* o = Row(out, outStride, i);
+			for (unsigned int r = 0; r < 4; r++)
+			{
+				__m128 row = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[r * 4 + 0]), b0), _mm_mul_ps(_mm_set1_ps(a[r * 4 + 1]), b1)),
+					_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[r * 4 + 2]), b2), _mm_mul_ps(_mm_set1_ps(a[r * 4 + 3]), b3)));
+				_mm_storeu_ps(o + r * 4, row);
+			}
+		}
+	}
+
+	// Same as SSE with two rows per register, the right matrix is repeated in
+	// both halves and each half of the left rows is spread across its own half
+	TRANSFORM_TARGET_AVX2 void MultiplyAVX2(const XMFLOAT4X4* left, size_t leftStride, const XMFLOAT4X4& right, XMFLOAT4X4* out, size_t outStride, unsigned int count)
+	{
+		const __m256 b0 = _mm256_broadcast_ps((const __m128*)right.m[0]);
+		const __m256 b1 = _mm256_broadcast_ps((const __m128*)right.m[1]);
+		const __m256 b2 = _mm256_broadcast_ps((const __m128*)right.m[2]);
+		const __m256 b3 = _mm256_broadcast_ps((const __m128*)right.m[3]);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const float* a = Row(left, leftStride, i);
+			float* o = Row(out, outStride, i);
+			for (unsigned int r = 0; r < 4; r += 2)
+			{
+				__m256 rows = _mm256_loadu_ps(a + r * 4);
+				__m256 result = _mm256_add_ps(
+					_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b0), _mm256_mul_ps(_mm256_permute_ps(rows, 0x55), b1)),
+					_mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(rows, 0xAA), b2), _mm256_mul_ps(_mm256_permute_ps(rows, 0xFF), b3)));
+				_mm256_storeu_ps(o + r * 4, result);
+			}
+		}
+	}
+#endif
+}
+
+/// <summary>
+/// Multiplies a batch of matrices by the same matrix on the right
+/// </summary>
+/// <param name="kernel">CULL_KERNEL_ type, falls back to the best supported one</param>
+/// <param name="left">First matrix on the left, such as a draw item's world matrix</param>
+/// <param name="leftStride">Bytes from one left matrix to the next</param>
+/// <param name="right">Matrix every left one is multiplied by, such as a view projection</param>
+/// <param name="out">First result, must not overlap the inputs</param>
+/// <param name="outStride">Bytes from one result to the next</param>
+/// <param name="count">Number of matrices</param>
+void BatchTransform::Multiply(int kernel, const XMFLOAT4X4* left, size_t leftStride, const XMFLOAT4X4& right, XMFLOAT4X4* out, size_t outStride, unsigned int count)
+{
+	if (!BatchCull::IsKernelSupported(kernel))
+		kernel = BatchCull::GetBestKernel();
+
+#ifdef TRANSFORM_HAS_X86
+	if (kernel == CULL_KERNEL_AVX2)
+		MultiplyAVX2(left, leftStride, right, out, outStride, count);
+	else if (kernel == CULL_KERNEL_SSE)
+		MultiplySSE(left, leftStride, right, out, outStride, count);
+	else
+#endif
+		MultiplyScalar(left, leftStride, right, out, outStride, count);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <DirectXMath.h>
+
+// Every world matrix of a batch times one shared view projection, so vertex
+// shaders only do a single matrix-vector multiply per vertex
+// - Takes the same CULL_KERNEL_ kernels as culling, SSE works out
+//   one row of a result at a time and AVX2 two
+// - Every kernel adds each element's four products in the same order and
+//   never fuses multiplies into adds, so all three agree down to the last bit
+namespace BatchTransform
+{
+	// out[i] = left[i] * right for count matrices, each found a stride of bytes after
+	// the last, so they can be read from and written into larger structs in place
+	void Multiply(int kernel, const DirectX::XMFLOAT4X4* left, size_t leftStride, const DirectX::XMFLOAT4X4& right, DirectX::XMFLOAT4X4* out, size_t outStride, unsigned int count);
+}
@@ -21,6 +21,57 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix() { return projection; }
 
 std::shared_ptr<Transform> Camera::GetTransform() { return transform; }
 
+// Vertical field of view in degrees
+float Camera::GetFieldOfView() { return fovAngle; }
+
+/// <summary>
+/// Copies the current matrices and position
+/// </summary>
+/// <returns>Snapshot of this camera</returns>
+CameraData Camera::GetData()
+{
+    CameraData data = {};
+    data.view = view;
+    data.projection = projection;
+    data.position = transform->GetPosition();
+    return data;
+}
+
+/// <summary>
+/// Builds the planes of what this camera can currently see
+/// </summary>
+/// <returns>World space frustum</returns>
+Frustum Camera::GetFrustum()
+{
+    XMFLOAT4X4 viewProjection;
+    XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+    return Frustum(viewProjection);
+}
+
+/// <summary>
+/// Builds the world space ray under a point on the screen, such as the mouse
+/// </summary>
+/// <param name="screenX">Pixels from the left edge</param>
+/// <param name="screenY">Pixels from the top edge</param>
+/// <param name="screenWidth">Width of the view in pixels</param>
+/// <param name="screenHeight">Height of the view in pixels</param>
+/// <param name="origin">Where the ray leaves the near plane</param>
+/// <param name="direction">Normalized direction into the scene</param>
+void Camera::GetRay(float screenX, float screenY, float screenWidth, float screenHeight, XMFLOAT3& origin, XMFLOAT3& direction)
+{
+    // Screen to clip space, y points down the screen but up in clip space
+    float x = screenX / screenWidth * 2.0f - 1.0f;
+    float y = 1.0f - screenY / screenHeight * 2.0f;
+
+    // Back out through the near and far planes
+    XMMATRIX inverse = XMMatrixInverse(nullptr, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&projection)));
+    XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), inverse);
+    XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), inverse);
+
+    XMStoreFloat3(&origin, nearPoint);
+    XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSubtract(farPoint, nearPoint)));
+}
+
 /// <summary>
 /// Updates the view matrix with new parameters called every update
 /// </summary>
@@ -2,8 +2,18 @@
 #include "Transform.h"
 #include "Input.h"
 #include "DirectXMath.h"
+#include "Frustum.h"
 #include <memory>
 
+// Copy of what drawing needs from a camera
+// - Lets a frame be drawn while the camera itself keeps moving
+struct CameraData
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT3 position;
+};
+
 // Class to hold view projection and a transform
 class Camera
 {
@@ -15,6 +25,10 @@ public:
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
 	std::shared_ptr<Transform> GetTransform();
+	CameraData GetData();
+	float GetFieldOfView();
+	Frustum GetFrustum();
+	void GetRay(float screenX, float screenY, float screenWidth, float screenHeight, DirectX::XMFLOAT3& origin, DirectX::XMFLOAT3& direction);
 	void UpdateProjectionMatrix(float aspectRatio);
 	void Update(float dt);
 
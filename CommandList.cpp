@@ -0,0 +1,208 @@
+#include "CommandList.h"
+#include <cstring>
+
+void CommandList::Reset()
+{
+	commands.clear();
+	payloads.clear();
+}
+
+/// <summary>
+/// Clears a render target, the color goes in the data block
+/// </summary>
+void CommandList::ClearTarget(ID3D11RenderTargetView* target, const float color[4])
+{
+	RenderCommand& command = Add(RENDER_COMMAND_CLEAR_TARGET);
+	command.object = target;
+	command.a = CopyData(color, sizeof(float) * 4);
+	command.b = sizeof(float) * 4;
+}
+
+/// <summary>
+/// Clears the depth of a depth buffer, the value's bits go in a
+/// </summary>
+void CommandList::ClearDepth(ID3D11DepthStencilView* depth, float value)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_CLEAR_DEPTH);
+	command.object = depth;
+	memcpy(&command.a, &value, sizeof(float));
+}
+
+/// <summary>
+/// Binds a single render target and a depth buffer, either can be null
+/// </summary>
+void CommandList::SetTargets(ID3D11RenderTargetView* target, ID3D11DepthStencilView* depth)
+{
+	RenderTargets targets = { target, depth };
+	RenderCommand& command = Add(RENDER_COMMAND_SET_TARGETS);
+	command.a = CopyData(&targets, sizeof(RenderTargets));
+	command.b = sizeof(RenderTargets);
+}
+
+/// <summary>
+/// Sets a viewport from the top left corner over the full depth range
+/// </summary>
+void CommandList::SetViewport(float width, float height)
+{
+	RenderViewport viewport = { 0.0f, 0.0f, width, height, 0.0f, 1.0f };
+	RenderCommand& command = Add(RENDER_COMMAND_SET_VIEWPORT);
+	command.a = CopyData(&viewport, sizeof(RenderViewport));
+	command.b = sizeof(RenderViewport);
+}
+
+void CommandList::SetRasterizerState(ID3D11RasterizerState* state)
+{
+	Add(RENDER_COMMAND_SET_RASTERIZER).object = state;
+}
+
+void CommandList::SetBlendState(ID3D11BlendState* state)
+{
+	Add(RENDER_COMMAND_SET_BLEND).object = state;
+}
+
+void CommandList::SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_DEPTH_STENCIL);
+	command.object = state;
+	command.a = stencilRef;
+}
+
+void CommandList::BindShader(unsigned int stage, ISimpleShader* shader)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_BIND_SHADER);
+	command.stage = (unsigned char)stage;
+	command.object = shader;
+}
+
+void CommandList::BindTexture(unsigned int stage, unsigned int slot, ID3D11ShaderResourceView* view)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_BIND_TEXTURE);
+	command.stage = (unsigned char)stage;
+	command.slot = (unsigned short)slot;
+	command.object = view;
+}
+
+void CommandList::BindSampler(unsigned int stage, unsigned int slot, ID3D11SamplerState* sampler)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_BIND_SAMPLER);
+	command.stage = (unsigned char)stage;
+	command.slot = (unsigned short)slot;
+	command.object = sampler;
+}
+
+void CommandList::UnbindTextures(unsigned int stage)
+{
+	Add(RENDER_COMMAND_UNBIND_TEXTURES).stage = (unsigned char)stage;
+}
+
+/// <summary>
+/// Copies the whole contents of a constant buffer, a is the
+/// offset of the copy in the data block and b its size
+/// </summary>
+void CommandList::UpdateConstants(ID3D11Buffer* buffer, const void* data, unsigned int size)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_UPDATE_CONSTANTS);
+	command.object = buffer;
+	command.a = CopyData(data, size);
+	command.b = size;
+}
+
+/// <summary>
+/// Copies data to write over a dynamic buffer, laid out like UpdateConstants()
+/// </summary>
+void CommandList::WriteBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_WRITE_BUFFER);
+	command.object = buffer;
+	command.a = CopyData(data, size);
+	command.b = size;
+}
+
+void CommandList::SetTopology(unsigned int topology)
+{
+	Add(RENDER_COMMAND_SET_TOPOLOGY).a = topology;
+}
+
+void CommandList::SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_SET_VERTEX_BUFFER);
+	command.slot = (unsigned short)slot;
+	command.object = buffer;
+	command.a = stride;
+}
+
+void CommandList::SetIndexBuffer(ID3D11Buffer* buffer)
+{
+	Add(RENDER_COMMAND_SET_INDEX_BUFFER).object = buffer;
+}
+
+void CommandList::Draw(unsigned int vertexCount, unsigned int startVertex)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_DRAW);
+	command.a = vertexCount;
+	command.b = startVertex;
+}
+
+void CommandList::DrawIndexed(unsigned int indexCount)
+{
+	Add(RENDER_COMMAND_DRAW_INDEXED).a = indexCount;
+}
+
+void CommandList::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startInstance)
+{
+	RenderCommand& command = Add(RENDER_COMMAND_DRAW_INDEXED_INSTANCED);
+	command.a = indexCount;
+	command.b = instanceCount;
+	command.c = startInstance;
+}
+
+unsigned int CommandList::Count() const { return (unsigned int)commands.size(); }
+const std::vector<RenderCommand>& CommandList::GetCommands() const { return commands; }
+const void* CommandList::GetData(unsigned int offset) const { return payloads.data() + offset; }
+unsigned int CommandList::GetDataSize() const { return (unsigned int)payloads.size(); }
+
+size_t CommandList::GetMemoryUsed() const
+{
+	return commands.size() * sizeof(RenderCommand) + payloads.size();
+}
+
+void CommandList::Assign(const RenderCommand* source, unsigned int count, const void* data, unsigned int dataSize)
+{
+	commands.assign(source, source + count);
+	payloads.assign((const unsigned char*)data, (const unsigned char*)data + dataSize);
+}
+
+const char* CommandList::GetTypeName(unsigned int type)
+{
+	static const char* names[RENDER_COMMAND_COUNT] =
+	{
+		"ClearTarget", "ClearDepth", "SetTargets", "SetViewport", "SetRasterizer", "SetBlend",
+		"SetDepthStencil", "BindShader", "BindTexture", "BindSampler", "UpdateConstants",
+		"WriteBuffer", "SetVertexBuffer", "SetIndexBuffer", "Draw", "DrawIndexed",
+		"DrawIndexedInstanced", "UnbindTextures", "SetTopology"
+	};
+	return type < RENDER_COMMAND_COUNT ? names[type] : "Unknown";
+}
+
+/// <summary>
+/// Appends a zeroed command of the given type
+/// </summary>
+RenderCommand& CommandList::Add(unsigned int type)
+{
+	RenderCommand command = {};
+	command.type = (unsigned char)type;
+	commands.push_back(command);
+	return commands.back();
+}
+
+/// <summary>
+/// Copies a payload to the end of the data block, aligned for any type
+/// </summary>
+/// <returns>Offset of the copy</returns>
+unsigned int CommandList::CopyData(const void* source, unsigned int size)
+{
+	size_t offset = (payloads.size() + RENDER_COMMAND_DATA_ALIGNMENT - 1) & ~(size_t)(RENDER_COMMAND_DATA_ALIGNMENT - 1);
+	payloads.resize(offset + size);
+	memcpy(payloads.data() + offset, source, size);
+	return (unsigned int)offset;
+}
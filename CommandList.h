@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+// Nothing here talks to Direct3D, resources are only carried as
+// pointers, so recording compiles and runs on any platform
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+class ISimpleShader;
+
+// Shader stages binds can target
+#define RENDER_STAGE_VERTEX 0
+#define RENDER_STAGE_PIXEL 1
+
+// Command types, in no particular order
+#define RENDER_COMMAND_CLEAR_TARGET 0
+#define RENDER_COMMAND_CLEAR_DEPTH 1
+#define RENDER_COMMAND_SET_TARGETS 2
+#define RENDER_COMMAND_SET_VIEWPORT 3
+#define RENDER_COMMAND_SET_RASTERIZER 4
+#define RENDER_COMMAND_SET_BLEND 5
+#define RENDER_COMMAND_SET_DEPTH_STENCIL 6
+#define RENDER_COMMAND_BIND_SHADER 7
+#define RENDER_COMMAND_BIND_TEXTURE 8
+#define RENDER_COMMAND_BIND_SAMPLER 9
+#define RENDER_COMMAND_UPDATE_CONSTANTS 10
+#define RENDER_COMMAND_WRITE_BUFFER 11
+#define RENDER_COMMAND_SET_VERTEX_BUFFER 12
+#define RENDER_COMMAND_SET_INDEX_BUFFER 13
+#define RENDER_COMMAND_DRAW 14
+#define RENDER_COMMAND_DRAW_INDEXED 15
+#define RENDER_COMMAND_DRAW_INDEXED_INSTANCED 16
+#define RENDER_COMMAND_UNBIND_TEXTURES 17
+#define RENDER_COMMAND_SET_TOPOLOGY 18
+#define RENDER_COMMAND_COUNT 19
+
+// Primitive topologies, the same values as D3D11_PRIMITIVE_TOPOLOGY
+#define RENDER_TOPOLOGY_TRIANGLE_LIST 4
+
+// Payloads are placed on this alignment inside the data block
+#define RENDER_COMMAND_DATA_ALIGNMENT 16
+
+// One recorded call, 24 bytes on x64
+// - object is the resource, state or shader the command is about
+// - a, b and c are counts, strides and offsets into the data block, see each recording method
+struct RenderCommand
+{
+	unsigned char type;
+	unsigned char stage;
+	unsigned short slot;
+	unsigned int a;
+	unsigned int b;
+	unsigned int c;
+	void* object;
+};
+
+// Targets bound together, stored in the data block
+struct RenderTargets
+{
+	ID3D11RenderTargetView* target;
+	ID3D11DepthStencilView* depth;
+};
+
+// Viewport from the top left corner, stored in the data block
+struct RenderViewport
+{
+	float x;
+	float y;
+	float width;
+	float height;
+	float minDepth;
+	float maxDepth;
+};
+
+// A frame's worth of render calls recorded into one flat array, for a backend to
+// replay later, such as Direct3D 11 or a null backend that only checks and counts
+// - Anything bigger than a few numbers (constant buffer contents, clear colors,
+//   viewports) is copied into a data block that lives as long as the commands
+// - Reset() keeps both allocations, so a list reused every frame stops allocating
+class CommandList
+{
+public:
+	void Reset();
+
+	// Output merger and rasterizer, null states restore the defaults
+	void ClearTarget(ID3D11RenderTargetView* target, const float color[4]);
+	void ClearDepth(ID3D11DepthStencilView* depth, float value);
+	void SetTargets(ID3D11RenderTargetView* target, ID3D11DepthStencilView* depth);
+	void SetViewport(float width, float height);
+	void SetRasterizerState(ID3D11RasterizerState* state);
+	void SetBlendState(ID3D11BlendState* state);
+	void SetDepthStencilState(ID3D11DepthStencilState* state, unsigned int stencilRef);
+
+	// Shaders bind with their constant buffers and input layout, a null pixel shader
+	// turns the stage off, RENDER_STAGE_ values pick where resources go
+	void BindShader(unsigned int stage, ISimpleShader* shader);
+	void BindTexture(unsigned int stage, unsigned int slot, ID3D11ShaderResourceView* view);
+	void BindSampler(unsigned int stage, unsigned int slot, ID3D11SamplerState* sampler);
+
+	// Clears every texture slot of a stage that could still hold a view, so render
+	// targets read this frame can be written to the next, backends work out which
+	void UnbindTextures(unsigned int stage);
+
+	// Both copy data right away, so it can change as soon as these return
+	// - UpdateConstants() replaces a default usage buffer's contents
+	// - WriteBuffer() discards a dynamic buffer and fills it from the start
+	void UpdateConstants(ID3D11Buffer* buffer, const void* data, unsigned int size);
+	void WriteBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size);
+
+	// Input assembler, indices are always 32 bit
+	// - Deferred contexts start every list with no topology, so lists played on
+	//   one, or after one, set a RENDER_TOPOLOGY_ value before they draw
+	void SetTopology(unsigned int topology);
+	void SetVertexBuffer(unsigned int slot, ID3D11Buffer* buffer, unsigned int stride);
+	void SetIndexBuffer(ID3D11Buffer* buffer);
+
+	void Draw(unsigned int vertexCount, unsigned int startVertex);
+	void DrawIndexed(unsigned int indexCount);
+	void DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startInstance);
+
+	unsigned int Count() const;
+	const std::vector<RenderCommand>& GetCommands() const;
+
+	// Payload of a command, offset is the command's a value
+	const void* GetData(unsigned int offset) const;
+	unsigned int GetDataSize() const;
+
+	// Commands plus payloads, what a frame costs to keep around
+	size_t GetMemoryUsed() const;
+
+	// Replaces the whole list with commands whose payload offsets already point
+	// into the given data block, for lists read back from a frame capture
+	void Assign(const RenderCommand* source, unsigned int count, const void* data, unsigned int dataSize);
+
+	// Name of a RENDER_COMMAND_ type, for reports
+	static const char* GetTypeName(unsigned int type);
+
+private:
+	RenderCommand& Add(unsigned int type);
+	unsigned int CopyData(const void* data, unsigned int size);
+
+	std::vector<RenderCommand> commands;
+	std::vector<unsigned char> payloads;
+};
@@ -0,0 +1,60 @@
+#include "ConstantStaging.h"
+#include <cstring>
+
+using namespace DirectX;
+
+/// <summary>
+/// Copies a shader's buffer to fill in
+/// </summary>
+/// <param name="shader">Shader owning the buffer, only read</param>
+/// <param name="bufferName">Name of the cbuffer in the shader</param>
+/// <returns>True if the shader has the buffer</returns>
+bool ConstantStaging::Begin(ISimpleShader* shader, const char* bufferName)
+{
+	this->shader = shader;
+	buffer = shader->GetBufferInfo(bufferName);
+	if (!buffer)
+		return false;
+
+	data.assign(buffer->LocalDataBuffer, buffer->LocalDataBuffer + buffer->Size);
+	return true;
+}
+
+/// <summary>
+/// Writes a variable into the copy, same rules as ISimpleShader::SetData()
+/// </summary>
+/// <param name="name">Variable name, it must live in the buffer Begin() copied</param>
+/// <param name="data">Bytes to write</param>
+/// <param name="size">Byte count, can be less than the variable holds</param>
+/// <returns>True if it was written</returns>
+bool ConstantStaging::SetData(const char* name, const void* data, unsigned int size)
+{
+	if (!buffer)
+		return false;
+
+	const SimpleShaderVariable* variable = shader->GetVariableInfo(name);
+	if (!variable || size > variable->Size || shader->GetBufferInfo(variable->ConstantBufferIndex) != buffer)
+		return false;
+
+	memcpy(this->data.data() + variable->ByteOffset, data, size);
+	return true;
+}
+
+bool ConstantStaging::SetFloat(const char* name, float data) { return SetData(name, &data, sizeof(float)); }
+bool ConstantStaging::SetFloat2(const char* name, const XMFLOAT2& data) { return SetData(name, &data, sizeof(XMFLOAT2)); }
+bool ConstantStaging::SetFloat3(const char* name, const XMFLOAT3& data) { return SetData(name, &data, sizeof(XMFLOAT3)); }
+bool ConstantStaging::SetFloat4(const char* name, const XMFLOAT4& data) { return SetData(name, &data, sizeof(XMFLOAT4)); }
+bool ConstantStaging::SetMatrix4x4(const char* name, const XMFLOAT4X4& data) { return SetData(name, &data, sizeof(XMFLOAT4X4)); }
+
+/// <summary>
+/// Records an upload of the copy to the shader's buffer
+/// </summary>
+/// <param name="commands">List to record into</param>
+void ConstantStaging::Record(CommandList& commands)
+{
+	if (!buffer)
+		return;
+
+	commands.UpdateConstants(buffer->ConstantBuffer.Get(), data.data(), buffer->Size);
+	ISimpleShader::UploadedBytes += buffer->Size;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "SimpleShader.h"
+#include "CommandList.h"
+
+// A private copy of one of a shader's constant buffers, filled and recorded
+// without touching the shader's own copy, so any number of threads can fill
+// the same buffer at once
+// - Begin() starts from whatever the shader's own copy holds, so variables
+//   that are never set keep the values they would have had
+// - Only reads the shader, nothing may Set() on it while copies are filled
+class ConstantStaging
+{
+public:
+	// False when the shader has no buffer of that name, everything else then does nothing
+	bool Begin(ISimpleShader* shader, const char* bufferName);
+
+	// False when the variable isn't in the buffer or is smaller than the data
+	bool SetData(const char* name, const void* data, unsigned int size);
+	bool SetFloat(const char* name, float data);
+	bool SetFloat2(const char* name, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(const char* name, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(const char* name, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(const char* name, const DirectX::XMFLOAT4X4& data);
+
+	// The list takes its own copy, this one can be changed and recorded again
+	void Record(CommandList& commands);
+
+private:
+	ISimpleShader* shader = nullptr;
+	const SimpleConstantBuffer* buffer = nullptr;
+	std::vector<unsigned char> data;
+};
@@ -1,7 +1,7 @@
 #include "ShaderHeader.hlsli"
 
 // Any external data coming into the shader
-cbuffer ExternalData : register(b0)
+cbuffer PerMaterial : register(b1)
 {
     float4 colorTint;
 };
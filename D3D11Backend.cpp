@@ -0,0 +1,228 @@
+#include "D3D11Backend.h"
+#include <cstring>
+
+D3D11Backend::D3D11Backend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context)
+{
+	this->context = context;
+	filtering = true;
+	filteredCount = 0;
+}
+
+void D3D11Backend::SetFiltering(bool enabled) { filtering = enabled; }
+unsigned int D3D11Backend::GetIssuedCount() const { return cache.GetStateCount() - filteredCount; }
+unsigned int D3D11Backend::GetFilteredCount() const { return filteredCount; }
+
+void D3D11Backend::ResetCounts()
+{
+	cache.ResetCounts();
+	filteredCount = 0;
+}
+
+void D3D11Backend::ForgetState()
+{
+	cache.ForgetBindings();
+	cache.ForgetConstants();
+}
+
+/// <summary>
+/// Makes each recorded call on the context, in order
+/// </summary>
+/// <param name="commands">Recorded list, left unchanged</param>
+void D3D11Backend::Execute(const CommandList& commands)
+{
+	cache.ForgetBindings();
+
+	for (const RenderCommand& command : commands.GetCommands())
+		ExecuteCommand(commands, command);
+}
+
+/// <summary>
+/// Makes one recorded call on the context, unless the cache drops it
+/// </summary>
+/// <param name="commands">List the command belongs to, for its payload</param>
+/// <param name="command">Command to make</param>
+void D3D11Backend::ExecuteCommand(const CommandList& commands, const RenderCommand& command)
+{
+	// Slots an unbind has to cover, before the cache marks them empty
+	unsigned int textureEnd = cache.GetTextureSlotEnd(command.stage);
+	if (cache.Filter(commands, command) && filtering)
+	{
+		filteredCount++;
+		return;
+	}
+
+	switch (command.type)
+	{
+	case RENDER_COMMAND_CLEAR_TARGET:
+		context->ClearRenderTargetView((ID3D11RenderTargetView*)command.object, (const float*)commands.GetData(command.a));
+		break;
+
+	case RENDER_COMMAND_CLEAR_DEPTH:
+	{
+		float depth;
+		memcpy(&depth, &command.a, sizeof(float));
+		context->ClearDepthStencilView((ID3D11DepthStencilView*)command.object, D3D11_CLEAR_DEPTH, depth, 0);
+		break;
+	}
+
+	case RENDER_COMMAND_SET_TARGETS:
+	{
+		const RenderTargets* targets = (const RenderTargets*)commands.GetData(command.a);
+		context->OMSetRenderTargets(1, &targets->target, targets->depth);
+		break;
+	}
+
+	case RENDER_COMMAND_SET_VIEWPORT:
+	{
+		const RenderViewport* source = (const RenderViewport*)commands.GetData(command.a);
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = source->x;
+		viewport.TopLeftY = source->y;
+		viewport.Width = source->width;
+		viewport.Height = source->height;
+		viewport.MinDepth = source->minDepth;
+		viewport.MaxDepth = source->maxDepth;
+		context->RSSetViewports(1, &viewport);
+		break;
+	}
+
+	case RENDER_COMMAND_SET_RASTERIZER:
+		context->RSSetState((ID3D11RasterizerState*)command.object);
+		break;
+
+	case RENDER_COMMAND_SET_BLEND:
+		context->OMSetBlendState((ID3D11BlendState*)command.object, 0, 0xFFFFFFFF);
+		break;
+
+	case RENDER_COMMAND_SET_DEPTH_STENCIL:
+		context->OMSetDepthStencilState((ID3D11DepthStencilState*)command.object, command.a);
+		break;
+
+	case RENDER_COMMAND_BIND_SHADER:
+		if (command.stage == RENDER_STAGE_PIXEL)
+			BindPixelShader((SimplePixelShader*)command.object);
+		else
+			BindVertexShader((SimpleVertexShader*)command.object);
+		break;
+
+	case RENDER_COMMAND_BIND_TEXTURE:
+	{
+		ID3D11ShaderResourceView* view = (ID3D11ShaderResourceView*)command.object;
+		if (command.stage == RENDER_STAGE_PIXEL)
+			context->PSSetShaderResources(command.slot, 1, &view);
+		else
+			context->VSSetShaderResources(command.slot, 1, &view);
+		break;
+	}
+
+	case RENDER_COMMAND_BIND_SAMPLER:
+	{
+		ID3D11SamplerState* sampler = (ID3D11SamplerState*)command.object;
+		if (command.stage == RENDER_STAGE_PIXEL)
+			context->PSSetSamplers(command.slot, 1, &sampler);
+		else
+			context->VSSetSamplers(command.slot, 1, &sampler);
+		break;
+	}
+
+	case RENDER_COMMAND_UNBIND_TEXTURES:
+	{
+		// Without the cache every slot is cleared
+		ID3D11ShaderResourceView* nullViews[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT] = {};
+		unsigned int count = filtering ? textureEnd : D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT;
+		if (command.stage == RENDER_STAGE_PIXEL)
+			context->PSSetShaderResources(0, count, nullViews);
+		else
+			context->VSSetShaderResources(0, count, nullViews);
+		break;
+	}
+
+	case RENDER_COMMAND_UPDATE_CONSTANTS:
+		context->UpdateSubresource((ID3D11Buffer*)command.object, 0, 0, commands.GetData(command.a), 0, 0);
+		break;
+
+	case RENDER_COMMAND_WRITE_BUFFER:
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (SUCCEEDED(context->Map((ID3D11Buffer*)command.object, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		{
+			memcpy(mapped.pData, commands.GetData(command.a), command.b);
+			context->Unmap((ID3D11Buffer*)command.object, 0);
+		}
+		break;
+	}
+
+	case RENDER_COMMAND_SET_VERTEX_BUFFER:
+	{
+		ID3D11Buffer* buffer = (ID3D11Buffer*)command.object;
+		UINT stride = command.a;
+		UINT offset = 0;
+		context->IASetVertexBuffers(command.slot, 1, &buffer, &stride, &offset);
+		break;
+	}
+
+	case RENDER_COMMAND_SET_INDEX_BUFFER:
+		context->IASetIndexBuffer((ID3D11Buffer*)command.object, DXGI_FORMAT_R32_UINT, 0);
+		break;
+
+	case RENDER_COMMAND_SET_TOPOLOGY:
+		context->IASetPrimitiveTopology((D3D11_PRIMITIVE_TOPOLOGY)command.a);
+		break;
+
+	case RENDER_COMMAND_DRAW:
+		context->Draw(command.a, command.b);
+		break;
+
+	case RENDER_COMMAND_DRAW_INDEXED:
+		context->DrawIndexed(command.a, 0, 0);
+		break;
+
+	case RENDER_COMMAND_DRAW_INDEXED_INSTANCED:
+		context->DrawIndexedInstanced(command.a, command.b, 0, 0, command.c);
+		break;
+	}
+}
+
+/// <summary>
+/// Binds a vertex shader, its input layout and its constant buffers, the
+/// same as SimpleVertexShader::SetShader() does on the shader's own context
+/// </summary>
+/// <param name="shader">Shader to bind, null unbinds the stage</param>
+void D3D11Backend::BindVertexShader(SimpleVertexShader* shader)
+{
+	if (!shader)
+	{
+		context->VSSetShader(0, 0, 0);
+		return;
+	}
+
+	context->IASetInputLayout(shader->GetInputLayout().Get());
+	context->VSSetShader(shader->GetDirectXShader().Get(), 0, 0);
+	for (unsigned int i = 0; i < shader->GetBufferCount(); i++)
+	{
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(i);
+		if (buffer->Type == D3D11_CT_CBUFFER)
+			context->VSSetConstantBuffers(buffer->BindIndex, 1, buffer->ConstantBuffer.GetAddressOf());
+	}
+}
+
+/// <summary>
+/// Binds a pixel shader and its constant buffers
+/// </summary>
+/// <param name="shader">Shader to bind, null turns the stage off</param>
+void D3D11Backend::BindPixelShader(SimplePixelShader* shader)
+{
+	if (!shader)
+	{
+		context->PSSetShader(0, 0, 0);
+		return;
+	}
+
+	context->PSSetShader(shader->GetDirectXShader().Get(), 0, 0);
+	for (unsigned int i = 0; i < shader->GetBufferCount(); i++)
+	{
+		const SimpleConstantBuffer* buffer = shader->GetBufferInfo(i);
+		if (buffer->Type == D3D11_CT_CBUFFER)
+			context->PSSetConstantBuffers(buffer->BindIndex, 1, buffer->ConstantBuffer.GetAddressOf());
+	}
+}
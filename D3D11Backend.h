@@ -0,0 +1,42 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "RenderBackend.h"
+#include "RenderStateCache.h"
+#include "SimpleShader.h"
+
+// Replays command lists on a Direct3D 11 device context, one call per command
+// - Shaders are bound with their constant buffers and input layout on this
+//   backend's own context, so it can be a deferred one filled on another thread
+// - A state cache drops binds of what is already bound and uploads of bytes a
+//   constant buffer already holds, bindings are forgotten at the start of each
+//   Execute() since the UI and presenting use the context in between
+class D3D11Backend : public IRenderBackend
+{
+public:
+	D3D11Backend(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+
+	void Execute(const CommandList& commands) override;
+	void ExecuteCommand(const CommandList& commands, const RenderCommand& command) override;
+
+	// Off, every command reaches the context, counts are still kept
+	void SetFiltering(bool enabled);
+
+	// Forgets constant buffer contents as well as bindings, for when other
+	// contexts may have written to the same buffers since the last Execute()
+	void ForgetState();
+
+	// State changing calls made and dropped, added up over every Execute() since ResetCounts()
+	unsigned int GetIssuedCount() const;
+	unsigned int GetFilteredCount() const;
+	void ResetCounts();
+
+private:
+	void BindVertexShader(SimpleVertexShader* shader);
+	void BindPixelShader(SimplePixelShader* shader);
+
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+	RenderStateCache cache;
+	bool filtering;
+	unsigned int filteredCount;
+};
@@ -1,6 +1,6 @@
 #include "ShaderHeader.hlsli"
 	
-cbuffer ExternalData : register(b0)
+cbuffer PerMaterial : register(b1)
 {
     float4 colorTint;
 };
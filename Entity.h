@@ -0,0 +1,20 @@
+#pragma once
+
+// Handle used to look up an entity's components inside the registry
+// - Low 20 bits are the slot index, high 12 bits are the slot's generation
+// - Destroying an entity bumps its slot's generation, so old handles
+//   to a reused slot no longer match and are detected as stale
+typedef unsigned int Entity;
+
+#define INVALID_ENTITY 0xFFFFFFFF
+#define ENTITY_INDEX_BITS 20
+#define ENTITY_INDEX_MASK ((1u << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_GENERATION_MASK (0xFFFFFFFFu >> ENTITY_INDEX_BITS)
+#define MAX_ENTITIES (1u << ENTITY_INDEX_BITS)
+
+inline unsigned int EntityIndex(Entity entity) { return entity & ENTITY_INDEX_MASK; }
+inline unsigned int EntityGeneration(Entity entity) { return entity >> ENTITY_INDEX_BITS; }
+inline Entity MakeEntity(unsigned int index, unsigned int generation)
+{
+	return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) | (index & ENTITY_INDEX_MASK);
+}
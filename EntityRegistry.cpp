@@ -0,0 +1,838 @@
+#include "EntityRegistry.h"
+#include "Mesh.h"
+#include "JobSystem.h"
+#include "OcclusionBuffer.h"
+#include "LodChain.h"
+#include "Material.h"
+#include "RenderQueue.h"
+#include "BatchTransform.h"
+#include <algorithm>
+#include <cmath>
+#include <bit>
+#include <chrono>
+#include <atomic>
+
+using namespace DirectX;
+
+/// <summary>
+/// Creates a new entity with a default transform
+/// </summary>
+/// <param name="mesh">Mesh to draw, owned elsewhere</param>
+/// <param name="material">Material to draw with, owned elsewhere</param>
+/// <returns>Handle of the new entity, or INVALID_ENTITY when full</returns>
+Entity EntityRegistry::Create(Mesh* mesh, Material* material)
+{
+	// Reuse a freed slot if there is one, otherwise grow
+	unsigned int slot;
+	if (!freeSlots.empty())
+	{
+		slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		// Last index is never handed out so no handle equals INVALID_ENTITY
+		if (sparse.size() >= MAX_ENTITIES - 1)
+			return INVALID_ENTITY;
+
+		slot = (unsigned int)sparse.size();
+		sparse.push_back(INVALID_ENTITY);
+		generations.push_back(0);
+	}
+
+	Entity entity = MakeEntity(slot, generations[slot]);
+	sparse[slot] = (unsigned int)entities.size();
+
+	entities.push_back(entity);
+	transforms.push_back(Transform());
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	bounds.push_back(mesh->GetBounds());
+	lodChains.push_back(nullptr);
+	lods.push_back(0);
+	temporalLimits.Resize((unsigned int)entities.size());
+	boundsSoA.Resize((unsigned int)entities.size());
+	boundsSoA.Set((unsigned int)entities.size() - 1, bounds.back());
+
+	// New entities count as changed so their bounds get built
+	transforms.back().SetJournal(&journal, entity);
+	journal.Record(entity);
+
+	return entity;
+}
+
+/// <summary>
+/// Removes an entity by moving the last entity into its slot
+/// </summary>
+/// <param name="entity">Entity to remove</param>
+void EntityRegistry::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	unsigned int slot = EntityIndex(entity);
+	unsigned int index = sparse[slot];
+	unsigned int last = (unsigned int)entities.size() - 1;
+
+	// Fill the hole with the last entity so arrays stay packed
+	if (index != last)
+	{
+		entities[index] = entities[last];
+		transforms[index] = transforms[last];
+		meshes[index] = meshes[last];
+		materials[index] = materials[last];
+		bounds[index] = bounds[last];
+		lodChains[index] = lodChains[last];
+		lods[index] = lods[last];
+		temporalLimits.Move(last, index);
+		boundsSoA.Set(index, bounds[index]);
+		sparse[EntityIndex(entities[index])] = index;
+	}
+
+	entities.pop_back();
+	transforms.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	bounds.pop_back();
+	lodChains.pop_back();
+	lods.pop_back();
+	temporalLimits.Resize((unsigned int)entities.size());
+	boundsSoA.Resize((unsigned int)entities.size());
+
+	if (activeIndex)
+		activeIndex->Remove(entity);
+
+	// Any handles still pointing at this slot are now stale
+	sparse[slot] = INVALID_ENTITY;
+	generations[slot] = (generations[slot] + 1) & ENTITY_GENERATION_MASK;
+	freeSlots.push_back(slot);
+}
+
+/// <summary>
+/// Checks that the handle's slot is in use by the same generation
+/// </summary>
+/// <param name="entity">Handle to check</param>
+/// <returns>False for destroyed or stale handles</returns>
+bool EntityRegistry::IsAlive(Entity entity)
+{
+	unsigned int slot = EntityIndex(entity);
+	return slot < sparse.size() &&
+		sparse[slot] != INVALID_ENTITY &&
+		generations[slot] == EntityGeneration(entity);
+}
+
+/// <summary>
+/// Reserves room in every component array up front
+/// </summary>
+/// <param name="count">Total entities expected</param>
+void EntityRegistry::Reserve(size_t count)
+{
+	sparse.reserve(count);
+	generations.reserve(count);
+	freeSlots.reserve(count);
+	entities.reserve(count);
+	transforms.reserve(count);
+	meshes.reserve(count);
+	materials.reserve(count);
+	bounds.reserve(count);
+	lodChains.reserve(count);
+	lods.reserve(count);
+	temporalLimits.Reserve((unsigned int)count);
+	boundsSoA.Reserve((unsigned int)count);
+}
+
+void EntityRegistry::Clear()
+{
+	sparse.clear();
+	generations.clear();
+	freeSlots.clear();
+	entities.clear();
+	transforms.clear();
+	meshes.clear();
+	materials.clear();
+	bounds.clear();
+	lodChains.clear();
+	lods.clear();
+	temporalLimits.Clear();
+	visibilityValid = false;
+	boundsSoA.Clear();
+	journal.Clear();
+	if (activeIndex)
+		activeIndex->Clear();
+}
+
+// Lookups
+Transform* EntityRegistry::GetTransform(Entity entity) { return IsAlive(entity) ? &transforms[sparse[EntityIndex(entity)]] : nullptr; }
+Mesh* EntityRegistry::GetMesh(Entity entity) { return IsAlive(entity) ? meshes[sparse[EntityIndex(entity)]] : nullptr; }
+Material* EntityRegistry::GetMaterial(Entity entity) { return IsAlive(entity) ? materials[sparse[EntityIndex(entity)]] : nullptr; }
+DirectX::BoundingBox* EntityRegistry::GetBounds(Entity entity) { return IsAlive(entity) ? &bounds[sparse[EntityIndex(entity)]] : nullptr; }
+LodChain* EntityRegistry::GetLodChain(Entity entity) { return IsAlive(entity) ? lodChains[sparse[EntityIndex(entity)]] : nullptr; }
+unsigned int EntityRegistry::GetLod(Entity entity) { return IsAlive(entity) ? lods[sparse[EntityIndex(entity)]] : 0; }
+
+void EntityRegistry::SetMaterial(Entity entity, Material* material)
+{
+	if (IsAlive(entity))
+		materials[sparse[EntityIndex(entity)]] = material;
+}
+
+void EntityRegistry::SetLodChain(Entity entity, LodChain* chain)
+{
+	if (!IsAlive(entity))
+		return;
+
+	unsigned int index = sparse[EntityIndex(entity)];
+	lodChains[index] = chain;
+	lods[index] = 0;
+}
+
+// Dense arrays
+size_t EntityRegistry::Count() { return entities.size(); }
+Entity* EntityRegistry::GetEntities() { return entities.data(); }
+Transform* EntityRegistry::GetTransforms() { return transforms.data(); }
+Mesh** EntityRegistry::GetMeshes() { return meshes.data(); }
+Material** EntityRegistry::GetMaterials() { return materials.data(); }
+DirectX::BoundingBox* EntityRegistry::GetAllBounds() { return bounds.data(); }
+unsigned char* EntityRegistry::GetLods() { return lods.data(); }
+TransformJournal& EntityRegistry::GetJournal() { return journal; }
+
+/// <summary>
+/// Picks which index culling goes through, building it from scratch
+/// </summary>
+/// <param name="type">One of the SPATIAL_INDEX_ types</param>
+void EntityRegistry::SetSpatialIndex(int type)
+{
+	if (indexType == type)
+		return;
+
+	indexType = type;
+	switch (type)
+	{
+	case SPATIAL_INDEX_TREE: BuildIndex(&tree); break;
+	case SPATIAL_INDEX_GRID: BuildIndex(&grid); break;
+
+	// Starts on the tree, UpdateBounds() moves it to the grid if that suits better
+	case SPATIAL_INDEX_AUTO: BuildIndex(&tree); break;
+	default: BuildIndex(nullptr); break;
+	}
+}
+
+int EntityRegistry::GetSpatialIndexType() { return indexType; }
+ISpatialIndex* EntityRegistry::GetSpatialIndex() { return activeIndex; }
+AABBTree& EntityRegistry::GetTree() { return tree; }
+SpatialGrid& EntityRegistry::GetGrid() { return grid; }
+unsigned int EntityRegistry::GetIndexMoves() { return indexMoves; }
+float EntityRegistry::GetMovingShare() { return movingShare; }
+
+void EntityRegistry::SetCullKernel(int kernel)
+{
+	cullKernel = BatchCull::IsKernelSupported(kernel) ? kernel : BatchCull::GetBestKernel();
+}
+
+int EntityRegistry::GetCullKernel() { return cullKernel; }
+float EntityRegistry::GetCullRate() { return kernelNs > 0.0 ? (float)(kernelBounds / kernelNs) : 0.0f; }
+
+void EntityRegistry::InvalidateVisibility() { visibilityValid = false; }
+void EntityRegistry::SetRevalidateInterval(unsigned int frames) { revalidateInterval = std::max(frames, 1u); }
+unsigned int EntityRegistry::GetRevalidateInterval() { return revalidateInterval; }
+float EntityRegistry::GetTemporalSkipShare() { return temporalSkipShare; }
+
+/// <summary>
+/// Throws away the current index and fills another with every entity
+/// </summary>
+/// <param name="newIndex">Index to switch to, null for none</param>
+void EntityRegistry::BuildIndex(ISpatialIndex* newIndex)
+{
+	if (activeIndex)
+		activeIndex->Clear();
+
+	activeIndex = newIndex;
+	reinsertShare = 0.0f;
+	if (!activeIndex)
+		return;
+
+	// Entities that moved this frame get fixed up by the next UpdateBounds()
+	for (size_t i = 0; i < entities.size(); i++)
+		activeIndex->Insert(entities[i], bounds[i]);
+}
+
+/// <summary>
+/// Moves local bounds into world space, only for entities that changed
+/// </summary>
+void EntityRegistry::UpdateBounds()
+{
+	const std::vector<Entity>& changed = journal.GetChanged();
+
+	// Each entity is only listed once, so chunks never touch the same transform
+	JobSystem::ParallelFor((unsigned int)changed.size(), [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int c = start; c < end; c++)
+			{
+				// Entities can be destroyed after moving in the same frame
+				unsigned int i = SlotToDense(changed[c]);
+				if (i == INVALID_ENTITY)
+					continue;
+
+				XMFLOAT4X4 world = transforms[i].GetWorldMatrix();
+				meshes[i]->GetBounds().Transform(bounds[i], XMLoadFloat4x4(&world));
+				boundsSoA.Set(i, bounds[i]);
+			}
+		});
+
+	// Averaged so a single burst of movement doesn't flip Auto back and forth
+	float count = (float)std::max<size_t>(entities.size(), 1);
+	movingShare = movingShare * 0.9f + changed.size() / count * 0.1f;
+
+	indexMoves = 0;
+	if (!activeIndex)
+		return;
+
+	// Neither index is thread safe, but most updates are cheap: tree moves
+	// usually stay inside the leaf's fattened box, grid moves are O(1) anyway
+	for (Entity entity : changed)
+	{
+		unsigned int i = SlotToDense(entity);
+		if (i != INVALID_ENTITY && activeIndex->Update(entities[i], bounds[i]))
+			indexMoves++;
+	}
+
+	if (activeIndex == &grid)
+		grid.Tune();
+	else
+		reinsertShare = reinsertShare * 0.9f + indexMoves / count * 0.1f;
+
+	// Entities bobbing around inside their fat boxes cost the tree nothing, so
+	// it's reinserts that make the grid worth it, not how many entities move
+	if (indexType == SPATIAL_INDEX_AUTO)
+	{
+		if (activeIndex == &tree && reinsertShare > SPATIAL_AUTO_GRID_ABOVE)
+			BuildIndex(&grid);
+		else if (activeIndex == &grid && movingShare < SPATIAL_AUTO_TREE_BELOW)
+			BuildIndex(&tree);
+	}
+}
+
+/// <summary>
+/// Finds whatever entity lives in a journal entry's slot now
+/// - The journal only keeps the first handle recorded for a slot each frame,
+///   so a slot destroyed and reused in the same frame still lists the old handle
+/// </summary>
+/// <param name="entity">Handle from the journal</param>
+/// <returns>Dense index of the slot's current entity, INVALID_ENTITY if the slot is free</returns>
+unsigned int EntityRegistry::SlotToDense(Entity entity)
+{
+	unsigned int slot = EntityIndex(entity);
+	return slot < sparse.size() ? sparse[slot] : INVALID_ENTITY;
+}
+
+/// <summary>
+/// Runs a bounds test over every entity in parallel, or through the spatial index when set
+/// </summary>
+/// <param name="test">Returns DISJOINT for bounds that should be dropped, used with the index</param>
+/// <param name="planes">Same test as planes every bounds has to reach, used by the batch kernels</param>
+/// <param name="passed">Filled with the dense index of each entity that passed</param>
+template<typename BoundsTest>
+void EntityRegistry::Cull(BoundsTest test, const CullPlanes& planes, std::vector<unsigned int>& passed)
+{
+	if (activeIndex)
+	{
+		passed.clear();
+		activeIndex->Query(test, [&](Entity entity, bool inside)
+			{
+				// Index boxes are looser, so check the real bounds unless a whole region was inside
+				unsigned int i = sparse[EntityIndex(entity)];
+				if (inside || test(bounds[i]) != DISJOINT)
+					passed.push_back(i);
+			});
+		return;
+	}
+
+	unsigned int count = (unsigned int)entities.size();
+	unsigned int words = (count + 31) / 32;
+	cullMask.resize(words);
+
+	// Chunks are whole words of the mask, so no two jobs write the same one
+	auto start = std::chrono::high_resolution_clock::now();
+	JobSystem::ParallelFor(words, [&](unsigned int first, unsigned int last)
+		{
+			BatchCull::Test(cullKernel, boundsSoA, planes, first * 32, std::min(last * 32, count), &cullMask[first]);
+		});
+	auto end = std::chrono::high_resolution_clock::now();
+	kernelBounds += count;
+	kernelNs += std::chrono::duration<double, std::nano>(end - start).count();
+
+	// Compacting skips 32 culled entities at a time, and keeps the list in dense order
+	passed.clear();
+	for (unsigned int w = 0; w < words; w++)
+	{
+		for (unsigned int bits = cullMask[w]; bits != 0; bits &= bits - 1)
+			passed.push_back(w * 32 + std::countr_zero(bits));
+	}
+}
+
+/// <summary>
+/// Tests every entity's world bounds against a frustum
+/// </summary>
+/// <param name="frustum">World space frustum, usually from Camera::GetFrustum()</param>
+/// <param name="visible">Filled with the dense index of each entity that may be seen</param>
+void EntityRegistry::CullFrustum(const Frustum& frustum, std::vector<unsigned int>& visible)
+{
+	CullPlanes planes;
+	planes.AddFrustum(frustum);
+	Cull([&](const BoundingBox& box) { return frustum.Contains(box); }, planes, visible);
+}
+
+/// <summary>
+/// Tests entities against a frustum like CullFrustum(), but reuses each entity's
+/// answer from an earlier frame when nothing since could have changed it
+/// - Every plane is n.(x - eye) + k, so between frames a plane's distance to a box
+///   moves by at most |change in n| * (box's reach from the eye) + |change in eye| + |change in k|
+/// - Those changes are added up into turn and travel totals, and each tested entity gets
+///   a limit on both that keeps the drift under its margin, so it is only retested once
+///   either limit is passed or it moves, and no entity is ever wrongly culled
+/// </summary>
+/// <param name="frustum">World space frustum, usually from Camera::GetFrustum()</param>
+/// <param name="eye">Position of the camera the frustum belongs to</param>
+/// <param name="visible">Filled with the dense index of each entity that may be seen, in dense order</param>
+void EntityRegistry::CullFrustumTemporal(const Frustum& frustum, XMFLOAT3 eye, std::vector<unsigned int>& visible)
+{
+	// Records are only good if they were kept up every frame since the last full test
+	bool full = !visibilityValid || temporalFrame + 1 != frameIndex || framesSinceRevalidate + 1 >= revalidateInterval;
+	if (full)
+	{
+		temporalTurn = 0.0f;
+		temporalTravel = 0.0f;
+		framesSinceRevalidate = 0;
+	}
+	else
+	{
+		float turn = 0.0f;
+		float offset = 0.0f;
+		for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+		{
+			XMFLOAT4 before = temporalPlanes[p];
+			XMFLOAT4 after = frustum.GetPlane(p);
+			XMFLOAT3 normalChange(after.x - before.x, after.y - before.y, after.z - before.z);
+			turn = std::max(turn, sqrtf(normalChange.x * normalChange.x + normalChange.y * normalChange.y + normalChange.z * normalChange.z));
+
+			float kBefore = before.w + before.x * temporalEye.x + before.y * temporalEye.y + before.z * temporalEye.z;
+			float kAfter = after.w + after.x * eye.x + after.y * eye.y + after.z * eye.z;
+			offset = std::max(offset, fabsf(kAfter - kBefore));
+		}
+
+		XMFLOAT3 move(eye.x - temporalEye.x, eye.y - temporalEye.y, eye.z - temporalEye.z);
+		turnRate = turn;
+		travelRate = sqrtf(move.x * move.x + move.y * move.y + move.z * move.z) + offset;
+		temporalTurn += turnRate;
+		temporalTravel += travelRate;
+		framesSinceRevalidate++;
+
+		// Moved entities have new bounds, travel is never negative so they get retested
+		for (Entity entity : journal.GetChanged())
+		{
+			unsigned int i = SlotToDense(entity);
+			if (i != INVALID_ENTITY)
+				temporalLimits.travel[i] = -1.0f;
+		}
+	}
+
+	for (int p = 0; p < FRUSTUM_PLANE_COUNT; p++)
+		temporalPlanes[p] = frustum.GetPlane(p);
+	temporalEye = eye;
+	temporalFrame = frameIndex;
+	visibilityValid = true;
+
+	TemporalCamera camera;
+	camera.eye = eye;
+	camera.turn = temporalTurn;
+	camera.travel = temporalTravel;
+	camera.turnRate = turnRate;
+	camera.travelRate = travelRate;
+	camera.epsilon = TEMPORAL_EPSILON;
+	CullPlanes planes;
+	planes.AddFrustum(frustum);
+
+	// Same mask layout as Cull(), chunks are whole words so no two jobs share one
+	unsigned int count = (unsigned int)entities.size();
+	unsigned int words = (count + 31) / 32;
+	cullMask.resize(words);
+	std::atomic<unsigned int> tested = 0;
+	JobSystem::ParallelFor(words, [&](unsigned int first, unsigned int last)
+		{
+			// Limits are checked 8 at a time, and only stale entities get the full test
+			// and new limits, both through the cull kernels
+			unsigned int start = first * 32;
+			unsigned int end = std::min(last * 32, count);
+			if (full)
+			{
+				std::fill(cullMask.begin() + first, cullMask.begin() + last, ~0u);
+				if (end % 32 != 0)
+					cullMask[last - 1] = (1u << (end % 32)) - 1;
+			}
+			else
+				BatchCull::TestStale(cullKernel, temporalLimits, camera.turn, camera.travel, start, end, &cullMask[first]);
+
+			unsigned int chunkTested = 0;
+			for (unsigned int w = first; w < last; w++)
+				chunkTested += std::popcount(cullMask[w]);
+			BatchCull::UpdateLimits(cullKernel, boundsSoA, planes, camera, start, end, &cullMask[first], temporalLimits);
+
+			std::copy(temporalLimits.visible.begin() + first, temporalLimits.visible.begin() + last, cullMask.begin() + first);
+			tested += chunkTested;
+		});
+
+	visible.clear();
+	for (unsigned int w = 0; w < words; w++)
+	{
+		for (unsigned int bits = cullMask[w]; bits != 0; bits &= bits - 1)
+			visible.push_back(w * 32 + std::countr_zero(bits));
+	}
+	temporalSkipShare = count ? (float)(count - tested) / count : 0.0f;
+}
+
+/// <summary>
+/// Finds the entities whose shadows could show up on screen
+/// </summary>
+/// <param name="light">Frustum of the light's shadow map projection</param>
+/// <param name="camera">Frustum of the camera the shadows are seen from</param>
+/// <param name="shadowSweep">Light direction scaled by how far shadows can fall</param>
+/// <param name="casters">Filled with the dense index of each entity to draw into the shadow map</param>
+void EntityRegistry::CullShadowCasters(const Frustum& light, const Frustum& camera, XMFLOAT3 shadowSweep, std::vector<unsigned int>& casters)
+{
+	// Anything between the light and its volume still casts into it,
+	// so the near plane is left out to stretch the volume back to the light
+	unsigned int lightPlanes = FRUSTUM_ALL_PLANES & ~(1u << FRUSTUM_NEAR);
+
+	CullPlanes planes;
+	planes.AddShadowCasters(light, camera, shadowSweep);
+
+	Cull([&](const BoundingBox& box)
+		{
+			ContainmentType inLight = light.Contains(box, lightPlanes);
+			if (inLight == DISJOINT || !camera.IntersectsSwept(box, shadowSweep))
+				return DISJOINT;
+
+			// A box fully in view keeps everything inside it in view, so its shadow reaches too
+			return inLight == CONTAINS && camera.Contains(box) == CONTAINS ? CONTAINS : INTERSECTS;
+		}, planes, casters);
+}
+
+/// <summary>
+/// Culls several views at once, such as every camera plus the shadow casters
+/// - With an index the tree or grid is walked once for all views, and a region
+///   stops being tested for a view once it is fully inside or outside it
+/// - Without one, each block of bounds is run through every view's planes
+///   while it is still in cache, instead of streaming every entity per view
+/// </summary>
+/// <param name="views">Planes of each view, such as from CullPlanes::AddFrustum()</param>
+/// <param name="viewCount">Number of views, at most CULL_MAX_VIEWS</param>
+/// <param name="masks">Filled with a bit per dense index for each view</param>
+void EntityRegistry::CullViews(const CullPlanes* views, unsigned int viewCount, ViewMasks& masks)
+{
+	viewCount = std::min(viewCount, (unsigned int)CULL_MAX_VIEWS);
+	unsigned int count = (unsigned int)entities.size();
+	masks.Reset(viewCount, count);
+	if (viewCount == 0)
+		return;
+
+	if (activeIndex)
+	{
+		activeIndex->QueryMany(viewCount,
+			[&](unsigned int view, const BoundingBox& box) { return views[view].Contains(box); },
+			[&](Entity entity, unsigned int inside, unsigned int partial)
+			{
+				// Index boxes are looser, so views that only partly held the region check the real bounds
+				unsigned int i = sparse[EntityIndex(entity)];
+				unsigned int visible = inside;
+				for (; partial != 0; partial &= partial - 1)
+				{
+					unsigned int v = std::countr_zero(partial);
+					if (views[v].Contains(bounds[i]) != DISJOINT)
+						visible |= 1u << v;
+				}
+
+				for (; visible != 0; visible &= visible - 1)
+					masks.GetView(std::countr_zero(visible))[i / 32] |= 1u << (i % 32);
+			});
+		return;
+	}
+
+	// Chunks are whole words of every view's mask, so no two jobs write the same one
+	auto start = std::chrono::high_resolution_clock::now();
+	JobSystem::ParallelFor(masks.words, [&](unsigned int first, unsigned int last)
+		{
+			BatchCull::TestViews(cullKernel, boundsSoA, views, viewCount, first * 32, std::min(last * 32, count), masks);
+		});
+	auto end = std::chrono::high_resolution_clock::now();
+	kernelBounds += (unsigned long long)count * viewCount;
+	kernelNs += std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/// <summary>
+/// Drops entities from a list that are hidden behind the occluders
+/// </summary>
+/// <param name="occlusion">Buffer already rasterized from the same camera</param>
+/// <param name="visible">Dense indices from frustum culling, trimmed down in place</param>
+void EntityRegistry::CullOccluded(const OcclusionBuffer& occlusion, std::vector<unsigned int>& visible)
+{
+	unsigned int count = (unsigned int)visible.size();
+	cullFlags.resize(count);
+
+	// The buffer is read only by now, so every chunk can test against it
+	JobSystem::ParallelFor(count, [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int i = start; i < end; i++)
+				cullFlags[i] = occlusion.IsVisible(bounds[visible[i]]) ? 1 : 0;
+		});
+
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (cullFlags[i])
+			visible[kept++] = visible[i];
+	}
+	visible.resize(kept);
+}
+
+/// <summary>
+/// Picks each listed entity's level of detail from how large its chain's error looks on screen
+/// </summary>
+/// <param name="cameraPosition">Where the view is from</param>
+/// <param name="projectionScale">Pixels one unit covers one unit away, viewport height / (2 * tan(fov / 2))</param>
+/// <param name="settings">Pixel threshold, hysteresis and bias</param>
+/// <param name="indices">Dense indices to update, such as the visible entities</param>
+void EntityRegistry::SelectLods(XMFLOAT3 cameraPosition, float projectionScale, const LodSettings& settings, const std::vector<unsigned int>& indices)
+{
+	XMVECTOR eye = XMLoadFloat3(&cameraPosition);
+	JobSystem::ParallelFor((unsigned int)indices.size(), [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int i = start; i < end; i++)
+			{
+				unsigned int index = indices[i];
+				LodChain* chain = lodChains[index];
+				if (!chain)
+					continue;
+
+				// Nearest point of the bounds, so big entities get detail once any part is close
+				XMVECTOR center = XMLoadFloat3(&bounds[index].Center);
+				XMVECTOR extents = XMLoadFloat3(&bounds[index].Extents);
+				XMVECTOR nearest = XMVectorClamp(eye, XMVectorSubtract(center, extents), XMVectorAdd(center, extents));
+				float distance = std::max(XMVectorGetX(XMVector3Length(XMVectorSubtract(eye, nearest))), 0.0001f);
+
+				// Errors are in local units, so they grow with the entity's largest scale
+				XMFLOAT3 scale = transforms[index].GetScale();
+				float largest = std::max(fabsf(scale.x), std::max(fabsf(scale.y), fabsf(scale.z)));
+
+				lods[index] = (unsigned char)chain->Select(projectionScale * largest / distance, lods[index], settings);
+			}
+		});
+}
+
+/// <summary>
+/// Fills a render queue with a sort key for each listed entity, ready for RenderQueue::Sort()
+/// - Keys use the mesh picked by SelectLods(), so call after it
+/// - The shadow pass only binds meshes, so its keys leave shader and material out
+/// </summary>
+/// <param name="indices">Dense indices to draw, such as the result of culling</param>
+/// <param name="pass">RENDER_PASS_ value the draws belong to</param>
+/// <param name="eye">Where the view is from</param>
+/// <param name="forward">Normalized view direction, depth is measured along it</param>
+/// <param name="depthRange">Depth that maps to the far end of the key's depth bits</param>
+/// <param name="queue">Queue to fill, replacing what it held</param>
+void EntityRegistry::BuildDrawKeys(const std::vector<unsigned int>& indices, unsigned int pass, XMFLOAT3 eye, XMFLOAT3 forward, float depthRange, RenderQueue& queue)
+{
+	bool shadow = pass == RENDER_PASS_SHADOW;
+	float depthScale = 1.0f / depthRange;
+
+	queue.Resize((unsigned int)indices.size());
+	JobSystem::ParallelFor((unsigned int)indices.size(), [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int i = start; i < end; i++)
+			{
+				unsigned int index = indices[i];
+				Mesh* mesh = lodChains[index] ? lodChains[index]->GetMesh(lods[index]) : meshes[index];
+				Material* material = materials[index];
+
+				const XMFLOAT3& center = bounds[index].Center;
+				float depth = (center.x - eye.x) * forward.x + (center.y - eye.y) * forward.y + (center.z - eye.z) * forward.z;
+
+				unsigned long long key = shadow ?
+					RenderQueue::MakeKey(pass, false, 0, 0, mesh->GetSortId(), depth * depthScale) :
+					RenderQueue::MakeKey(pass, material->GetColor().w < 1.0f, material->GetShaderSortId(), material->GetSortId(), mesh->GetSortId(), depth * depthScale);
+				queue.Set(i, key, index);
+			}
+		});
+}
+
+/// <summary>
+/// Walks the dense arrays and copies out what is needed to draw each entity
+/// - No view is given, so the world view projection matrices are left alone
+/// </summary>
+/// <param name="drawList">List to fill, resized to match but keeps its capacity</param>
+void EntityRegistry::BuildDrawList(std::vector<DrawItem>& drawList)
+{
+	drawList.resize(entities.size());
+	JobSystem::ParallelFor((unsigned int)entities.size(), [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int i = start; i < end; i++)
+				FillDrawItem(i, drawList[i]);
+		});
+}
+
+/// <summary>
+/// Copies out what is needed to draw only the listed entities,
+/// along with their world view projection matrices
+/// - Each job multiplies its own items in one batch while they are still in cache,
+///   with the same kernel culling uses
+/// </summary>
+/// <param name="indices">Dense indices to draw, such as the result of culling</param>
+/// <param name="viewProjection">View projection of the pass the list is drawn in</param>
+/// <param name="shadowViewProjection">Shadow map's view projection to look shadows up with, or null to skip</param>
+/// <param name="drawList">List to fill, resized to match but keeps its capacity</param>
+void EntityRegistry::BuildDrawList(const std::vector<unsigned int>& indices, const XMFLOAT4X4& viewProjection, const XMFLOAT4X4* shadowViewProjection, std::vector<DrawItem>& drawList)
+{
+	drawList.resize(indices.size());
+	JobSystem::ParallelFor((unsigned int)indices.size(), [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int i = start; i < end; i++)
+				FillDrawItem(indices[i], drawList[i]);
+
+			DrawItem* first = drawList.data() + start;
+			BatchTransform::Multiply(cullKernel, &first->world, sizeof(DrawItem), viewProjection, &first->worldViewProjection, sizeof(DrawItem), end - start);
+			if (shadowViewProjection)
+				BatchTransform::Multiply(cullKernel, &first->world, sizeof(DrawItem), *shadowViewProjection, &first->shadowWorldViewProjection, sizeof(DrawItem), end - start);
+		});
+}
+
+void EntityRegistry::FillDrawItem(unsigned int index, DrawItem& item)
+{
+	item.entity = entities[index];
+	item.mesh = lodChains[index] ? lodChains[index]->GetMesh(lods[index]) : meshes[index];
+	item.material = materials[index];
+	item.world = transforms[index].GetWorldMatrix();
+	item.worldInvTranspose = transforms[index].GetWorldInverseTransposeMatrix();
+}
+
+/// <summary>
+/// Finds the closest entity triangle along a ray
+/// - With a scene index the mesh triangles of each entity are tested as the index
+///   reaches it, and every hit shortens the ray the index walks on with
+/// - Without one every bounds the ray enters is sorted and tested nearest first
+/// - Bounds must be up to date, so call after UpdateBounds()
+/// </summary>
+/// <param name="origin">Start of the ray in world space</param>
+/// <param name="direction">Normalized direction of the ray</param>
+/// <param name="maxDistance">Length of the ray</param>
+/// <param name="hit">Closest hit, left alone on a miss</param>
+/// <returns>True if any entity was hit</returns>
+bool EntityRegistry::RayCast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, RayHit& hit)
+{
+	Entity closest = INVALID_ENTITY;
+	unsigned int closestTriangle = 0;
+	float closestDistance = maxDistance;
+
+	auto narrowPhase = [&](unsigned int index)
+		{
+			float distance;
+			unsigned int triangle;
+			if (RayCastMesh(index, origin, direction, closestDistance, distance, triangle))
+			{
+				closest = entities[index];
+				closestTriangle = triangle;
+				closestDistance = distance;
+			}
+		};
+
+	if (activeIndex)
+	{
+		// Handing back the closest hit so far lets the index skip every box behind it,
+		// index boxes can be looser than the real bounds, so those are checked first
+		activeIndex->RayCast(origin, direction, maxDistance, [&](Entity entity, float)
+			{
+				unsigned int index = sparse[EntityIndex(entity)];
+				float boxDistance;
+				if (SpatialMath::IntersectsRay(bounds[index], origin, direction, closestDistance, boxDistance))
+					narrowPhase(index);
+				return closestDistance;
+			});
+	}
+	else
+	{
+		// Gather every entity whose bounds the ray enters
+		rayCandidates.clear();
+		for (unsigned int i = 0; i < entities.size(); i++)
+		{
+			float boxDistance;
+			if (SpatialMath::IntersectsRay(bounds[i], origin, direction, maxDistance, boxDistance))
+				rayCandidates.push_back({ boxDistance, i });
+		}
+
+		// Triangles cost far more than boxes, so test meshes nearest first,
+		// once a box starts past the closest hit nothing after it can win
+		std::sort(rayCandidates.begin(), rayCandidates.end());
+		for (const std::pair<float, unsigned int>& candidate : rayCandidates)
+		{
+			if (candidate.first > closestDistance)
+				break;
+			narrowPhase(candidate.second);
+		}
+	}
+
+	if (closest == INVALID_ENTITY)
+		return false;
+
+	hit.entity = closest;
+	hit.triangle = closestTriangle;
+	hit.distance = closestDistance;
+	XMStoreFloat3(&hit.point, XMVectorAdd(XMLoadFloat3(&origin), XMVectorScale(XMLoadFloat3(&direction), closestDistance)));
+	return true;
+}
+
+// --------------------------------------------------------
+// Tests a ray against every triangle of an entity's mesh,
+// in the mesh's local space so no vertex is transformed
+// --------------------------------------------------------
+bool EntityRegistry::RayCastMesh(unsigned int index, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float& distance, unsigned int& triangle)
+{
+	XMFLOAT4X4 world = transforms[index].GetWorldMatrix();
+	XMVECTOR determinant;
+	XMMATRIX toLocal = XMMatrixInverse(&determinant, XMLoadFloat4x4(&world));
+	if (XMVectorGetX(determinant) == 0.0f)
+		return false;
+
+	// The direction isn't renormalized, so distances along it are still world units
+	XMFLOAT3 localOrigin, localDirection;
+	XMStoreFloat3(&localOrigin, XMVector3TransformCoord(XMLoadFloat3(&origin), toLocal));
+	XMStoreFloat3(&localDirection, XMVector3TransformNormal(XMLoadFloat3(&direction), toLocal));
+
+	// World bounds of a turned mesh are loose, its own box is a cheaper miss than every triangle
+	float boxDistance;
+	if (!SpatialMath::IntersectsRay(meshes[index]->GetBounds(), localOrigin, localDirection, maxDistance, boxDistance))
+		return false;
+
+	const std::vector<XMFLOAT3>& positions = meshes[index]->GetPositions();
+	const std::vector<unsigned int>& indices = meshes[index]->GetIndices();
+	bool found = false;
+	distance = maxDistance;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		float t;
+		if (SpatialMath::IntersectsTriangle(positions[indices[i]], positions[indices[i + 1]], positions[indices[i + 2]], localOrigin, localDirection, distance, t))
+		{
+			distance = t;
+			triangle = (unsigned int)(i / 3);
+			found = true;
+		}
+	}
+	return found;
+}
+
+/// <summary>
+/// Called once every consumer of the journal has run for the frame
+/// </summary>
+void EntityRegistry::EndFrame()
+{
+	journal.Clear();
+	frameIndex++;
+	kernelBounds = 0;
+	kernelNs = 0.0;
+}
@@ -0,0 +1,213 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "Entity.h"
+#include "Transform.h"
+#include "TransformJournal.h"
+#include "Frustum.h"
+#include "AABBTree.h"
+#include "SpatialGrid.h"
+#include "BatchCull.h"
+
+// Auto moves to the grid once this share of entities gets reinserted into
+// the tree each frame, and back once fewer than this share move at all
+// - Averaged over a few frames, and far enough apart not to flip back and forth
+#define SPATIAL_AUTO_GRID_ABOVE 0.004f
+#define SPATIAL_AUTO_TREE_BELOW 0.002f
+
+// Temporal culling retests every entity at least this often, and only trusts an old
+// answer while its margin beats the camera's drift by this much, to cover float rounding
+#define TEMPORAL_REVALIDATE_FRAMES 30
+#define TEMPORAL_EPSILON 0.001f
+
+class Mesh;
+class Material;
+class OcclusionBuffer;
+class LodChain;
+class RenderQueue;
+struct LodSettings;
+
+// Everything needed to submit a single entity to the GPU
+// - Matrices are copied out so drawing never touches the registry
+struct DrawItem
+{
+	Entity entity;
+	Mesh* mesh;
+	Material* material;
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTranspose;
+
+	// World times the view's and the shadow map's view projection, worked out
+	// once per entity so vertex shaders skip two matrix multiplies per vertex
+	DirectX::XMFLOAT4X4 worldViewProjection;
+	DirectX::XMFLOAT4X4 shadowWorldViewProjection;
+};
+
+// Closest triangle a ray hit, and where
+struct RayHit
+{
+	Entity entity = INVALID_ENTITY;
+	unsigned int triangle = 0;
+	float distance = 0.0f;
+	DirectX::XMFLOAT3 point = {};
+};
+
+// Stores every renderable entity's components in tightly packed arrays
+// - A single archetype (transform, mesh, material, bounds) so every
+//   component of one entity lives at the same index in each array
+// - Destroying swaps the last entity into the hole to keep arrays dense
+// - Freed slots are reused through a free list with a bumped generation,
+//   so create/destroy are O(1) and never allocate once capacity is reached
+// - Pointers returned from lookups are only valid until the next Create/Destroy
+class EntityRegistry
+{
+public:
+	// Transforms hold a pointer to the journal, so the registry never moves
+	EntityRegistry() = default;
+	EntityRegistry(const EntityRegistry&) = delete;
+	EntityRegistry& operator=(const EntityRegistry&) = delete;
+
+	// Entity lifetime
+	Entity Create(Mesh* mesh, Material* material);
+	void Destroy(Entity entity);
+	bool IsAlive(Entity entity);
+	void Reserve(size_t count);
+	void Clear();
+
+	// Component lookups through the sparse index
+	Transform* GetTransform(Entity entity);
+	Mesh* GetMesh(Entity entity);
+	Material* GetMaterial(Entity entity);
+	DirectX::BoundingBox* GetBounds(Entity entity);
+	void SetMaterial(Entity entity, Material* material);
+
+	// Optional chain of coarser meshes, the entity's own mesh is still used for bounds
+	void SetLodChain(Entity entity, LodChain* chain);
+	LodChain* GetLodChain(Entity entity);
+	unsigned int GetLod(Entity entity);
+
+	// Dense component arrays for systems to iterate
+	size_t Count();
+	Entity* GetEntities();
+	Transform* GetTransforms();
+	Mesh** GetMeshes();
+	Material** GetMaterials();
+	DirectX::BoundingBox* GetAllBounds();
+	unsigned char* GetLods();
+
+	// Entities whose transform changed this frame
+	TransformJournal& GetJournal();
+
+	// Optional index over every entity's bounds (SPATIAL_INDEX_ types), when
+	// set culling walks the index instead of testing every entity
+	// - Auto switches between the tree and grid based on how much moves
+	void SetSpatialIndex(int type);
+	int GetSpatialIndexType();
+	ISpatialIndex* GetSpatialIndex();
+	AABBTree& GetTree();
+	SpatialGrid& GetGrid();
+	unsigned int GetIndexMoves();
+	float GetMovingShare();
+
+	// Brute force culling runs one of the BatchCull kernels (CULL_KERNEL_ types),
+	// the rate is bounds tested per nanosecond by the kernels this frame
+	void SetCullKernel(int kernel);
+	int GetCullKernel();
+	float GetCullRate();
+
+	// Temporal camera culling keeps each entity's last answer until it moves or the
+	// camera has drifted far enough to change it, invalidate on camera cuts
+	void InvalidateVisibility();
+	void SetRevalidateInterval(unsigned int frames);
+	unsigned int GetRevalidateInterval();
+	float GetTemporalSkipShare();
+
+	// Systems
+	void UpdateBounds();
+	void CullFrustum(const Frustum& frustum, std::vector<unsigned int>& visible);
+	void CullFrustumTemporal(const Frustum& frustum, DirectX::XMFLOAT3 eye, std::vector<unsigned int>& visible);
+	void CullShadowCasters(const Frustum& light, const Frustum& camera, DirectX::XMFLOAT3 shadowSweep, std::vector<unsigned int>& casters);
+	void CullViews(const CullPlanes* views, unsigned int viewCount, ViewMasks& masks);
+	void CullOccluded(const OcclusionBuffer& occlusion, std::vector<unsigned int>& visible);
+	void SelectLods(DirectX::XMFLOAT3 cameraPosition, float projectionScale, const LodSettings& settings, const std::vector<unsigned int>& indices);
+	void BuildDrawKeys(const std::vector<unsigned int>& indices, unsigned int pass, DirectX::XMFLOAT3 eye, DirectX::XMFLOAT3 forward, float depthRange, RenderQueue& queue);
+	void BuildDrawList(std::vector<DrawItem>& drawList);
+	void BuildDrawList(const std::vector<unsigned int>& indices, const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT4X4* shadowViewProjection, std::vector<DrawItem>& drawList);
+	void EndFrame();
+
+	// Picking, tests the entity's own mesh so the result doesn't change with LOD
+	bool RayCast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, RayHit& hit);
+
+private:
+	void FillDrawItem(unsigned int index, DrawItem& item);
+	unsigned int SlotToDense(Entity entity);
+	bool RayCastMesh(unsigned int index, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float& distance, unsigned int& triangle);
+	void BuildIndex(ISpatialIndex* newIndex);
+
+	// Runs the planes over every entity, or the bounds test through the index,
+	// and keeps the indices that pass, both have to agree on what passes
+	template<typename BoundsTest>
+	void Cull(BoundsTest test, const CullPlanes& planes, std::vector<unsigned int>& passed);
+
+	// Slot index to dense index, INVALID_ENTITY when the slot is free
+	std::vector<unsigned int> sparse;
+
+	// Current generation of each slot and the slots ready for reuse
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeSlots;
+
+	// Dense component arrays, all the same length
+	std::vector<Entity> entities;
+	std::vector<Transform> transforms;
+	std::vector<Mesh*> meshes;
+	std::vector<Material*> materials;
+	std::vector<DirectX::BoundingBox> bounds;
+	std::vector<LodChain*> lodChains;
+	std::vector<unsigned char> lods;
+
+	// What the last full camera test found for each entity, and how far the camera's
+	// turn and travel totals can get before that answer might no longer hold
+	TemporalLimits temporalLimits;
+
+	// Frame scoped record of moved entities
+	TransformJournal journal;
+
+	// One flag per dense index, written in parallel by culling before being compacted
+	std::vector<unsigned char> cullFlags;
+
+	// Copy of the bounds laid out for the batch kernels, and a bit per dense index they fill
+	BoundsSoA boundsSoA;
+	std::vector<unsigned int> cullMask;
+
+	// Entities whose bounds a ray entered, by distance, when picking without an index
+	std::vector<std::pair<float, unsigned int>> rayCandidates;
+	int cullKernel = BatchCull::GetBestKernel();
+	unsigned long long kernelBounds = 0;
+	double kernelNs = 0.0;
+
+	// Camera the visibility records were measured against, and how far it has
+	// turned (plane normals) and travelled (eye and plane offsets) since the last full test
+	DirectX::XMFLOAT4 temporalPlanes[FRUSTUM_PLANE_COUNT] = {};
+	DirectX::XMFLOAT3 temporalEye = {};
+	float temporalTurn = 0.0f;
+	float temporalTravel = 0.0f;
+	float turnRate = 0.0f;
+	float travelRate = 0.0f;
+	bool visibilityValid = false;
+	unsigned int frameIndex = 0;
+	unsigned int temporalFrame = 0;
+	unsigned int revalidateInterval = TEMPORAL_REVALIDATE_FRAMES;
+	unsigned int framesSinceRevalidate = 0;
+	float temporalSkipShare = 0.0f;
+
+	// Kept in sync with the journal by UpdateBounds(), activeIndex
+	// points at whichever one is in use or is null for brute force
+	AABBTree tree;
+	SpatialGrid grid;
+	ISpatialIndex* activeIndex = nullptr;
+	int indexType = SPATIAL_INDEX_NONE;
+	unsigned int indexMoves = 0;
+	float movingShare = 0.0f;
+	float reinsertShare = 0.0f;
+};
@@ -0,0 +1,314 @@
+#include "FrameCapture.h"
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+
+// Annonymous namespace for file layout helpers
+namespace
+{
+	// Bytes a command takes in a file, its fields one after another with a 32 bit id
+	const unsigned int CommandFileSize = 20;
+
+	// Fixed part at the start of a file
+	const unsigned int HeaderFileSize = 5 * sizeof(unsigned int) + sizeof(unsigned long long);
+
+	// Kind of resource a command's object is, or -1 when it doesn't carry one
+	int GetObjectKind(const RenderCommand& command)
+	{
+		switch (command.type)
+		{
+		case RENDER_COMMAND_CLEAR_TARGET: return FRAME_RESOURCE_TARGET;
+		case RENDER_COMMAND_CLEAR_DEPTH: return FRAME_RESOURCE_DEPTH;
+		case RENDER_COMMAND_SET_RASTERIZER: return FRAME_RESOURCE_RASTERIZER;
+		case RENDER_COMMAND_SET_BLEND: return FRAME_RESOURCE_BLEND;
+		case RENDER_COMMAND_SET_DEPTH_STENCIL: return FRAME_RESOURCE_DEPTH_STENCIL;
+		case RENDER_COMMAND_BIND_SHADER: return command.stage == RENDER_STAGE_PIXEL ? FRAME_RESOURCE_PIXEL_SHADER : FRAME_RESOURCE_VERTEX_SHADER;
+		case RENDER_COMMAND_BIND_TEXTURE: return FRAME_RESOURCE_TEXTURE;
+		case RENDER_COMMAND_BIND_SAMPLER: return FRAME_RESOURCE_SAMPLER;
+		case RENDER_COMMAND_UPDATE_CONSTANTS:
+		case RENDER_COMMAND_WRITE_BUFFER:
+		case RENDER_COMMAND_SET_VERTEX_BUFFER:
+		case RENDER_COMMAND_SET_INDEX_BUFFER: return FRAME_RESOURCE_BUFFER;
+		}
+		return -1;
+	}
+
+	void* IdToObject(unsigned int id)
+	{
+		return (void*)(uintptr_t)id;
+	}
+
+	unsigned int ObjectToId(void* object)
+	{
+		return (unsigned int)(uintptr_t)object;
+	}
+
+	template <typename T>
+	void Write(std::vector<unsigned char>& bytes, const T& value)
+	{
+		const unsigned char* source = (const unsigned char*)&value;
+		bytes.insert(bytes.end(), source, source + sizeof(T));
+	}
+
+	// Reads a value and moves past it, false once the file is too short
+	template <typename T>
+	bool Read(const std::vector<unsigned char>& bytes, size_t& offset, T& value)
+	{
+		if (offset + sizeof(T) > bytes.size())
+			return false;
+		memcpy(&value, bytes.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+}
+
+void FrameCapture::Clear()
+{
+	frame = 0;
+	lists.clear();
+	resourceKinds.clear();
+	resources.clear();
+	ids.clear();
+}
+
+/// <summary>
+/// Copies a list in, each pointer it holds becomes the id it was first given,
+/// including the targets inside target payloads
+/// </summary>
+/// <param name="list">Recorded list, left unchanged</param>
+void FrameCapture::Add(const CommandList& list)
+{
+	const std::vector<RenderCommand>& source = list.GetCommands();
+	scratchCommands.assign(source.begin(), source.end());
+	const unsigned char* data = (const unsigned char*)list.GetData(0);
+	scratchData.assign(data, data + list.GetDataSize());
+
+	for (RenderCommand& command : scratchCommands)
+	{
+		int kind = GetObjectKind(command);
+		command.object = kind >= 0 ? IdToObject(GetId(command.object, kind)) : nullptr;
+
+		if (command.type == RENDER_COMMAND_SET_TARGETS && command.a + sizeof(RenderTargets) <= scratchData.size())
+		{
+			RenderTargets* targets = (RenderTargets*)(scratchData.data() + command.a);
+			targets->target = (ID3D11RenderTargetView*)IdToObject(GetId(targets->target, FRAME_RESOURCE_TARGET));
+			targets->depth = (ID3D11DepthStencilView*)IdToObject(GetId(targets->depth, FRAME_RESOURCE_DEPTH));
+		}
+	}
+
+	lists.emplace_back();
+	lists.back().Assign(scratchCommands.data(), (unsigned int)scratchCommands.size(), scratchData.data(), (unsigned int)scratchData.size());
+}
+
+/// <summary>
+/// Writes the capture to a file in one go
+/// </summary>
+/// <param name="path">File to create or replace</param>
+/// <returns>False if the file couldn't be written</returns>
+bool FrameCapture::Save(const std::string& path) const
+{
+	std::vector<unsigned char> bytes;
+	bytes.reserve(GetFileSize());
+
+	Write(bytes, (unsigned int)FRAME_CAPTURE_MAGIC);
+	Write(bytes, (unsigned int)FRAME_CAPTURE_VERSION);
+	Write(bytes, (unsigned int)sizeof(void*));
+	Write(bytes, (unsigned int)lists.size());
+	Write(bytes, (unsigned int)resourceKinds.size());
+	Write(bytes, frame);
+	bytes.insert(bytes.end(), resourceKinds.begin(), resourceKinds.end());
+
+	for (const CommandList& list : lists)
+	{
+		Write(bytes, list.Count());
+		Write(bytes, list.GetDataSize());
+		for (const RenderCommand& command : list.GetCommands())
+		{
+			Write(bytes, command.type);
+			Write(bytes, command.stage);
+			Write(bytes, command.slot);
+			Write(bytes, command.a);
+			Write(bytes, command.b);
+			Write(bytes, command.c);
+			Write(bytes, ObjectToId(command.object));
+		}
+		const unsigned char* data = (const unsigned char*)list.GetData(0);
+		bytes.insert(bytes.end(), data, data + list.GetDataSize());
+	}
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return false;
+	file.write((const char*)bytes.data(), bytes.size());
+	return file.good();
+}
+
+/// <summary>
+/// Reads a capture back, objects are left as ids since the resources belong to another run
+/// </summary>
+/// <param name="path">File written by Save()</param>
+/// <returns>False if the file is missing, from another version or pointer size, or cut short</returns>
+bool FrameCapture::Load(const std::string& path)
+{
+	Clear();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open())
+		return false;
+	std::vector<unsigned char> bytes((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)bytes.data(), bytes.size());
+	if (!file.good())
+		return false;
+
+	size_t offset = 0;
+	unsigned int magic = 0, version = 0, pointerSize = 0, listCount = 0, resourceCount = 0;
+	if (!Read(bytes, offset, magic) || !Read(bytes, offset, version) || !Read(bytes, offset, pointerSize) ||
+		!Read(bytes, offset, listCount) || !Read(bytes, offset, resourceCount) || !Read(bytes, offset, frame))
+		return false;
+	if (magic != FRAME_CAPTURE_MAGIC || version != FRAME_CAPTURE_VERSION || pointerSize != sizeof(void*))
+		return false;
+	if (offset + resourceCount > bytes.size())
+		return false;
+	resourceKinds.assign(bytes.begin() + offset, bytes.begin() + offset + resourceCount);
+	offset += resourceCount;
+
+	for (unsigned int i = 0; i < listCount; i++)
+	{
+		unsigned int commandCount = 0, dataSize = 0;
+		if (!Read(bytes, offset, commandCount) || !Read(bytes, offset, dataSize))
+			return false;
+		if (offset + (size_t)commandCount * CommandFileSize + dataSize > bytes.size())
+			return false;
+
+		scratchCommands.resize(commandCount);
+		for (RenderCommand& command : scratchCommands)
+		{
+			unsigned int id = 0;
+			Read(bytes, offset, command.type);
+			Read(bytes, offset, command.stage);
+			Read(bytes, offset, command.slot);
+			Read(bytes, offset, command.a);
+			Read(bytes, offset, command.b);
+			Read(bytes, offset, command.c);
+			Read(bytes, offset, id);
+			command.object = IdToObject(id);
+		}
+
+		lists.emplace_back();
+		lists.back().Assign(scratchCommands.data(), commandCount, bytes.data() + offset, dataSize);
+		offset += dataSize;
+	}
+	return true;
+}
+
+/// <summary>
+/// Replays the frame, timing only the backend's work on each command
+/// - The clock is read twice per command, so very cheap commands
+///   mostly measure the clock, compare types against each other
+/// </summary>
+/// <param name="backend">Backend to play the lists on, its state carries over between lists</param>
+/// <param name="liveResources">Swap ids back for objects, needs HasLiveResources()</param>
+/// <param name="timings">Filled from scratch</param>
+void FrameCapture::Replay(IRenderBackend& backend, bool liveResources, FrameReplayTimings& timings) const
+{
+	timings = FrameReplayTimings();
+	timings.commandMicroseconds.reserve(GetCommandCount());
+
+	CommandList resolved;
+	for (const CommandList& captured : lists)
+	{
+		const CommandList* list = &captured;
+		if (liveResources && HasLiveResources())
+		{
+			ResolveList(captured, resolved);
+			list = &resolved;
+		}
+
+		for (const RenderCommand& command : list->GetCommands())
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			backend.ExecuteCommand(*list, command);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			float microseconds = std::chrono::duration<float, std::micro>(end - start).count();
+			timings.commandMicroseconds.push_back(microseconds);
+			timings.totalMs += microseconds / 1000.0;
+			if (command.type < RENDER_COMMAND_COUNT)
+			{
+				timings.typeCounts[command.type]++;
+				timings.typeMs[command.type] += microseconds / 1000.0;
+			}
+		}
+	}
+}
+
+bool FrameCapture::HasLiveResources() const { return !resources.empty() || resourceKinds.empty(); }
+unsigned int FrameCapture::GetListCount() const { return (unsigned int)lists.size(); }
+const CommandList& FrameCapture::GetList(unsigned int index) const { return lists[index]; }
+unsigned int FrameCapture::GetResourceCount() const { return (unsigned int)resourceKinds.size(); }
+
+unsigned int FrameCapture::GetResourceKind(unsigned int id) const
+{
+	return id > 0 && id <= resourceKinds.size() ? resourceKinds[id - 1] : FRAME_RESOURCE_KIND_COUNT;
+}
+
+unsigned int FrameCapture::GetCommandCount() const
+{
+	unsigned int count = 0;
+	for (const CommandList& list : lists)
+		count += list.Count();
+	return count;
+}
+
+size_t FrameCapture::GetFileSize() const
+{
+	size_t size = HeaderFileSize + resourceKinds.size();
+	for (const CommandList& list : lists)
+		size += 2 * sizeof(unsigned int) + (size_t)list.Count() * CommandFileSize + list.GetDataSize();
+	return size;
+}
+
+/// <summary>
+/// Finds the id of an object, giving it the next one the first time it is seen
+/// </summary>
+/// <returns>0 for null</returns>
+unsigned int FrameCapture::GetId(void* object, unsigned int kind)
+{
+	if (!object)
+		return 0;
+
+	auto found = ids.find(object);
+	if (found != ids.end())
+		return found->second;
+
+	resources.push_back(object);
+	resourceKinds.push_back((unsigned char)kind);
+	unsigned int id = (unsigned int)resources.size();
+	ids[object] = id;
+	return id;
+}
+
+/// <summary>
+/// Copies a captured list with every id turned back into its object
+/// </summary>
+void FrameCapture::ResolveList(const CommandList& list, CommandList& resolved) const
+{
+	std::vector<RenderCommand> commands(list.GetCommands());
+	const unsigned char* source = (const unsigned char*)list.GetData(0);
+	std::vector<unsigned char> data(source, source + list.GetDataSize());
+
+	auto toObject = [&](void* id) { return id ? resources[ObjectToId(id) - 1] : nullptr; };
+	for (RenderCommand& command : commands)
+	{
+		command.object = toObject(command.object);
+		if (command.type == RENDER_COMMAND_SET_TARGETS && command.a + sizeof(RenderTargets) <= data.size())
+		{
+			RenderTargets* targets = (RenderTargets*)(data.data() + command.a);
+			targets->target = (ID3D11RenderTargetView*)toObject(targets->target);
+			targets->depth = (ID3D11DepthStencilView*)toObject(targets->depth);
+		}
+	}
+	resolved.Assign(commands.data(), (unsigned int)commands.size(), data.data(), (unsigned int)data.size());
+}
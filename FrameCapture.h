@@ -0,0 +1,94 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "CommandList.h"
+#include "RenderBackend.h"
+
+// First bytes of every capture file, "FCAP", and the layout version after them
+#define FRAME_CAPTURE_MAGIC 0x50414346
+#define FRAME_CAPTURE_VERSION 2
+
+// What each resource id stood for, going by the commands that used it
+#define FRAME_RESOURCE_TARGET 0
+#define FRAME_RESOURCE_DEPTH 1
+#define FRAME_RESOURCE_RASTERIZER 2
+#define FRAME_RESOURCE_BLEND 3
+#define FRAME_RESOURCE_DEPTH_STENCIL 4
+#define FRAME_RESOURCE_VERTEX_SHADER 5
+#define FRAME_RESOURCE_PIXEL_SHADER 6
+#define FRAME_RESOURCE_TEXTURE 7
+#define FRAME_RESOURCE_SAMPLER 8
+#define FRAME_RESOURCE_BUFFER 9
+#define FRAME_RESOURCE_KIND_COUNT 10
+
+// CPU time a replay spent in the backend, per command and per command type
+struct FrameReplayTimings
+{
+	double totalMs = 0.0;
+	unsigned int typeCounts[RENDER_COMMAND_COUNT] = {};
+	double typeMs[RENDER_COMMAND_COUNT] = {};
+
+	// One entry per command, lists one after another in the order they were replayed
+	std::vector<float> commandMicroseconds;
+};
+
+// Every command list of one frame, kept past the frame and saved to a compact file,
+// so a slow frame can be played back later on any backend and looked at offline
+// - Resource, state and shader pointers are swapped for ids numbered in the order
+//   they were first used, 0 stays null, so the same frame always gives the same file
+// - Draws, state, constant buffer contents and dynamic buffer writes are all kept,
+//   resources themselves aren't, only which id each command used and what kind it is
+// - File: header, a byte per resource for its kind, then for each list its command
+//   and data block sizes, 20 bytes per command and the data block as recorded
+// - Target pointers inside payloads are swapped for ids too, so files are only read
+//   back by builds with the same pointer size, which the header records
+class FrameCapture
+{
+public:
+	void Clear();
+
+	// Copies a list in as the next one executed, holding ids instead of pointers
+	void Add(const CommandList& list);
+
+	bool Save(const std::string& path) const;
+	bool Load(const std::string& path);
+
+	// Plays every list in order through a backend, one ExecuteCommand() at a time
+	// - With live resources the ids go back to the objects they stood for, so a GPU
+	//   backend can replay a frame captured earlier in the same run, if those objects
+	//   still exist, otherwise commands carry the ids, fine for the null backend
+	void Replay(IRenderBackend& backend, bool liveResources, FrameReplayTimings& timings) const;
+
+	// Captured in this run rather than loaded, so ids can be turned back into objects
+	bool HasLiveResources() const;
+
+	unsigned long long frame = 0;
+
+	unsigned int GetListCount() const;
+	const CommandList& GetList(unsigned int index) const;
+	unsigned int GetCommandCount() const;
+
+	// Ids run from 1 to GetResourceCount()
+	unsigned int GetResourceCount() const;
+	unsigned int GetResourceKind(unsigned int id) const;
+
+	// Bytes the capture takes on disk
+	size_t GetFileSize() const;
+
+private:
+	unsigned int GetId(void* object, unsigned int kind);
+	void ResolveList(const CommandList& list, CommandList& resolved) const;
+
+	// Lists in execution order, objects are ids
+	std::vector<CommandList> lists;
+
+	// Kind of id i + 1, and the object it was, left empty by Load()
+	std::vector<unsigned char> resourceKinds;
+	std::vector<void*> resources;
+	std::unordered_map<void*, unsigned int> ids;
+
+	// Scratch for Add(), a list is copied here before its pointers are swapped
+	std::vector<RenderCommand> scratchCommands;
+	std::vector<unsigned char> scratchData;
+};
@@ -0,0 +1,146 @@
+#include "FramePipeline.h"
+#include <chrono>
+
+FramePipeline::~FramePipeline()
+{
+	SetThreaded(false);
+}
+
+/// <summary>
+/// Sets the function that draws a packet
+/// </summary>
+/// <param name="render">Called once per submitted packet</param>
+void FramePipeline::SetRenderer(std::function<void(RenderPacket&)> render)
+{
+	Flush();
+	this->render = render;
+}
+
+/// <summary>
+/// Moves drawing onto its own thread or back onto the main thread
+/// </summary>
+/// <param name="threaded">Whether a render thread should draw packets</param>
+void FramePipeline::SetThreaded(bool threaded)
+{
+	if (this->threaded == threaded)
+		return;
+
+	// Nothing can be in flight while switching
+	Flush();
+	this->threaded = threaded;
+
+	if (threaded)
+	{
+		running = true;
+		renderThread = std::thread(&FramePipeline::RenderLoop, this);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			running = false;
+		}
+		signal.notify_all();
+		renderThread.join();
+	}
+}
+
+bool FramePipeline::IsThreaded() { return threaded; }
+
+/// <summary>
+/// Hands out the next packet to fill, waiting on the render thread if
+/// it is still drawing the frame that last used it
+/// </summary>
+/// <returns>Packet to fill for this frame</returns>
+RenderPacket& FramePipeline::BeginFrame()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		signal.wait(guard, [&]() { return submitted - completed < RENDER_PACKET_COUNT; });
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	waitMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+	// Only the main thread changes the submitted count, so no lock is needed to read it
+	RenderPacket& packet = packets[submitted % RENDER_PACKET_COUNT];
+	packet.frame = submitted;
+	return packet;
+}
+
+/// <summary>
+/// Publishes the packet from BeginFrame() to be drawn
+/// </summary>
+void FramePipeline::Submit()
+{
+	if (!threaded)
+	{
+		// Draw right here, the fence never has anything to wait on
+		RenderPacket& packet = packets[submitted % RENDER_PACKET_COUNT];
+		auto start = std::chrono::high_resolution_clock::now();
+		render(packet);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		std::lock_guard<std::mutex> guard(lock);
+		renderMs = std::chrono::duration<float, std::milli>(end - start).count();
+		submitted++;
+		completed++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		submitted++;
+	}
+	signal.notify_all();
+}
+
+/// <summary>
+/// Waits until the render thread has drawn everything submitted, after
+/// which the main thread is free to use the graphics context
+/// </summary>
+void FramePipeline::Flush()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	signal.wait(guard, [&]() { return completed == submitted; });
+}
+
+float FramePipeline::GetRenderMs()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return renderMs;
+}
+
+float FramePipeline::GetWaitMs() { return waitMs; }
+
+/// <summary>
+/// Render thread body, draws packets in order until stopped
+/// </summary>
+void FramePipeline::RenderLoop()
+{
+	while (true)
+	{
+		RenderPacket* packet = nullptr;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			signal.wait(guard, [&]() { return completed < submitted || !running; });
+
+			// Stopping only happens after a flush, so nothing is left to draw
+			if (completed == submitted)
+				return;
+
+			packet = &packets[completed % RENDER_PACKET_COUNT];
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		render(*packet);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			renderMs = std::chrono::duration<float, std::milli>(end - start).count();
+			completed++;
+		}
+		signal.notify_all();
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "RenderPacket.h"
+
+#define RENDER_PACKET_COUNT 2
+
+// Two stage frame pipeline, the main thread updates frame N+1 while
+// a render thread draws frame N
+// - Packets are double buffered, the main thread fills one while the
+//   render thread reads the other
+// - Submitted and completed frame counts act as the fence between the
+//   stages, a packet is only handed out again once it has been drawn
+// - When not threaded, submitting a packet draws it right away
+class FramePipeline
+{
+public:
+	FramePipeline() = default;
+	~FramePipeline();
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+
+	// What to call for each packet, on whichever thread draws it
+	void SetRenderer(std::function<void(RenderPacket&)> render);
+
+	// Starts or stops the render thread, finishing frames in flight first
+	void SetThreaded(bool threaded);
+	bool IsThreaded();
+
+	// Main thread side, waits until a packet is free to be filled
+	RenderPacket& BeginFrame();
+	void Submit();
+
+	// Blocks until every submitted packet has been drawn
+	void Flush();
+
+	// Timings of the most recent frame in milliseconds
+	float GetRenderMs();
+	float GetWaitMs();
+
+private:
+	void RenderLoop();
+
+	RenderPacket packets[RENDER_PACKET_COUNT];
+	std::function<void(RenderPacket&)> render;
+
+	std::thread renderThread;
+	bool threaded = false;
+	bool running = false;
+
+	// Guards the counters and timings, signalled whenever either side moves on
+	std::mutex lock;
+	std::condition_variable signal;
+	unsigned long long submitted = 0;
+	unsigned long long completed = 0;
+
+	float renderMs = 0.0f;
+	float waitMs = 0.0f;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "LodChain.h"
+#include "BatchCull.h"
+
+// Counters and timings gathered over a single frame
+// - Reset at the start of each frame and shown in the UI
+struct FrameStats
+{
+	// Entities
+	unsigned int entityCount;
+	unsigned int changedTransforms;
+	unsigned int drawCount;
+	unsigned int visibleCount;
+	unsigned int culledCount;
+	unsigned int casterCount;
+	unsigned int casterCulledCount;
+	unsigned int occludedCount;
+	unsigned int occluderTriangles;
+	unsigned int indexMoves;
+	unsigned int treeHeight;
+	unsigned int gridCells;
+	unsigned int triangleCount;
+	unsigned int lodCounts[LOD_MAX_LEVELS];
+	unsigned int viewCount;
+	unsigned int viewVisible[CULL_MAX_VIEWS];
+	unsigned int stateChangesUnsorted;
+	unsigned int stateChangesSorted;
+	unsigned int transparentCount;
+	unsigned int uploadedBytes;
+	unsigned int drawCalls;
+	unsigned int shadowDrawCalls;
+	unsigned int commandCount;
+	unsigned int commandBytes;
+	unsigned int nullDraws;
+	unsigned int nullErrors;
+	const char* nullFirstError;
+	unsigned int stateIssued;
+	unsigned int stateFiltered;
+	unsigned int recordedSlices;
+	unsigned int prepassDrawCalls;
+	unsigned long long capturedFrame;
+	unsigned int captureCommands;
+	unsigned int captureBytes;
+	bool captureSaved;
+	unsigned int staticMembers;
+	unsigned int staticChunks;
+	unsigned int staticDraws;
+	unsigned int staticMerges;
+	size_t staticBytes;
+	unsigned int spawned;
+	unsigned int despawned;
+
+	// CPU timings in milliseconds
+	float churnMs;
+	float boundsMs;
+	float staticMs;
+	float cullMs;
+	float occlusionMs;
+	float lodMs;
+	float gridCellSize;
+	float cullRate;
+	float temporalSkipShare;
+	float overdraw;
+	float sortMs;
+	float drawListMs;
+
+	// Pipeline timings in milliseconds
+	float updateMs;
+	float renderMs;
+	float fenceWaitMs;
+	float recordMs;
+	float executeMs;
+	float captureReplayMs;
+};
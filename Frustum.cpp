@@ -0,0 +1,155 @@
+#include "Frustum.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+using namespace DirectX;
+
+/// <summary>
+/// Extracts the planes from a combined view and projection matrix
+/// </summary>
+/// <param name="viewProjection">View matrix multiplied by a D3D style projection (depth 0 to 1)</param>
+Frustum::Frustum(XMFLOAT4X4 viewProjection)
+{
+	const XMFLOAT4X4& m = viewProjection;
+
+	// DirectXMath uses row vectors, so clip space is v * M and
+	// each plane is a sum of the matrix's columns
+	planes[FRUSTUM_LEFT] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+	planes[FRUSTUM_RIGHT] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+	planes[FRUSTUM_BOTTOM] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+	planes[FRUSTUM_TOP] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+	planes[FRUSTUM_NEAR] = XMFLOAT4(m._13, m._23, m._33, m._43);
+	planes[FRUSTUM_FAR] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+
+	// Normalize so plane distances are in world units
+	for (XMFLOAT4& p : planes)
+	{
+		float length = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (length > 0.0f)
+		{
+			p.x /= length;
+			p.y /= length;
+			p.z /= length;
+			p.w /= length;
+		}
+	}
+}
+
+XMFLOAT4 Frustum::GetPlane(int plane) const { return planes[plane]; }
+
+bool Frustum::Contains(XMFLOAT3 point) const
+{
+	for (const XMFLOAT4& p : planes)
+	{
+		if (p.x * point.x + p.y * point.y + p.z * point.z + p.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Checks if any part of a box could be inside the frustum
+/// </summary>
+/// <param name="box">World space box</param>
+/// <param name="planeMask">Bit per plane to test, leaving one out makes the frustum endless that way</param>
+/// <returns>False only when the box is entirely outside one of the planes</returns>
+bool Frustum::Intersects(const BoundingBox& box, unsigned int planeMask) const
+{
+	for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+	{
+		if (!(planeMask & (1u << i)))
+			continue;
+
+		// Distance of the corner furthest along the plane's normal
+		const XMFLOAT4& p = planes[i];
+		float distance =
+			p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w +
+			fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+
+		if (distance < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Classifies a box as outside, partly inside or fully inside the frustum
+/// </summary>
+/// <param name="box">World space box</param>
+/// <param name="planeMask">Bit per plane to test</param>
+/// <returns>DISJOINT, INTERSECTS or CONTAINS</returns>
+ContainmentType Frustum::Contains(const BoundingBox& box, unsigned int planeMask) const
+{
+	ContainmentType result = CONTAINS;
+	for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+	{
+		if (!(planeMask & (1u << i)))
+			continue;
+
+		const XMFLOAT4& p = planes[i];
+		float center = p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w;
+		float radius = fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+
+		// Furthest corner behind the plane means the whole box is
+		if (center + radius < 0.0f)
+			return DISJOINT;
+
+		// Nearest corner behind it means the box straddles the plane
+		if (center - radius < 0.0f)
+			result = INTERSECTS;
+	}
+	return result;
+}
+
+/// <summary>
+/// Tests a box like Intersects() and measures how settled that answer is
+/// - A visible box stays visible until some plane moves inwards past its furthest corner,
+///   a culled box stays culled until the plane it is furthest behind moves out past it
+/// </summary>
+/// <param name="box">World space box</param>
+/// <param name="visible">Set to the result Intersects() would give</param>
+/// <returns>Distance any plane can shift without changing the answer, never negative</returns>
+float Frustum::GetMargin(const BoundingBox& box, bool& visible) const
+{
+	float inside = FLT_MAX;
+	float outside = 0.0f;
+	for (const XMFLOAT4& p : planes)
+	{
+		// Added up in the same order as Intersects() so both agree on boxes right at a plane
+		float distance =
+			p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w +
+			fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+
+		// Kept branch free, only planes the box is behind can push outside above zero
+		inside = std::min(inside, distance);
+		outside = std::max(outside, -distance);
+	}
+
+	visible = outside == 0.0f;
+	return visible ? inside : outside;
+}
+
+/// <summary>
+/// Checks if a box moved along a vector could touch the frustum at any point
+/// </summary>
+/// <param name="box">World space box at the start of the sweep</param>
+/// <param name="sweep">Direction and distance the box travels</param>
+/// <returns>False only when the whole swept volume is outside one of the planes</returns>
+bool Frustum::IntersectsSwept(const BoundingBox& box, XMFLOAT3 sweep) const
+{
+	for (const XMFLOAT4& p : planes)
+	{
+		float start =
+			p.x * box.Center.x + p.y * box.Center.y + p.z * box.Center.z + p.w +
+			fabsf(p.x) * box.Extents.x + fabsf(p.y) * box.Extents.y + fabsf(p.z) * box.Extents.z;
+
+		// The swept volume is the hull of the start and end boxes,
+		// so it is only outside when both ends are
+		float end = start + p.x * sweep.x + p.y * sweep.y + p.z * sweep.z;
+
+		if (start < 0.0f && end < 0.0f)
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+#define FRUSTUM_LEFT 0
+#define FRUSTUM_RIGHT 1
+#define FRUSTUM_BOTTOM 2
+#define FRUSTUM_TOP 3
+#define FRUSTUM_NEAR 4
+#define FRUSTUM_FAR 5
+#define FRUSTUM_PLANE_COUNT 6
+#define FRUSTUM_ALL_PLANES ((1u << FRUSTUM_PLANE_COUNT) - 1)
+
+// Six inward facing planes (a, b, c, d), a point is inside when ax + by + cz + d >= 0
+// - Pulled straight out of a view * projection matrix (Gribb/Hartmann),
+//   so it matches whatever camera or light built the matrix
+// - Plain math with no device, so it can be used and checked anywhere
+class Frustum
+{
+public:
+	Frustum() = default;
+	Frustum(DirectX::XMFLOAT4X4 viewProjection);
+
+	// Getters
+	DirectX::XMFLOAT4 GetPlane(int plane) const;
+
+	// Tests, boxes are only rejected when fully behind one plane,
+	// so a few boxes near the corners are kept when they needn't be
+	bool Contains(DirectX::XMFLOAT3 point) const;
+	bool Intersects(const DirectX::BoundingBox& box, unsigned int planeMask = FRUSTUM_ALL_PLANES) const;
+
+	// Same test, but also tells apart boxes that are completely inside
+	DirectX::ContainmentType Contains(const DirectX::BoundingBox& box, unsigned int planeMask = FRUSTUM_ALL_PLANES) const;
+
+	// Same answer as Intersects(), plus how far the planes would have to move to change it
+	float GetMargin(const DirectX::BoundingBox& box, bool& visible) const;
+
+	// Tests everything the box passes through while moving along sweep,
+	// such as the shadow it throws away from a directional light
+	bool IntersectsSwept(const DirectX::BoundingBox& box, DirectX::XMFLOAT3 sweep) const;
+
+private:
+	DirectX::XMFLOAT4 planes[FRUSTUM_PLANE_COUNT] = {};
+};
@@ -12,9 +12,13 @@
 #include "WICTextureLoader.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "JobSystem.h"
 
 #include <DirectXMath.h>
 #include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
 
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
@@ -28,6 +32,22 @@
 // For the DirectX Math library
 using namespace DirectX;
 
+// Rows of stress entities between each occluding wall
+#define STRESS_WALL_SPACING 10
+
+// Room each static prop gets when scattered, and how big they are
+#define STRESS_PROP_SPACING 2.0f
+#define STRESS_PROP_SCALE 0.4f
+
+// Furthest a click can pick, matches the cameras' far plane
+#define PICK_DISTANCE 1000.0f
+
+// Depth the main pass sort keys spread over, also the cameras' far plane
+#define DRAW_DEPTH_RANGE 1000.0f
+
+// Name a captured frame is saved under, next to the executable
+#define FRAME_CAPTURE_FILE "frame_%llu.fcap"
+
 // --------------------------------------------------------
 // Called once per program, after the window and graphics API
 // are initialized but before the game loop begins
@@ -57,6 +77,9 @@ void Game::Initialize()
 		// geometric primitives (points, lines or triangles) we want to draw.  
 		// Essentially: "What kind of shape should the GPU draw with our vertices?"
 		Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		// Recorded frames are played back on the same context
+		gpuBackend = std::make_unique<D3D11Backend>(Graphics::Context);
 	}
 
 	// Instantiate UI variables
@@ -70,6 +93,47 @@ void Game::Initialize()
 		// Color tint and offset vectors
 		colorTint = new float[4] { 0.0f, 0.0f, 1.0f, 0.8f };
 		offset = new float[3] { 0.0f, 0.0f, 0.0f };
+
+		// Default number of entities for the stress test, mostly static
+		stressCount = 10000;
+		stressMovingPercent = 1;
+		stressChurn = 0;
+		churnCursor = 0;
+		stressSwarm = false;
+		stressPropCount = 5000;
+		staticBatching = true;
+		spatialIndexType = SPATIAL_INDEX_NONE;
+		occlusionEnabled = true;
+		temporalCulling = false;
+		multiViewCulling = false;
+		sortDraws = true;
+		splitConstantBuffers = true;
+		uploadedBytes = 0;
+		instancing = true;
+		instanceCapacity = 0;
+		nullBackendEnabled = false;
+		recordMs = 0.0f;
+		executeMs = 0.0f;
+		commandCount = 0;
+		commandBytes = 0;
+		nullDraws = 0;
+		nullErrors = 0;
+		nullFirstError = nullptr;
+		filterState = true;
+		stateIssued = 0;
+		stateFiltered = 0;
+		recordSlices = 1;
+		deferredContextsEnabled = true;
+		recordedSlices = 1;
+		depthPrepass = false;
+		captureRequested = false;
+		capturedFrame = 0;
+		captureCommands = 0;
+		captureBytes = 0;
+		captureReplayMs = 0.0f;
+		captureSaved = false;
+		pickRequested = false;
+		pickMicroseconds = 0.0f;
 	}
 
 	// Create cameras
@@ -200,15 +264,43 @@ void Game::Initialize()
 		XMStoreFloat4x4(&lightViewMatrix, lightView);
 
 		// Using orthographics for directional light
+		// - Shadows can fall as far as the far plane
 		float lightProjectionSize = 30.0f;
+		shadowDistance = 100.0f;
 		XMMATRIX lightProj = XMMatrixOrthographicLH(
 			lightProjectionSize,
 			lightProjectionSize,
 			1.0f,
-			100.0f);
+			shadowDistance);
 		XMStoreFloat4x4(&lightProjectionMatrix, lightProj);
 	}
 
+	// Transparent rendering states
+	{
+		// Standard alpha blending from the pixel shader's alpha
+		D3D11_BLEND_DESC blendDesc = {};
+		blendDesc.RenderTarget[0].BlendEnable = true;
+		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		Graphics::Device->CreateBlendState(&blendDesc, transparentBlend.GetAddressOf());
+
+		// Hidden by opaque geometry, but never hides what is blended after it
+		D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+		depthDesc.DepthEnable = true;
+		depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		depthDesc.DepthFunc = D3D11_COMPARISON_LESS;
+		Graphics::Device->CreateDepthStencilState(&depthDesc, transparentDepth.GetAddressOf());
+
+		// After the depth pre-pass only the front surface passes, and depth is already written
+		depthDesc.DepthFunc = D3D11_COMPARISON_EQUAL;
+		Graphics::Device->CreateDepthStencilState(&depthDesc, prepassEqualDepth.GetAddressOf());
+	}
+
 	// Post processing set up
 	{
 		// Set up sampler
@@ -256,6 +348,14 @@ void Game::Initialize()
 
 		blurRadius = std::make_shared<int>(0);
 	}
+
+	// Frames are drawn by the pipeline, on a render thread by default
+	{
+		renderThreaded = true;
+		updateMs = 0.0f;
+		pipeline.SetRenderer([this](RenderPacket& packet) { Render(packet); });
+		pipeline.SetThreaded(renderThreaded);
+	}
 }
 
 
@@ -267,6 +367,9 @@ void Game::Initialize()
 // --------------------------------------------------------
 Game::~Game()
 {
+	// Stop drawing before anything the render thread uses goes away
+	pipeline.SetThreaded(false);
+
 	delete backgroundColor;
 	backgroundColor = nullptr;
 
@@ -290,6 +393,9 @@ void Game::CreateGeometry()
 	std::shared_ptr<SimpleVertexShader> vShader = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"VertexShader.cso").c_str());
 
+	std::shared_ptr<SimpleVertexShader> instancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShaderInstanced.cso").c_str());
+
 	std::shared_ptr<SimplePixelShader> pShader = std::make_shared<SimplePixelShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"PixelShader.cso").c_str());
 
@@ -314,6 +420,9 @@ void Game::CreateGeometry()
 	shadowVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"ShadowVS.cso").c_str());
 
+	shadowInstancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"ShadowInstancedVS.cso").c_str());
+
 	// Shaders for post processing
 	ppVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"ppVS.cso").c_str());
@@ -413,6 +522,13 @@ void Game::CreateGeometry()
 	materials.push_back(debugNormals);
 	materials.push_back(customMaterial);
 
+	// Everything above uses the standard vertex shader, so all of them can be instanced
+	for (std::shared_ptr<Material>& material : materials)
+	{
+		if (material->GetVertexShader() == vShader)
+			material->SetInstancedVertexShader(instancedVS);
+	}
+
 	// Apply textures and normals to materials using pShader
 	metalMaterial->AddTextureSRV("Albedo", metalSRV);
 	metalMaterial->AddTextureSRV("NormalMap", metalNormalSRV);
@@ -443,14 +559,18 @@ void Game::CreateGeometry()
 	twoTexturesMaterial->AddTextureSRV("SurfaceTexture2", snowSRV);
 	twoTexturesMaterial->AddSampler("BasicSampler", sampleState);
 
-	// Create meshes
-	std::shared_ptr<Mesh> cube = std::make_shared<Mesh>(FixPath("../../Assets/Models/cube.obj").c_str());
-	std::shared_ptr<Mesh> cylinder = std::make_shared<Mesh>(FixPath("../../Assets/Models/cylinder.obj").c_str());
-	std::shared_ptr<Mesh> helix = std::make_shared<Mesh>(FixPath("../../Assets/Models/helix.obj").c_str());
-	std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>(FixPath("../../Assets/Models/sphere.obj").c_str());
-	std::shared_ptr<Mesh> torus = std::make_shared<Mesh>(FixPath("../../Assets/Models/torus.obj").c_str());
-	std::shared_ptr<Mesh> quad = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad.obj").c_str());
-	std::shared_ptr<Mesh> quad2Side = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad_double_sided.obj").c_str());
+	// Create meshes, each model is parsed on its own job
+	// - Only the device is used while loading, which is safe across threads
+	std::shared_ptr<Mesh> cube, cylinder, helix, sphere, torus, quad, quad2Side;
+	JobCounter meshesLoaded;
+	JobSystem::Run([&]() { cube = std::make_shared<Mesh>(FixPath("../../Assets/Models/cube.obj").c_str(), true); }, &meshesLoaded);
+	JobSystem::Run([&]() { cylinder = std::make_shared<Mesh>(FixPath("../../Assets/Models/cylinder.obj").c_str(), true); }, &meshesLoaded);
+	JobSystem::Run([&]() { helix = std::make_shared<Mesh>(FixPath("../../Assets/Models/helix.obj").c_str()); }, &meshesLoaded);
+	JobSystem::Run([&]() { sphere = std::make_shared<Mesh>(FixPath("../../Assets/Models/sphere.obj").c_str()); }, &meshesLoaded);
+	JobSystem::Run([&]() { torus = std::make_shared<Mesh>(FixPath("../../Assets/Models/torus.obj").c_str()); }, &meshesLoaded);
+	JobSystem::Run([&]() { quad = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad.obj").c_str()); }, &meshesLoaded);
+	JobSystem::Run([&]() { quad2Side = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad_double_sided.obj").c_str()); }, &meshesLoaded);
+	JobSystem::Wait(&meshesLoaded);
 
 	meshes.push_back(cube);
 	meshes.push_back(cylinder);
@@ -460,36 +580,59 @@ void Game::CreateGeometry()
 	meshes.push_back(quad);
 	meshes.push_back(quad2Side);
 
-	// Create entities
-	std::shared_ptr<GameEntity> sphereEntity = std::make_shared<GameEntity>(sphere, metalMaterial);
-	std::shared_ptr<GameEntity> sphereEntity2 = std::make_shared<GameEntity>(sphere, onyxMaterial);
-	std::shared_ptr<GameEntity> sphereEntity3 = std::make_shared<GameEntity>(sphere, snowMaterial);
-	std::shared_ptr<GameEntity> sphereEntity4 = std::make_shared<GameEntity>(sphere, woodMaterial);
+	// Coarser spheres for entities far away, the model has 32 slices around
+	// - A UV sphere with n slices dips up to about sin^2(pi / n) under the
+	//   true surface, close enough to its error from the finest level
+	sphereLods.AddLevel(sphere.get(), 0.0f);
+	const char* sphereLodNames[] = { "Sphere LOD 1", "Sphere LOD 2", "Sphere LOD 3" };
+	int sphereLodSlices[] = { 16, 8, 4 };
+	for (int i = 0; i < 3; i++)
+	{
+		std::shared_ptr<Mesh> level = CreateSphere(sphereLodSlices[i], sphereLodNames[i]);
+		float dip = sinf(XM_PI / sphereLodSlices[i]);
+		sphereLods.AddLevel(level.get(), dip * dip);
+		meshes.push_back(level);
+	}
+
+	// Create entities, the registry only borrows the meshes and materials
+	GameEntity sphereEntity(&registry, registry.Create(sphere.get(), metalMaterial.get()));
+	GameEntity sphereEntity2(&registry, registry.Create(sphere.get(), onyxMaterial.get()));
+	GameEntity sphereEntity3(&registry, registry.Create(sphere.get(), snowMaterial.get()));
+	GameEntity sphereEntity4(&registry, registry.Create(sphere.get(), woodMaterial.get()));
 
 	// Helix
-	std::shared_ptr<GameEntity> helixEntity = std::make_shared<GameEntity>(helix, metalMaterial);
+	GameEntity helixEntity(&registry, registry.Create(helix.get(), metalMaterial.get()));
 
 	// Floor entity
-	std::shared_ptr<GameEntity> floorEntity = std::make_shared<GameEntity>(cube, woodMaterial);
+	GameEntity floorEntity(&registry, registry.Create(cube.get(), woodMaterial.get()));
 
-	sphereEntity2->GetTransform()->SetPosition(-3.0f, 0.0f, 0.0f);
-	sphereEntity3->GetTransform()->SetPosition(3.0f, 0.0f, 0.0f);
-	sphereEntity4->GetTransform()->SetPosition(6.0f, 0.0f, 0.0f);
+	sphereEntity2.GetTransform()->SetPosition(-3.0f, 0.0f, 0.0f);
+	sphereEntity3.GetTransform()->SetPosition(3.0f, 0.0f, 0.0f);
+	sphereEntity4.GetTransform()->SetPosition(6.0f, 0.0f, 0.0f);
 
-	helixEntity->GetTransform()->SetPosition(0.0f, 3.0f, -2.0f);
+	helixEntity.GetTransform()->SetPosition(0.0f, 3.0f, -2.0f);
 
-	floorEntity->GetTransform()->SetPosition(0.0f, -22.0f, 0.0f);
-	floorEntity->GetTransform()->SetScale(20.0f, 20.0f, 20.0f);
+	floorEntity.GetTransform()->SetPosition(0.0f, -22.0f, 0.0f);
+	floorEntity.GetTransform()->SetScale(20.0f, 20.0f, 20.0f);
 
 	entities.push_back(sphereEntity);
 	entities.push_back(sphereEntity2);
 	entities.push_back(sphereEntity3);
 	entities.push_back(sphereEntity4);
+	for (int i = 0; i < 4; i++)
+		registry.SetLodChain(entities[i].GetEntity(), &sphereLods);
 
 	entities.push_back(helixEntity);
 
 	entities.push_back(floorEntity);
 
+	// The floor hides anything below it
+	occluders.push_back(floorEntity.GetEntity());
+
+	// And never moves
+	staticEntities.push_back(floorEntity.GetEntity());
+	SyncStaticBatching();
+
 	// Create skybox
 	skybox = std::make_shared<Sky>(cube, sampleState, skyPS, skyVS, 
 		FixPath(L"../../Assets/Textures/Skybox/right.png").c_str(),
@@ -500,6 +643,199 @@ void Game::CreateGeometry()
 		FixPath(L"../../Assets/Textures/Skybox/back.png").c_str());
 }
 
+// --------------------------------------------------------
+// Builds a unit UV sphere with the given slices around
+// and half as many stacks from pole to pole
+// --------------------------------------------------------
+std::shared_ptr<Mesh> Game::CreateSphere(int slices, const char* name)
+{
+	int stacks = slices / 2;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	// A ring per stack, the seam is doubled up so UVs can wrap
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float phi = XM_PI * stack / stacks;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float theta = XM_2PI * slice / slices;
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			vertex.Normal = vertex.Position;
+			vertex.UV = XMFLOAT2((float)slice / slices, (float)stack / stacks);
+			vertices.push_back(vertex);
+		}
+	}
+
+	// Two clockwise triangles per quad, minus the ones squashed flat at the poles
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			unsigned int a = stack * (slices + 1) + slice;
+			unsigned int b = a + 1;
+			unsigned int c = a + slices + 1;
+			unsigned int d = c + 1;
+			if (stack > 0)
+				indices.insert(indices.end(), { a, b, c });
+			if (stack < stacks - 1)
+				indices.insert(indices.end(), { b, d, c });
+		}
+	}
+
+	return std::make_shared<Mesh>(vertices.data(), vertices.size(), indices.data(), indices.size(), name);
+}
+
+// --------------------------------------------------------
+// Fills the scene with extra spheres to measure CPU cost
+// --------------------------------------------------------
+void Game::SpawnStressEntities(int count)
+{
+	registry.Reserve(registry.Count() + count);
+	stressEntities.reserve(stressEntities.size() + count);
+
+	// Lay the spheres out on a square grid in front of the cameras
+	int side = (int)ceil(sqrt((double)count));
+	for (int i = 0; i < count; i++)
+	{
+		Entity e = registry.Create(meshes[3].get(), materials[i % 4].get());
+		if (e == INVALID_ENTITY)
+			break;
+		registry.SetLodChain(e, &sphereLods);
+
+		registry.GetTransform(e)->SetPosition(
+			(float)(i % side - side / 2) * 3.0f,
+			0.0f,
+			(float)(i / side) * 3.0f + 5.0f);
+		stressEntities.push_back(e);
+	}
+
+	// A long low wall every few rows, so there is something to hide the rows behind it
+	int rows = (int)stressEntities.size() / side;
+	for (int row = STRESS_WALL_SPACING; row < rows; row += STRESS_WALL_SPACING)
+	{
+		Entity wall = registry.Create(meshes[0].get(), materials[row % 4].get());
+		if (wall == INVALID_ENTITY)
+			break;
+
+		Transform* transform = registry.GetTransform(wall);
+		transform->SetPosition(-1.5f, 0.5f, row * 3.0f + 3.5f);
+		transform->SetScale(side * 1.5f, 2.0f, 0.25f);
+		stressWalls.push_back(wall);
+		occluders.push_back(wall);
+		staticEntities.push_back(wall);
+	}
+	SyncStaticBatching();
+}
+
+// --------------------------------------------------------
+// Scatters small cubes and cylinders that never move over
+// the stress test's area, for static batching to merge
+// --------------------------------------------------------
+void Game::SpawnStressProps(int count)
+{
+	registry.Reserve(registry.Count() + count);
+	stressProps.reserve(stressProps.size() + count);
+
+	// Spread evenly over a square with a low discrepancy sequence, so props rarely overlap
+	float side = sqrtf((float)count) * STRESS_PROP_SPACING;
+	for (int i = 0; i < count; i++)
+	{
+		Entity e = registry.Create(meshes[i % 2].get(), materials[i % 4].get());
+		if (e == INVALID_ENTITY)
+			break;
+
+		float u = fmodf(0.5f + i * 0.7548776662f, 1.0f);
+		float v = fmodf(0.5f + i * 0.5698402910f, 1.0f);
+		Transform* transform = registry.GetTransform(e);
+		transform->SetPosition((u - 0.5f) * side, -0.6f, v * side + 5.0f);
+		transform->SetRotation(0.0f, i * 0.37f, 0.0f);
+		transform->SetScale(STRESS_PROP_SCALE, STRESS_PROP_SCALE, STRESS_PROP_SCALE);
+		stressProps.push_back(e);
+		staticEntities.push_back(e);
+	}
+	SyncStaticBatching();
+}
+
+// --------------------------------------------------------
+// Batches every entity that never moves, or stops batching
+// all of them, to match the static batching setting
+// --------------------------------------------------------
+void Game::SyncStaticBatching()
+{
+	if (!staticBatching)
+	{
+		staticBatcher.Clear();
+		return;
+	}
+
+	// Members are skipped, so only new entities are added
+	for (Entity e : staticEntities)
+		staticBatcher.Add(registry, e);
+}
+
+// --------------------------------------------------------
+// Applies the material changes queued by the UI
+//  - Materials are shared with the render thread, so any frame
+//    still in flight is finished first, which only stalls the
+//    pipeline on frames where something was actually edited
+// --------------------------------------------------------
+void Game::ApplyMaterialEdits()
+{
+	if (materialEdits.empty())
+		return;
+
+	pipeline.Flush();
+	for (const MaterialEdit& edit : materialEdits)
+	{
+		edit.material->SetColor(edit.color);
+		edit.material->SetScale(edit.scale);
+		edit.material->SetOffset(edit.offset);
+	}
+	materialEdits.clear();
+
+	// Chunks are drawn opaque, so members whose material turned translucent
+	// leave them, and ones that turned opaque again are batched once more
+	for (Entity e : staticEntities)
+	{
+		if (registry.GetMaterial(e)->GetColor().w < 1.0f)
+			staticBatcher.Remove(e);
+	}
+	SyncStaticBatching();
+}
+
+// --------------------------------------------------------
+// Removes every entity made by SpawnStressEntities
+// --------------------------------------------------------
+void Game::ClearStressEntities()
+{
+	for (Entity e : stressEntities)
+		registry.Destroy(e);
+	stressEntities.clear();
+	churnCursor = 0;
+
+	// Static ones leave their chunks first, which are merged again without them
+	for (Entity wall : stressWalls)
+	{
+		staticBatcher.Remove(wall);
+		registry.Destroy(wall);
+		occluders.erase(std::find(occluders.begin(), occluders.end(), wall));
+	}
+	stressWalls.clear();
+
+	for (Entity prop : stressProps)
+	{
+		staticBatcher.Remove(prop);
+		registry.Destroy(prop);
+	}
+	stressProps.clear();
+
+	staticEntities.erase(
+		std::remove_if(staticEntities.begin(), staticEntities.end(), [&](Entity e) { return !registry.IsAlive(e); }),
+		staticEntities.end());
+}
+
 
 // --------------------------------------------------------
 // Handle resizing to match the new window size
@@ -507,6 +843,9 @@ void Game::CreateGeometry()
 // --------------------------------------------------------
 void Game::OnResize()
 {
+	// Frames still being drawn use the old render targets
+	pipeline.Flush();
+
 	for (int i = 0; i < cameras.size(); i++)
 	{
 		if (cameras[i] != nullptr)
@@ -563,6 +902,8 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	auto updateStart = std::chrono::high_resolution_clock::now();
+
 	// Call helper method to update UI
 	UpdateUIContext(deltaTime);
 	CustomizeUIContext();
@@ -574,105 +915,731 @@ void Game::Update(float deltaTime, float totalTime)
 	// Update a couple entities
 	double movement = sin((double)(totalTime / 3));
 	movement *= 5;
-	entities[4]->GetTransform()->Rotate(0.0f, 0.003f, 0.0f);
-	entities[4]->GetTransform()->SetPosition((float)movement, 3.0f, -2.0f);
+	entities[4].GetTransform()->Rotate(0.0f, 0.003f, 0.0f);
+	entities[4].GetTransform()->SetPosition((float)movement, 3.0f, -2.0f);
+
+	// Swap the oldest stress entities for new ones to test spawn/despawn churn
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		churnSpawned = 0;
+		churnDespawned = 0;
+		for (int i = 0; i < stressChurn && !stressEntities.empty(); i++)
+		{
+			Entity old = stressEntities[churnCursor];
+			XMFLOAT3 position = registry.GetTransform(old)->GetPosition();
+			registry.Destroy(old);
+			churnDespawned++;
+
+			// Reuses the slot just freed, so no allocation happens here
+			Entity e = registry.Create(meshes[3].get(), materials[churnCursor % 4].get());
+			registry.GetTransform(e)->SetPosition(position);
+			registry.SetLodChain(e, &sphereLods);
+			stressEntities[churnCursor] = e;
+
+			churnCursor = (churnCursor + 1) % stressEntities.size();
+			churnSpawned++;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		churnMs = std::chrono::duration<float, std::milli>(end - start).count();
+	}
+
+	// Bob a slice of the stress entities to test incremental updates,
+	// or send them circling around to test entities that really travel
+	size_t movingCount = stressEntities.size() * stressMovingPercent / 100;
+	for (size_t i = 0; i < movingCount; i++)
+	{
+		Transform* transform = registry.GetTransform(stressEntities[i]);
+		XMFLOAT3 position = transform->GetPosition();
+		if (stressSwarm)
+		{
+			position.x += (float)cos(totalTime + i) * 4.0f * deltaTime;
+			position.z += (float)sin(totalTime + i) * 4.0f * deltaTime;
+		}
+		else
+		{
+			position.y = (float)sin(totalTime + i) * 0.5f;
+		}
+		transform->SetPosition(position);
+	}
+
+	// Left drags the camera around, so right clicks pick, once this frame's bounds are ready
+	if (Input::MouseRightPress())
+		pickRequested = true;
 
 	// Update the cameras
 	currentCamera->Update(deltaTime);
+
+	auto updateEnd = std::chrono::high_resolution_clock::now();
+	updateMs = std::chrono::duration<float, std::milli>(updateEnd - updateStart).count();
 }
 
 
 // --------------------------------------------------------
-// Clear the screen, redraw everything, present to the user
+// Copy everything this frame needs into a render packet and
+// hand it to the pipeline, drawing happens in Render()
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// Only blocks when the render thread is a whole frame behind
+	RenderPacket& packet = pipeline.BeginFrame();
+
+	// Before anything reads materials for this frame
+	ApplyMaterialEdits();
+
+	// Reset counters for this frame
+	stats = {};
+
+	// Gather everything to draw this frame from the registry's dense arrays
+	{
+		// Bounds only need updating for entities that moved, static chunks
+		// are merged again when a member moved or came or went
+		auto start = std::chrono::high_resolution_clock::now();
+		registry.UpdateBounds();
+		auto boundsEnd = std::chrono::high_resolution_clock::now();
+		staticBatcher.Update(registry);
+		auto staticEnd = std::chrono::high_resolution_clock::now();
+
+		// Only entities the camera can see are drawn in the main pass
+		CameraData camera = currentCamera->GetData();
+		Frustum cameraFrustum = currentCamera->GetFrustum();
+
+		// Casters must be in the light's volume, and their shadow,
+		// swept along the light, has to reach the camera's view
+		XMFLOAT4X4 lightViewProjection;
+		XMStoreFloat4x4(&lightViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&lightViewMatrix), XMLoadFloat4x4(&lightProjectionMatrix)));
+		Frustum lightFrustum(lightViewProjection);
+		XMFLOAT3 shadowSweep;
+		XMStoreFloat3(&shadowSweep, XMVector3Normalize(XMLoadFloat3(&lights[0].direction)) * shadowDistance);
+
+		if (multiViewCulling)
+		{
+			// Camera, shadow casters, then the other cameras a picture in picture
+			// or minimap would draw, all culled in the same pass
+			CullPlanes views[CULL_MAX_VIEWS];
+			unsigned int viewCount = 2;
+			views[0].AddFrustum(cameraFrustum);
+			views[1].AddShadowCasters(lightFrustum, cameraFrustum, shadowSweep);
+			for (std::shared_ptr<Camera>& other : cameras)
+			{
+				if (other != currentCamera && viewCount < CULL_MAX_VIEWS)
+					views[viewCount++].AddFrustum(other->GetFrustum());
+			}
+
+			registry.CullViews(views, viewCount, viewMasks);
+			viewMasks.GetIndices(0, visibleIndices);
+			viewMasks.GetIndices(1, casterIndices);
+			stats.viewCount = viewCount;
+			for (unsigned int v = 0; v < viewCount; v++)
+				stats.viewVisible[v] = viewMasks.CountVisible(v);
+		}
+		else if (temporalCulling)
+			registry.CullFrustumTemporal(cameraFrustum, camera.position, visibleIndices);
+		else
+			registry.CullFrustum(cameraFrustum, visibleIndices);
+
+		// Then drop what is hidden behind the occluders, shadows can still be cast
+		// by entities the camera can't see so the casters below are left alone
+		auto occlusionStart = std::chrono::high_resolution_clock::now();
+		if (occlusionEnabled)
+		{
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(XMLoadFloat4x4(&camera.view), XMLoadFloat4x4(&camera.projection)));
+
+			occlusion.Begin(viewProjection);
+			for (Entity e : occluders)
+				occlusion.AddOccluder(registry.GetMesh(e), registry.GetTransform(e)->GetWorldMatrix());
+			occlusion.Rasterize();
+
+			size_t inFrustum = visibleIndices.size();
+			registry.CullOccluded(occlusion, visibleIndices);
+			stats.occludedCount = (unsigned int)(inFrustum - visibleIndices.size());
+			stats.occluderTriangles = occlusion.GetTriangleCount();
+		}
+		auto occlusionEnd = std::chrono::high_resolution_clock::now();
+
+		if (!multiViewCulling)
+			registry.CullShadowCasters(lightFrustum, cameraFrustum, shadowSweep, casterIndices);
+
+		// Culled counts come first, members dropped below were still visible
+		stats.entityCount = (unsigned int)registry.Count();
+		stats.culledCount = stats.entityCount - (unsigned int)visibleIndices.size() - stats.occludedCount;
+		stats.casterCulledCount = stats.entityCount - (unsigned int)casterIndices.size();
+
+		// Static entities are drawn by their chunks instead
+		staticBatcher.RemoveMembers(registry, visibleIndices);
+		staticBatcher.RemoveMembers(registry, casterIndices);
+		auto cullEnd = std::chrono::high_resolution_clock::now();
+
+		// Swap distant entities to coarser meshes, only what the camera sees needs
+		// picking, casters out of view keep the level they were last seen with
+		float projectionScale = Window::Height() / (2.0f * tanf(XMConvertToRadians(currentCamera->GetFieldOfView()) * 0.5f));
+		registry.SelectLods(camera.position, projectionScale, lodSettings, visibleIndices);
+		auto lodEnd = std::chrono::high_resolution_clock::now();
+
+		// Order draws so neighbours share shaders, materials and meshes, opaques front
+		// to back and blended draws back to front after them, casters only bind meshes
+		auto sortStart = std::chrono::high_resolution_clock::now();
+		XMFLOAT3 forward(camera.view._13, camera.view._23, camera.view._33);
+		registry.BuildDrawKeys(visibleIndices, RENDER_PASS_MAIN, camera.position, forward, DRAW_DEPTH_RANGE, drawQueue);
+		stats.stateChangesUnsorted = drawQueue.CountStateChanges();
+		if (sortDraws)
+		{
+			XMFLOAT3 lightPosition;
+			XMFLOAT3 lightForward(lightViewMatrix._13, lightViewMatrix._23, lightViewMatrix._33);
+			XMStoreFloat3(&lightPosition, XMMatrixInverse(nullptr, XMLoadFloat4x4(&lightViewMatrix)).r[3]);
+			registry.BuildDrawKeys(casterIndices, RENDER_PASS_SHADOW, lightPosition, lightForward, shadowDistance, shadowQueue);
+
+			drawQueue.Sort();
+			shadowQueue.Sort();
+			stats.stateChangesSorted = drawQueue.CountStateChanges();
+			stats.transparentCount = drawQueue.Count() - drawQueue.GetFirstTransparent();
+		}
+		auto sortEnd = std::chrono::high_resolution_clock::now();
+
+		// Without sorting everything is drawn opaque in culling order, as before
+		XMFLOAT4X4 cameraViewProjection;
+		XMStoreFloat4x4(&cameraViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&camera.view), XMLoadFloat4x4(&camera.projection)));
+		registry.BuildDrawList(sortDraws ? drawQueue.GetIndices() : visibleIndices, cameraViewProjection, &lightViewProjection, packet.drawList);
+		registry.BuildDrawList(sortDraws ? shadowQueue.GetIndices() : casterIndices, lightViewProjection, nullptr, packet.shadowList);
+		packet.firstTransparent = sortDraws ? drawQueue.GetFirstTransparent() : (unsigned int)packet.drawList.size();
+
+		// Chunks go first, they are opaque and large enough to be worth having in depth early
+		CullPlanes cameraPlanes;
+		cameraPlanes.AddFrustum(cameraFrustum);
+		CullPlanes casterPlanes;
+		casterPlanes.AddShadowCasters(lightFrustum, cameraFrustum, shadowSweep);
+		stats.staticDraws = staticBatcher.AddDraws(cameraPlanes, cameraViewProjection, &lightViewProjection, packet.drawList);
+		staticBatcher.AddDraws(casterPlanes, lightViewProjection, nullptr, packet.shadowList);
+		packet.firstTransparent += stats.staticDraws;
+
+		// Pre-pass order is pure depth, the main pass keeps its state order
+		packet.depthPrepass = depthPrepass;
+		if (depthPrepass)
+			packet.BuildDepthOrder(DRAW_DEPTH_RANGE, depthQueue);
+		stats.overdraw = packet.EstimateOverdraw();
+
+		// Batches come from the final order, the render thread only uploads them,
+		// instanced shaders rebuild each draw's matrices from these two
+		packet.instancing = instancing && splitConstantBuffers;
+		if (packet.instancing)
+			packet.BuildInstances();
+		packet.viewProjection = cameraViewProjection;
+		packet.shadowViewProjection = lightViewProjection;
+		auto end = std::chrono::high_resolution_clock::now();
+
+		stats.visibleCount = (unsigned int)visibleIndices.size();
+		stats.casterCount = (unsigned int)casterIndices.size();
+		stats.indexMoves = registry.GetIndexMoves();
+		stats.treeHeight = registry.GetTree().GetHeight();
+		stats.gridCells = registry.GetGrid().GetCellCount();
+		stats.gridCellSize = registry.GetGrid().GetCellSize();
+		stats.cullRate = registry.GetCullRate();
+		stats.temporalSkipShare = temporalCulling ? registry.GetTemporalSkipShare() : 0.0f;
+		stats.drawCount = (unsigned int)packet.drawList.size();
+		stats.drawCalls = stats.drawCount;
+		stats.shadowDrawCalls = (unsigned int)packet.shadowList.size();
+		if (packet.instancing)
+		{
+			// Same choice Render() makes, materials without an instanced shader draw one at a time
+			stats.drawCalls = 0;
+			for (const DrawBatch& batch : packet.batches)
+				stats.drawCalls += batch.count > 1 && packet.drawList[batch.first].material->GetInstancedVertexShader() ? 1 : batch.count;
+			stats.shadowDrawCalls = (unsigned int)packet.shadowBatches.size();
+		}
+		if (depthPrepass)
+			stats.prepassDrawCalls = packet.instancing ? (unsigned int)packet.depthBatches.size() : packet.firstTransparent;
+		for (const DrawItem& item : packet.drawList)
+			stats.triangleCount += item.mesh->GetIndexCount() / 3;
+		unsigned char* lods = registry.GetLods();
+		for (unsigned int index : visibleIndices)
+			stats.lodCounts[lods[index]]++;
+		stats.spawned = churnSpawned;
+		stats.despawned = churnDespawned;
+		stats.churnMs = churnMs;
+		stats.changedTransforms = (unsigned int)registry.GetJournal().GetChanged().size();
+		stats.staticMembers = staticBatcher.GetMemberCount();
+		stats.staticChunks = staticBatcher.GetChunkCount();
+		stats.staticMerges = staticBatcher.GetMergeCount();
+		stats.staticBytes = staticBatcher.GetMemoryUsed();
+		stats.boundsMs = std::chrono::duration<float, std::milli>(boundsEnd - start).count();
+		stats.staticMs = std::chrono::duration<float, std::milli>(staticEnd - boundsEnd).count();
+		stats.cullMs = std::chrono::duration<float, std::milli>(cullEnd - staticEnd).count();
+		stats.occlusionMs = std::chrono::duration<float, std::milli>(occlusionEnd - occlusionStart).count();
+		stats.lodMs = std::chrono::duration<float, std::milli>(lodEnd - cullEnd).count();
+		stats.sortMs = std::chrono::duration<float, std::milli>(sortEnd - sortStart).count();
+		stats.drawListMs = std::chrono::duration<float, std::milli>((end - lodEnd) - (sortEnd - sortStart)).count();
+	}
+
+	// Find what's under the cursor now that bounds match the transforms
+	if (pickRequested)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		XMFLOAT3 origin, direction;
+		currentCamera->GetRay((float)Input::GetMouseX(), (float)Input::GetMouseY(), (float)Window::Width(), (float)Window::Height(), origin, direction);
+		if (!registry.RayCast(origin, direction, PICK_DISTANCE, pickHit))
+			pickHit = RayHit();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		pickMicroseconds = std::chrono::duration<float, std::micro>(end - start).count();
+		pickRequested = false;
+	}
+
+	// Copy the rest of the scene so the next update can change it freely
+	packet.camera = currentCamera->GetData();
+	packet.lights = lights;
+	packet.ambientLight = ambientLight;
+	packet.blurRadius = *blurRadius;
+	packet.vsync = vsync;
+	packet.splitConstantBuffers = splitConstantBuffers;
+	packet.nullBackend = nullBackendEnabled;
+	packet.filterState = filterState;
+	packet.recordSlices = (unsigned int)recordSlices;
+	packet.deferredContexts = deferredContextsEnabled;
+	packet.capture = captureRequested;
+	captureRequested = false;
+
+	// Turn the UI into triangles now, ImGui starts the next frame before this one is drawn
+	ImGui::Render();
+	packet.CopyUI(ImGui::GetDrawData());
+
+	// Every consumer of this frame's transform changes is done
+	registry.EndFrame();
+
+	// Timings from the pipeline describe the previous frame
+	stats.updateMs = updateMs;
+	stats.renderMs = pipeline.GetRenderMs();
+	stats.fenceWaitMs = pipeline.GetWaitMs();
+	stats.uploadedBytes = uploadedBytes;
+	stats.recordMs = recordMs;
+	stats.executeMs = executeMs;
+	stats.commandCount = commandCount;
+	stats.commandBytes = commandBytes;
+	stats.nullDraws = nullDraws;
+	stats.nullErrors = nullErrors;
+	stats.nullFirstError = nullFirstError;
+	stats.stateIssued = stateIssued;
+	stats.stateFiltered = stateFiltered;
+	stats.recordedSlices = recordedSlices;
+	stats.capturedFrame = capturedFrame;
+	stats.captureCommands = captureCommands;
+	stats.captureBytes = captureBytes;
+	stats.captureReplayMs = captureReplayMs;
+	stats.captureSaved = captureSaved;
+
+	pipeline.Submit();
+}
+
+// --------------------------------------------------------
+// Clear the screen, redraw everything, present to the user
+//  - Only reads the packet, so this is safe on the render thread
+// --------------------------------------------------------
+void Game::Render(RenderPacket& packet)
+{
+	// Count every constant buffer upload this frame makes
+	ISimpleShader::UploadedBytes = 0;
+
+	// Everything up to the UI is recorded, shaders included, then handed to a backend
+	auto recordStart = std::chrono::high_resolution_clock::now();
+	commands.Reset();
+	ISimpleShader::Recording = &commands;
+
 	// Frame START
 	// - These things should happen ONCE PER FRAME
-	// - At the beginning of Game::Draw() before drawing *anything*
+	// - At the beginning of Game::Render() before drawing *anything*
 	{
 		// Clear the back buffer (erase what's on screen) and depth buffer
 		const float black[4] = { 0, 0, 0, 0 };
-		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(), black);
-		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		commands.ClearTarget(Graphics::BackBufferRTV.Get(), black);
+		commands.ClearDepth(Graphics::DepthBufferDSV.Get(), 1.0f);
 		
 		// Clear post processing render target and ensure that the correct render target is set
-		Graphics::Context->ClearRenderTargetView(ppRTV.Get(), black);		
+		commands.ClearTarget(ppRTV.Get(), black);
 		// For shadows as well
-		Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+		commands.ClearDepth(shadowDSV.Get(), 1.0f);
 	}
 
-	// Change state to shadow rendering
-	Graphics::Context->RSSetState(shadowRasterizer.Get());
+	// Change state to shadow rendering, the topology too since the last frame's
+	// deferred lists left the context with none
+	commands.SetTopology(RENDER_TOPOLOGY_TRIANGLE_LIST);
+	commands.SetRasterizerState(shadowRasterizer.Get());
 
 	// Output merger stage
-	ID3D11RenderTargetView* nullRTV{};
-	Graphics::Context->OMSetRenderTargets(1, &nullRTV, shadowDSV.Get());
+	commands.SetTargets(nullptr, shadowDSV.Get());
 
 	// Deactivate pixel shader
-	Graphics::Context->PSSetShader(0, 0, 0);
+	commands.BindShader(RENDER_STAGE_PIXEL, nullptr);
 
 	// Change the viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.Width = 1024;
-	viewport.Height = 1024;
-	viewport.MaxDepth = 1.0f;
-	Graphics::Context->RSSetViewports(1, &viewport);
+	commands.SetViewport(1024, 1024);
 
-	// Set shadow VS
-	shadowVS->SetShader();
-	shadowVS->SetMatrix4x4("view", lightViewMatrix);
-	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
+	// Every instance of both passes goes up in one write, the buffer grows with the scene
+	if (packet.instancing && !packet.instances.empty())
+	{
+		unsigned int instanceCount = (unsigned int)packet.instances.size();
+		if (instanceCount > instanceCapacity)
+		{
+			instanceCapacity = instanceCount + instanceCount / 2;
+
+			D3D11_BUFFER_DESC instanceDesc = {};
+			instanceDesc.ByteWidth = sizeof(InstanceData) * instanceCapacity;
+			instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+			instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+			instanceBuffer.Reset();
+			Graphics::Device->CreateBuffer(&instanceDesc, 0, instanceBuffer.GetAddressOf());
+		}
 
-	//  Draw entities
-	for (auto& e : entities)
+		commands.WriteBuffer(instanceBuffer.Get(), packet.instances.data(), sizeof(InstanceData) * instanceCount);
+
+		// Meshes only ever set slot 0, so this stays bound, lists that start
+		// from nothing bound set it again
+		commands.SetVertexBuffer(1, instanceBuffer.Get(), sizeof(InstanceData));
+	}
+
+	// Matrices already include the light's view and projection
+	auto drawCaster = [&](DrawItem& item)
 	{
-		shadowVS->SetMatrix4x4("world", e->GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		shadowVS->SetMatrix4x4("worldViewProjection", item.worldViewProjection);
+		if (packet.splitConstantBuffers)
+			shadowVS->CopyBufferData("PerObject");
+		else
+			shadowVS->CopyAllBufferData();
 
 		// Draw avoiding material
-		e->GetMesh()->Draw();
+		item.mesh->Draw(commands);
+	};
+
+	//  Draw entities
+	if (!packet.instancing)
+	{
+		shadowVS->SetShader();
+		for (DrawItem& item : packet.shadowList)
+			drawCaster(item);
 	}
+	else
+	{
+		// Casters sharing a mesh are one draw, lone ones keep the regular shader
+		shadowInstancedVS->SetMatrix4x4("viewProjection", packet.shadowViewProjection);
+		shadowInstancedVS->CopyBufferData("PerFrame");
 
-	// Reset pipeline
-	viewport.Width = (float)Window::Width();
-	viewport.Height = (float)Window::Height();
-	Graphics::Context->RSSetViewports(1, &viewport);
-	Graphics::Context->OMSetRenderTargets(1, 
-		ppRTV.GetAddressOf(), 
-		Graphics::DepthBufferDSV.Get());
-	Graphics::Context->RSSetState(0);
+		unsigned int shadowInstanceStart = (unsigned int)packet.drawList.size();
+		SimpleVertexShader* boundShadowShader = nullptr;
+		for (const DrawBatch& batch : packet.shadowBatches)
+		{
+			SimpleVertexShader* shader = batch.count > 1 ? shadowInstancedVS.get() : shadowVS.get();
+			if (shader != boundShadowShader)
+			{
+				shader->SetShader();
+				boundShadowShader = shader;
+			}
 
+			if (batch.count > 1)
+				packet.shadowList[batch.first].mesh->DrawInstanced(commands, batch.count, shadowInstanceStart + batch.first);
+			else
+				drawCaster(packet.shadowList[batch.first]);
+		}
+	}
+
+	// Reset pipeline, lists recorded on other threads start from here too since
+	// a deferred context begins every list with nothing bound
+	auto setMainPass = [&](CommandList& list)
+	{
+		list.SetViewport((float)Window::Width(), (float)Window::Height());
+		list.SetTargets(ppRTV.Get(), Graphics::DepthBufferDSV.Get());
+		list.SetTopology(RENDER_TOPOLOGY_TRIANGLE_LIST);
+		list.SetRasterizerState(0);
+		if (packet.instancing && !packet.instances.empty())
+			list.SetVertexBuffer(1, instanceBuffer.Get(), sizeof(InstanceData));
+	};
+	setMainPass(commands);
+
+	// Depth of every opaque draw, nearest first with no pixel shader, through the
+	// shadow shaders which match the main ones' math, regular or instanced
+	// - Written with the default depth state, opaque draws after it only pass
+	//   where their depth is equal
+	if (packet.depthPrepass && packet.firstTransparent > 0)
+	{
+		commands.SetDepthStencilState(0, 0);
+		if (!packet.instancing)
+		{
+			shadowVS->SetShader();
+			for (unsigned int slot : packet.depthOrder)
+				drawCaster(packet.drawList[slot]);
+		}
+		else
+		{
+			// The shadow pass's light matrix is already recorded, this replaces it from here on
+			shadowInstancedVS->SetMatrix4x4("viewProjection", packet.viewProjection);
+			shadowInstancedVS->CopyBufferData("PerFrame");
+
+			unsigned int depthInstanceStart = (unsigned int)(packet.drawList.size() + packet.shadowList.size());
+			SimpleVertexShader* boundDepthShader = nullptr;
+			for (const DrawBatch& batch : packet.depthBatches)
+			{
+				bool instanced = packet.instancedDraws[packet.depthOrder[batch.first]];
+				SimpleVertexShader* shader = instanced ? shadowInstancedVS.get() : shadowVS.get();
+				if (shader != boundDepthShader)
+				{
+					shader->SetShader();
+					boundDepthShader = shader;
+				}
+
+				if (instanced)
+					packet.drawList[packet.depthOrder[batch.first]].mesh->DrawInstanced(commands, batch.count, depthInstanceStart + batch.first);
+				else
+					drawCaster(packet.drawList[packet.depthOrder[batch.first]]);
+			}
+		}
+		commands.SetDepthStencilState(prepassEqualDepth.Get(), 0);
+	}
+
+	// What the last draw of one command list left bound, and its copy of the
+	// constants being filled, so each list can be recorded on its own thread
+	struct BoundState
+	{
+		SimpleVertexShader* vertexShader = nullptr;
+		SimplePixelShader* pixelShader = nullptr;
+		Material* material = nullptr;
+		ConstantStaging staging;
+	};
+
+	// Shaders whose per frame data is already up, only ever added to on this thread
+	std::vector<ISimpleShader*> frameUploaded;
+	auto uploadFrameData = [&](ISimpleShader* shader, bool pixel)
+	{
+		if (std::find(frameUploaded.begin(), frameUploaded.end(), shader) != frameUploaded.end())
+			return;
+
+		// Only the instanced shader has per frame vertex data, the others skip these
+		if (!pixel)
+		{
+			shader->SetMatrix4x4("viewProjection", packet.viewProjection);
+			shader->SetMatrix4x4("shadowViewProjection", packet.shadowViewProjection);
+		}
+		else
+		{
+			shader->SetFloat3("cameraPosition", packet.camera.position);
+			shader->SetFloat3("ambientLight", packet.ambientLight);
+			shader->SetData(
+				"lights",
+				&packet.lights[0],
+				sizeof(Light) * (int)packet.lights.size());
+		}
+		shader->CopyBufferData("PerFrame");
+		frameUploaded.push_back(shader);
+	};
+
+	// Per frame data goes up once for each shader the first time it is used,
+	// and per material data whenever the material changes
+	auto bindMaterial = [&](CommandList& list, BoundState& bound, Material* material, const std::shared_ptr<SimpleVertexShader>& vertexShader)
+	{
+		std::shared_ptr<SimplePixelShader> pixelShader = material->GetPixelShader();
+
+		if (vertexShader.get() != bound.vertexShader)
+		{
+			vertexShader->SetShader();
+			uploadFrameData(vertexShader.get(), false);
+			bound.vertexShader = vertexShader.get();
+		}
+
+		if (pixelShader.get() != bound.pixelShader)
+		{
+			pixelShader->SetShader();
+			uploadFrameData(pixelShader.get(), true);
+
+			// Shadow map slots differ between shaders, and the material's textures go on top
+			pixelShader->SetShaderResourceView("ShadowMap", shadowSRV);
+			pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
+			bound.pixelShader = pixelShader.get();
+			bound.material = nullptr;
+		}
+
+		if (material != bound.material)
+		{
+			bound.staging.Begin(pixelShader.get(), "PerMaterial");
+			material->PrepareMaterial(bound.staging);
+			bound.staging.Record(list);
+			bound.material = material;
+		}
+	};
+
+	// Only the matrices go up for every draw
+	auto drawBatched = [&](CommandList& list, BoundState& bound, DrawItem& item)
+	{
+		std::shared_ptr<SimpleVertexShader> vertexShader = item.material->GetVertexShader();
+		bindMaterial(list, bound, item.material, vertexShader);
+
+		ConstantStaging& perObject = bound.staging;
+		perObject.Begin(vertexShader.get(), "PerObject");
+		perObject.SetMatrix4x4("m4World", item.world);
+		perObject.SetMatrix4x4("m4WorldInvTranspose", item.worldInvTranspose);
+		perObject.SetMatrix4x4("m4WorldViewProjection", item.worldViewProjection);
+		perObject.SetMatrix4x4("m4ShadowWorldViewProjection", item.shadowWorldViewProjection);
+		perObject.Record(list);
+
+		item.mesh->Draw(list);
+	};
 
 	// DRAW geometry, each mesh is drawn seperately as mesh class has been created
-	for (UINT i = 0; i < entities.size(); i++)
+	// - Without the split everything is set and uploaded again for every draw,
+	//   through the shaders' own buffers, so that is only ever done on this thread
+	auto drawItem = [&](CommandList& list, BoundState& bound, DrawItem& item)
 	{
-		// Pass in shadow data to the vertex shader
-		std::shared_ptr<SimpleVertexShader> vertexShader = entities[i]->GetMaterial()->GetVertexShader();
-		vertexShader->SetMatrix4x4("lightView", lightViewMatrix);
-		vertexShader->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+		if (packet.splitConstantBuffers)
+		{
+			drawBatched(list, bound, item);
+			return;
+		}
 
 		// Pass in the ambient light to each shader
-		std::shared_ptr<SimplePixelShader> pixelShader = entities[i]->GetMaterial()->GetPixelShader();
-		pixelShader->SetFloat3("ambientLight", ambientLight);
+		std::shared_ptr<SimplePixelShader> pixelShader = item.material->GetPixelShader();
+		pixelShader->SetFloat3("ambientLight", packet.ambientLight);
 		pixelShader->SetData(
 			"lights",
-			&lights[0],
-			sizeof(Light) * (int)lights.size());
+			&packet.lights[0],
+			sizeof(Light) * (int)packet.lights.size());
 
 		// Pass in shadow data to pixel shader
 		pixelShader->SetShaderResourceView("ShadowMap", shadowSRV);
 		pixelShader->SetSamplerState("ShadowSampler", shadowSampler);
 
-		entities[i]->Draw(*currentCamera);
+		GameEntity::Draw(list, item, packet.camera);
+	};
+
+	// A batch of more than one draw is a single instanced call when its material has
+	// an instanced shader, the draw list's order is kept either way
+	auto drawBatch = [&](CommandList& list, BoundState& bound, const DrawBatch& batch)
+	{
+		DrawItem& first = packet.drawList[batch.first];
+		std::shared_ptr<SimpleVertexShader> instancedShader = first.material->GetInstancedVertexShader();
+		if (batch.count < 2 || !instancedShader)
+		{
+			for (unsigned int i = batch.first; i < batch.first + batch.count; i++)
+				drawItem(list, bound, packet.drawList[i]);
+			return;
+		}
+
+		bindMaterial(list, bound, first.material, instancedShader);
+		first.mesh->DrawInstanced(list, batch.count, batch.first);
+	};
+
+	// Draws list entries [start, end), batches never cross the transparent boundary
+	// since blended and opaque draws can't share a material
+	auto drawRange = [&](CommandList& list, BoundState& bound, unsigned int start, unsigned int end)
+	{
+		if (!packet.instancing)
+		{
+			for (unsigned int i = start; i < end; i++)
+				drawItem(list, bound, packet.drawList[i]);
+			return;
+		}
+
+		for (const DrawBatch& batch : packet.batches)
+		{
+			if (batch.first >= start && batch.first < end)
+				drawBatch(list, bound, batch);
+		}
+	};
+
+	// Opaque geometry first, sorted by state then nearest first
+	// - Split into contiguous slices of the draw list, each recorded by a job into its own
+	//   list and executed in order, more than one only works with split constant buffers
+	unsigned int opaqueCount = packet.firstTransparent;
+	unsigned int sliceCount = packet.splitConstantBuffers ? std::clamp(packet.recordSlices, 1u, std::max(1u, opaqueCount)) : 1;
+	bool deferred = sliceCount > 1 && packet.deferredContexts && !packet.nullBackend;
+	if (sliceCount == 1)
+	{
+		BoundState bound;
+		drawRange(commands, bound, 0, opaqueCount);
 	}
+	else
+	{
+		// Jobs only read the shaders, so every per frame upload they need happens here first
+		Material* lastMaterial = nullptr;
+		for (unsigned int i = 0; i < opaqueCount; i++)
+		{
+			Material* material = packet.drawList[i].material;
+			if (material == lastMaterial)
+				continue;
+
+			uploadFrameData(material->GetVertexShader().get(), false);
+			uploadFrameData(material->GetPixelShader().get(), true);
+			if (packet.instancing && material->GetInstancedVertexShader())
+				uploadFrameData(material->GetInstancedVertexShader().get(), false);
+			lastMaterial = material;
+		}
+
+		if (sliceCommands.size() < sliceCount)
+			sliceCommands.resize(sliceCount);
+		while (deferred && deferredBackends.size() < sliceCount)
+		{
+			Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+			Graphics::Device->CreateDeferredContext(0, context.GetAddressOf());
+			deferredBackends.push_back(std::make_unique<D3D11Backend>(context));
+			deferredContexts.push_back(context);
+			deferredLists.emplace_back();
+		}
 
-	// After drawing all geometry draw the sky
-	skybox->Draw(*currentCamera);
+		// One slice per job, each job with a deferred context also turns its slice into
+		// a Direct3D command list, so that work is spread over the threads as well
+		JobSystem::ParallelFor(sliceCount, [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int slice = start; slice < end; slice++)
+			{
+				CommandList& list = sliceCommands[slice];
+				list.Reset();
+
+				// Jobs can run on the thread that waits for them, which is recording too
+				CommandList* recording = ISimpleShader::Recording;
+				ISimpleShader::Recording = &list;
+				setMainPass(list);
+				if (packet.depthPrepass && packet.firstTransparent > 0)
+					list.SetDepthStencilState(prepassEqualDepth.Get(), 0);
+				BoundState bound;
+				drawRange(list, bound, opaqueCount * slice / sliceCount, opaqueCount * (slice + 1) / sliceCount);
+				ISimpleShader::Recording = recording;
+
+				if (deferred)
+				{
+					// Other contexts wrote to the same buffers since this one last ran
+					D3D11Backend& backend = *deferredBackends[slice];
+					backend.ForgetState();
+					backend.ResetCounts();
+					backend.SetFiltering(packet.filterState);
+					backend.Execute(list);
+					deferredContexts[slice]->FinishCommandList(FALSE, deferredLists[slice].ReleaseAndGetAddressOf());
+				}
+			}
+		}, 1);
+	}
+
+	// Whatever follows the slices goes in a list of its own, executed after them
+	CommandList& late = sliceCount > 1 ? lateCommands : commands;
+	if (sliceCount > 1)
+	{
+		late.Reset();
+		ISimpleShader::Recording = &late;
+		setMainPass(late);
+	}
+
+	// After drawing all opaque geometry draw the sky, it sets its own shaders and
+	// depth state, and leaves the default one bound
+	skybox->Draw(late, packet.camera);
+
+	// Blended geometry last, furthest first, over the sky
+	if (packet.firstTransparent < packet.drawList.size())
+	{
+		BoundState bound;
+		late.SetBlendState(transparentBlend.Get());
+		late.SetDepthStencilState(transparentDepth.Get(), 0);
+		drawRange(late, bound, packet.firstTransparent, (unsigned int)packet.drawList.size());
+		late.SetBlendState(0);
+		late.SetDepthStencilState(0, 0);
+	}
 
 	// Anything to do with post processing
 	{
-		Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), 0);
+		late.SetTargets(Graphics::BackBufferRTV.Get(), nullptr);
 
 		// Set up shaders and set required buffers
 		ppVS->SetShader();
@@ -680,36 +1647,135 @@ void Game::Draw(float deltaTime, float totalTime)
 		blurPS->SetShaderResourceView("Pixels", ppSRV.Get());
 		blurPS->SetSamplerState("ClampSampler", ppSampler.Get());
 		
-		blurPS->SetInt("blurRadius", *blurRadius);
+		blurPS->SetInt("blurRadius", packet.blurRadius);
 		blurPS->SetFloat("pixelWidth", 1.0f / Window::Width());
 		blurPS->SetFloat("pixelHeight", 1.0f / Window::Height());
 		blurPS->CopyAllBufferData();
 
-		Graphics::Context->Draw(3, 0);
+		late.Draw(3, 0);
+
+		// Shadow map and post process views go back to being targets next frame
+		late.UnbindTextures(RENDER_STAGE_PIXEL);
+	}
+
+	// Recording is done, the null backend only counts and checks what the GPU would be asked to do
+	ISimpleShader::Recording = nullptr;
+	auto recordEnd = std::chrono::high_resolution_clock::now();
+	if (packet.nullBackend)
+	{
+		nullBackend.Reset();
+		nullBackend.Execute(commands);
+		if (sliceCount > 1)
+		{
+			for (unsigned int slice = 0; slice < sliceCount; slice++)
+				nullBackend.Execute(sliceCommands[slice]);
+			nullBackend.Execute(late);
+		}
+		nullDraws = nullBackend.GetDrawCount();
+		nullErrors = nullBackend.GetErrorCount();
+		nullFirstError = nullBackend.GetFirstError();
+
+		// What the cache would have dropped had this gone to the GPU
+		unsigned int filtered = packet.filterState ? nullBackend.GetRedundantCount() : 0;
+		stateIssued = nullBackend.GetStateCount() - filtered;
+		stateFiltered = filtered;
+	}
+	else
+	{
+		gpuBackend->ResetCounts();
+		gpuBackend->SetFiltering(packet.filterState);
+		gpuBackend->Execute(commands);
+		unsigned int issued = 0;
+		unsigned int filtered = 0;
+		if (sliceCount > 1)
+		{
+			for (unsigned int slice = 0; slice < sliceCount; slice++)
+			{
+				if (!deferred)
+				{
+					gpuBackend->Execute(sliceCommands[slice]);
+					continue;
+				}
+
+				// Each list leaves the context with nothing bound, the next one starts from scratch
+				Graphics::Context->ExecuteCommandList(deferredLists[slice].Get(), FALSE);
+				deferredLists[slice].Reset();
+				issued += deferredBackends[slice]->GetIssuedCount();
+				filtered += deferredBackends[slice]->GetFilteredCount();
+			}
+			if (deferred)
+				gpuBackend->ForgetState();
+			gpuBackend->Execute(late);
+		}
+		stateIssued = issued + gpuBackend->GetIssuedCount();
+		stateFiltered = filtered + gpuBackend->GetFilteredCount();
+	}
+	auto executeEnd = std::chrono::high_resolution_clock::now();
+
+	recordMs = std::chrono::duration<float, std::milli>(recordEnd - recordStart).count();
+	executeMs = std::chrono::duration<float, std::milli>(executeEnd - recordEnd).count();
+	unsigned int listCommands = commands.Count();
+	size_t listBytes = commands.GetMemoryUsed();
+	if (sliceCount > 1)
+	{
+		for (unsigned int slice = 0; slice < sliceCount; slice++)
+		{
+			listCommands += sliceCommands[slice].Count();
+			listBytes += sliceCommands[slice].GetMemoryUsed();
+		}
+		listCommands += late.Count();
+		listBytes += late.GetMemoryUsed();
+	}
+	commandCount = listCommands;
+	commandBytes = (unsigned int)listBytes;
+	recordedSlices = sliceCount;
+
+	// Keep the lists in the order they were executed, then see what they cost alone
+	if (packet.capture)
+	{
+		capture.Clear();
+		capture.frame = packet.frame;
+		capture.Add(commands);
+		if (sliceCount > 1)
+		{
+			for (unsigned int slice = 0; slice < sliceCount; slice++)
+				capture.Add(sliceCommands[slice]);
+			capture.Add(late);
+		}
+
+		char fileName[64];
+		snprintf(fileName, sizeof(fileName), FRAME_CAPTURE_FILE, packet.frame);
+		captureSaved = capture.Save(FixPath(fileName));
+
+		NullBackend replayBackend;
+		FrameReplayTimings timings;
+		capture.Replay(replayBackend, false, timings);
+		captureReplayMs = (float)timings.totalMs;
+		captureCommands = capture.GetCommandCount();
+		captureBytes = (unsigned int)capture.GetFileSize();
+		capturedFrame = packet.frame;
 	}
 
 	// Frame END
 	// - These should happen exactly ONCE PER FRAME
 	// - At the very end of the frame (after drawing *everything*)
 	{
-		// Render UI at the end of frame
-		ImGui::Render(); //Turn data into triangles to draw
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); //Draw triangles
+		// ImGui fills its own buffers, so this is every constant buffer upload the frame made
+		uploadedBytes = ISimpleShader::UploadedBytes.load();
+
+		// Render UI at the end of frame, triangles were copied when the packet was made
+		ImGui_ImplDX11_RenderDrawData(&packet.ui); //Draw triangles
 
 		// Present at the end of the frame
 		Graphics::SwapChain->Present(
-			vsync ? 1 : 0,
-			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+			packet.vsync ? 1 : 0,
+			packet.vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
 
 		// Re-bind back buffer and depth buffer after presenting
 		Graphics::Context->OMSetRenderTargets(
 			1,
 			Graphics::BackBufferRTV.GetAddressOf(),
 			Graphics::DepthBufferDSV.Get());
-
-		// Unbind shadow map
-		ID3D11ShaderResourceView* nullSRVs[128] = {};
-		Graphics::Context->PSSetShaderResources(0, 128, nullSRVs);
 	}
 }
 
@@ -800,20 +1866,40 @@ void Game::CustomizeUIContext()
 	// UI tree for game entities
 	if (ImGui::TreeNode("Entities"))
 	{
+		// Right clicking the scene picks whatever is under the cursor, stress entities included
+		Transform* picked = registry.GetTransform(pickHit.entity);
+		if (picked)
+		{
+			ImGui::Text("Picked: slot %u, triangle %u, at (%.2f, %.2f, %.2f)",
+				EntityIndex(pickHit.entity), pickHit.triangle, pickHit.point.x, pickHit.point.y, pickHit.point.z);
+
+			XMFLOAT3 position = picked->GetPosition();
+			XMFLOAT3 rotation = picked->GetPitchYawRoll();
+			XMFLOAT3 scale = picked->GetScale();
+			if (ImGui::DragFloat3("Picked position", &position.x, 0.1f)) picked->SetPosition(position);
+			if (ImGui::DragFloat3("Picked rotation", &rotation.x, 0.1f)) picked->SetRotation(rotation);
+			if (ImGui::DragFloat3("Picked scale", &scale.x, 0.1f)) picked->SetScale(scale);
+		}
+		else
+		{
+			ImGui::Text("Right click the scene to pick an entity");
+		}
+		ImGui::Text("Last pick: %.1f us", pickMicroseconds);
+
 		for (UINT i = 0; i < entities.size(); i++)
 		{
 			ImGui::PushID(i);
 			// Reference floats for position, rotation, and scale
-			XMFLOAT3 position = entities[i]->GetTransform()->GetPosition();
-			XMFLOAT3 rotation = entities[i]->GetTransform()->GetPitchYawRoll();
-			XMFLOAT3 scale = entities[i]->GetTransform()->GetScale();
+			XMFLOAT3 position = entities[i].GetTransform()->GetPosition();
+			XMFLOAT3 rotation = entities[i].GetTransform()->GetPitchYawRoll();
+			XMFLOAT3 scale = entities[i].GetTransform()->GetScale();
 
 			if (ImGui::TreeNode("Entity", "Entity: %d", i))
 			{
 				// Display each float3
-				if (ImGui::DragFloat3("Position", &position.x, 0.1f)) entities[i]->GetTransform()->SetPosition(position);
-				if (ImGui::DragFloat3("Rotation", &rotation.x, 0.1f)) entities[i]->GetTransform()->SetRotation(rotation);
-				if (ImGui::DragFloat3("Scale", &scale.x, 0.1f)) entities[i]->GetTransform()->SetScale(scale);
+				if (ImGui::DragFloat3("Position", &position.x, 0.1f)) entities[i].GetTransform()->SetPosition(position);
+				if (ImGui::DragFloat3("Rotation", &rotation.x, 0.1f)) entities[i].GetTransform()->SetRotation(rotation);
+				if (ImGui::DragFloat3("Scale", &scale.x, 0.1f)) entities[i].GetTransform()->SetScale(scale);
 				ImGui::TreePop();
 			}
 			ImGui::PopID();
@@ -829,14 +1915,17 @@ void Game::CustomizeUIContext()
 		if (ImGui::RadioButton("Camera 1: 90FOV", &selected, 0))
 		{
 			currentCamera = cameras[0];
+			registry.InvalidateVisibility();
 		}
 		if (ImGui::RadioButton("Camera 2: 120FOV", &selected, 1))
 		{
 			currentCamera = cameras[1];
+			registry.InvalidateVisibility();
 		}
 		if (ImGui::RadioButton("Camera 3: 60FOV", &selected, 2))
 		{
 			currentCamera = cameras[2];
+			registry.InvalidateVisibility();
 		}
 
 		// Display information about each camera
@@ -871,17 +1960,18 @@ void Game::CustomizeUIContext()
 					ImGui::Image((ImTextureID)texture.second.Get(), ImVec2(256, 256));
 				}
 
-				// Color tint
+				// Color tint, UV scale and offset
+				// - The render thread may still be drawing with this material, so
+				//   changes are queued and applied by ApplyMaterialEdits()
 				XMFLOAT4 color = materials[i]->GetColor();
-				if (ImGui::ColorEdit4("Color Tint", &color.x))
-					materials[i]->SetColor(color);
-				
-				// UV scale and offset
 				XMFLOAT2 scale = materials[i]->GetScale();
 				XMFLOAT2 offset = materials[i]->GetOffset();
-				
-				if (ImGui::DragFloat2("UV Scale", &scale.x, 0.2f, 1.0f, 10.0f)) materials[i]->SetScale(scale);
-				if (ImGui::DragFloat2("UV Offset", &offset.x, 0.2f, -10.0f, 10.0f)) materials[i]->SetOffset(offset);
+
+				bool edited = ImGui::ColorEdit4("Color Tint", &color.x);
+				edited |= ImGui::DragFloat2("UV Scale", &scale.x, 0.2f, 1.0f, 10.0f);
+				edited |= ImGui::DragFloat2("UV Offset", &offset.x, 0.2f, -10.0f, 10.0f);
+				if (edited)
+					materialEdits.push_back({ materials[i].get(), color, scale, offset });
 
 				ImGui::TreePop();
 			}
@@ -923,6 +2013,148 @@ void Game::CustomizeUIContext()
 		ImGui::TreePop();
 	}
 
+	// Counters from the last frame
+	if (ImGui::TreeNode("Frame Stats"))
+	{
+		ImGui::Text("Entities: %u", stats.entityCount);
+		ImGui::Text("Changed transforms: %u", stats.changedTransforms);
+		ImGui::Text("Draws: %u", stats.drawCount);
+		ImGui::Text("Visible: %u Culled: %u", stats.visibleCount, stats.culledCount);
+		ImGui::Text("Shadow casters: %u Culled: %u", stats.casterCount, stats.casterCulledCount);
+		ImGui::Text("Spawned: %u Despawned: %u", stats.spawned, stats.despawned);
+		ImGui::Text("Spawn churn: %.3f ms", stats.churnMs);
+		ImGui::Text("Bounds update: %.3f ms", stats.boundsMs);
+		ImGui::Text("Culling (camera and shadows): %.3f ms", stats.cullMs);
+
+		// Brute force tests 8 bounds per step with AVX2 and 4 with SSE, all three give the same answer
+		int cullKernel = registry.GetCullKernel();
+		if (ImGui::Combo("Cull kernel", &cullKernel, "Scalar\0SSE (4 wide)\0AVX2 (8 wide)\0"))
+			registry.SetCullKernel(cullKernel);
+		if (registry.GetSpatialIndex())
+			ImGui::Text("Kernel rate: only used without a scene index");
+		else
+			ImGui::Text("Kernel rate: %.2f bounds/ns", stats.cullRate);
+
+		// One pass gives a mask per view: this camera, the shadow casters and the other cameras
+		ImGui::Checkbox("Multi-view culling", &multiViewCulling);
+		if (multiViewCulling)
+		{
+			ImGui::Text("Views: %u Camera: %u Casters: %u", stats.viewCount, stats.viewVisible[0], stats.viewVisible[1]);
+			for (unsigned int v = 2; v < stats.viewCount; v++)
+				ImGui::Text("Other camera %u: %u visible", v - 1, stats.viewVisible[v]);
+		}
+
+		// Only entities that moved or sit near a plane the camera could have pushed past
+		// get retested, everything is rechecked every so often and on camera switches
+		ImGui::Checkbox("Temporal culling (single view)", &temporalCulling);
+		int revalidateFrames = (int)registry.GetRevalidateInterval();
+		if (ImGui::SliderInt("Full revalidation (frames)", &revalidateFrames, 1, 240))
+			registry.SetRevalidateInterval(revalidateFrames);
+		ImGui::Text("Camera tests skipped: %.1f%%", stats.temporalSkipShare * 100.0f);
+
+		// Rasterizes the floor and stress walls on the CPU, then tests what's left in view against them
+		ImGui::Checkbox("Occlusion culling", &occlusionEnabled);
+		unsigned int inFrustum = stats.visibleCount + stats.occludedCount;
+		ImGui::Text("Occluded: %u (%.1f%% of in view) Occluder triangles: %u",
+			stats.occludedCount, inFrustum ? 100.0f * stats.occludedCount / inFrustum : 0.0f, stats.occluderTriangles);
+		ImGui::Text("Occlusion (raster and test): %.3f ms", stats.occlusionMs);
+
+		// Brute force tests every entity in parallel, the tree skips whole groups at
+		// once, the grid is cheapest to keep up to date when lots of entities travel
+		if (ImGui::Combo("Scene index", &spatialIndexType, "None (brute force)\0BVH\0Grid\0Auto\0"))
+			registry.SetSpatialIndex(spatialIndexType);
+		if (registry.GetSpatialIndex() == &registry.GetTree())
+			ImGui::Text("BVH height: %u Reinserted: %u", stats.treeHeight, stats.indexMoves);
+		else if (registry.GetSpatialIndex() == &registry.GetGrid())
+			ImGui::Text("Grid cells: %u Size: %.2f Changed cell: %u", stats.gridCells, stats.gridCellSize, stats.indexMoves);
+		ImGui::Text("Draw list build: %.3f ms", stats.drawListMs);
+
+		// Shader, material and mesh binds in the order culling left the draws, and once sorted
+		ImGui::Checkbox("Sort draws", &sortDraws);
+		ImGui::Text("State changes: %u unsorted, %u sorted", stats.stateChangesUnsorted, stats.stateChangesSorted);
+		ImGui::Text("Key build and sort: %.3f ms Transparent: %u", stats.sortMs, stats.transparentCount);
+
+		// Levels are picked by how many pixels their error would cover, bias doubles that per step
+		ImGui::SliderFloat("LOD pixel error", &lodSettings.pixelError, 0.1f, 16.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+		ImGui::SliderFloat("LOD hysteresis", &lodSettings.hysteresis, 0.0f, 0.9f);
+		ImGui::SliderFloat("LOD bias", &lodSettings.bias, -2.0f, 4.0f);
+		ImGui::Text("Visible per LOD: %u / %u / %u / %u", stats.lodCounts[0], stats.lodCounts[1], stats.lodCounts[2], stats.lodCounts[3]);
+		ImGui::Text("Triangles: %u LOD selection: %.3f ms", stats.triangleCount, stats.lodMs);
+
+		// Threaded, a CPU bound frame costs roughly max(update, render) instead of the sum
+		if (ImGui::Checkbox("Render thread", &renderThreaded))
+			pipeline.SetThreaded(renderThreaded);
+		ImGui::Text("Update: %.3f ms", stats.updateMs);
+		ImGui::Text("Render: %.3f ms", stats.renderMs);
+		ImGui::Text("Waiting on render thread: %.3f ms", stats.fenceWaitMs);
+
+		// Per frame, per material and per object buffers each go up only when they change
+		ImGui::Checkbox("Split constant buffers", &splitConstantBuffers);
+		ImGui::Text("Constant buffer uploads: %.1f KB", stats.uploadedBytes / 1024.0f);
+
+		// Runs of draws sharing a mesh and material become one call, needs the split buffers
+		ImGui::Checkbox("Instancing", &instancing);
+		ImGui::Text("Draw calls: %u for %u entities", stats.drawCalls, stats.drawCount);
+		ImGui::Text("Shadow draw calls: %u for %u casters", stats.shadowDrawCalls, stats.casterCount);
+
+		// Entities that never move merged per material and chunk, off draws each one alone
+		if (ImGui::Checkbox("Static batching", &staticBatching))
+			SyncStaticBatching();
+		ImGui::Text("Static: %u entities in %u chunks, %u drawn, %.1f KB", stats.staticMembers, stats.staticChunks, stats.staticDraws, stats.staticBytes / 1024.0f);
+		ImGui::Text("Chunks merged: %u (%.3f ms)", stats.staticMerges, stats.staticMs);
+
+		// The frame is recorded either way, the null backend skips the GPU and checks the list instead
+		ImGui::Checkbox("Null backend (scene isn't drawn)", &nullBackendEnabled);
+		ImGui::Text("Commands: %u (%.1f KB)", stats.commandCount, stats.commandBytes / 1024.0f);
+		ImGui::Text("Record: %.3f ms Execute: %.3f ms", stats.recordMs, stats.executeMs);
+		if (nullBackendEnabled)
+			ImGui::Text("Null backend: %u draws, %u errors %s", stats.nullDraws, stats.nullErrors, stats.nullFirstError ? stats.nullFirstError : "");
+
+		// The next frame's lists go to a file, UI triangles aren't recorded so they aren't in it
+		if (ImGui::Button("Capture frame"))
+			captureRequested = true;
+		if (stats.captureCommands > 0)
+		{
+			ImGui::Text("Frame %llu: %u commands, %.1f KB%s", stats.capturedFrame, stats.captureCommands, stats.captureBytes / 1024.0f, stats.captureSaved ? "" : ", couldn't save");
+			ImGui::Text("Null backend replay: %.3f ms", stats.captureReplayMs);
+		}
+
+		// Binds of what is already bound, and uploads of unchanged constants, never reach the driver
+		ImGui::Checkbox("Filter redundant state", &filterState);
+		ImGui::Text("State calls: %u issued, %u filtered", stats.stateIssued, stats.stateFiltered);
+
+		// Opaque draws recorded by that many jobs at once, only with the split buffers
+		ImGui::SliderInt("Recording slices", &recordSlices, 1, 16);
+		ImGui::Checkbox("Deferred contexts", &deferredContextsEnabled);
+		ImGui::Text("Recorded in %u slices", stats.recordedSlices);
+
+		// Opaque depth first, so the main pass shades each covered pixel once
+		ImGui::Checkbox("Depth pre-pass", &depthPrepass);
+		ImGui::Text("Opaque overdraw estimate: %.2fx the screen", stats.overdraw);
+		if (depthPrepass)
+			ImGui::Text("Pre-pass: %u draw calls, main pass shades each pixel once", stats.prepassDrawCalls);
+		ImGui::TreePop();
+	}
+
+	// Spawning lots of entities to measure CPU cost
+	if (ImGui::TreeNode("Stress Test"))
+	{
+		ImGui::DragInt("Count", &stressCount, 100.0f, 0, 1000000);
+		ImGui::SliderInt("Moving %", &stressMovingPercent, 0, 100);
+		ImGui::Checkbox("Swarm (moving entities travel)", &stressSwarm);
+		ImGui::DragInt("Churn per frame", &stressChurn, 10.0f, 0, 10000);
+		if (ImGui::Button("Spawn")) SpawnStressEntities(stressCount);
+		ImGui::SameLine();
+		if (ImGui::Button("Clear")) ClearStressEntities();
+		ImGui::Text("Stress entities: %d", (int)stressEntities.size());
+
+		// Props never move, so static batching can merge them
+		ImGui::DragInt("Static props", &stressPropCount, 100.0f, 0, 100000);
+		if (ImGui::Button("Spawn props")) SpawnStressProps(stressPropCount);
+		ImGui::Text("Static props: %d", (int)stressProps.size());
+		ImGui::TreePop();
+	}
+
 	// End UI
 	ImGui::End();
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <d3d11.h>
 #include <wrl/client.h>
 #include <memory>
+#include <atomic>
 #include "Mesh.h"
 #include "GameEntity.h"
 #include <vector>
@@ -11,6 +12,17 @@
 #include "Material.h"
 #include "Lights.h"
 #include "Sky.h"
+#include "EntityRegistry.h"
+#include "FrameStats.h"
+#include "FramePipeline.h"
+#include "OcclusionBuffer.h"
+#include "LodChain.h"
+#include "RenderQueue.h"
+#include "StaticBatcher.h"
+#include "CommandList.h"
+#include "NullBackend.h"
+#include "D3D11Backend.h"
+#include "FrameCapture.h"
 
 class Game
 {
@@ -31,6 +43,16 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void CreateGeometry();
+	std::shared_ptr<Mesh> CreateSphere(int slices, const char* name);
+
+	// Draws a finished frame, possibly on the render thread
+	void Render(RenderPacket& packet);
+
+	// Stress testing
+	void SpawnStressEntities(int count);
+	void SpawnStressProps(int count);
+	void ClearStressEntities();
+	void SyncStaticBatching();
 
 	// ImGui usage
 	void UpdateUIContext(float deltaTime);
@@ -44,12 +66,139 @@ private:
 	// Smart pointers for meshes
 	std::vector<std::shared_ptr<Mesh>> meshes;
 
-	// Smart pointer for game entities
-	std::vector<std::shared_ptr<GameEntity>> entities;
+	// Coarser spheres swapped in by distance, and how levels get picked
+	LodChain sphereLods;
+	LodSettings lodSettings;
+
+	// Components for every entity and handles to the ones shown in the UI
+	EntityRegistry registry;
+	std::vector<GameEntity> entities;
+
+	// Entities only spawned for stress testing, and walls between their rows
+	std::vector<Entity> stressEntities;
+	std::vector<Entity> stressWalls;
+	std::vector<Entity> stressProps;
+	int stressPropCount;
+	int stressCount;
+	int stressMovingPercent;
+	int stressChurn;
+	bool stressSwarm;
+	int spatialIndexType;
+	size_t churnCursor;
+	unsigned int churnSpawned;
+	unsigned int churnDespawned;
+	float churnMs;
+
+	// Frames are handed to the pipeline to be drawn while the next one updates
+	FramePipeline pipeline;
+	bool renderThreaded;
+	float updateMs;
+
+	// Constant buffers uploaded at their own rate instead of all of them every draw,
+	// and the bytes the last drawn frame uploaded, written by the render thread
+	bool splitConstantBuffers;
+	std::atomic<unsigned int> uploadedBytes;
+
+	// Neighbouring draws sharing a mesh and material go out as one instanced draw,
+	// every instance's matrices live in one dynamic buffer the render thread refills
+	bool instancing;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+	unsigned int instanceCapacity;
+	std::shared_ptr<SimpleVertexShader> shadowInstancedVS;
+
+	// The render thread records each frame here and a backend plays it back, the
+	// null backend only counts and checks it, so the CPU cost can be measured alone
+	CommandList commands;
+	std::unique_ptr<D3D11Backend> gpuBackend;
+	NullBackend nullBackend;
+	bool nullBackendEnabled;
+
+	// Drop binds and uploads that wouldn't change the context's state
+	bool filterState;
+
+	// Opaque draws split into this many slices, each recorded by a job into its own
+	// list, then turned into Direct3D command lists on deferred contexts by the same
+	// jobs or replayed one after another, whatever follows the slices gets its own list
+	int recordSlices;
+	bool deferredContextsEnabled;
+	std::vector<CommandList> sliceCommands;
+	CommandList lateCommands;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DeviceContext>> deferredContexts;
+	std::vector<std::unique_ptr<D3D11Backend>> deferredBackends;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11CommandList>> deferredLists;
+
+	// The next frame's lists are kept, saved next to the executable and timed
+	// on a null backend once drawn, Tools/FrameReplay.cpp replays the file offline
+	bool captureRequested;
+	FrameCapture capture;
+
+	// Written by the render thread for the last drawn frame
+	std::atomic<float> recordMs;
+	std::atomic<float> executeMs;
+	std::atomic<unsigned int> commandCount;
+	std::atomic<unsigned int> commandBytes;
+	std::atomic<unsigned int> nullDraws;
+	std::atomic<unsigned int> nullErrors;
+	std::atomic<const char*> nullFirstError;
+	std::atomic<unsigned int> stateIssued;
+	std::atomic<unsigned int> stateFiltered;
+	std::atomic<unsigned int> recordedSlices;
+	std::atomic<unsigned long long> capturedFrame;
+	std::atomic<unsigned int> captureCommands;
+	std::atomic<unsigned int> captureBytes;
+	std::atomic<float> captureReplayMs;
+	std::atomic<bool> captureSaved;
+
+	// Dense indices of the entities the current camera can see,
+	// and of those whose shadows could land in its view
+	std::vector<unsigned int> visibleIndices;
+	std::vector<unsigned int> casterIndices;
+
+	// Cull every camera and the shadow casters in one pass, a mask per view
+	bool multiViewCulling;
+	ViewMasks viewMasks;
+
+	// Reuse last frame's camera visibility for entities the camera's motion can't have changed
+	bool temporalCulling;
+
+	// Draws ordered by state and depth before they go into the packet
+	bool sortDraws;
+	RenderQueue drawQueue;
+	RenderQueue shadowQueue;
+
+	// Entities that never move, merged per material and chunk while batching is on
+	std::vector<Entity> staticEntities;
+	StaticBatcher staticBatcher;
+	bool staticBatching;
+
+	// Big solid entities drawn into a CPU depth buffer to hide what's behind them
+	OcclusionBuffer occlusion;
+	std::vector<Entity> occluders;
+	bool occlusionEnabled;
+
+	// Entity under the cursor after the last right click
+	RayHit pickHit;
+	bool pickRequested;
+	float pickMicroseconds;
+
+	// Per frame counters shown in the UI
+	FrameStats stats;
 
 	// Smart pointer for materials
 	std::vector<std::shared_ptr<Material>> materials;
 
+	// Material changes made in the UI, held back until the render thread
+	// has finished every frame that could still be reading the old values
+	struct MaterialEdit
+	{
+		Material* material;
+		DirectX::XMFLOAT4 color;
+		DirectX::XMFLOAT2 scale;
+		DirectX::XMFLOAT2 offset;
+	};
+	std::vector<MaterialEdit> materialEdits;
+	void ApplyMaterialEdits();
+
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
 	//     Component Object Model, which DirectX objects do
@@ -82,8 +231,19 @@ private:
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> shadowSampler;
 	DirectX::XMFLOAT4X4 lightViewMatrix;
 	DirectX::XMFLOAT4X4 lightProjectionMatrix;
+	float shadowDistance;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
 
+	// Blended draws go after the sky, reading depth without writing it
+	Microsoft::WRL::ComPtr<ID3D11BlendState> transparentBlend;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> transparentDepth;
+
+	// Opaque depth laid down first by the shadow shaders, nearest first, then the
+	// main pass only shades pixels whose depth matches it exactly
+	bool depthPrepass;
+	RenderQueue depthQueue;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> prepassEqualDepth;
+
 	// Data for post processing
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> ppSampler;
 	std::shared_ptr<SimpleVertexShader> ppVS;
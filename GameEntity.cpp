@@ -5,48 +5,83 @@
 #include <DirectXMath.h>
 
 /// <summary>
-/// Constructs a new game entity to be rendered
+/// Constructs a handle to an entity living in the registry
 /// </summary>
-/// <param name="mesh">Game entity's mesh</param>
-GameEntity::GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
+/// <param name="registry">Registry that owns the components</param>
+/// <param name="entity">Id of the entity</param>
+GameEntity::GameEntity(EntityRegistry* registry, Entity entity)
 {
-	//Initialize mesh and transform
-	this->mesh = mesh;
-	transform = std::make_shared<Transform>();
-
-	this->material = material;
+	this->registry = registry;
+	this->entity = entity;
 }
 
 /// <summary>
-/// Get shared pointer for a transform
+/// Get the id of the entity in the registry
+/// </summary>
+/// <returns>Entity id</returns>
+Entity GameEntity::GetEntity() { return entity; }
+
+/// <summary>
+/// Get pointer to the entity's transform
 /// </summary>
 /// <returns>Game entity's transform</returns>
-std::shared_ptr<Transform> GameEntity::GetTransform() { return transform; }
+Transform* GameEntity::GetTransform() { return registry->GetTransform(entity); }
 
 /// <summary>
-/// Get shared pointer for a mesh
+/// Get pointer to the entity's mesh
 /// </summary>
 /// <returns>Game entity's mesh</returns>
-std::shared_ptr<Mesh> GameEntity::GetMesh() { return mesh; }
+Mesh* GameEntity::GetMesh() { return registry->GetMesh(entity); }
 
 /// <summary>
-/// Get shared pointer for a material
+/// Get pointer to the entity's material
 /// </summary>
 /// <returns>Game entity's material</returns>
-std::shared_ptr<Material> GameEntity::GetMaterial() { return material; }
+Material* GameEntity::GetMaterial() { return registry->GetMaterial(entity); }
 
 /// <summary>
 /// Sets the current meshes material
 /// </summary>
 /// <param name="material">new material</param>
-void GameEntity::SetMaterial(std::shared_ptr<Material> material) { this->material = material; }
+void GameEntity::SetMaterial(Material* material) { registry->SetMaterial(entity, material); }
+
+/// <summary>
+/// Draws this entity on its own
+/// </summary>
+/// <param name="commands">List the draw is recorded into</param>
+/// <param name="currentCam">Camera to draw from</param>
+void GameEntity::Draw(CommandList& commands, Camera& currentCam)
+{
+	Transform* transform = GetTransform();
+
+	DrawItem item = {};
+	item.entity = entity;
+	item.mesh = GetMesh();
+	item.material = GetMaterial();
+	item.world = transform->GetWorldMatrix();
+	item.worldInvTranspose = transform->GetWorldInverseTransposeMatrix();
+
+	// Drawn outside a frame there's no shadow map to look up, the camera's matrix stands in
+	CameraData camera = currentCam.GetData();
+	DirectX::XMMATRIX viewProjection = DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&camera.view), DirectX::XMLoadFloat4x4(&camera.projection));
+	DirectX::XMStoreFloat4x4(&item.worldViewProjection, DirectX::XMMatrixMultiply(DirectX::XMLoadFloat4x4(&item.world), viewProjection));
+	item.shadowWorldViewProjection = item.worldViewProjection;
+
+	Draw(commands, item, camera);
+}
 
 /// <summary>
 /// Sets up necessary buffers and handles drawing mesh to the screen
+/// - Sets both shaders and uploads every one of their constant buffers,
+///   so it works on its own, batches of draws should only upload what changed
 /// </summary>
-/// <param name="constantBuffer"></param>
-void GameEntity::Draw(Camera currentCam)
+/// <param name="commands">List the draw is recorded into</param>
+/// <param name="item">Entity data copied out of the registry</param>
+/// <param name="currentCam">Camera snapshot to draw from</param>
+void GameEntity::Draw(CommandList& commands, const DrawItem& item, const CameraData& currentCam)
 {
+	Material* material = item.material;
+
 	// Set vertex and pixel shaders
 	material->GetVertexShader()->SetShader();
 	material->GetPixelShader()->SetShader();
@@ -54,23 +89,23 @@ void GameEntity::Draw(Camera currentCam)
 	// Map to the GPU
 	std::shared_ptr<SimpleVertexShader> vShader = material->GetVertexShader();
 
-	vShader->SetMatrix4x4("m4World", GetTransform()->GetWorldMatrix());
-	vShader->SetMatrix4x4("m4View", currentCam.GetViewMatrix());
-	vShader->SetMatrix4x4("m4Projection", currentCam.GetProjectionMatrix());
-	vShader->SetMatrix4x4("m4WorldInvTranspose", GetTransform()->GetWorldInverseTransposeMatrix());
+	vShader->SetMatrix4x4("m4World", item.world);
+	vShader->SetMatrix4x4("m4WorldInvTranspose", item.worldInvTranspose);
+	vShader->SetMatrix4x4("m4WorldViewProjection", item.worldViewProjection);
+	vShader->SetMatrix4x4("m4ShadowWorldViewProjection", item.shadowWorldViewProjection);
 
 	vShader->CopyAllBufferData();
 
 	// Prepare the material for drawing
-	material->PrepareMaterial(currentCam);
+	material->PrepareMaterial();
 
 	// Set pixel shader information
 	std::shared_ptr<SimplePixelShader> pShader = material->GetPixelShader();
 
-	pShader->SetFloat4("colorTint", material->GetColor());
+	pShader->SetFloat3("cameraPosition", currentCam.position);
 
 	pShader->CopyAllBufferData();
-	
+
 	// Call draw for the mesh itself
-	mesh->Draw();
+	item.mesh->Draw(commands);
 }
\ No newline at end of file
@@ -1,30 +1,33 @@
 #pragma once
-#include <memory>
 #include "Transform.h"
 #include "Mesh.h"
 #include "Camera.h"
 #include "Material.h"
+#include "EntityRegistry.h"
 
 // Overall class of what is rendered
+// - A lightweight handle, the actual components live in the registry
 class GameEntity
 {
 public:
 	// Constructor
-	GameEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+	GameEntity(EntityRegistry* registry, Entity entity);
 
 	// Getters
-	std::shared_ptr<Transform> GetTransform();
-	std::shared_ptr<Mesh> GetMesh();
-	std::shared_ptr<Material> GetMaterial();
+	Entity GetEntity();
+	Transform* GetTransform();
+	Mesh* GetMesh();
+	Material* GetMaterial();
 
 	// Setters
-	void SetMaterial(std::shared_ptr<Material> material);
+	void SetMaterial(Material* material);
 
 	// Draw
-	void Draw(Camera currentCam);
+	// Record into a list that shaders are also recording into, see ISimpleShader::Recording
+	void Draw(CommandList& commands, Camera& currentCam);
+	static void Draw(CommandList& commands, const DrawItem& item, const CameraData& currentCam);
 
 private:
-	std::shared_ptr<Transform> transform;
-	std::shared_ptr<Mesh> mesh;
-	std::shared_ptr<Material> material;
+	EntityRegistry* registry;
+	Entity entity;
 };
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <thread>
+
+// --------------- Basic usage -----------------
+//
+// Call JobSystem::Initialize() once on the main thread
+// before queueing anything, and JobSystem::ShutDown()
+// at the very end of the program.
+//
+// Queue a job and wait for it with a counter:
+//
+//   JobCounter counter;
+//   JobSystem::Run([&]() { DoWork(); }, &counter);
+//   JobSystem::Wait(&counter);
+//
+// Jobs can be held back until another counter finishes:
+//
+//   JobSystem::Run(LoadMesh, &loaded);
+//   JobSystem::Run(BuildBounds, &built, &loaded);
+//
+// Splitting a loop across every thread:
+//
+//   JobSystem::ParallelFor(count, [&](unsigned int start, unsigned int end)
+//   {
+//       for (unsigned int i = start; i < end; i++) { ... }
+//   });
+//
+// Waiting never blocks idle, the waiting thread keeps
+// running queued jobs, so ParallelFor can be nested.
+//
+// ---------------------------------------------
+
+namespace JobSystem
+{
+	// Annonymous namespace to hold variables only accessible in this file
+	namespace
+	{
+		struct Job
+		{
+			std::function<void()> work;
+			JobCounter* counter;
+		};
+
+		// Each thread owns one queue, pushing and popping at the back
+		// while other threads steal the oldest jobs from the front
+		struct WorkQueue
+		{
+			std::mutex lock;
+			std::deque<Job> jobs;
+		};
+
+		// Queue 0 belongs to the main thread, the rest to the workers
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::vector<std::thread> workers;
+
+		std::atomic<bool> running = false;
+		std::atomic<int> queuedJobs = 0;
+		std::atomic<unsigned int> nextQueue = 0;
+
+		// Idle workers sleep here until something is queued
+		std::mutex sleepLock;
+		std::condition_variable wake;
+
+		// Which queue the current thread owns, -1 for outside threads
+		thread_local int threadIndex = -1;
+
+		void Push(Job job)
+		{
+			// Outside threads spread their jobs around
+			unsigned int index = threadIndex >= 0 ?
+				(unsigned int)threadIndex :
+				nextQueue.fetch_add(1, std::memory_order_relaxed) % (unsigned int)queues.size();
+
+			{
+				std::lock_guard<std::mutex> lock(queues[index]->lock);
+				queues[index]->jobs.push_back(std::move(job));
+			}
+			queuedJobs.fetch_add(1, std::memory_order_release);
+			wake.notify_one();
+		}
+
+		bool Pop(Job& job)
+		{
+			unsigned int count = (unsigned int)queues.size();
+
+			// Newest job from our own queue is the most likely to be in cache
+			if (threadIndex >= 0)
+			{
+				WorkQueue& own = *queues[threadIndex];
+				std::lock_guard<std::mutex> lock(own.lock);
+				if (!own.jobs.empty())
+				{
+					job = std::move(own.jobs.back());
+					own.jobs.pop_back();
+					queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			// Steal the oldest job from someone else
+			unsigned int start = threadIndex >= 0 ? (unsigned int)threadIndex + 1 : 0;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				unsigned int victim = (start + i) % count;
+				if ((int)victim == threadIndex)
+					continue;
+
+				WorkQueue& other = *queues[victim];
+				std::lock_guard<std::mutex> lock(other.lock);
+				if (!other.jobs.empty())
+				{
+					job = std::move(other.jobs.front());
+					other.jobs.pop_front();
+					queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		void Finish(JobCounter* counter)
+		{
+			if (!counter)
+				return;
+
+			// Not the last job, a plain decrement is enough
+			int pending = counter->pending.load(std::memory_order_relaxed);
+			while (pending > 1)
+			{
+				if (counter->pending.compare_exchange_weak(pending, pending - 1, std::memory_order_acq_rel))
+					return;
+			}
+
+			// Possibly the last job, so finish under the lock. Wait() takes the
+			// same lock before returning, which keeps the counter alive until
+			// we are completely done touching it
+			std::vector<std::function<void()>> readyJobs;
+			std::vector<JobCounter*> readyCounters;
+			{
+				std::lock_guard<std::mutex> lock(counter->waitLock);
+				if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					// Release anything that depended on this counter
+					readyJobs.swap(counter->waitingJobs);
+					readyCounters.swap(counter->waitingCounters);
+				}
+			}
+
+			for (size_t i = 0; i < readyJobs.size(); i++)
+				Push({ std::move(readyJobs[i]), readyCounters[i] });
+		}
+
+		bool RunOne()
+		{
+			Job job;
+			if (!Pop(job))
+				return false;
+
+			job.work();
+			Finish(job.counter);
+			return true;
+		}
+
+		void WorkerLoop(unsigned int index)
+		{
+			threadIndex = (int)index;
+			while (running.load(std::memory_order_acquire))
+			{
+				if (RunOne())
+					continue;
+
+				// Nothing to do, sleep until woken (or briefly, in case a wake was missed)
+				std::unique_lock<std::mutex> lock(sleepLock);
+				wake.wait_for(lock, std::chrono::milliseconds(1), []()
+					{
+						return queuedJobs.load(std::memory_order_acquire) > 0 || !running.load();
+					});
+			}
+		}
+	}
+}
+
+
+// ---------------------------------------------------
+//  Starts the worker threads, the calling thread
+//  becomes the owner of queue 0
+//
+//  workerCount - threads to start, 0 picks one per
+//                core minus the calling thread
+// ---------------------------------------------------
+void JobSystem::Initialize(unsigned int workerCount)
+{
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	threadIndex = 0;
+	running = true;
+
+	for (unsigned int i = 0; i < workerCount + 1; i++)
+		queues.push_back(std::make_unique<WorkQueue>());
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.push_back(std::thread(WorkerLoop, i + 1));
+}
+
+// ---------------------------------------------------
+//  Stops and joins every worker thread
+// ---------------------------------------------------
+void JobSystem::ShutDown()
+{
+	running = false;
+	wake.notify_all();
+
+	for (auto& t : workers)
+		t.join();
+
+	workers.clear();
+	queues.clear();
+	threadIndex = -1;
+}
+
+// ---------------------------------------------------
+//  Queues a job
+//
+//  job        - work to do
+//  counter    - incremented now, decremented when done
+//  dependency - job is held until this counter is done
+// ---------------------------------------------------
+void JobSystem::Run(std::function<void()> job, JobCounter* counter, JobCounter* dependency)
+{
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	// Without workers just do the job right away
+	if (queues.empty())
+	{
+		if (dependency)
+			Wait(dependency);
+		job();
+		Finish(counter);
+		return;
+	}
+
+	// Park the job on the dependency, checked under its lock so
+	// the last finishing job can't slip past without seeing it
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->waitLock);
+		if (!dependency->IsDone())
+		{
+			dependency->waitingJobs.push_back(std::move(job));
+			dependency->waitingCounters.push_back(counter);
+			return;
+		}
+	}
+
+	Push({ std::move(job), counter });
+}
+
+// ---------------------------------------------------
+//  Helps out with queued jobs until the counter
+//  reaches zero
+// ---------------------------------------------------
+void JobSystem::Wait(JobCounter* counter)
+{
+	if (!counter)
+		return;
+
+	while (!counter->IsDone())
+	{
+		if (!RunOne())
+			std::this_thread::yield();
+	}
+
+	// Let the thread that finished the last job release the lock
+	std::lock_guard<std::mutex> lock(counter->waitLock);
+}
+
+// ---------------------------------------------------
+//  Runs a job over [0, count) in chunks on every
+//  thread, returning once all chunks are done
+//
+//  grain - items per chunk, 0 aims for a few chunks
+//          per thread so stealing can even things out
+// ---------------------------------------------------
+void JobSystem::ParallelFor(unsigned int count, const std::function<void(unsigned int start, unsigned int end)>& job, unsigned int grain)
+{
+	if (count == 0)
+		return;
+
+	if (grain == 0)
+	{
+		unsigned int chunks = GetThreadCount() * 4;
+		grain = std::max(1u, (count + chunks - 1) / chunks);
+	}
+
+	// Not worth splitting
+	if (count <= grain || queues.size() <= 1)
+	{
+		job(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (unsigned int start = grain; start < count; start += grain)
+	{
+		unsigned int end = std::min(count, start + grain);
+		Run([&job, start, end]() { job(start, end); }, &counter);
+	}
+
+	// First chunk runs here while the others are picked up
+	job(0, std::min(count, grain));
+	Wait(&counter);
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return std::max(1u, (unsigned int)queues.size());
+}
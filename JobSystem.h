@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// See JobSystem.cpp for usage details
+
+// Tracks how many jobs are still outstanding
+// - Jobs can be made to wait on a counter, and start once it reaches zero
+struct JobCounter
+{
+	std::atomic<int> pending{ 0 };
+
+	// Jobs held back until this counter is done
+	std::mutex waitLock;
+	std::vector<std::function<void()>> waitingJobs;
+	std::vector<JobCounter*> waitingCounters;
+
+	bool IsDone() { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+namespace JobSystem
+{
+	void Initialize(unsigned int workerCount = 0);
+	void ShutDown();
+
+	// Queue work, optionally only after another counter has finished
+	void Run(std::function<void()> job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// Runs other jobs on the calling thread until the counter finishes
+	void Wait(JobCounter* counter);
+
+	// Splits [0, count) into chunks and waits for all of them
+	// - A grain of 0 picks a chunk size from the count and thread count
+	void ParallelFor(unsigned int count, const std::function<void(unsigned int start, unsigned int end)>& job, unsigned int grain = 0);
+
+	unsigned int GetThreadCount();
+}
@@ -0,0 +1,68 @@
+#include "LodChain.h"
+#include <algorithm>
+#include <cmath>
+
+/// <summary>
+/// Adds the next coarser level to the end of the chain
+/// </summary>
+/// <param name="mesh">Mesh for this level, owned elsewhere</param>
+/// <param name="error">Furthest this level's surface strays from the finest level, in local units</param>
+void LodChain::AddLevel(Mesh* mesh, float error)
+{
+	if (meshes.size() >= LOD_MAX_LEVELS)
+		return;
+
+	// A coarser level with less error would never get picked
+	if (!errors.empty())
+		error = std::max(error, errors.back());
+
+	meshes.push_back(mesh);
+	errors.push_back(error);
+}
+
+unsigned int LodChain::GetLevelCount() { return (unsigned int)meshes.size(); }
+Mesh* LodChain::GetMesh(unsigned int level) { return meshes[std::min(level, (unsigned int)meshes.size() - 1)]; }
+float LodChain::GetError(unsigned int level) { return errors[std::min(level, (unsigned int)errors.size() - 1)]; }
+
+/// <summary>
+/// Picks the level to draw from the size of each level's error on screen
+/// </summary>
+/// <param name="pixelsPerUnit">Pixels covered by one local unit at the entity's distance</param>
+/// <param name="current">Level picked last time, for hysteresis</param>
+/// <param name="settings">Threshold, hysteresis and bias</param>
+/// <returns>Index of the level to draw</returns>
+unsigned int LodChain::Select(float pixelsPerUnit, unsigned int current, const LodSettings& settings)
+{
+	if (meshes.empty())
+		return 0;
+
+	float threshold = settings.pixelError * exp2f(settings.bias);
+	unsigned int last = (unsigned int)meshes.size() - 1;
+	current = std::min(current, last);
+
+	// Coarsest level whose error is small enough to go unnoticed
+	unsigned int fits = 0;
+	for (unsigned int level = last; level > 0; level--)
+	{
+		if (errors[level] * pixelsPerUnit <= threshold)
+		{
+			fits = level;
+			break;
+		}
+	}
+
+	// Too coarse, switch to more detail straight away
+	if (fits < current)
+		return fits;
+
+	// Coarser only once a level's error is well under the threshold,
+	// so distance creeping back and forth over it doesn't flip levels
+	float coarsenThreshold = threshold * (1.0f - settings.hysteresis);
+	for (unsigned int level = fits; level > current; level--)
+	{
+		if (errors[level] * pixelsPerUnit <= coarsenThreshold)
+			return level;
+	}
+
+	return current;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+
+class Mesh;
+
+// Most levels a chain can hold, an entity's level is kept in a byte
+#define LOD_MAX_LEVELS 8
+
+// Error on screen a level may have, in pixels, and the share of that
+// a coarser level has to get under before an entity switches down to it
+#define LOD_DEFAULT_PIXEL_ERROR 1.0f
+#define LOD_DEFAULT_HYSTERESIS 0.5f
+
+// How every chain picks its level, set once a frame
+struct LodSettings
+{
+	float pixelError = LOD_DEFAULT_PIXEL_ERROR;
+	float hysteresis = LOD_DEFAULT_HYSTERESIS;
+
+	// Each step up doubles the allowed error, trading quality for frame time
+	float bias = 0.0f;
+};
+
+// The same model at falling detail, finest level first
+// - Each level records its geometric error, how far its surface strays
+//   from the finest level's at most, in the mesh's local units
+// - Picking turns that error into pixels from the entity's distance and size
+//   on screen and takes the coarsest level that stays under the threshold
+// - Only coarsens once a level is well under the threshold and refines as soon
+//   as the current one goes over, so entities sitting on the edge don't pop
+class LodChain
+{
+public:
+	LodChain() = default;
+
+	// Levels must be added finest first with growing error
+	void AddLevel(Mesh* mesh, float error);
+	unsigned int GetLevelCount();
+	Mesh* GetMesh(unsigned int level);
+	float GetError(unsigned int level);
+
+	// pixelsPerUnit is how many pixels one local unit covers at the entity's distance
+	unsigned int Select(float pixelsPerUnit, unsigned int current, const LodSettings& settings);
+
+private:
+	std::vector<Mesh*> meshes;
+	std::vector<float> errors;
+};
@@ -6,6 +6,7 @@
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "JobSystem.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -83,6 +84,9 @@ int WINAPI WinMain(
 	// Initalize the input system, which requires the window handle
 	Input::Initialize(Window::Handle());
 
+	// Start worker threads before the game queues any jobs
+	JobSystem::Initialize();
+
 	// Now the game itself can be initialzied
 	game->Initialize();
 
@@ -144,6 +148,7 @@ int WINAPI WinMain(
 
 	// Clean up
 	delete game;
+	JobSystem::ShutDown();
 	Input::ShutDown();
 	Graphics::ShutDown();
 	return (HRESULT)msg.wParam;
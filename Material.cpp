@@ -1,4 +1,31 @@
 #include "Material.h"
+#include "RenderQueue.h"
+#include <mutex>
+
+// Annonymous namespace for handing out sort ids
+namespace
+{
+	SortIdAllocator sortIds;
+
+	// Every vertex and pixel shader pair seen so far, the slot is the pair's id
+	// - Only a handful of pairs ever exist, so a linear search is fine and ids are kept
+	std::vector<std::pair<SimpleVertexShader*, SimplePixelShader*>> shaderPairs;
+	std::mutex shaderPairMutex;
+
+	unsigned int GetShaderPairId(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+	{
+		std::lock_guard<std::mutex> lock(shaderPairMutex);
+		std::pair<SimpleVertexShader*, SimplePixelShader*> pair(vertexShader, pixelShader);
+		for (unsigned int i = 0; i < shaderPairs.size(); i++)
+		{
+			if (shaderPairs[i] == pair)
+				return i;
+		}
+
+		shaderPairs.push_back(pair);
+		return (unsigned int)shaderPairs.size() - 1;
+	}
+}
 
 // Constructor
 Material::Material(DirectX::XMFLOAT4 colorTint, std::shared_ptr<SimpleVertexShader> vShader, std::shared_ptr<SimplePixelShader> pShader, DirectX::XMFLOAT2 scale, DirectX::XMFLOAT2 offset, float roughness)
@@ -9,20 +36,43 @@ Material::Material(DirectX::XMFLOAT4 colorTint, std::shared_ptr<SimpleVertexShad
 	this->scale = scale;
 	this->offset = offset;
 	this->roughness = roughness;
+	sortId = sortIds.Allocate();
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+}
+
+Material::~Material()
+{
+	sortIds.Release(sortId);
 }
 
 // Getters
 DirectX::XMFLOAT4 Material::GetColor() { return colorTint; }
 std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vShader; }
 std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return pShader; }
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVertexShader() { return instancedVShader; }
 DirectX::XMFLOAT2 Material::GetScale() { return scale; }
 DirectX::XMFLOAT2 Material::GetOffset() { return offset; }
 std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& Material::GetSRVs() { return textureSRVs; }
+unsigned int Material::GetSortId() { return sortId; }
+unsigned int Material::GetShaderSortId() { return shaderSortId; }
 
 // Setters
 void Material::SetColor(DirectX::XMFLOAT4 newColor) { colorTint = newColor; }
-void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader) { vShader = vertexShader; }
-void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader) { pShader = pixelShader; }
+void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader)
+{
+	vShader = vertexShader;
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+
+	// The instanced version belonged to the old shader
+	instancedVShader = nullptr;
+}
+
+void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader)
+{
+	pShader = pixelShader;
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+}
+void Material::SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader) { instancedVShader = vertexShader; }
 void Material::SetScale(DirectX::XMFLOAT2 scale) { this->scale = scale; }
 void Material::SetOffset(DirectX::XMFLOAT2 offset) { this->offset = offset; }
 
@@ -47,14 +97,32 @@ void Material::AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11
 }
 
 /// <summary>
-/// Sets the srvs and samplers before drawing
+/// Sets the per material values, srvs and samplers before drawing
+/// - Only fills the pixel shader's local copy of PerMaterial, the caller
+///   uploads it so it can skip the upload when the material hasn't changed
 /// </summary>
-void Material::PrepareMaterial(Camera currentCam)
+void Material::PrepareMaterial()
 {
+	pShader->SetFloat4("colorTint", colorTint);
 	pShader->SetFloat2("scale", scale);
 	pShader->SetFloat2("offset", offset);
 	pShader->SetFloat("roughness", roughness);
-	pShader->SetFloat3("cameraPosition", currentCam.GetTransform()->GetPosition());
+
+	for (auto& t : textureSRVs) { pShader->SetShaderResourceView(t.first.c_str(), t.second); }
+	for (auto& s : samplers) { pShader->SetSamplerState(s.first.c_str(), s.second); }
+}
+
+/// <summary>
+/// Sets the per material values into the caller's copy of PerMaterial, then srvs and samplers
+/// - Binding only records into the calling thread's list, so this never writes to the shader
+/// </summary>
+/// <param name="perMaterial">Copy begun on this material's pixel shader, the caller records it</param>
+void Material::PrepareMaterial(ConstantStaging& perMaterial)
+{
+	perMaterial.SetFloat4("colorTint", colorTint);
+	perMaterial.SetFloat2("scale", scale);
+	perMaterial.SetFloat2("offset", offset);
+	perMaterial.SetFloat("roughness", roughness);
 
 	for (auto& t : textureSRVs) { pShader->SetShaderResourceView(t.first.c_str(), t.second); }
 	for (auto& s : samplers) { pShader->SetSamplerState(s.first.c_str(), s.second); }
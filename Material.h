@@ -1,5 +1,6 @@
 #pragma once
 #include "SimpleShader.h"
+#include "ConstantStaging.h"
 #include "Camera.h"
 #include <memory>
 
@@ -8,19 +9,33 @@ class Material
 public:
 	// Constructor
 	Material(DirectX::XMFLOAT4 colorTint, std::shared_ptr<SimpleVertexShader> vShader, std::shared_ptr<SimplePixelShader> pShader, DirectX::XMFLOAT2 scale, DirectX::XMFLOAT2 offset, float roughness);
+	~Material();
+
+	// Each one owns its sort id, a copy would hand it back twice
+	Material(const Material&) = delete;
+	Material& operator=(const Material&) = delete;
 
 	// Getters
 	DirectX::XMFLOAT4 GetColor();
 	std::shared_ptr<SimpleVertexShader> GetVertexShader();
 	std::shared_ptr<SimplePixelShader> GetPixelShader();
+	std::shared_ptr<SimpleVertexShader> GetInstancedVertexShader();
 	DirectX::XMFLOAT2 GetScale();
 	DirectX::XMFLOAT2 GetOffset();
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& GetSRVs();
 
+	// Small ids for draw sort keys, materials sharing both shaders share a shader id
+	unsigned int GetSortId();
+	unsigned int GetShaderSortId();
+
 	// Setters
 	void SetColor(DirectX::XMFLOAT4 newColor);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
+
+	// Version of the vertex shader reading its matrices per instance, materials
+	// without one are always drawn an entity at a time
+	void SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader);
 	void SetScale(DirectX::XMFLOAT2 scale);
 	void SetOffset(DirectX::XMFLOAT2 offset);
 
@@ -28,14 +43,20 @@ public:
 	void AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string samplerName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
 
-	// Prepare material for drawing
-	void PrepareMaterial(Camera currentCam);
+	// Prepare material for drawing, fills the pixel shader's
+	// per material data and binds textures, uploading is left to the caller
+	void PrepareMaterial();
+
+	// Same, but the values go into a copy of PerMaterial begun on the pixel
+	// shader, so draws can be recorded on several threads at once
+	void PrepareMaterial(ConstantStaging& perMaterial);
 
 private:
 	// Color along with both pixel and vertex shaders
 	DirectX::XMFLOAT4 colorTint;
 	std::shared_ptr<SimpleVertexShader> vShader;
 	std::shared_ptr<SimplePixelShader> pShader;
+	std::shared_ptr<SimpleVertexShader> instancedVShader;
 
 	// Textures and samplers
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
@@ -47,5 +68,9 @@ private:
 
 	// Roughness
 	float roughness;
+
+	// Ids the render queue sorts by, the shader id follows the shaders when they change
+	unsigned int sortId;
+	unsigned int shaderSortId;
 };
 
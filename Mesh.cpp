@@ -3,14 +3,21 @@
 #include <wrl/client.h>
 #include "Graphics.h"
 #include "Vertex.h"
+#include "RenderQueue.h"
 #include <fstream>
 #include <stdexcept>
 #include <vector>
 
 using namespace DirectX;
 
+// Annonymous namespace for the sort ids every mesh shares
+namespace
+{
+	SortIdAllocator sortIds;
+}
+
 // Constructor to create both the vertex and index buffer
-Mesh::Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t numIndices, const char* meshName)
+Mesh::Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t numIndices, const char* meshName, bool keepVertices)
 {
 	// Took inspiration from the demo code for passing in the number of vertices and indices
 	// Thought to use sizeof(arr)/sizeof(arr[0]) but would not be correct the arrays are now outside initialization scope
@@ -18,10 +25,22 @@ Mesh::Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t n
 	this->numVertices = (unsigned int)numVertices;
 	this->numIndices = (unsigned int)numIndices;
 	this->meshName = meshName;
+	sortId = sortIds.Allocate();
 
 	// Calculate tangents before creating buffers
 	CalculateTangents(vertices, this->numVertices, indices, this->numIndices);
 
+	// Bounds used for culling
+	BoundingBox::CreateFromPoints(localBounds, numVertices, &vertices[0].Position, sizeof(Vertex));
+
+	// Keep the geometry for CPU side tests
+	positions.resize(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+		positions[i] = vertices[i].Position;
+	cpuIndices.assign(indices, indices + numIndices);
+	if (keepVertices)
+		cpuVertices.assign(vertices, vertices + numVertices);
+
 	// Creation of vertex buffer
 	{
 		// Vertex buffer description
@@ -62,7 +81,7 @@ Mesh::Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t n
 }
 
 // Constructor that takes in a parameter for data in a 3d model
-Mesh::Mesh(const char* parameter)
+Mesh::Mesh(const char* parameter, bool keepVertices)
 {
 	// Author: Chris Cascioli
 	// Purpose: Basic .OBJ 3D model loading, supporting positions, uvs and normals
@@ -324,10 +343,22 @@ Mesh::Mesh(const char* parameter)
 	
 	// Save name as parameter
 	meshName = parameter;
+	sortId = sortIds.Allocate();
 
 	// Calculate tangents before creating buffers
 	CalculateTangents(&verts[0], numVertices, &indices[0], numIndices);
 
+	// Bounds used for culling
+	BoundingBox::CreateFromPoints(localBounds, numVertices, &verts[0].Position, sizeof(Vertex));
+
+	// Keep the geometry for CPU side tests
+	positions.resize(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+		positions[i] = verts[i].Position;
+	cpuIndices = indices;
+	if (keepVertices)
+		cpuVertices = verts;
+
 	// Creation of vertex buffer
 	{
 		// Vertex buffer description
@@ -370,7 +401,8 @@ Mesh::Mesh(const char* parameter)
 // Deconstructor
 Mesh::~Mesh()
 {
-	// Can be empty, as everything is handled through smart pointers
+	// Buffers are handled through smart pointers, only the sort id is handed back
+	sortIds.Release(sortId);
 }
 
 // Public getters
@@ -379,19 +411,34 @@ Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return indexBuffer
 unsigned int Mesh::GetVertexCount() { return numVertices; }
 unsigned int Mesh::GetIndexCount() { return numIndices; }
 const char* Mesh::GetMeshName() { return meshName; }
+DirectX::BoundingBox Mesh::GetBounds() { return localBounds; }
+unsigned int Mesh::GetSortId() { return sortId; }
+const std::vector<DirectX::XMFLOAT3>& Mesh::GetPositions() { return positions; }
+const std::vector<unsigned int>& Mesh::GetIndices() { return cpuIndices; }
+const std::vector<Vertex>& Mesh::GetVertices() { return cpuVertices; }
 
 // Functions
 // Draws the current mesh
-void Mesh::Draw()
+void Mesh::Draw(CommandList& commands)
 {
 	// Set the buffers in the input assembler stage
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	commands.SetVertexBuffer(0, vertexBuffer.Get(), sizeof(Vertex));
+	commands.SetIndexBuffer(indexBuffer.Get());
+
+	// Tell the graphics API to draw the mesh
+	commands.DrawIndexed(numIndices);
+}
 
-	// Tell the graphics API to draw the mesh (Direct3D)
-	Graphics::Context->DrawIndexed(numIndices, 0, 0);
+// --------------------------------------------------------
+// Sets the mesh's buffers and draws one copy per instance
+// - Only slot 0 is set here, so the instance buffer in slot 1 is
+//   bound once and shared by every mesh drawn from it
+// --------------------------------------------------------
+void Mesh::DrawInstanced(CommandList& commands, unsigned int instanceCount, unsigned int startInstance)
+{
+	commands.SetVertexBuffer(0, vertexBuffer.Get(), sizeof(Vertex));
+	commands.SetIndexBuffer(indexBuffer.Get());
+	commands.DrawIndexedInstanced(numIndices, instanceCount, startInstance);
 }
 
 // --------------------------------------------------------
@@ -1,7 +1,11 @@
 #pragma once
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
 #include "Vertex.h"
+#include "CommandList.h"
 
 //Class that creates both index and vertex buffers for a mesh
 //Mesh will be allowed to use both buffers created, meaning it will be able to draw the geometry using the buffers
@@ -9,12 +13,18 @@ class Mesh
 {
 public:
 	// Constructor
-	Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t numIndices, const char* meshName);
-	Mesh(const char* parameter);
+	// - keepVertices holds on to every vertex for GetVertices(), only meshes
+	//   that static batches merge copies of need them
+	Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t numIndices, const char* meshName, bool keepVertices = false);
+	Mesh(const char* parameter, bool keepVertices = false);
 
 	// Destructor
 	~Mesh();
 
+	// Each one owns its sort id, a copy would hand it back twice
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	// Functions to return vertex and index buffer
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
@@ -25,9 +35,26 @@ public:
 
 	// Function to return the name of the mesh
 	const char* GetMeshName();
+
+	// Local space bounds around every vertex
+	DirectX::BoundingBox GetBounds();
+
+	// Small id handed out in creation order, for draw sort keys
+	unsigned int GetSortId();
+
+	// CPU side copy of the geometry for occlusion and picking
+	const std::vector<DirectX::XMFLOAT3>& GetPositions();
+	const std::vector<unsigned int>& GetIndices();
+
+	// Every vertex as uploaded, for merging copies of the mesh into static batches,
+	// empty unless the mesh was made with keepVertices
+	const std::vector<Vertex>& GetVertices();
 	
-	// Draw function to set the buffers and draw the geometry
-	void Draw();
+	// Draw function to record setting the buffers and drawing the geometry
+	void Draw(CommandList& commands);
+
+	// Draws several copies at once, the instance buffer must already be bound to slot 1
+	void DrawInstanced(CommandList& commands, unsigned int instanceCount, unsigned int startInstance);
 
 	// Takes vertices and calculates tangent data
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
@@ -43,4 +70,15 @@ private:
 
 	//Name for the mesh
 	const char* meshName;
+
+	//Id the render queue sorts by, pointers are too wide for a key
+	unsigned int sortId;
+
+	//Bounds of the vertices before any transform
+	DirectX::BoundingBox localBounds;
+
+	//Positions and indices kept after the buffers are made, the GPU copies can't be read back
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<unsigned int> cpuIndices;
+	std::vector<Vertex> cpuVertices;
 };
\ No newline at end of file
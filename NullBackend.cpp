@@ -0,0 +1,183 @@
+#include "NullBackend.h"
+
+/// <summary>
+/// Walks the list in order, updating the bound state and counting every command
+/// </summary>
+/// <param name="commands">Recorded list, left unchanged</param>
+void NullBackend::Execute(const CommandList& commands)
+{
+	for (const RenderCommand& command : commands.GetCommands())
+		ExecuteCommand(commands, command);
+}
+
+/// <summary>
+/// Counts and checks a single command against the bound state
+/// </summary>
+/// <param name="commands">List the command belongs to, for its payload</param>
+/// <param name="command">Command to check</param>
+void NullBackend::ExecuteCommand(const CommandList& commands, const RenderCommand& command)
+{
+	if (command.type >= RENDER_COMMAND_COUNT)
+	{
+		Fail("Unknown command type");
+		return;
+	}
+	commandCounts[command.type]++;
+	cache.Filter(commands, command);
+
+	switch (command.type)
+	{
+	case RENDER_COMMAND_CLEAR_TARGET:
+	case RENDER_COMMAND_CLEAR_DEPTH:
+		if (!command.object)
+			Fail("Clearing a null view");
+		if (command.type == RENDER_COMMAND_CLEAR_TARGET)
+			CheckPayload(commands, command);
+		break;
+
+	case RENDER_COMMAND_SET_TARGETS:
+		CheckPayload(commands, command);
+		if (command.a + sizeof(RenderTargets) <= commands.GetDataSize())
+		{
+			const RenderTargets* targets = (const RenderTargets*)commands.GetData(command.a);
+			targetBound = targets->target || targets->depth;
+		}
+		break;
+
+	case RENDER_COMMAND_SET_VIEWPORT:
+		CheckPayload(commands, command);
+		viewportSet = true;
+		break;
+
+	case RENDER_COMMAND_BIND_SHADER:
+		if (command.stage == RENDER_STAGE_VERTEX)
+			vertexShaderBound = command.object != nullptr;
+		else if (command.stage != RENDER_STAGE_PIXEL)
+			Fail("Shader bound to an unknown stage");
+		break;
+
+	case RENDER_COMMAND_BIND_TEXTURE:
+	case RENDER_COMMAND_BIND_SAMPLER:
+	case RENDER_COMMAND_UNBIND_TEXTURES:
+		if (command.stage != RENDER_STAGE_VERTEX && command.stage != RENDER_STAGE_PIXEL)
+			Fail("Resource bound to an unknown stage");
+		break;
+
+	case RENDER_COMMAND_UPDATE_CONSTANTS:
+	case RENDER_COMMAND_WRITE_BUFFER:
+		if (!command.object)
+			Fail("Writing to a null buffer");
+		CheckPayload(commands, command);
+		uploadedBytes += command.b;
+		break;
+
+	case RENDER_COMMAND_SET_VERTEX_BUFFER:
+		if (command.slot > 1)
+			Fail("Vertex buffer slot past the ones in use");
+		else
+			vertexBufferBound[command.slot] = command.object != nullptr;
+		if (command.object && command.a == 0)
+			Fail("Vertex buffer without a stride");
+		break;
+
+	case RENDER_COMMAND_SET_INDEX_BUFFER:
+		indexBufferBound = command.object != nullptr;
+		break;
+
+	case RENDER_COMMAND_SET_TOPOLOGY:
+		topologySet = command.a != 0;
+		if (!topologySet)
+			Fail("Undefined primitive topology");
+		break;
+
+	case RENDER_COMMAND_DRAW:
+		CheckDraw(false, false);
+		break;
+
+	case RENDER_COMMAND_DRAW_INDEXED:
+		CheckDraw(true, false);
+		indexCount += command.a;
+		break;
+
+	case RENDER_COMMAND_DRAW_INDEXED_INSTANCED:
+		CheckDraw(true, true);
+		if (command.b == 0)
+			Fail("Instanced draw of no instances");
+		indexCount += (unsigned long long)command.a * command.b;
+		instanceCount += command.b;
+		break;
+	}
+}
+
+/// <summary>
+/// Clears every counter and the bound state
+/// </summary>
+void NullBackend::Reset()
+{
+	for (unsigned int& count : commandCounts)
+		count = 0;
+	drawCount = 0;
+	instanceCount = 0;
+	indexCount = 0;
+	uploadedBytes = 0;
+	errorCount = 0;
+	firstError = nullptr;
+	cache.ForgetBindings();
+	cache.ResetCounts();
+
+	vertexShaderBound = false;
+	vertexBufferBound[0] = vertexBufferBound[1] = false;
+	indexBufferBound = false;
+	targetBound = false;
+	viewportSet = false;
+	topologySet = false;
+}
+
+unsigned int NullBackend::GetCommandCount(unsigned int type) const { return type < RENDER_COMMAND_COUNT ? commandCounts[type] : 0; }
+unsigned int NullBackend::GetDrawCount() const { return drawCount; }
+unsigned long long NullBackend::GetInstanceCount() const { return instanceCount; }
+unsigned long long NullBackend::GetIndexCount() const { return indexCount; }
+unsigned long long NullBackend::GetUploadedBytes() const { return uploadedBytes; }
+unsigned int NullBackend::GetStateCount() const { return cache.GetStateCount(); }
+unsigned int NullBackend::GetRedundantCount() const { return cache.GetRedundantCount(); }
+unsigned int NullBackend::GetErrorCount() const { return errorCount; }
+const char* NullBackend::GetFirstError() const { return firstError; }
+
+void NullBackend::Fail(const char* message)
+{
+	if (!firstError)
+		firstError = message;
+	errorCount++;
+}
+
+/// <summary>
+/// Payloads start at a and are b bytes long
+/// </summary>
+void NullBackend::CheckPayload(const CommandList& commands, const RenderCommand& command)
+{
+	if ((unsigned long long)command.a + command.b > commands.GetDataSize())
+		Fail("Payload outside the data block");
+}
+
+/// <summary>
+/// Everything a draw needs must have been bound by an earlier command,
+/// pixel shaders are optional since depth only passes turn them off
+/// </summary>
+void NullBackend::CheckDraw(bool indexed, bool instanced)
+{
+	drawCount++;
+	if (!vertexShaderBound)
+		Fail("Draw without a vertex shader");
+	if (!targetBound)
+		Fail("Draw without a render target or depth buffer");
+	if (!viewportSet)
+		Fail("Draw without a viewport");
+	if (!topologySet)
+		Fail("Draw without a primitive topology");
+	if (indexed && !vertexBufferBound[0])
+		Fail("Indexed draw without a vertex buffer");
+	if (indexed && !indexBufferBound)
+		Fail("Indexed draw without an index buffer");
+	if (instanced && !vertexBufferBound[1])
+		Fail("Instanced draw without an instance buffer");
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "RenderBackend.h"
+#include "RenderStateCache.h"
+
+// Plays a command list back against nothing, counting what it would
+// have done and checking a GPU backend could replay it
+// - Tracks what is bound, a draw without a vertex shader, vertex buffer, index
+//   buffer, target, viewport or topology is an error, as is a payload outside the data block
+// - Runs the same state cache a GPU backend filters with, to count redundant calls
+// - Counters add up over every Execute() until Reset(), which also forgets the bound
+//   state, the cache keeps constant buffer contents like it would on a GPU
+class NullBackend : public IRenderBackend
+{
+public:
+	void Execute(const CommandList& commands) override;
+	void ExecuteCommand(const CommandList& commands, const RenderCommand& command) override;
+	void Reset();
+
+	// RENDER_COMMAND_ type to how many of them were executed
+	unsigned int GetCommandCount(unsigned int type) const;
+
+	// Draws of every kind, and what they covered
+	unsigned int GetDrawCount() const;
+	unsigned long long GetInstanceCount() const;
+	unsigned long long GetIndexCount() const;
+
+	// Constant buffer and dynamic buffer bytes
+	unsigned long long GetUploadedBytes() const;
+
+	// State changing commands, and those a state cache would drop
+	unsigned int GetStateCount() const;
+	unsigned int GetRedundantCount() const;
+
+	// First problem found keeps its message, later ones are only counted
+	unsigned int GetErrorCount() const;
+	const char* GetFirstError() const;
+
+private:
+	void Fail(const char* message);
+	void CheckPayload(const CommandList& commands, const RenderCommand& command);
+	void CheckDraw(bool indexed, bool instanced);
+
+	unsigned int commandCounts[RENDER_COMMAND_COUNT] = {};
+	unsigned int drawCount = 0;
+	unsigned long long instanceCount = 0;
+	unsigned long long indexCount = 0;
+	unsigned long long uploadedBytes = 0;
+	unsigned int errorCount = 0;
+	const char* firstError = nullptr;
+	RenderStateCache cache;
+
+	// What a context would have bound by now
+	bool vertexShaderBound = false;
+	bool vertexBufferBound[2] = {};
+	bool indexBufferBound = false;
+	bool targetBound = false;
+	bool viewportSet = false;
+	bool topologySet = false;
+};
@@ -0,0 +1,350 @@
+#include "OcclusionBuffer.h"
+#include "Mesh.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+OcclusionBuffer::OcclusionBuffer() :
+	depth(OCCLUSION_WIDTH * OCCLUSION_HEIGHT, 1.0f),
+	blockMax(OCCLUSION_BLOCKS_X * OCCLUSION_BLOCKS_Y, 1.0f)
+{
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+}
+
+/// <summary>
+/// Starts a new frame of occluders seen through the given camera
+/// </summary>
+/// <param name="viewProjection">Camera's view matrix multiplied by its projection</param>
+void OcclusionBuffer::Begin(XMFLOAT4X4 viewProjection)
+{
+	this->viewProjection = viewProjection;
+	triangles.clear();
+	for (std::vector<unsigned int>& bin : bins)
+		bin.clear();
+}
+
+/// <summary>
+/// Transforms an occluder's triangles to the screen and sorts them into tiles
+/// - The mesh must be solid, anything behind its surface is treated as hidden
+/// </summary>
+/// <param name="mesh">Mesh with CPU side positions and indices</param>
+/// <param name="world">Occluder's world matrix</param>
+void OcclusionBuffer::AddOccluder(Mesh* mesh, const XMFLOAT4X4& world)
+{
+	const std::vector<XMFLOAT3>& positions = mesh->GetPositions();
+	const std::vector<unsigned int>& indices = mesh->GetIndices();
+
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&viewProjection));
+	clipVertices.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+		XMStoreFloat4(&clipVertices[i], XMVector3Transform(XMLoadFloat3(&positions[i]), worldViewProjection));
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		AddTriangle(clipVertices[indices[i]], clipVertices[indices[i + 1]], clipVertices[indices[i + 2]]);
+}
+
+/// <summary>
+/// Fills every tile's depth from its bin, then the block level above it
+/// </summary>
+void OcclusionBuffer::Rasterize()
+{
+	// Tiles never share pixels, so each one is its own job
+	JobSystem::ParallelFor(OCCLUSION_TILE_COUNT, [&](unsigned int start, unsigned int end)
+		{
+			for (unsigned int tile = start; tile < end; tile++)
+				RasterizeTile(tile);
+		}, 1);
+}
+
+/// <summary>
+/// Checks if any part of a box could be in front of the occluders
+/// </summary>
+/// <param name="box">World space bounds</param>
+/// <returns>False only when every pixel the box covers has an occluder in front of the box's nearest point</returns>
+bool OcclusionBuffer::IsVisible(const BoundingBox& box) const
+{
+	XMMATRIX matrix = XMLoadFloat4x4(&viewProjection);
+
+	// Screen rectangle and nearest depth of the box's corners
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float minDepth = FLT_MAX;
+	for (int i = 0; i < 8; i++)
+	{
+		XMVECTOR corner = XMVectorSet(
+			box.Center.x + ((i & 1) ? box.Extents.x : -box.Extents.x),
+			box.Center.y + ((i & 2) ? box.Extents.y : -box.Extents.y),
+			box.Center.z + ((i & 4) ? box.Extents.z : -box.Extents.z),
+			1.0f);
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(corner, matrix));
+
+		// Through the near plane, so the camera might be right next to or inside it
+		if (clip.z < 0.0f)
+			return true;
+
+		float x = (clip.x / clip.w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		float y = (0.5f - clip.y / clip.w * 0.5f) * OCCLUSION_HEIGHT;
+		minX = std::min(minX, x);
+		minY = std::min(minY, y);
+		maxX = std::max(maxX, x);
+		maxY = std::max(maxY, y);
+		minDepth = std::min(minDepth, clip.z / clip.w);
+	}
+
+	// Off screen is for frustum culling to decide
+	if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUSION_WIDTH || minY >= OCCLUSION_HEIGHT)
+		return true;
+
+	int x0 = std::max(0, (int)floorf(minX));
+	int y0 = std::max(0, (int)floorf(minY));
+	int x1 = std::min(OCCLUSION_WIDTH - 1, (int)floorf(maxX));
+	int y1 = std::min(OCCLUSION_HEIGHT - 1, (int)floorf(maxY));
+
+	for (int by = y0 / OCCLUSION_BLOCK_SIZE; by <= y1 / OCCLUSION_BLOCK_SIZE; by++)
+	{
+		for (int bx = x0 / OCCLUSION_BLOCK_SIZE; bx <= x1 / OCCLUSION_BLOCK_SIZE; bx++)
+		{
+			// Even the furthest pixel in the block is in front of the box
+			if (blockMax[by * OCCLUSION_BLOCKS_X + bx] < minDepth)
+				continue;
+
+			// Otherwise check just the pixels the box covers
+			int startX = std::max(x0, bx * OCCLUSION_BLOCK_SIZE);
+			int startY = std::max(y0, by * OCCLUSION_BLOCK_SIZE);
+			int endX = std::min(x1, bx * OCCLUSION_BLOCK_SIZE + OCCLUSION_BLOCK_SIZE - 1);
+			int endY = std::min(y1, by * OCCLUSION_BLOCK_SIZE + OCCLUSION_BLOCK_SIZE - 1);
+			for (int y = startY; y <= endY; y++)
+			{
+				for (int x = startX; x <= endX; x++)
+				{
+					if (depth[y * OCCLUSION_WIDTH + x] >= minDepth)
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+unsigned int OcclusionBuffer::GetTriangleCount() { return (unsigned int)triangles.size(); }
+float OcclusionBuffer::GetDepth(int x, int y) { return depth[y * OCCLUSION_WIDTH + x]; }
+
+// --------------------------------------------------------
+// Culls a clip space triangle against the view and clips
+// it against the near plane, which can turn it into two
+// --------------------------------------------------------
+void OcclusionBuffer::AddTriangle(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c)
+{
+	// Entirely past one side of the view
+	if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+		(a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+		(a.z > a.w && b.z > b.w && c.z > c.w) || (a.z < 0.0f && b.z < 0.0f && c.z < 0.0f))
+		return;
+
+	// Common case, nothing to clip
+	if (a.z >= 0.0f && b.z >= 0.0f && c.z >= 0.0f)
+	{
+		XMFLOAT4 clip[3] = { a, b, c };
+		AddClippedTriangle(clip);
+		return;
+	}
+
+	// Walk the edges, keeping corners in front of the near
+	// plane and adding a corner wherever an edge crosses it
+	const XMFLOAT4* corners[3] = { &a, &b, &c };
+	XMFLOAT4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& p = *corners[i];
+		const XMFLOAT4& q = *corners[(i + 1) % 3];
+		if (p.z >= 0.0f)
+			polygon[count++] = p;
+
+		if ((p.z >= 0.0f) != (q.z >= 0.0f))
+		{
+			float t = p.z / (p.z - q.z);
+			polygon[count++] = XMFLOAT4(
+				p.x + (q.x - p.x) * t,
+				p.y + (q.y - p.y) * t,
+				0.0f,
+				p.w + (q.w - p.w) * t);
+		}
+	}
+
+	// One corner in front leaves a triangle, two leave a quad
+	XMFLOAT4 clip[3] = { polygon[0], polygon[1], polygon[2] };
+	AddClippedTriangle(clip);
+	if (count == 4)
+	{
+		clip[1] = polygon[2];
+		clip[2] = polygon[3];
+		AddClippedTriangle(clip);
+	}
+}
+
+// --------------------------------------------------------
+// Projects a triangle that is fully in front of the near
+// plane onto the screen and adds it to each tile it touches
+// --------------------------------------------------------
+void OcclusionBuffer::AddClippedTriangle(const XMFLOAT4* clip)
+{
+	Triangle triangle;
+	for (int i = 0; i < 3; i++)
+	{
+		float invW = 1.0f / clip[i].w;
+		triangle.v[i] = XMFLOAT3(
+			(clip[i].x * invW * 0.5f + 0.5f) * OCCLUSION_WIDTH,
+			(0.5f - clip[i].y * invW * 0.5f) * OCCLUSION_HEIGHT,
+			clip[i].z * invW);
+	}
+
+	const XMFLOAT3* v = triangle.v;
+	float minX = std::min({ v[0].x, v[1].x, v[2].x });
+	float minY = std::min({ v[0].y, v[1].y, v[2].y });
+	float maxX = std::max({ v[0].x, v[1].x, v[2].x });
+	float maxY = std::max({ v[0].y, v[1].y, v[2].y });
+	if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUSION_WIDTH || minY >= OCCLUSION_HEIGHT)
+		return;
+
+	// Edge on, covers nothing
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if (area == 0.0f)
+		return;
+
+	int tileX0 = (int)std::max(minX, 0.0f) / OCCLUSION_TILE_WIDTH;
+	int tileY0 = (int)std::max(minY, 0.0f) / OCCLUSION_TILE_HEIGHT;
+	int tileX1 = std::min((int)maxX / OCCLUSION_TILE_WIDTH, OCCLUSION_TILES_X - 1);
+	int tileY1 = std::min((int)maxY / OCCLUSION_TILE_HEIGHT, OCCLUSION_TILES_Y - 1);
+
+	unsigned int index = (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+	for (int ty = tileY0; ty <= tileY1; ty++)
+	{
+		for (int tx = tileX0; tx <= tileX1; tx++)
+			bins[ty * OCCLUSION_TILES_X + tx].push_back(index);
+	}
+}
+
+// --------------------------------------------------------
+// Clears a tile, draws everything binned into it and then
+// finds the furthest depth in each of its blocks
+// --------------------------------------------------------
+void OcclusionBuffer::RasterizeTile(int tile)
+{
+	int x0 = (tile % OCCLUSION_TILES_X) * OCCLUSION_TILE_WIDTH;
+	int y0 = (tile / OCCLUSION_TILES_X) * OCCLUSION_TILE_HEIGHT;
+	int x1 = x0 + OCCLUSION_TILE_WIDTH;
+	int y1 = y0 + OCCLUSION_TILE_HEIGHT;
+
+	for (int y = y0; y < y1; y++)
+		std::fill_n(&depth[y * OCCLUSION_WIDTH + x0], OCCLUSION_TILE_WIDTH, 1.0f);
+
+	for (unsigned int index : bins[tile])
+		RasterizeTriangle(triangles[index], x0, y0, x1, y1);
+
+	for (int by = y0 / OCCLUSION_BLOCK_SIZE; by < y1 / OCCLUSION_BLOCK_SIZE; by++)
+	{
+		for (int bx = x0 / OCCLUSION_BLOCK_SIZE; bx < x1 / OCCLUSION_BLOCK_SIZE; bx++)
+		{
+			float furthest = 0.0f;
+			for (int y = by * OCCLUSION_BLOCK_SIZE; y < (by + 1) * OCCLUSION_BLOCK_SIZE; y++)
+			{
+				const float* row = &depth[y * OCCLUSION_WIDTH + bx * OCCLUSION_BLOCK_SIZE];
+				furthest = std::max(furthest, *std::max_element(row, row + OCCLUSION_BLOCK_SIZE));
+			}
+			blockMax[by * OCCLUSION_BLOCKS_X + bx] = furthest;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Draws the part of a triangle inside [x0, x1) x [y0, y1),
+// testing pixel centers against the three edges and keeping
+// the nearest depth, four pixels per step
+// --------------------------------------------------------
+void OcclusionBuffer::RasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1)
+{
+	XMFLOAT3 v0 = triangle.v[0];
+	XMFLOAT3 v1 = triangle.v[1];
+	XMFLOAT3 v2 = triangle.v[2];
+
+	// Occluders are drawn from both sides, so turn the triangle to face forward
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	// Pixels covered inside this tile, starting on a multiple of four
+	int minX = (int)floorf(std::max(std::min({ v0.x, v1.x, v2.x }), (float)x0)) & ~3;
+	int minY = (int)floorf(std::max(std::min({ v0.y, v1.y, v2.y }), (float)y0));
+	int maxX = (int)ceilf(std::min(std::max({ v0.x, v1.x, v2.x }), (float)(x1 - 1)));
+	int maxY = (int)ceilf(std::min(std::max({ v0.y, v1.y, v2.y }), (float)(y1 - 1)));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// Edge functions a * x + b * y + c, positive on the inside of each edge
+	const XMFLOAT3* corners[3] = { &v0, &v1, &v2 };
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT3& p = *corners[i];
+		const XMFLOAT3& q = *corners[(i + 1) % 3];
+		edgeA[i] = p.y - q.y;
+		edgeB[i] = q.x - p.x;
+		edgeC[i] = (q.y - p.y) * p.x - (q.x - p.x) * p.y;
+	}
+
+	// Depth is linear in screen space after the divide by w
+	float depthA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) / area;
+	float depthB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+	float depthC = v0.z - depthA * v0.x - depthB * v0.y;
+
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR pixelX = XMVectorAdd(XMVectorReplicate((float)minX), XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f));
+	XMVECTOR edgeStep[3];
+	XMVECTOR edgeStart[3];
+	for (int i = 0; i < 3; i++)
+	{
+		edgeStep[i] = XMVectorReplicate(edgeA[i] * 4.0f);
+		edgeStart[i] = XMVectorMultiplyAdd(XMVectorReplicate(edgeA[i]), pixelX, XMVectorReplicate(edgeC[i]));
+	}
+	XMVECTOR depthStep = XMVectorReplicate(depthA * 4.0f);
+	XMVECTOR depthStart = XMVectorMultiplyAdd(XMVectorReplicate(depthA), pixelX, XMVectorReplicate(depthC));
+
+	for (int y = minY; y <= maxY; y++)
+	{
+		float pixelY = y + 0.5f;
+		XMVECTOR e0 = XMVectorAdd(edgeStart[0], XMVectorReplicate(edgeB[0] * pixelY));
+		XMVECTOR e1 = XMVectorAdd(edgeStart[1], XMVectorReplicate(edgeB[1] * pixelY));
+		XMVECTOR e2 = XMVectorAdd(edgeStart[2], XMVectorReplicate(edgeB[2] * pixelY));
+		XMVECTOR z = XMVectorAdd(depthStart, XMVectorReplicate(depthB * pixelY));
+
+		float* row = &depth[y * OCCLUSION_WIDTH];
+		for (int x = minX; x <= maxX; x += 4)
+		{
+			XMVECTOR inside = XMVectorAndInt(
+				XMVectorAndInt(XMVectorGreaterOrEqual(e0, zero), XMVectorGreaterOrEqual(e1, zero)),
+				XMVectorGreaterOrEqual(e2, zero));
+
+			if (XMVector4NotEqualInt(inside, XMVectorFalseInt()))
+			{
+				XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(&row[x]);
+				XMVECTOR current = XMLoadFloat4(pixels);
+				XMStoreFloat4(pixels, XMVectorSelect(current, XMVectorMin(current, z), inside));
+			}
+
+			e0 = XMVectorAdd(e0, edgeStep[0]);
+			e1 = XMVectorAdd(e1, edgeStep[1]);
+			e2 = XMVectorAdd(e2, edgeStep[2]);
+			z = XMVectorAdd(z, depthStep);
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+
+class Mesh;
+
+// Size of the CPU depth buffer, low enough to fill in well under a millisecond
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+
+// Screen is split into tiles that are rasterized as separate jobs
+#define OCCLUSION_TILE_WIDTH 64
+#define OCCLUSION_TILE_HEIGHT 32
+#define OCCLUSION_TILES_X (OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH)
+#define OCCLUSION_TILES_Y (OCCLUSION_HEIGHT / OCCLUSION_TILE_HEIGHT)
+#define OCCLUSION_TILE_COUNT (OCCLUSION_TILES_X * OCCLUSION_TILES_Y)
+
+// Pixels per side of each max depth block in the coarse level
+#define OCCLUSION_BLOCK_SIZE 8
+#define OCCLUSION_BLOCKS_X (OCCLUSION_WIDTH / OCCLUSION_BLOCK_SIZE)
+#define OCCLUSION_BLOCKS_Y (OCCLUSION_HEIGHT / OCCLUSION_BLOCK_SIZE)
+
+// Software depth buffer for throwing out entities hidden behind big occluders
+// - A few chosen meshes (floors, walls, buildings) are drawn on the CPU into
+//   a small depth buffer, then entity bounds are tested against it
+// - Triangles are clipped and binned into screen tiles up front, then every
+//   tile rasterizes its own bin on the job system, four pixels at a time
+// - Each block of pixels also keeps its furthest depth, so most boxes are
+//   answered from a handful of blocks without touching single pixels
+// - Depth is D3D style, 0 at the near plane and 1 at the far plane
+// - Fill with Begin(), AddOccluder() and Rasterize() on one thread, after
+//   that IsVisible() is read only and safe to call from any thread
+class OcclusionBuffer
+{
+public:
+	OcclusionBuffer();
+
+	// Building the buffer
+	void Begin(DirectX::XMFLOAT4X4 viewProjection);
+	void AddOccluder(Mesh* mesh, const DirectX::XMFLOAT4X4& world);
+	void Rasterize();
+
+	// Tests, boxes poking through the near plane always count as visible
+	bool IsVisible(const DirectX::BoundingBox& box) const;
+
+	// Stats
+	unsigned int GetTriangleCount();
+	float GetDepth(int x, int y);
+
+private:
+	// Screen space corners, x and y in pixels and z as depth
+	struct Triangle
+	{
+		DirectX::XMFLOAT3 v[3];
+	};
+
+	void AddTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c);
+	void AddClippedTriangle(const DirectX::XMFLOAT4* clip);
+	void RasterizeTile(int tile);
+	void RasterizeTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	// Triangles for this frame and the ones touching each tile
+	std::vector<Triangle> triangles;
+	std::vector<unsigned int> bins[OCCLUSION_TILE_COUNT];
+
+	// Full resolution depth, and the furthest depth in each block
+	std::vector<float> depth;
+	std::vector<float> blockMax;
+
+	// Reused when transforming each occluder's vertices
+	std::vector<DirectX::XMFLOAT4> clipVertices;
+};
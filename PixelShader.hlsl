@@ -11,15 +11,21 @@ SamplerComparisonState ShadowSampler : register(s1);
 // Texture for shadows
 Texture2D ShadowMap : register(t4);
 
-cbuffer ExternalData : register(b0)
+// Camera and lights, uploaded once a frame
+cbuffer PerFrame : register(b0)
+{
+    float3 cameraPosition;
+    float3 ambientLight;
+    Light lights[5];
+};
+
+// Uploaded when the material changes
+cbuffer PerMaterial : register(b1)
 {
     float4 colorTint;
     float2 scale;
     float2 offset;
     float roughness;
-    float3 cameraPosition;
-    Light lights[5];
-    float3 ambientLight;
 };
 
 // --------------------------------------------------------
@@ -113,5 +119,6 @@ float4 main(VertexToPixel input) : SV_TARGET
 	// - This color (like most values passing through the rasterizer) is 
 	//   interpolated for each pixel between the corresponding vertices 
 	//   of the triangle we're rendering
-    return float4(pow(totalLight, 1.0f / 2.2f), 1);
+    // Alpha from the tint, only blended when the material is sorted as transparent
+    return float4(pow(totalLight, 1.0f / 2.2f), colorTint.a);
 }
\ No newline at end of file
@@ -0,0 +1,17 @@
+#pragma once
+#include "CommandList.h"
+
+// Common interface of everything that can play back a recorded command list,
+// so the frame is recorded the same way whether it reaches a GPU or not
+// - Bound state carries over from one Execute() to the next, like a device context
+class IRenderBackend
+{
+public:
+	virtual ~IRenderBackend() = default;
+
+	virtual void Execute(const CommandList& commands) = 0;
+
+	// One command of a list, skipping whatever Execute() does once per list,
+	// so a replay can time every command on its own
+	virtual void ExecuteCommand(const CommandList& commands, const RenderCommand& command) = 0;
+};
@@ -0,0 +1,176 @@
+#include "RenderPacket.h"
+#include "Mesh.h"
+#include "Material.h"
+#include <algorithm>
+
+// Annonymous namespace for batching helpers
+namespace
+{
+	// Starts a new batch whenever the mesh, or the material if it matters, changes
+	void SplitBatches(const std::vector<DrawItem>& list, bool byMaterial, std::vector<DrawBatch>& batches)
+	{
+		batches.clear();
+		for (unsigned int i = 0; i < (unsigned int)list.size(); i++)
+		{
+			if (i > 0 &&
+				list[i].mesh == list[i - 1].mesh &&
+				(!byMaterial || list[i].material == list[i - 1].material))
+			{
+				batches.back().count++;
+				continue;
+			}
+			batches.push_back({ i, 1 });
+		}
+	}
+}
+
+RenderPacket::~RenderPacket()
+{
+	ClearUI();
+}
+
+/// <summary>
+/// Takes a copy of the UI triangles ImGui produced this frame
+/// </summary>
+/// <param name="drawData">Result of ImGui::Render()</param>
+void RenderPacket::CopyUI(ImDrawData* drawData)
+{
+	ClearUI();
+
+	// ImGui already skipped empty lists, so every list is copied as is
+	for (ImDrawList* list : drawData->CmdLists)
+		ui.CmdLists.push_back(list->CloneOutput());
+
+	ui.Valid = drawData->Valid;
+	ui.CmdListsCount = ui.CmdLists.Size;
+	ui.TotalIdxCount = drawData->TotalIdxCount;
+	ui.TotalVtxCount = drawData->TotalVtxCount;
+	ui.DisplayPos = drawData->DisplayPos;
+	ui.DisplaySize = drawData->DisplaySize;
+	ui.FramebufferScale = drawData->FramebufferScale;
+}
+
+/// <summary>
+/// Groups the draw lists for instancing, only draws already next to each other are
+/// batched, so sorted lists give the fewest batches and any order is kept as is
+/// </summary>
+void RenderPacket::BuildInstances()
+{
+	SplitBatches(drawList, true, batches);
+	SplitBatches(shadowList, false, shadowBatches);
+
+	size_t depthCount = depthPrepass ? depthOrder.size() : 0;
+	size_t depthStart = drawList.size() + shadowList.size();
+	instances.resize(depthStart + depthCount);
+	for (size_t i = 0; i < drawList.size(); i++)
+		instances[i] = { drawList[i].world, drawList[i].worldInvTranspose };
+	for (size_t i = 0; i < shadowList.size(); i++)
+		instances[drawList.size() + i] = { shadowList[i].world, shadowList[i].worldInvTranspose };
+	for (size_t i = 0; i < depthCount; i++)
+		instances[depthStart + i] = { drawList[depthOrder[i]].world, drawList[depthOrder[i]].worldInvTranspose };
+
+	// Same choice Render() makes for the main pass, materials without an instanced shader draw one at a time
+	depthBatches.clear();
+	if (!depthPrepass)
+		return;
+
+	instancedDraws.assign(drawList.size(), false);
+	for (const DrawBatch& batch : batches)
+	{
+		if (batch.count > 1 && drawList[batch.first].material->GetInstancedVertexShader())
+			std::fill(instancedDraws.begin() + batch.first, instancedDraws.begin() + batch.first + batch.count, true);
+	}
+
+	// Draws the main pass doesn't instance are drawn alone
+	for (unsigned int i = 0; i < (unsigned int)depthOrder.size(); i++)
+	{
+		unsigned int slot = depthOrder[i];
+		if (i > 0 && instancedDraws[slot])
+		{
+			unsigned int last = depthOrder[i - 1];
+			if (instancedDraws[last] && drawList[last].mesh == drawList[slot].mesh)
+			{
+				depthBatches.back().count++;
+				continue;
+			}
+		}
+		depthBatches.push_back({ i, 1 });
+	}
+}
+
+/// <summary>
+/// Sorts the opaque draws front to back alone, state is ignored since the
+/// pre-pass binds one shader, the depth of a draw is the view depth of its
+/// mesh's bounds centre, so merged chunks are placed by their own centre
+/// </summary>
+/// <param name="depthRange">View depth that maps to the far end of the key</param>
+/// <param name="queue">Scratch queue, cleared first</param>
+void RenderPacket::BuildDepthOrder(float depthRange, RenderQueue& queue)
+{
+	float depthScale = 1.0f / depthRange;
+
+	queue.Clear();
+	for (unsigned int i = 0; i < firstTransparent; i++)
+	{
+		// Perspective leaves the view depth in w
+		const DrawItem& item = drawList[i];
+		DirectX::XMFLOAT3 center = item.mesh->GetBounds().Center;
+		const DirectX::XMFLOAT4X4& m = item.worldViewProjection;
+		float depth = center.x * m._14 + center.y * m._24 + center.z * m._34 + m._44;
+		queue.Add(RenderQueue::MakeKey(RENDER_PASS_MAIN, false, 0, 0, 0, depth * depthScale), i);
+	}
+	queue.Sort();
+	depthOrder = queue.GetIndices();
+}
+
+/// <summary>
+/// Adds up the share of the screen each opaque draw's bounds cover once
+/// projected, a box reaching behind the eye counts as the whole screen
+/// - Ignores depth testing, so it's what every draw would shade without
+///   any early depth rejection, the pre-pass brings shading down to once per pixel
+/// </summary>
+/// <returns>Covered area over the screen's area, 1 is one layer over the whole screen</returns>
+float RenderPacket::EstimateOverdraw() const
+{
+	float overdraw = 0.0f;
+	for (unsigned int i = 0; i < firstTransparent; i++)
+	{
+		const DrawItem& item = drawList[i];
+		DirectX::XMFLOAT3 corners[8];
+		item.mesh->GetBounds().GetCorners(corners);
+
+		float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f;
+		bool behind = false;
+		for (const DirectX::XMFLOAT3& corner : corners)
+		{
+			DirectX::XMFLOAT4 clip;
+			DirectX::XMStoreFloat4(&clip, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&corner), DirectX::XMLoadFloat4x4(&item.worldViewProjection)));
+			if (clip.w <= 0.0f)
+			{
+				behind = true;
+				break;
+			}
+			minX = std::min(minX, clip.x / clip.w);
+			minY = std::min(minY, clip.y / clip.w);
+			maxX = std::max(maxX, clip.x / clip.w);
+			maxY = std::max(maxY, clip.y / clip.w);
+		}
+
+		// Clip space runs from -1 to 1, so the screen is 4 square units
+		if (behind)
+			overdraw += 1.0f;
+		else if (maxX > -1.0f && maxY > -1.0f && minX < 1.0f && minY < 1.0f)
+			overdraw += (std::min(maxX, 1.0f) - std::max(minX, -1.0f)) * (std::min(maxY, 1.0f) - std::max(minY, -1.0f)) * 0.25f;
+	}
+	return overdraw;
+}
+
+/// <summary>
+/// Frees the copied UI lists
+/// </summary>
+void RenderPacket::ClearUI()
+{
+	for (ImDrawList* list : ui.CmdLists)
+		IM_DELETE(list);
+	ui.Clear();
+}
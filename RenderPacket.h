@@ -0,0 +1,109 @@
+#pragma once
+#include <vector>
+#include <DirectXMath.h>
+#include "Camera.h"
+#include "Lights.h"
+#include "EntityRegistry.h"
+#include "Vertex.h"
+#include "RenderQueue.h"
+#include "ImGui/imgui.h"
+
+// Neighbouring draws of a list that share a mesh, and a material
+// for the main pass, so one instanced draw can cover all of them
+struct DrawBatch
+{
+	unsigned int first;
+	unsigned int count;
+};
+
+// Everything needed to draw one frame
+// - Filled in on the main thread once the frame's update is done, then
+//   only read while drawing, so the next update can't change what is drawn
+// - Meshes and materials are borrowed, everything else is a copy, so
+//   material settings edited in the UI show up a frame early
+struct RenderPacket
+{
+	RenderPacket() = default;
+	~RenderPacket();
+	RenderPacket(const RenderPacket&) = delete;
+	RenderPacket& operator=(const RenderPacket&) = delete;
+
+	// ImGui reuses its draw lists as soon as the next frame starts,
+	// so the packet keeps its own copy of the triangles
+	void CopyUI(ImDrawData* drawData);
+	void ClearUI();
+
+	// Splits both lists into batches and copies every draw's matrices into the
+	// instance data, the main list's draws first, then the casters, then the
+	// pre-pass's copies of the opaque draws in depth order
+	void BuildInstances();
+
+	// Puts the opaque draws' slots in depthOrder nearest first, queue is only
+	// scratch space for the sort, kept by the caller so its memory is reused
+	void BuildDepthOrder(float depthRange, RenderQueue& queue);
+
+	// Times each screen pixel is covered by opaque draws, going by the
+	// screen rectangles of their bounds, so a rough upper estimate
+	float EstimateOverdraw() const;
+
+	unsigned long long frame = 0;
+
+	// Camera and the entities it can see
+	CameraData camera = {};
+	std::vector<DrawItem> drawList;
+
+	// Draws from here on are blended, drawn after the sky
+	unsigned int firstTransparent = 0;
+
+	// Everything drawn into the shadow map
+	std::vector<DrawItem> shadowList;
+
+	// Lighting, the shadow matrices are already folded into each draw item
+	std::vector<Light> lights;
+	DirectX::XMFLOAT3 ambientLight = {};
+
+	// Post processing and presenting
+	int blurRadius = 0;
+	bool vsync = false;
+
+	// Upload each constant buffer at its own rate, or all of them for every draw
+	bool splitConstantBuffers = true;
+
+	// Draw each batch of more than one draw with a single instanced call, instance
+	// data for drawList[i] is instances[i] and for shadowList[i] it follows the main list
+	bool instancing = false;
+	std::vector<DrawBatch> batches;
+	std::vector<DrawBatch> shadowBatches;
+	std::vector<InstanceData> instances;
+
+	// Opaque draws again before the main pass, depth only and nearest first, so the main
+	// pass only shades what is in front, depthOrder holds drawList slots
+	// - Runs share a mesh and whether the main pass draws them instanced, so both passes
+	//   do the same vertex math and the main pass can test for equal depth
+	// - With instancing, instance data for depthOrder[i] is the casters' end plus i
+	bool depthPrepass = false;
+	std::vector<unsigned int> depthOrder;
+	std::vector<DrawBatch> depthBatches;
+	std::vector<bool> instancedDraws;
+
+	// Instanced shaders multiply by these per vertex instead of reading the draw item's
+	DirectX::XMFLOAT4X4 viewProjection = {};
+	DirectX::XMFLOAT4X4 shadowViewProjection = {};
+
+	// Record the frame as usual but only check the commands instead of drawing them
+	bool nullBackend = false;
+
+	// Copy this frame's command lists into a capture once they are executed
+	bool capture = false;
+
+	// Let the backend drop calls its state cache says are redundant
+	bool filterState = true;
+
+	// Jobs recording the opaque draws, and whether each turns its slice into
+	// a command list on a deferred context instead of leaving it to the end
+	unsigned int recordSlices = 1;
+	bool deferredContexts = true;
+
+	// Copied UI, the packet owns every list in here
+	ImDrawData ui;
+};
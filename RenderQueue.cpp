@@ -0,0 +1,227 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <functional>
+
+// Annonymous namespace for key layout helpers
+namespace
+{
+	const unsigned int PassShift = 62;
+	const unsigned int TransparentShift = 61;
+
+	// Opaque keys, state first then depth
+	const unsigned int OpaqueShaderShift = 24 + RENDER_KEY_MESH_BITS + RENDER_KEY_MATERIAL_BITS;
+	const unsigned int OpaqueMaterialShift = 24 + RENDER_KEY_MESH_BITS;
+	const unsigned int OpaqueMeshShift = 24;
+
+	// Transparent keys, depth first then state, the bottom 3 bits are unused
+	const unsigned int TransparentDepthShift = 3 + RENDER_KEY_MESH_BITS + RENDER_KEY_MATERIAL_BITS + RENDER_KEY_SHADER_BITS;
+	const unsigned int TransparentShaderShift = 3 + RENDER_KEY_MESH_BITS + RENDER_KEY_MATERIAL_BITS;
+	const unsigned int TransparentMaterialShift = 3 + RENDER_KEY_MESH_BITS;
+	const unsigned int TransparentMeshShift = 3;
+
+	unsigned long long Field(unsigned int value, unsigned int bits)
+	{
+		return (unsigned long long)(value & ((1u << bits) - 1));
+	}
+
+	unsigned int Extract(unsigned long long key, unsigned int shift, unsigned int bits)
+	{
+		return (unsigned int)(key >> shift) & ((1u << bits) - 1);
+	}
+}
+
+/// <summary>
+/// Packs everything a draw is ordered by into one key
+/// </summary>
+/// <param name="pass">RENDER_PASS_ value, passes sort in that order</param>
+/// <param name="transparent">Blended draws go after every opaque draw of the pass, back to front</param>
+/// <param name="shader">Id of the shader pair</param>
+/// <param name="material">Id of the material</param>
+/// <param name="mesh">Id of the mesh</param>
+/// <param name="depth">Distance along the view, 0 at the eye and 1 at the far end</param>
+/// <returns>Key that sorts into submission order</returns>
+unsigned long long RenderQueue::MakeKey(unsigned int pass, bool transparent, unsigned int shader, unsigned int material, unsigned int mesh, float depth)
+{
+	const unsigned int maxDepth = (1u << RENDER_KEY_DEPTH_BITS) - 1;
+	unsigned int quantized = (unsigned int)(std::clamp(depth, 0.0f, 1.0f) * maxDepth);
+
+	unsigned long long key = (unsigned long long)(pass & 3) << PassShift;
+	if (!transparent)
+	{
+		key |= Field(shader, RENDER_KEY_SHADER_BITS) << OpaqueShaderShift;
+		key |= Field(material, RENDER_KEY_MATERIAL_BITS) << OpaqueMaterialShift;
+		key |= Field(mesh, RENDER_KEY_MESH_BITS) << OpaqueMeshShift;
+		key |= quantized;
+	}
+	else
+	{
+		key |= 1ull << TransparentShift;
+		key |= (unsigned long long)(maxDepth - quantized) << TransparentDepthShift;
+		key |= Field(shader, RENDER_KEY_SHADER_BITS) << TransparentShaderShift;
+		key |= Field(material, RENDER_KEY_MATERIAL_BITS) << TransparentMaterialShift;
+		key |= Field(mesh, RENDER_KEY_MESH_BITS) << TransparentMeshShift;
+	}
+	return key;
+}
+
+bool RenderQueue::IsTransparent(unsigned long long key) { return (key >> TransparentShift) & 1; }
+
+unsigned int RenderQueue::GetShader(unsigned long long key)
+{
+	return Extract(key, IsTransparent(key) ? TransparentShaderShift : OpaqueShaderShift, RENDER_KEY_SHADER_BITS);
+}
+
+unsigned int RenderQueue::GetMaterial(unsigned long long key)
+{
+	return Extract(key, IsTransparent(key) ? TransparentMaterialShift : OpaqueMaterialShift, RENDER_KEY_MATERIAL_BITS);
+}
+
+unsigned int RenderQueue::GetMesh(unsigned long long key)
+{
+	return Extract(key, IsTransparent(key) ? TransparentMeshShift : OpaqueMeshShift, RENDER_KEY_MESH_BITS);
+}
+
+void RenderQueue::Clear()
+{
+	keys.clear();
+	indices.clear();
+}
+
+void RenderQueue::Reserve(unsigned int capacity)
+{
+	keys.reserve(capacity);
+	indices.reserve(capacity);
+	scratchKeys.reserve(capacity);
+	scratchIndices.reserve(capacity);
+}
+
+void RenderQueue::Resize(unsigned int count)
+{
+	keys.resize(count);
+	indices.resize(count);
+}
+
+void RenderQueue::Set(unsigned int slot, unsigned long long key, unsigned int index)
+{
+	keys[slot] = key;
+	indices[slot] = index;
+}
+
+void RenderQueue::Add(unsigned long long key, unsigned int index)
+{
+	keys.push_back(key);
+	indices.push_back(index);
+}
+
+/// <summary>
+/// Orders the draws by key, draws with equal keys keep the order they were added in
+/// - One read of the keys builds the histogram of all 8 digits, then each
+///   digit that differs between keys is one stable scatter into the scratch arrays
+/// - Keys mostly differ in their low state and depth bits, so the pass and
+///   transparent digit is usually skipped, and so are unused id bits
+/// </summary>
+void RenderQueue::Sort()
+{
+	unsigned int count = (unsigned int)keys.size();
+	if (count < 2)
+		return;
+
+	unsigned int counts[8][256] = {};
+	for (unsigned long long key : keys)
+	{
+		for (unsigned int digit = 0; digit < 8; digit++)
+			counts[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	scratchKeys.resize(count);
+	scratchIndices.resize(count);
+	for (unsigned int digit = 0; digit < 8; digit++)
+	{
+		// Every key has the same value here, the scatter wouldn't move anything
+		unsigned int shift = digit * 8;
+		if (counts[digit][(keys[0] >> shift) & 0xFF] == count)
+			continue;
+
+		unsigned int offsets[256];
+		unsigned int total = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			offsets[bucket] = total;
+			total += counts[digit][bucket];
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int slot = offsets[(keys[i] >> shift) & 0xFF]++;
+			scratchKeys[slot] = keys[i];
+			scratchIndices[slot] = indices[i];
+		}
+
+		keys.swap(scratchKeys);
+		indices.swap(scratchIndices);
+	}
+}
+
+unsigned int RenderQueue::Count() { return (unsigned int)keys.size(); }
+const std::vector<unsigned long long>& RenderQueue::GetKeys() { return keys; }
+const std::vector<unsigned int>& RenderQueue::GetIndices() { return indices; }
+
+/// <summary>
+/// Finds where the blended draws start, for a sorted queue holding a single pass
+/// </summary>
+/// <returns>Slot of the first transparent draw, or Count() if there are none</returns>
+unsigned int RenderQueue::GetFirstTransparent()
+{
+	auto first = std::partition_point(keys.begin(), keys.end(), [](unsigned long long key) { return !IsTransparent(key); });
+	return (unsigned int)(first - keys.begin());
+}
+
+/// <summary>
+/// Counts the binds drawing in the current order would need, before
+/// or after sorting, the first draw binds all three
+/// </summary>
+/// <returns>Shader, material and mesh changes added together</returns>
+unsigned int RenderQueue::CountStateChanges()
+{
+	unsigned int changes = 0;
+	unsigned int shader = ~0u, material = ~0u, mesh = ~0u;
+	for (unsigned long long key : keys)
+	{
+		unsigned int nextShader = GetShader(key);
+		unsigned int nextMaterial = GetMaterial(key);
+		unsigned int nextMesh = GetMesh(key);
+		changes += (nextShader != shader) + (nextMaterial != material) + (nextMesh != mesh);
+		shader = nextShader;
+		material = nextMaterial;
+		mesh = nextMesh;
+	}
+	return changes;
+}
+
+/// <summary>
+/// Takes the lowest released id, or a new one past the highest when none is free
+/// </summary>
+unsigned int SortIdAllocator::Allocate()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (freeIds.empty())
+		return next++;
+
+	std::pop_heap(freeIds.begin(), freeIds.end(), std::greater<unsigned int>());
+	unsigned int id = freeIds.back();
+	freeIds.pop_back();
+	return id;
+}
+
+void SortIdAllocator::Release(unsigned int id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	freeIds.push_back(id);
+	std::push_heap(freeIds.begin(), freeIds.end(), std::greater<unsigned int>());
+}
+
+unsigned int SortIdAllocator::GetCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return next - (unsigned int)freeIds.size();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <vector>
+#include <mutex>
+
+// Passes, in the order they are drawn, the top two bits of a draw key
+#define RENDER_PASS_SHADOW 0
+#define RENDER_PASS_MAIN 1
+
+// Bits each field of a draw key gets, ids past these wrap around
+// and only cost a few extra state changes, never a wrong draw
+#define RENDER_KEY_SHADER_BITS 10
+#define RENDER_KEY_MATERIAL_BITS 12
+#define RENDER_KEY_MESH_BITS 12
+#define RENDER_KEY_DEPTH_BITS 24
+
+// Draws ordered by a single 64 bit key, so one sort groups them by state
+// - Opaque:      pass 2 | 0 | shader 10 | material 12 | mesh 12 | depth 24
+//   nearest first inside each run of identical state, so early depth rejects more
+// - Transparent: pass 2 | 1 | inverted depth 24 | shader 10 | material 12 | mesh 12
+//   furthest first whatever the state, blending needs back to front
+// - Keys are sorted with an 8 bit least significant digit radix sort, linear in
+//   the number of draws, digits every key shares are skipped
+class RenderQueue
+{
+public:
+	// depth is 0 at the eye and 1 at the far end of the range, clamped
+	static unsigned long long MakeKey(unsigned int pass, bool transparent, unsigned int shader, unsigned int material, unsigned int mesh, float depth);
+	static bool IsTransparent(unsigned long long key);
+	static unsigned int GetShader(unsigned long long key);
+	static unsigned int GetMaterial(unsigned long long key);
+	static unsigned int GetMesh(unsigned long long key);
+
+	void Clear();
+	void Reserve(unsigned int capacity);
+
+	// Resize() then Set() lets jobs fill their own slots in parallel
+	void Resize(unsigned int count);
+	void Set(unsigned int slot, unsigned long long key, unsigned int index);
+	void Add(unsigned long long key, unsigned int index);
+
+	void Sort();
+
+	unsigned int Count();
+	const std::vector<unsigned long long>& GetKeys();
+	const std::vector<unsigned int>& GetIndices();
+
+	// First slot holding a transparent draw, Count() when there are none, only valid once sorted
+	unsigned int GetFirstTransparent();
+
+	// Shader, material and mesh binds the current order needs, each counted when it differs from the draw before
+	unsigned int CountStateChanges();
+
+private:
+	// Keys and the dense index each one draws, moved together
+	std::vector<unsigned long long> keys;
+	std::vector<unsigned int> indices;
+
+	// Every pass scatters into these, then they swap with the above
+	std::vector<unsigned long long> scratchKeys;
+	std::vector<unsigned int> scratchIndices;
+};
+
+// Hands out the small ids meshes and materials put in draw keys, lowest free one first
+// - Ids come back when their owner is destroyed, so scenes that keep making meshes,
+//   like the static batcher merging chunks, stay inside the key's bits
+// - Locked, resources can be made and destroyed from any thread
+class SortIdAllocator
+{
+public:
+	unsigned int Allocate();
+	void Release(unsigned int id);
+
+	// Ids handed out and not yet released
+	unsigned int GetCount();
+
+private:
+	std::mutex mutex;
+	unsigned int next = 0;
+
+	// Released ids as a min heap, so the lowest is reused first
+	std::vector<unsigned int> freeIds;
+};
@@ -0,0 +1,182 @@
+#include "RenderStateCache.h"
+#include <cstring>
+
+// Annonymous namespace for the unknown binding marker
+namespace
+{
+	// Never a real pointer, so it never matches what a command binds
+	void* const Unknown = (void*)~(size_t)0;
+}
+
+RenderStateCache::RenderStateCache()
+{
+	Clear();
+}
+
+/// <summary>
+/// Checks a command against the shadow state and records its effect
+/// </summary>
+/// <param name="commands">List holding the command's payload</param>
+/// <param name="command">Next command to replay</param>
+/// <returns>True when replaying it would leave the context as it is</returns>
+bool RenderStateCache::Filter(const CommandList& commands, const RenderCommand& command)
+{
+	bool redundant = false;
+	unsigned int stage = command.stage < 2 ? command.stage : 0;
+
+	switch (command.type)
+	{
+	case RENDER_COMMAND_SET_TARGETS:
+	{
+		const RenderTargets* next = (const RenderTargets*)commands.GetData(command.a);
+		redundant = targetsKnown && next->target == targets.target && next->depth == targets.depth;
+		targets = *next;
+		targetsKnown = true;
+		break;
+	}
+
+	case RENDER_COMMAND_SET_VIEWPORT:
+	{
+		const RenderViewport* next = (const RenderViewport*)commands.GetData(command.a);
+		redundant = viewportKnown && memcmp(next, &viewport, sizeof(RenderViewport)) == 0;
+		viewport = *next;
+		viewportKnown = true;
+		break;
+	}
+
+	case RENDER_COMMAND_SET_RASTERIZER:
+		redundant = Replace(rasterizerState, command.object);
+		break;
+
+	case RENDER_COMMAND_SET_BLEND:
+		redundant = Replace(blendState, command.object);
+		break;
+
+	case RENDER_COMMAND_SET_DEPTH_STENCIL:
+		redundant = Replace(depthStencilState, command.object) && stencilRef == command.a;
+		stencilRef = command.a;
+		break;
+
+	case RENDER_COMMAND_BIND_SHADER:
+		redundant = Replace(shaders[stage], command.object);
+		break;
+
+	case RENDER_COMMAND_BIND_TEXTURE:
+		if (command.slot >= RENDER_CACHE_TEXTURE_SLOTS)
+			break;
+		redundant = Replace(textures[stage][command.slot], command.object);
+		if (command.object && command.slot >= textureEnd[stage])
+			textureEnd[stage] = command.slot + 1u;
+		break;
+
+	case RENDER_COMMAND_UNBIND_TEXTURES:
+		// Nothing left bound, or at least nothing the lists bound
+		redundant = textureEnd[stage] == 0;
+		for (unsigned int slot = 0; slot < textureEnd[stage]; slot++)
+			textures[stage][slot] = nullptr;
+		textureEnd[stage] = 0;
+		break;
+
+	case RENDER_COMMAND_BIND_SAMPLER:
+		if (command.slot < RENDER_CACHE_SAMPLER_SLOTS)
+			redundant = Replace(samplers[stage][command.slot], command.object);
+		break;
+
+	case RENDER_COMMAND_UPDATE_CONSTANTS:
+	{
+		std::vector<unsigned char>& last = constants[command.object];
+		const void* data = commands.GetData(command.a);
+		redundant = last.size() == command.b && memcmp(last.data(), data, command.b) == 0;
+		if (!redundant)
+			last.assign((const unsigned char*)data, (const unsigned char*)data + command.b);
+		break;
+	}
+
+	case RENDER_COMMAND_SET_VERTEX_BUFFER:
+		if (command.slot >= RENDER_CACHE_VERTEX_SLOTS)
+			break;
+		redundant = Replace(vertexBuffers[command.slot], command.object) && vertexStrides[command.slot] == command.a;
+		vertexStrides[command.slot] = command.a;
+		break;
+
+	case RENDER_COMMAND_SET_INDEX_BUFFER:
+		redundant = Replace(indexBuffer, command.object);
+		break;
+
+	case RENDER_COMMAND_SET_TOPOLOGY:
+		redundant = topologyKnown && topology == command.a;
+		topology = command.a;
+		topologyKnown = true;
+		break;
+
+	default:
+		// Clears, draws and dynamic writes
+		return false;
+	}
+
+	stateCount++;
+	redundantCount += redundant;
+	return redundant;
+}
+
+/// <summary>
+/// Marks every binding unknown, so the next one of each kind goes through
+/// </summary>
+void RenderStateCache::ForgetBindings()
+{
+	for (unsigned int stage = 0; stage < 2; stage++)
+	{
+		shaders[stage] = Unknown;
+		for (void*& texture : textures[stage])
+			texture = Unknown;
+		for (void*& sampler : samplers[stage])
+			sampler = Unknown;
+	}
+
+	for (unsigned int slot = 0; slot < RENDER_CACHE_VERTEX_SLOTS; slot++)
+	{
+		vertexBuffers[slot] = Unknown;
+		vertexStrides[slot] = 0;
+	}
+	indexBuffer = Unknown;
+	topology = 0;
+	topologyKnown = false;
+
+	rasterizerState = Unknown;
+	blendState = Unknown;
+	depthStencilState = Unknown;
+	stencilRef = 0;
+	targetsKnown = false;
+	viewportKnown = false;
+}
+
+/// <summary>
+/// Forgets everything, including constant buffer contents
+/// and which texture slots may still need unbinding
+/// </summary>
+void RenderStateCache::Clear()
+{
+	ForgetBindings();
+	constants.clear();
+	textureEnd[0] = textureEnd[1] = 0;
+	ResetCounts();
+}
+
+void RenderStateCache::ForgetConstants() { constants.clear(); }
+
+unsigned int RenderStateCache::GetTextureSlotEnd(unsigned int stage) const { return stage < 2 ? textureEnd[stage] : 0; }
+unsigned int RenderStateCache::GetStateCount() const { return stateCount; }
+unsigned int RenderStateCache::GetRedundantCount() const { return redundantCount; }
+
+void RenderStateCache::ResetCounts()
+{
+	stateCount = 0;
+	redundantCount = 0;
+}
+
+bool RenderStateCache::Replace(void*& slot, void* value)
+{
+	bool same = slot == value;
+	slot = value;
+	return same;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "CommandList.h"
+
+// Slots the cache tracks per stage, matching Direct3D 11's limits
+#define RENDER_CACHE_TEXTURE_SLOTS 128
+#define RENDER_CACHE_SAMPLER_SLOTS 16
+#define RENDER_CACHE_VERTEX_SLOTS 2
+
+// Shadow copy of what a device context has bound, so calls that wouldn't
+// change anything can be dropped before they reach the driver
+// - Only compares the pointers and payloads commands carry, so the null
+//   backend can report what a real backend would filter
+// - Bindings start out unknown and ForgetBindings() makes them unknown again,
+//   for whenever something outside the command lists may have used the context
+// - Constant buffer contents are kept until Clear(), only recorded uploads write
+//   them, so uploading the bytes a buffer already holds is dropped, even a frame later
+class RenderStateCache
+{
+public:
+	RenderStateCache();
+
+	// Updates the shadow state with a command, true when it would change nothing
+	// - Clears, draws and dynamic buffer writes always go through and aren't counted
+	bool Filter(const CommandList& commands, const RenderCommand& command);
+
+	void ForgetBindings();
+	void Clear();
+
+	// For when another context may have written to the buffers in between
+	void ForgetConstants();
+
+	// One past the highest texture slot of a RENDER_STAGE_ that may still hold
+	// a view, what an unbind has to cover, not affected by ForgetBindings()
+	unsigned int GetTextureSlotEnd(unsigned int stage) const;
+
+	// State changing commands seen since the last ResetCounts(), and how many were redundant
+	unsigned int GetStateCount() const;
+	unsigned int GetRedundantCount() const;
+	void ResetCounts();
+
+private:
+	// True when slot already holds value, stores it either way
+	bool Replace(void*& slot, void* value);
+
+	void* shaders[2];
+	void* textures[2][RENDER_CACHE_TEXTURE_SLOTS];
+	void* samplers[2][RENDER_CACHE_SAMPLER_SLOTS];
+	unsigned int textureEnd[2];
+
+	void* vertexBuffers[RENDER_CACHE_VERTEX_SLOTS];
+	unsigned int vertexStrides[RENDER_CACHE_VERTEX_SLOTS];
+	void* indexBuffer;
+	unsigned int topology;
+
+	void* rasterizerState;
+	void* blendState;
+	void* depthStencilState;
+	unsigned int stencilRef;
+
+	RenderTargets targets;
+	RenderViewport viewport;
+	bool targetsKnown;
+	bool viewportKnown;
+	bool topologyKnown;
+
+	// Last bytes uploaded to each constant buffer
+	std::unordered_map<void*, std::vector<unsigned char>> constants;
+
+	unsigned int stateCount;
+	unsigned int redundantCount;
+};
@@ -0,0 +1,29 @@
+#include "ShaderHeader.hlsli"
+
+// Uploaded once per frame, the light's view and projection
+cbuffer PerFrame : register(b0)
+{
+    matrix viewProjection;
+};
+
+// Mesh vertex plus the caster's world matrix, stepped once per instance,
+// only the world rows of the instance data are read
+struct InstancedShadowInput
+{
+    float3 localPosition : POSITION;
+    float4 world0 : WORLD_PER_INSTANCE0;
+    float4 world1 : WORLD_PER_INSTANCE1;
+    float4 world2 : WORLD_PER_INSTANCE2;
+    float4 world3 : WORLD_PER_INSTANCE3;
+};
+
+// Simplified VS for shadows, many casters sharing a mesh at once
+float4 main(InstancedShadowInput input) : SV_POSITION
+{
+    // Rows arrive as stored on the CPU, so the vector goes on the left
+    float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+    // Precise to match VertexShaderInstanced.hlsl's depth exactly for the pre-pass
+    precise float4 worldPosition = mul(float4(input.localPosition, 1.0f), world);
+    precise float4 position = mul(viewProjection, worldPosition);
+    return position;
+}
@@ -1,17 +1,17 @@
 #include "ShaderHeader.hlsli"
 
-// External Data
-cbuffer externalData : register(b0)
+// Uploaded for every caster, world times the light's view and projection
+cbuffer PerObject : register(b2)
 {
-    matrix world;
-    matrix view;
-    matrix projection;
+    matrix worldViewProjection;
 };
 
 // Simplified VS for shadows
 float4 main(VertexShaderInput input) : SV_POSITION
 {
-    matrix wvp = mul(projection, mul(view, world));
-    return mul(wvp, float4(input.localPosition, 1.0f));
+    // Precise so the depth pre-pass lands on the exact depth VertexShader.hlsl
+    // gives, the main pass only draws where the two are equal
+    precise float4 position = mul(worldViewProjection, float4(input.localPosition, 1.0f));
+    return position;
 
 }
\ No newline at end of file
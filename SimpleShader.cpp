@@ -1,9 +1,16 @@
 #include "SimpleShader.h"
+#include "CommandList.h"
 
 // Default error reporting state
 bool ISimpleShader::ReportErrors = false;
 bool ISimpleShader::ReportWarnings = false;
 
+// Upload counter, reset and read by whoever wants to measure
+std::atomic<unsigned int> ISimpleShader::UploadedBytes{ 0 };
+
+// Nothing is recorded until a renderer asks for it
+thread_local CommandList* ISimpleShader::Recording = nullptr;
+
 // To enable error reporting, use either or both 
 // of the following lines somewhere in your program, 
 // preferably before loading/using any shaders.
@@ -349,9 +356,13 @@ void ISimpleShader::CopyAllBufferData()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer.Get(), 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
+		if (Recording)
+			Recording->UpdateConstants(constantBuffers[i].ConstantBuffer.Get(), constantBuffers[i].LocalDataBuffer, constantBuffers[i].Size);
+		else
+			deviceContext->UpdateSubresource(
+				constantBuffers[i].ConstantBuffer.Get(), 0, 0,
+				constantBuffers[i].LocalDataBuffer, 0, 0);
+		UploadedBytes += constantBuffers[i].Size;
 	}
 }
 
@@ -380,9 +391,13 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	if (Recording)
+		Recording->UpdateConstants(cb->ConstantBuffer.Get(), cb->LocalDataBuffer, cb->Size);
+	else
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0, 
+			cb->LocalDataBuffer, 0, 0);
+	UploadedBytes += cb->Size;
 }
 
 // --------------------------------------------------------
@@ -402,9 +417,13 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer.Get(), 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	if (Recording)
+		Recording->UpdateConstants(cb->ConstantBuffer.Get(), cb->LocalDataBuffer, cb->Size);
+	else
+		deviceContext->UpdateSubresource(
+			cb->ConstantBuffer.Get(), 0, 0, 
+			cb->LocalDataBuffer, 0, 0);
+	UploadedBytes += cb->Size;
 }
 
 
@@ -868,6 +887,13 @@ void SimpleVertexShader::SetShaderAndCBs()
 	// Is shader valid?
 	if (!shaderValid) return;
 
+	// Recorded binds call back in here when they are replayed
+	if (Recording)
+	{
+		Recording->BindShader(RENDER_STAGE_VERTEX, this);
+		return;
+	}
+
 	// Set the shader and input layout
 	deviceContext->IASetInputLayout(inputLayout.Get());
 	deviceContext->VSSetShader(shader.Get(), 0, 0);
@@ -911,7 +937,10 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, Microsoft::WRL:
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (Recording)
+		Recording->BindTexture(RENDER_STAGE_VERTEX, srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -941,7 +970,10 @@ bool SimpleVertexShader::SetSamplerState(std::string name, Microsoft::WRL::ComPt
 	}
 
 	// Set the shader resource view
-	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (Recording)
+		Recording->BindSampler(RENDER_STAGE_VERTEX, sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -1010,6 +1042,13 @@ void SimplePixelShader::SetShaderAndCBs()
 {
 	// Is shader valid?
 	if (!shaderValid) return;
+
+	// Recorded binds call back in here when they are replayed
+	if (Recording)
+	{
+		Recording->BindShader(RENDER_STAGE_PIXEL, this);
+		return;
+	}
 	
 	// Set the shader
 	deviceContext->PSSetShader(shader.Get(), 0, 0);
@@ -1053,7 +1092,10 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, Microsoft::WRL::
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
+	if (Recording)
+		Recording->BindTexture(RENDER_STAGE_PIXEL, srvInfo->BindIndex, srv.Get());
+	else
+		deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, srv.GetAddressOf());
 
 	// Success
 	return true;
@@ -1083,7 +1125,10 @@ bool SimplePixelShader::SetSamplerState(std::string name, Microsoft::WRL::ComPtr
 	}
 
 	// Set the shader resource view
-	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
+	if (Recording)
+		Recording->BindSampler(RENDER_STAGE_PIXEL, sampInfo->BindIndex, samplerState.Get());
+	else
+		deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, samplerState.GetAddressOf());
 
 	// Success
 	return true;
@@ -10,7 +10,10 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <atomic>
 
+// Recording target, see ISimpleShader::Recording
+class CommandList;
 
 // --------------------------------------------------------
 // Used by simple shaders to store information about
@@ -122,6 +125,14 @@ public:
 	static bool ReportErrors;
 	static bool ReportWarnings;
 
+	// Bytes every shader has copied to constant buffers since this was last reset,
+	// atomic since command lists can be recorded on several threads
+	static std::atomic<unsigned int> UploadedBytes;
+
+	// While set, vertex and pixel shader binds, constant buffer copies and resource
+	// binds made on this thread are recorded into the list instead of the context
+	static thread_local CommandList* Recording;
+
 protected:
 	
 	bool shaderValid;
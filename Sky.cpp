@@ -37,16 +37,16 @@ Sky::~Sky()
 	// Should remain empty with no raw pointers
 }
 
-void Sky::Draw(Camera currentCamera)
+void Sky::Draw(CommandList& commands, const CameraData& currentCamera)
 {
 	// Change the render states
-	Graphics::Context->RSSetState(rasterizerState.Get());
-	Graphics::Context->OMSetDepthStencilState(depthState.Get(), 0);
+	commands.SetRasterizerState(rasterizerState.Get());
+	commands.SetDepthStencilState(depthState.Get(), 0);
 
 	// Prepare sky shaders
 	vertexShader->SetShader();
-	vertexShader->SetMatrix4x4("m4View", currentCamera.GetViewMatrix());
-	vertexShader->SetMatrix4x4("m4Projection", currentCamera.GetProjectionMatrix());
+	vertexShader->SetMatrix4x4("m4View", currentCamera.view);
+	vertexShader->SetMatrix4x4("m4Projection", currentCamera.projection);
 
 	vertexShader->CopyAllBufferData();
 
@@ -54,11 +54,11 @@ void Sky::Draw(Camera currentCamera)
 	pixelShader->SetShaderResourceView("SkyTexture", SRV);
 	pixelShader->SetSamplerState("BasicSampler", samplerState);
 
-	mesh->Draw();
+	mesh->Draw(commands);
 
 	// Reset rasterizer state
-	Graphics::Context->RSSetState(0);
-	Graphics::Context->OMSetDepthStencilState(0, 0);
+	commands.SetRasterizerState(0);
+	commands.SetDepthStencilState(0, 0);
 }
 
 // --------------------------------------------------------
@@ -18,7 +18,7 @@ public:
 		const wchar_t* front,
 		const wchar_t* back);
 	~Sky();
-	void Draw(Camera currentCamera);
+	void Draw(CommandList& commands, const CameraData& currentCamera);
 
 	// From the helper code on MyCourses
 	// Helper for creating a cubemap from 6 individual textures
@@ -0,0 +1,540 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <bit>
+
+using namespace DirectX;
+using namespace SpatialMath;
+
+// Annonymous namespace to hold helpers only used in this file
+namespace
+{
+	// Widest side of a box
+	float Width(const BoundingBox& box)
+	{
+		return 2.0f * std::max(box.Extents.x, std::max(box.Extents.y, box.Extents.z));
+	}
+
+	// 21 bits per axis, about a million cells each way
+	unsigned long long PackCell(int x, int y, int z)
+	{
+		const unsigned long long mask = (1ull << 21) - 1;
+		return
+			(((unsigned long long)(x + (1 << 20)) & mask) << 42) |
+			(((unsigned long long)(y + (1 << 20)) & mask) << 21) |
+			((unsigned long long)(z + (1 << 20)) & mask);
+	}
+
+	// Number of cells in a block of coordinates, ends included
+	unsigned long long CountCells(const int low[3], const int high[3])
+	{
+		return
+			(unsigned long long)(high[0] - low[0] + 1) *
+			(unsigned long long)(high[1] - low[1] + 1) *
+			(unsigned long long)(high[2] - low[2] + 1);
+	}
+}
+
+/// <summary>
+/// Adds an entity, or moves it if it is already in the grid
+/// </summary>
+/// <param name="entity">Entity the entry belongs to</param>
+/// <param name="box">Tight world space bounds</param>
+void SpatialGrid::Insert(Entity entity, const BoundingBox& box)
+{
+	if (Contains(entity))
+	{
+		Update(entity, box);
+		return;
+	}
+
+	unsigned int slot = EntityIndex(entity);
+	if (slot >= items.size())
+		items.resize(slot + 1);
+
+	Item& item = items[slot];
+	item.entity = entity;
+	item.box = box;
+	itemCount++;
+	widthSum += Width(box);
+
+	AddToCell(slot, FindCell(box.Center));
+}
+
+void SpatialGrid::Remove(Entity entity)
+{
+	if (!Contains(entity))
+		return;
+
+	unsigned int slot = EntityIndex(entity);
+	RemoveFromCell(slot);
+	widthSum -= Width(items[slot].box);
+	items[slot].entity = INVALID_ENTITY;
+	itemCount--;
+}
+
+/// <summary>
+/// Stores an entity's new bounds, moving it to another cell if its center left the old one
+/// </summary>
+/// <param name="entity">Entity that moved</param>
+/// <param name="box">New tight world space bounds</param>
+/// <returns>True if the entry changed cells</returns>
+bool SpatialGrid::Update(Entity entity, const BoundingBox& box)
+{
+	if (!Contains(entity))
+	{
+		Insert(entity, box);
+		return true;
+	}
+
+	unsigned int slot = EntityIndex(entity);
+	Item& item = items[slot];
+	widthSum += Width(box) - Width(item.box);
+	item.box = box;
+
+	// Same cell, just make sure the cell still reaches far enough
+	Cell& current = cells[item.cell];
+	if ((int)floorf(box.Center.x / cellSize) == current.x &&
+		(int)floorf(box.Center.y / cellSize) == current.y &&
+		(int)floorf(box.Center.z / cellSize) == current.z)
+	{
+		GrowReach(current, box);
+		return false;
+	}
+
+	RemoveFromCell(slot);
+	AddToCell(slot, FindCell(box.Center));
+	return true;
+}
+
+bool SpatialGrid::Contains(Entity entity)
+{
+	unsigned int slot = EntityIndex(entity);
+	return slot < items.size() && items[slot].entity == entity;
+}
+
+void SpatialGrid::Clear()
+{
+	items.clear();
+	cells.clear();
+	freeCells.clear();
+	lookup.clear();
+	itemCount = 0;
+	cellCount = 0;
+	widthSum = 0.0;
+}
+
+unsigned int SpatialGrid::GetCount() { return itemCount; }
+float SpatialGrid::GetCellSize() { return cellSize; }
+unsigned int SpatialGrid::GetCellCount() { return cellCount; }
+
+/// <summary>
+/// Rebuilds with a new cell size if cells have ended up far too full or too empty
+/// - Cell size matters more than anything else for a grid, too small and queries
+///   test as many cells as entities, too big and every cell is brute force
+/// </summary>
+/// <returns>True if the grid was rebuilt</returns>
+bool SpatialGrid::Tune()
+{
+	// Too little in the grid for the occupancy to mean anything
+	if (itemCount < GRID_TARGET_PER_CELL * GRID_TUNE_SLACK || cellCount == 0)
+		return false;
+
+	float occupancy = (float)itemCount / cellCount;
+	if (occupancy > GRID_TARGET_PER_CELL / GRID_TUNE_SLACK &&
+		occupancy < GRID_TARGET_PER_CELL * GRID_TUNE_SLACK)
+		return false;
+
+	// Occupancy grows with the square of the cell size for flat scenes and
+	// the cube for filled volumes, the square root step lands close for either
+	float newCellSize = cellSize * sqrtf(GRID_TARGET_PER_CELL / occupancy);
+
+	// Cells much smaller than the entities would just spread them out
+	float minCellSize = (float)(widthSum / itemCount) * GRID_MIN_CELL_SCALE;
+	newCellSize = std::max(newCellSize, minCellSize);
+	if (fabsf(newCellSize - cellSize) < cellSize * 0.01f)
+		return false;
+
+	Rebuild(newCellSize);
+	return true;
+}
+
+/// <summary>
+/// Calls visit with each occupied cell in a block, looked up by coordinate, or by going
+/// through the pool when the block holds more coordinates than the pool has cells
+/// </summary>
+template<typename Visit>
+void SpatialGrid::ForEachCell(const int low[3], const int high[3], Visit visit)
+{
+	if (CountCells(low, high) > cells.size())
+	{
+		for (const Cell& cell : cells)
+		{
+			if (!cell.slots.empty() &&
+				cell.x >= low[0] && cell.x <= high[0] &&
+				cell.y >= low[1] && cell.y <= high[1] &&
+				cell.z >= low[2] && cell.z <= high[2])
+				visit(cell);
+		}
+		return;
+	}
+
+	for (int z = low[2]; z <= high[2]; z++)
+	{
+		for (int y = low[1]; y <= high[1]; y++)
+		{
+			for (int x = low[0]; x <= high[0]; x++)
+			{
+				auto it = lookup.find(PackCell(x, y, z));
+				if (it != lookup.end())
+					visit(cells[it->second]);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Finds every entry in a cell whose loose box passes a test
+/// </summary>
+/// <param name="test">Must not reject a box that contains a passing box, true for convex volume tests</param>
+/// <param name="found">Called with each entity, and whether the test said its whole cell was inside</param>
+void SpatialGrid::Query(const std::function<ContainmentType(const BoundingBox&)>& test, const std::function<void(Entity entity, bool inside)>& found)
+{
+	QueryMany(1,
+		[&](unsigned int, const BoundingBox& box) { return test(box); },
+		[&](Entity entity, unsigned int inside, unsigned int) { found(entity, inside != 0); });
+}
+
+/// <summary>
+/// Runs several tests over the cells in one pass, entries share their cell's answers
+/// - Starts from the block of every occupied cell and halves blocks some test still
+///   partly overlaps, a block's box is its cells grown by the largest reach, so only
+///   the cells inside blocks that pass are ever looked up
+/// </summary>
+/// <param name="testCount">Number of tests, at most 32</param>
+/// <param name="test">Gets the test's index and a box, same rules as Query()</param>
+/// <param name="found">Called with each entity, the tests its cell was fully inside and the ones still partial</param>
+void SpatialGrid::QueryMany(unsigned int testCount, const std::function<ContainmentType(unsigned int test, const BoundingBox&)>& test, const std::function<void(Entity entity, unsigned int inside, unsigned int partial)>& found)
+{
+	if (cellCount == 0 || testCount == 0)
+		return;
+
+	ranges.clear();
+	CellRange all = { { lowCell[0], lowCell[1], lowCell[2] }, { highCell[0], highCell[1], highCell[2] }, testCount >= 32 ? ~0u : (1u << testCount) - 1, 0 };
+	ranges.push_back(all);
+	while (!ranges.empty())
+	{
+		CellRange range = ranges.back();
+		ranges.pop_back();
+
+		// Tests the block is fully inside move over, ones it misses drop out
+		BoundingBox box = GetRangeBox(range.low, range.high);
+		for (unsigned int bits = range.partial; bits != 0; bits &= bits - 1)
+		{
+			unsigned int t = std::countr_zero(bits);
+			ContainmentType result = test(t, box);
+			if (result != INTERSECTS)
+			{
+				range.partial &= ~(1u << t);
+				if (result == CONTAINS)
+					range.inside |= 1u << t;
+			}
+		}
+
+		if (range.partial == 0 && range.inside == 0)
+			continue;
+
+		// Still undecided, so split across its longest side
+		if (range.partial != 0 && CountCells(range.low, range.high) > GRID_QUERY_LEAF_CELLS)
+		{
+			int axis = 0;
+			for (int i = 1; i < 3; i++)
+			{
+				if (range.high[i] - range.low[i] > range.high[axis] - range.low[axis])
+					axis = i;
+			}
+
+			CellRange upper = range;
+			range.high[axis] = range.low[axis] + (range.high[axis] - range.low[axis]) / 2;
+			upper.low[axis] = range.high[axis] + 1;
+			ranges.push_back(range);
+			ranges.push_back(upper);
+			continue;
+		}
+
+		// Small or decided, each cell is only tested for what is still partial
+		ForEachCell(range.low, range.high, [&](const Cell& cell)
+			{
+				unsigned int inside = range.inside;
+				unsigned int partial = 0;
+				if (range.partial != 0)
+				{
+					BoundingBox cellBox = GetCellBox(cell);
+					for (unsigned int bits = range.partial; bits != 0; bits &= bits - 1)
+					{
+						unsigned int t = std::countr_zero(bits);
+						ContainmentType result = test(t, cellBox);
+						if (result == CONTAINS)
+							inside |= 1u << t;
+						else if (result == INTERSECTS)
+							partial |= 1u << t;
+					}
+				}
+
+				if (inside == 0 && partial == 0)
+					return;
+
+				for (unsigned int slot : cell.slots)
+					found(items[slot].entity, inside, partial);
+			});
+	}
+}
+
+/// <summary>
+/// Walks every entry box along a ray, stepping through the cells it crosses in order
+/// (Amanatides and Woo), entries can stick out of their cell by up to the largest reach,
+/// so each step also looks that far into the cells around it
+/// </summary>
+/// <param name="origin">Start of the ray</param>
+/// <param name="direction">Normalized direction of the ray</param>
+/// <param name="maxDistance">Length of the ray</param>
+/// <param name="hit">Gets each entity and the distance to its box, returns the new ray length</param>
+void SpatialGrid::RayCast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, const std::function<float(Entity, float)>& hit)
+{
+	float start;
+	if (cellCount == 0 || !IntersectsRay(GetRangeBox(lowCell, highCell), origin, direction, maxDistance, start))
+		return;
+
+	// A cell can be around several steps, so each is only tested the first time
+	cellStamps.resize(cells.size());
+	if (++stamp == 0)
+	{
+		std::fill(cellStamps.begin(), cellStamps.end(), 0u);
+		stamp = 1;
+	}
+
+	bool done = false;
+	auto visit = [&](const Cell& cell)
+		{
+			unsigned int& cellStamp = cellStamps[&cell - cells.data()];
+			float distance;
+			if (done || cellStamp == stamp)
+				return;
+			cellStamp = stamp;
+			if (!IntersectsRay(GetCellBox(cell), origin, direction, maxDistance, distance))
+				return;
+
+			for (unsigned int slot : cell.slots)
+			{
+				if (!IntersectsRay(items[slot].box, origin, direction, maxDistance, distance))
+					continue;
+
+				maxDistance = std::min(maxDistance, hit(items[slot].entity, distance));
+				if (maxDistance <= 0.0f)
+				{
+					done = true;
+					return;
+				}
+			}
+		};
+
+	// Huge entries make every step look at more cells than there are, test them all instead
+	const float reach[3] = { maxReach.x, maxReach.y, maxReach.z };
+	unsigned long long stepCells = 1;
+	for (int axis = 0; axis < 3; axis++)
+		stepCells *= 2 * (unsigned long long)ceilf(reach[axis] / cellSize) + 2;
+	if (stepCells > cells.size())
+	{
+		for (const Cell& cell : cells)
+		{
+			if (!cell.slots.empty())
+				visit(cell);
+		}
+		return;
+	}
+
+	// Cell the ray enters the occupied block in, and when it crosses into the next one on each axis
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float d[3] = { direction.x, direction.y, direction.z };
+	int cell[3], step[3], stop[3];
+	float next[3], delta[3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		cell[axis] = (int)floorf((o[axis] + d[axis] * start) / cellSize);
+		if (d[axis] > 0.0f)
+		{
+			step[axis] = 1;
+			stop[axis] = highCell[axis] + (int)ceilf(reach[axis] / cellSize) + 1;
+			next[axis] = ((cell[axis] + 1) * cellSize - o[axis]) / d[axis];
+			delta[axis] = cellSize / d[axis];
+		}
+		else if (d[axis] < 0.0f)
+		{
+			step[axis] = -1;
+			stop[axis] = lowCell[axis] - (int)ceilf(reach[axis] / cellSize) - 1;
+			next[axis] = (cell[axis] * cellSize - o[axis]) / d[axis];
+			delta[axis] = -cellSize / d[axis];
+		}
+		else
+		{
+			step[axis] = 0;
+			stop[axis] = 0;
+			next[axis] = FLT_MAX;
+			delta[axis] = FLT_MAX;
+		}
+	}
+
+	// Anything not found yet is hit no nearer than where the current step starts
+	float t = start;
+	while (!done && t <= maxDistance)
+	{
+		// Cells around this step's stretch of the ray, grown by the reach
+		float end = std::min(std::min(next[0], next[1]), std::min(next[2], maxDistance));
+		int low[3], high[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float a = o[axis] + d[axis] * t;
+			float b = o[axis] + d[axis] * end;
+			low[axis] = (int)floorf((std::min(a, b) - reach[axis]) / cellSize);
+			high[axis] = (int)floorf((std::max(a, b) + reach[axis]) / cellSize);
+		}
+		ForEachCell(low, high, visit);
+
+		int axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+		if (step[axis] == 0)
+			break;
+		cell[axis] += step[axis];
+		t = next[axis];
+		next[axis] += delta[axis];
+
+		// Past every occupied cell and anything reaching out of them
+		if (cell[axis] * step[axis] >= stop[axis] * step[axis])
+			break;
+	}
+}
+
+// --------------------------------------------------------
+// Cell bookkeeping, cells are created the first time
+// something lands in them and pooled once they empty
+// --------------------------------------------------------
+int SpatialGrid::FindCell(const XMFLOAT3& point)
+{
+	int x = (int)floorf(point.x / cellSize);
+	int y = (int)floorf(point.y / cellSize);
+	int z = (int)floorf(point.z / cellSize);
+
+	unsigned long long key = PackCell(x, y, z);
+	auto it = lookup.find(key);
+	if (it != lookup.end())
+		return it->second;
+
+	int index;
+	if (!freeCells.empty())
+	{
+		index = freeCells.back();
+		freeCells.pop_back();
+	}
+	else
+	{
+		index = (int)cells.size();
+		cells.push_back(Cell());
+	}
+
+	Cell& cell = cells[index];
+	cell.x = x;
+	cell.y = y;
+	cell.z = z;
+	cell.reach = XMFLOAT3(0, 0, 0);
+	lookup[key] = index;
+
+	// The first cell starts the occupied block over, later ones grow it
+	const int coordinates[3] = { x, y, z };
+	for (int axis = 0; axis < 3; axis++)
+	{
+		lowCell[axis] = cellCount == 0 ? coordinates[axis] : std::min(lowCell[axis], coordinates[axis]);
+		highCell[axis] = cellCount == 0 ? coordinates[axis] : std::max(highCell[axis], coordinates[axis]);
+	}
+	if (cellCount == 0)
+		maxReach = XMFLOAT3(0, 0, 0);
+	cellCount++;
+	return index;
+}
+
+void SpatialGrid::AddToCell(unsigned int slot, int cell)
+{
+	Item& item = items[slot];
+	Cell& target = cells[cell];
+	item.cell = cell;
+	item.position = (unsigned int)target.slots.size();
+	target.slots.push_back(slot);
+	GrowReach(target, item.box);
+}
+
+void SpatialGrid::RemoveFromCell(unsigned int slot)
+{
+	Item& item = items[slot];
+	Cell& cell = cells[item.cell];
+
+	// Swap the last entry into the hole
+	unsigned int last = cell.slots.back();
+	cell.slots[item.position] = last;
+	items[last].position = item.position;
+	cell.slots.pop_back();
+
+	// Empty cells go back to the pool, keeping their slot vector's memory
+	if (cell.slots.empty())
+	{
+		lookup.erase(PackCell(cell.x, cell.y, cell.z));
+		freeCells.push_back(item.cell);
+		cellCount--;
+	}
+}
+
+void SpatialGrid::GrowReach(Cell& cell, const BoundingBox& box)
+{
+	cell.reach.x = std::max(cell.reach.x, box.Extents.x);
+	cell.reach.y = std::max(cell.reach.y, box.Extents.y);
+	cell.reach.z = std::max(cell.reach.z, box.Extents.z);
+	maxReach.x = std::max(maxReach.x, cell.reach.x);
+	maxReach.y = std::max(maxReach.y, cell.reach.y);
+	maxReach.z = std::max(maxReach.z, cell.reach.z);
+}
+
+BoundingBox SpatialGrid::GetCellBox(const Cell& cell)
+{
+	float half = cellSize * 0.5f;
+	return BoundingBox(
+		XMFLOAT3((cell.x + 0.5f) * cellSize, (cell.y + 0.5f) * cellSize, (cell.z + 0.5f) * cellSize),
+		XMFLOAT3(half + cell.reach.x, half + cell.reach.y, half + cell.reach.z));
+}
+
+// Box of a block of cells, grown by the largest reach so it holds every entry in them
+BoundingBox SpatialGrid::GetRangeBox(const int low[3], const int high[3])
+{
+	XMFLOAT3 minPoint(low[0] * cellSize - maxReach.x, low[1] * cellSize - maxReach.y, low[2] * cellSize - maxReach.z);
+	XMFLOAT3 maxPoint((high[0] + 1) * cellSize + maxReach.x, (high[1] + 1) * cellSize + maxReach.y, (high[2] + 1) * cellSize + maxReach.z);
+	return BoundingBox(
+		XMFLOAT3((minPoint.x + maxPoint.x) * 0.5f, (minPoint.y + maxPoint.y) * 0.5f, (minPoint.z + maxPoint.z) * 0.5f),
+		XMFLOAT3((maxPoint.x - minPoint.x) * 0.5f, (maxPoint.y - minPoint.y) * 0.5f, (maxPoint.z - minPoint.z) * 0.5f));
+}
+
+void SpatialGrid::Rebuild(float newCellSize)
+{
+	cellSize = newCellSize;
+	for (Cell& cell : cells)
+		cell.slots.clear();
+	lookup.clear();
+	freeCells.clear();
+	cellCount = 0;
+
+	// Every cell is free again, hand them out back to front
+	for (int i = (int)cells.size() - 1; i >= 0; i--)
+		freeCells.push_back(i);
+
+	for (unsigned int slot = 0; slot < items.size(); slot++)
+	{
+		if (items[slot].entity != INVALID_ENTITY)
+			AddToCell(slot, FindCell(items[slot].box.Center));
+	}
+}
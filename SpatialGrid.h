@@ -0,0 +1,128 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "SpatialIndex.h"
+
+// Cell size used until there is enough in the grid to tune it
+#define GRID_DEFAULT_CELL_SIZE 4.0f
+
+// Entries per occupied cell the tuning aims for, and how far
+// off it can drift either way before the grid is rebuilt
+#define GRID_TARGET_PER_CELL 8.0f
+#define GRID_TUNE_SLACK 4.0f
+
+// Cells never get smaller than this many average entity widths
+#define GRID_MIN_CELL_SCALE 2.0f
+
+// Undecided cell ranges with this many cells or fewer stop
+// being split and have their cells tested one by one
+#define GRID_QUERY_LEAF_CELLS 8
+
+// Loose uniform grid over entity bounds, with cells kept in a hash map
+// so only occupied cells take up memory and the world has no fixed size
+// - Each entry lives in the single cell holding its box's center, and a
+//   cell's box is grown by the largest entry in it (that's the "loose" part),
+//   so moving never touches more than two cells and is always O(1)
+// - There is no hierarchy to keep in shape, which makes it the better
+//   pick when most entities move every frame, the tree's boxes follow
+//   the entities more closely, so it can still win for static scenes
+// - Queries split the range of occupied cell coordinates in half until the
+//   test decides it, then look up only the cells inside, and rays step from
+//   cell to cell, so both cost what they overlap rather than every cell
+// - Tune() picks a new cell size from how full cells are, call it once
+//   a frame or so after updating
+class SpatialGrid : public ISpatialIndex
+{
+public:
+	SpatialGrid() = default;
+
+	// Maintenance, keyed by the entity's handle
+	void Insert(Entity entity, const DirectX::BoundingBox& box) override;
+	void Remove(Entity entity) override;
+	bool Update(Entity entity, const DirectX::BoundingBox& box) override;
+	bool Contains(Entity entity) override;
+	void Clear() override;
+	unsigned int GetCount() override;
+	bool Tune();
+
+	// Queries
+	void Query(const std::function<DirectX::ContainmentType(const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, bool inside)>& found) override;
+	void QueryMany(unsigned int testCount, const std::function<DirectX::ContainmentType(unsigned int test, const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, unsigned int inside, unsigned int partial)>& found) override;
+	void RayCast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, const std::function<float(Entity, float)>& hit) override;
+
+	// Stats
+	float GetCellSize();
+	unsigned int GetCellCount();
+
+private:
+	struct Cell
+	{
+		int x, y, z;
+
+		// Largest extents of anything in the cell, only reset once it empties
+		DirectX::XMFLOAT3 reach;
+
+		// Slots of the entries in this cell
+		std::vector<unsigned int> slots;
+	};
+
+	struct Item
+	{
+		Entity entity = INVALID_ENTITY;
+		DirectX::BoundingBox box;
+		int cell;
+		unsigned int position;
+	};
+
+	// Block of cell coordinates, both ends included, and the tests still partial
+	// for it or already inside it, for QueryMany()
+	struct CellRange
+	{
+		int low[3];
+		int high[3];
+		unsigned int partial;
+		unsigned int inside;
+	};
+
+	int FindCell(const DirectX::XMFLOAT3& point);
+	void AddToCell(unsigned int slot, int cell);
+	void RemoveFromCell(unsigned int slot);
+	void GrowReach(Cell& cell, const DirectX::BoundingBox& box);
+	DirectX::BoundingBox GetCellBox(const Cell& cell);
+	DirectX::BoundingBox GetRangeBox(const int low[3], const int high[3]);
+	void Rebuild(float newCellSize);
+
+	// Calls visit with each occupied cell in a block of coordinates
+	template<typename Visit>
+	void ForEachCell(const int low[3], const int high[3], Visit visit);
+
+	float cellSize = GRID_DEFAULT_CELL_SIZE;
+
+	// Entries by slot index, entity is INVALID_ENTITY when not in the grid
+	std::vector<Item> items;
+	unsigned int itemCount = 0;
+
+	// Sum of every entry's width, for the smallest useful cell size
+	double widthSum = 0.0;
+
+	// Cell pool, emptied cells are kept around and reused
+	std::vector<Cell> cells;
+	std::vector<int> freeCells;
+	unsigned int cellCount = 0;
+
+	// Packed cell coordinates to index in the pool
+	std::unordered_map<unsigned long long, int> lookup;
+
+	// Coordinates every occupied cell falls in, and the largest reach of any cell,
+	// both only grow until the grid empties or is rebuilt
+	int lowCell[3] = {};
+	int highCell[3] = {};
+	DirectX::XMFLOAT3 maxReach = DirectX::XMFLOAT3(0, 0, 0);
+
+	// Reused by queries so they don't allocate, cells a ray already tested are stamped
+	std::vector<CellRange> ranges;
+	std::vector<unsigned int> cellStamps;
+	unsigned int stamp = 0;
+};
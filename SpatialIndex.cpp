@@ -0,0 +1,145 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+void ISpatialIndex::QueryFrustum(const Frustum& frustum, std::vector<Entity>& results)
+{
+	results.clear();
+	Query(
+		[&](const BoundingBox& box) { return frustum.Contains(box); },
+		[&](Entity entity, bool) { results.push_back(entity); });
+}
+
+void ISpatialIndex::QuerySphere(XMFLOAT3 center, float radius, std::vector<Entity>& results)
+{
+	results.clear();
+	Query(
+		[&](const BoundingBox& box) { return SpatialMath::IntersectsSphere(box, center, radius) ? INTERSECTS : DISJOINT; },
+		[&](Entity entity, bool) { results.push_back(entity); });
+}
+
+// --------------------------------------------------------
+// Box helpers, boxes are stored as center and extents to
+// match DirectXCollision so these work on that form directly
+// --------------------------------------------------------
+BoundingBox SpatialMath::Merge(const BoundingBox& a, const BoundingBox& b)
+{
+	XMFLOAT3 minPoint(
+		std::min(a.Center.x - a.Extents.x, b.Center.x - b.Extents.x),
+		std::min(a.Center.y - a.Extents.y, b.Center.y - b.Extents.y),
+		std::min(a.Center.z - a.Extents.z, b.Center.z - b.Extents.z));
+	XMFLOAT3 maxPoint(
+		std::max(a.Center.x + a.Extents.x, b.Center.x + b.Extents.x),
+		std::max(a.Center.y + a.Extents.y, b.Center.y + b.Extents.y),
+		std::max(a.Center.z + a.Extents.z, b.Center.z + b.Extents.z));
+
+	BoundingBox merged;
+	merged.Center = XMFLOAT3((minPoint.x + maxPoint.x) * 0.5f, (minPoint.y + maxPoint.y) * 0.5f, (minPoint.z + maxPoint.z) * 0.5f);
+	merged.Extents = XMFLOAT3((maxPoint.x - minPoint.x) * 0.5f, (maxPoint.y - minPoint.y) * 0.5f, (maxPoint.z - minPoint.z) * 0.5f);
+	return merged;
+}
+
+bool SpatialMath::ContainsBox(const BoundingBox& outer, const BoundingBox& inner)
+{
+	return
+		fabsf(inner.Center.x - outer.Center.x) + inner.Extents.x <= outer.Extents.x &&
+		fabsf(inner.Center.y - outer.Center.y) + inner.Extents.y <= outer.Extents.y &&
+		fabsf(inner.Center.z - outer.Center.z) + inner.Extents.z <= outer.Extents.z;
+}
+
+bool SpatialMath::IntersectsSphere(const BoundingBox& box, XMFLOAT3 center, float radius)
+{
+	// Distance from the sphere's center to the closest point on the box
+	float dx = std::max(0.0f, fabsf(center.x - box.Center.x) - box.Extents.x);
+	float dy = std::max(0.0f, fabsf(center.y - box.Center.y) - box.Extents.y);
+	float dz = std::max(0.0f, fabsf(center.z - box.Center.z) - box.Extents.z);
+	return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+// Slab test, distance is where the ray enters the box (0 when starting inside)
+bool SpatialMath::IntersectsRay(const BoundingBox& box, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float& distance)
+{
+	const float o[3] = { origin.x, origin.y, origin.z };
+	const float d[3] = { direction.x, direction.y, direction.z };
+	const float c[3] = { box.Center.x, box.Center.y, box.Center.z };
+	const float e[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+
+	float tMin = 0.0f;
+	float tMax = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float minSlab = c[axis] - e[axis];
+		float maxSlab = c[axis] + e[axis];
+
+		// Parallel to this slab, so it either always or never overlaps
+		if (fabsf(d[axis]) < 1e-8f)
+		{
+			if (o[axis] < minSlab || o[axis] > maxSlab)
+				return false;
+			continue;
+		}
+
+		float t1 = (minSlab - o[axis]) / d[axis];
+		float t2 = (maxSlab - o[axis]) / d[axis];
+		if (t1 > t2)
+			std::swap(t1, t2);
+
+		tMin = std::max(tMin, t1);
+		tMax = std::min(tMax, t2);
+		if (tMin > tMax)
+			return false;
+	}
+
+	distance = tMin;
+	return true;
+}
+
+/// <summary>
+/// Finds where a ray crosses a triangle (Moller-Trumbore), from either side
+/// </summary>
+/// <param name="a">First corner</param>
+/// <param name="b">Second corner</param>
+/// <param name="c">Third corner</param>
+/// <param name="origin">Start of the ray</param>
+/// <param name="direction">Direction of the ray, distances are in multiples of its length</param>
+/// <param name="maxDistance">Length of the ray</param>
+/// <param name="distance">Distance along the ray to the hit, only set on a hit</param>
+/// <returns>True if the ray hits the triangle within maxDistance</returns>
+bool SpatialMath::IntersectsTriangle(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float& distance)
+{
+	XMFLOAT3 edge1(b.x - a.x, b.y - a.y, b.z - a.z);
+	XMFLOAT3 edge2(c.x - a.x, c.y - a.y, c.z - a.z);
+
+	// Zero when the ray runs along the triangle's plane
+	XMFLOAT3 p(
+		direction.y * edge2.z - direction.z * edge2.y,
+		direction.z * edge2.x - direction.x * edge2.z,
+		direction.x * edge2.y - direction.y * edge2.x);
+	float determinant = edge1.x * p.x + edge1.y * p.y + edge1.z * p.z;
+	if (determinant == 0.0f)
+		return false;
+	float inverse = 1.0f / determinant;
+
+	// Barycentric coordinates of the crossing, both in range means it's inside
+	XMFLOAT3 s(origin.x - a.x, origin.y - a.y, origin.z - a.z);
+	float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inverse;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	XMFLOAT3 q(
+		s.y * edge1.z - s.z * edge1.y,
+		s.z * edge1.x - s.x * edge1.z,
+		s.x * edge1.y - s.y * edge1.x);
+	float v = (direction.x * q.x + direction.y * q.y + direction.z * q.z) * inverse;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	float t = (edge2.x * q.x + edge2.y * q.y + edge2.z * q.z) * inverse;
+	if (t < 0.0f || t > maxDistance)
+		return false;
+
+	distance = t;
+	return true;
+}
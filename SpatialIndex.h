@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "Entity.h"
+#include "Frustum.h"
+
+#define SPATIAL_INDEX_NONE 0
+#define SPATIAL_INDEX_TREE 1
+#define SPATIAL_INDEX_GRID 2
+#define SPATIAL_INDEX_AUTO 3
+
+// Common interface of every structure that can answer "what is near here"
+// about entity bounds, so culling and picking don't care which one is used
+// - Entries are keyed by entity handle and hold a copy of the world bounds
+// - Implementations are free to store looser boxes than they are given,
+//   so callers recheck the tight bounds unless a query says it was inside
+// - Not thread safe, update from one thread at a time
+class ISpatialIndex
+{
+public:
+	virtual ~ISpatialIndex() = default;
+
+	// Maintenance, Update() returns true when the entry had to be moved around
+	virtual void Insert(Entity entity, const DirectX::BoundingBox& box) = 0;
+	virtual void Remove(Entity entity) = 0;
+	virtual bool Update(Entity entity, const DirectX::BoundingBox& box) = 0;
+	virtual bool Contains(Entity entity) = 0;
+	virtual void Clear() = 0;
+	virtual unsigned int GetCount() = 0;
+
+	// Queries, results are in no particular order
+	// - Any region the test calls CONTAINS has every entry in it
+	//   reported without testing further, with inside set to true
+	virtual void Query(const std::function<DirectX::ContainmentType(const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, bool inside)>& found) = 0;
+
+	// Same walk for up to 32 tests at once, such as one per camera, with a bit per test
+	// - A region is only tested again for the tests it partly overlapped, and entries are
+	//   reported with the tests their region was fully inside and the ones still partial
+	virtual void QueryMany(unsigned int testCount, const std::function<DirectX::ContainmentType(unsigned int test, const DirectX::BoundingBox&)>& test, const std::function<void(Entity entity, unsigned int inside, unsigned int partial)>& found) = 0;
+
+	// Calls hit for each entry box the ray enters, nearest first is not guaranteed
+	// - hit gets the distance to the box and returns how far to keep searching,
+	//   so returning a closer distance prunes everything behind it
+	virtual void RayCast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, const std::function<float(Entity, float)>& hit) = 0;
+
+	// Shortcuts built on Query()
+	void QueryFrustum(const Frustum& frustum, std::vector<Entity>& results);
+	void QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<Entity>& results);
+};
+
+// Box tests shared by the index implementations
+namespace SpatialMath
+{
+	DirectX::BoundingBox Merge(const DirectX::BoundingBox& a, const DirectX::BoundingBox& b);
+	bool ContainsBox(const DirectX::BoundingBox& outer, const DirectX::BoundingBox& inner);
+	bool IntersectsSphere(const DirectX::BoundingBox& box, DirectX::XMFLOAT3 center, float radius);
+	bool IntersectsRay(const DirectX::BoundingBox& box, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float& distance);
+	bool IntersectsTriangle(const DirectX::XMFLOAT3& a, const DirectX::XMFLOAT3& b, const DirectX::XMFLOAT3& c, DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float& distance);
+}
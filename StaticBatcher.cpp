@@ -0,0 +1,290 @@
+#include "StaticBatcher.h"
+#include "Material.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Annonymous namespace for chunk keys
+namespace
+{
+	// Material sort id and chunk coordinates, each wrapped to 16 bits
+	unsigned long long ChunkKey(Material* material, XMFLOAT3 position)
+	{
+		unsigned long long x = (unsigned short)(int)floorf(position.x / STATIC_CHUNK_SIZE);
+		unsigned long long y = (unsigned short)(int)floorf(position.y / STATIC_CHUNK_SIZE);
+		unsigned long long z = (unsigned short)(int)floorf(position.z / STATIC_CHUNK_SIZE);
+		return ((unsigned long long)(material->GetSortId() & 0xFFFF) << 48) | (x << 32) | (y << 16) | z;
+	}
+}
+
+/// <summary>
+/// Makes an entity static, its geometry is merged into its chunk on the next Update()
+/// </summary>
+/// <param name="registry">Registry the entity lives in</param>
+/// <param name="entity">Entity that won't move, ignored if dead or already a member</param>
+void StaticBatcher::Add(EntityRegistry& registry, Entity entity)
+{
+	if (!registry.IsAlive(entity) || Contains(entity))
+		return;
+
+	// Blended entities have to be sorted back to front with everything else
+	if (registry.GetMaterial(entity)->GetColor().w < 1.0f)
+		return;
+
+	// Meshes that didn't keep their vertices have nothing to merge
+	if (registry.GetMesh(entity)->GetVertices().empty())
+		return;
+
+	unsigned int slot = EntityIndex(entity);
+	if (slot >= memberEntities.size())
+	{
+		memberEntities.resize(slot + 1, INVALID_ENTITY);
+		memberChunks.resize(slot + 1, ~0u);
+	}
+
+	unsigned int chunk = FindChunk(registry, entity);
+	chunks[chunk].members.push_back(entity);
+	chunks[chunk].dirty = true;
+	memberEntities[slot] = entity;
+	memberChunks[slot] = chunk;
+	memberCount++;
+}
+
+/// <summary>
+/// Stops batching an entity, its chunk is merged again without it on the next Update()
+/// </summary>
+/// <param name="entity">Member to remove, ignored if it isn't one</param>
+void StaticBatcher::Remove(Entity entity)
+{
+	if (!Contains(entity))
+		return;
+
+	unsigned int slot = EntityIndex(entity);
+	Chunk& chunk = chunks[memberChunks[slot]];
+	chunk.members.erase(std::find(chunk.members.begin(), chunk.members.end(), entity));
+	chunk.dirty = true;
+	memberEntities[slot] = INVALID_ENTITY;
+	memberChunks[slot] = ~0u;
+	memberCount--;
+}
+
+bool StaticBatcher::Contains(Entity entity) const
+{
+	unsigned int slot = EntityIndex(entity);
+	return entity != INVALID_ENTITY && slot < memberEntities.size() && memberEntities[slot] == entity;
+}
+
+/// <summary>
+/// Removes every member, merged meshes are retired so frames in flight can finish with them
+/// </summary>
+void StaticBatcher::Clear()
+{
+	for (Chunk& chunk : chunks)
+		Retire(std::move(chunk.mesh));
+	chunks.clear();
+	chunkLookup.clear();
+	memberEntities.clear();
+	memberChunks.clear();
+	memberCount = 0;
+}
+
+void StaticBatcher::Refresh(Entity entity)
+{
+	if (Contains(entity))
+		chunks[memberChunks[EntityIndex(entity)]].dirty = true;
+}
+
+/// <summary>
+/// Follows members the journal says moved into their new chunks, then merges every
+/// chunk that changed, the others keep the meshes they have
+/// </summary>
+/// <param name="registry">Registry the members live in, before its journal is cleared</param>
+void StaticBatcher::Update(EntityRegistry& registry)
+{
+	frame++;
+	while (!retired.empty() && frame - retired.front().first >= STATIC_RETIRE_FRAMES)
+		retired.erase(retired.begin());
+
+	for (Entity entity : registry.GetJournal().GetChanged())
+	{
+		if (!Contains(entity))
+			continue;
+
+		unsigned int slot = EntityIndex(entity);
+		Chunk& old = chunks[memberChunks[slot]];
+		old.dirty = true;
+
+		unsigned int chunk = FindChunk(registry, entity);
+		if (chunk == memberChunks[slot])
+			continue;
+
+		// FindChunk() can add a chunk, so the old one is looked up again
+		Chunk& from = chunks[memberChunks[slot]];
+		from.members.erase(std::find(from.members.begin(), from.members.end(), entity));
+		chunks[chunk].members.push_back(entity);
+		chunks[chunk].dirty = true;
+		memberChunks[slot] = chunk;
+	}
+
+	mergeCount = 0;
+	for (Chunk& chunk : chunks)
+	{
+		if (!chunk.dirty)
+			continue;
+
+		Merge(registry, chunk);
+		chunk.dirty = false;
+		mergeCount++;
+	}
+}
+
+/// <summary>
+/// Keeps only the indices of entities that aren't members, in order
+/// </summary>
+/// <param name="registry">Registry the indices are dense indices of</param>
+/// <param name="indices">List to filter in place</param>
+void StaticBatcher::RemoveMembers(EntityRegistry& registry, std::vector<unsigned int>& indices) const
+{
+	if (memberCount == 0)
+		return;
+
+	Entity* entities = registry.GetEntities();
+	indices.erase(
+		std::remove_if(indices.begin(), indices.end(), [&](unsigned int index) { return Contains(entities[index]); }),
+		indices.end());
+}
+
+/// <summary>
+/// Draws whole chunks, before everything else in the list
+/// </summary>
+/// <param name="planes">Planes a chunk's bounds have to reach inside of</param>
+/// <param name="viewProjection">View projection of the pass the list is drawn in</param>
+/// <param name="shadowViewProjection">Shadow map's view projection, or null to skip</param>
+/// <param name="drawList">List to add to the front of</param>
+/// <returns>Number of draws added</returns>
+unsigned int StaticBatcher::AddDraws(const CullPlanes& planes, const XMFLOAT4X4& viewProjection, const XMFLOAT4X4* shadowViewProjection, std::vector<DrawItem>& drawList) const
+{
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	std::vector<DrawItem> draws;
+	for (const Chunk& chunk : chunks)
+	{
+		if (!chunk.mesh || planes.Contains(chunk.bounds) == DISJOINT)
+			continue;
+
+		DrawItem item = {};
+		item.entity = INVALID_ENTITY;
+		item.mesh = chunk.mesh.get();
+		item.material = chunk.material;
+		item.world = identity;
+		item.worldInvTranspose = identity;
+		item.worldViewProjection = viewProjection;
+		item.shadowWorldViewProjection = shadowViewProjection ? *shadowViewProjection : identity;
+		draws.push_back(item);
+	}
+
+	drawList.insert(drawList.begin(), draws.begin(), draws.end());
+	return (unsigned int)draws.size();
+}
+
+unsigned int StaticBatcher::GetMemberCount() const { return memberCount; }
+unsigned int StaticBatcher::GetMergeCount() const { return mergeCount; }
+
+unsigned int StaticBatcher::GetChunkCount() const
+{
+	unsigned int count = 0;
+	for (const Chunk& chunk : chunks)
+		count += chunk.mesh != nullptr;
+	return count;
+}
+
+size_t StaticBatcher::GetMemoryUsed() const
+{
+	size_t bytes = 0;
+	for (const Chunk& chunk : chunks)
+	{
+		if (!chunk.mesh)
+			continue;
+
+		// Vertex and index buffers, then the positions and indices the mesh keeps
+		size_t vertices = chunk.mesh->GetVertexCount();
+		size_t indices = chunk.mesh->GetIndexCount();
+		bytes += vertices * sizeof(Vertex) + indices * sizeof(unsigned int) * 2;
+		bytes += vertices * sizeof(XMFLOAT3);
+	}
+	return bytes;
+}
+
+/// <summary>
+/// Finds the chunk an entity's position and material belong in, adding it if needed
+/// </summary>
+unsigned int StaticBatcher::FindChunk(EntityRegistry& registry, Entity entity)
+{
+	Material* material = registry.GetMaterial(entity);
+	unsigned long long key = ChunkKey(material, registry.GetTransform(entity)->GetPosition());
+	auto found = chunkLookup.find(key);
+	if (found != chunkLookup.end())
+		return found->second;
+
+	chunks.emplace_back();
+	chunks.back().material = material;
+	chunkLookup[key] = (unsigned int)chunks.size() - 1;
+	return (unsigned int)chunks.size() - 1;
+}
+
+/// <summary>
+/// Builds a chunk's mesh from scratch out of its members' meshes in world space
+/// - Tangents are left for the mesh to work out again, from the moved positions
+/// </summary>
+void StaticBatcher::Merge(EntityRegistry& registry, Chunk& chunk)
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (size_t i = 0; i < chunk.members.size();)
+	{
+		// Destroyed without being removed, it can't be drawn anymore
+		Entity entity = chunk.members[i];
+		if (!registry.IsAlive(entity))
+		{
+			memberEntities[EntityIndex(entity)] = INVALID_ENTITY;
+			memberChunks[EntityIndex(entity)] = ~0u;
+			memberCount--;
+			chunk.members.erase(chunk.members.begin() + i);
+			continue;
+		}
+
+		Mesh* mesh = registry.GetMesh(entity);
+		Transform* transform = registry.GetTransform(entity);
+		XMFLOAT4X4 worldMatrix = transform->GetWorldMatrix();
+		XMFLOAT4X4 inverseTransposeMatrix = transform->GetWorldInverseTransposeMatrix();
+		XMMATRIX world = XMLoadFloat4x4(&worldMatrix);
+		XMMATRIX inverseTranspose = XMLoadFloat4x4(&inverseTransposeMatrix);
+
+		unsigned int base = (unsigned int)vertices.size();
+		for (const Vertex& source : mesh->GetVertices())
+		{
+			Vertex vertex = source;
+			XMStoreFloat3(&vertex.Position, XMVector3Transform(XMLoadFloat3(&source.Position), world));
+			XMStoreFloat3(&vertex.Normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&source.Normal), inverseTranspose)));
+			vertices.push_back(vertex);
+		}
+		for (unsigned int index : mesh->GetIndices())
+			indices.push_back(base + index);
+		i++;
+	}
+
+	Retire(std::move(chunk.mesh));
+	if (indices.empty())
+		return;
+
+	chunk.mesh = std::make_unique<Mesh>(vertices.data(), vertices.size(), indices.data(), indices.size(), "Static batch");
+	chunk.bounds = chunk.mesh->GetBounds();
+}
+
+void StaticBatcher::Retire(std::unique_ptr<Mesh> mesh)
+{
+	if (mesh)
+		retired.emplace_back(frame, std::move(mesh));
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include "Entity.h"
+#include "EntityRegistry.h"
+#include "BatchCull.h"
+#include "Mesh.h"
+
+// Edge length of the cubes static entities are grouped by, everything sharing a
+// material inside one cube becomes a single merged mesh culled as a whole
+#define STATIC_CHUNK_SIZE 32.0f
+
+// Frames a replaced merged mesh is kept alive for, packets still being
+// drawn on the render thread can hold it until then
+#define STATIC_RETIRE_FRAMES 3
+
+// Entities that never move drawn as a handful of merged meshes instead of one draw each
+// - Every member's mesh is transformed into world space once and appended to the
+//   merged mesh of its chunk, a material and a cube of STATIC_CHUNK_SIZE
+// - Members are still in the registry, culling them is up to the caller, see
+//   RemoveMembers(), chunks are culled and drawn by AddDraws() instead
+// - Only chunks whose members were added, removed, moved or refreshed are merged again,
+//   moves are found through the registry's journal, so call Update() before it clears
+class StaticBatcher
+{
+public:
+	// Membership, a member that is destroyed has to be removed first, or it is dropped
+	// the next time its chunk is merged, blended entities are never added
+	void Add(EntityRegistry& registry, Entity entity);
+	void Remove(Entity entity);
+	bool Contains(Entity entity) const;
+	void Clear();
+
+	// Merges the chunk again on the next Update(), for changes the journal doesn't see, like materials
+	void Refresh(Entity entity);
+
+	// Moves members that changed chunk, merges every chunk that needs it, once a frame
+	void Update(EntityRegistry& registry);
+
+	// Drops members from a list of dense indices, such as what culling found
+	void RemoveMembers(EntityRegistry& registry, std::vector<unsigned int>& indices) const;
+
+	// Puts a draw for each chunk passing the planes in front of the list, merged meshes are
+	// already in world space so their world matrix is identity, returns how many went in
+	unsigned int AddDraws(const CullPlanes& planes, const DirectX::XMFLOAT4X4& viewProjection, const DirectX::XMFLOAT4X4* shadowViewProjection, std::vector<DrawItem>& drawList) const;
+
+	// Members, chunks with any, chunks merged by the last Update() and what the merged meshes hold,
+	// vertex and index buffers on the GPU plus the copies meshes keep on the CPU
+	unsigned int GetMemberCount() const;
+	unsigned int GetChunkCount() const;
+	unsigned int GetMergeCount() const;
+	size_t GetMemoryUsed() const;
+
+private:
+	struct Chunk
+	{
+		Material* material = nullptr;
+		std::vector<Entity> members;
+		std::unique_ptr<Mesh> mesh;
+		DirectX::BoundingBox bounds;
+		bool dirty = false;
+	};
+
+	unsigned int FindChunk(EntityRegistry& registry, Entity entity);
+	void Merge(EntityRegistry& registry, Chunk& chunk);
+	void Retire(std::unique_ptr<Mesh> mesh);
+
+	std::vector<Chunk> chunks;
+	std::unordered_map<unsigned long long, unsigned int> chunkLookup;
+
+	// By entity slot, the handle that is a member and the chunk it is in
+	std::vector<Entity> memberEntities;
+	std::vector<unsigned int> memberChunks;
+	unsigned int memberCount = 0;
+
+	// Replaced meshes and the frame they were replaced on
+	std::vector<std::pair<unsigned long long, std::unique_ptr<Mesh>>> retired;
+	unsigned long long frame = 0;
+	unsigned int mergeCount = 0;
+};
@@ -0,0 +1,136 @@
+// Times the AABB tree's queries and updates against testing every box,
+// from 1K to 1M entities spread over a plane
+// - Only needs the index and frustum code, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -I. Tools/AABBTreeBench.cpp AABBTree.cpp SpatialIndex.cpp Frustum.cpp -o AABBTreeBench
+// - Usage: AABBTreeBench [largest count], defaults to 1000000
+// - Every query's results, rechecked against the tight boxes, must match
+//   brute force exactly, the tool exits with 1 if any of them don't
+#include "ToolHelpers.h"
+#include "../AABBTree.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Annonymous namespace for the brute force side
+namespace
+{
+	// Tree entries are fattened, so candidates are filtered by their real box like callers do
+	template <typename Test>
+	size_t Recheck(const std::vector<Entity>& candidates, const std::vector<BoundingBox>& boxes, Test test)
+	{
+		size_t count = 0;
+		for (Entity entity : candidates)
+			count += test(boxes[EntityIndex(entity)]) ? 1 : 0;
+		return count;
+	}
+
+	template <typename Test>
+	size_t BruteForce(const std::vector<BoundingBox>& boxes, Test test)
+	{
+		size_t count = 0;
+		for (const BoundingBox& box : boxes)
+			count += test(box) ? 1 : 0;
+		return count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int largest = argc > 1 ? (unsigned int)std::max(1000, atoi(argv[1])) : 1000000;
+	CheckCounter checks;
+
+	printf("%8s %9s %7s | %-26s | %-26s | %-26s | %s\n", "Entities", "Build ms", "Height",
+		"Frustum: found, tree/brute", "Sphere: found, tree/brute", "Ray: nearest, tree/brute", "1% moved ms, reinserts");
+	for (unsigned int count = 1000; count <= largest; count *= 10)
+	{
+		// Unit boxes scattered over a square about three boxes apart
+		std::mt19937 random(1);
+		float side = std::sqrt((float)count) * 3.0f;
+		std::uniform_real_distribution<float> spread(-side / 2, side / 2);
+		std::vector<BoundingBox> boxes(count);
+		for (BoundingBox& box : boxes)
+			box = BoundingBox(XMFLOAT3(spread(random), 0.0f, spread(random)), XMFLOAT3(0.5f, 0.5f, 0.5f));
+
+		AABBTree tree;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+			tree.Insert(MakeEntity(i, 0), boxes[i]);
+		double buildMs = ElapsedMs(start);
+
+		// Camera on the edge of the square looking across it
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, -side / 2, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		Frustum frustum(viewProjection);
+
+		std::vector<Entity> found;
+		auto inFrustum = [&](const BoundingBox& box) { return frustum.Intersects(box); };
+		double frustumTreeMs = BestOfMs(5, [&]() { tree.QueryFrustum(frustum, found); });
+		size_t frustumFound = Recheck(found, boxes, inFrustum);
+		size_t frustumBrute = 0;
+		double frustumBruteMs = BestOfMs(5, [&]() { frustumBrute = BruteForce(boxes, inFrustum); });
+		checks.Check(frustumFound == frustumBrute, "frustum query matches brute force");
+
+		XMFLOAT3 center(0.0f, 0.0f, 0.0f);
+		float radius = 20.0f;
+		auto inSphere = [&](const BoundingBox& box) { return SpatialMath::IntersectsSphere(box, center, radius); };
+		double sphereTreeMs = BestOfMs(5, [&]() { tree.QuerySphere(center, radius, found); });
+		size_t sphereFound = Recheck(found, boxes, inSphere);
+		size_t sphereBrute = 0;
+		double sphereBruteMs = BestOfMs(5, [&]() { sphereBrute = BruteForce(boxes, inSphere); });
+		checks.Check(sphereFound == sphereBrute, "sphere query matches brute force");
+
+		// Nearest box along a ray skimming the plane, the callback shrinks the search as it goes
+		XMFLOAT3 origin(-side / 2, 0.0f, -side / 2);
+		XMFLOAT3 direction(0.70710678f, 0.0f, 0.70710678f);
+		float maxDistance = side * 2.0f;
+		float treeNearest = maxDistance;
+		double rayTreeMs = BestOfMs(5, [&]()
+			{
+				treeNearest = maxDistance;
+				tree.RayCast(origin, direction, maxDistance, [&](Entity entity, float)
+					{
+						float distance;
+						if (SpatialMath::IntersectsRay(boxes[EntityIndex(entity)], origin, direction, treeNearest, distance))
+							treeNearest = std::min(treeNearest, distance);
+						return treeNearest;
+					});
+			});
+		float bruteNearest = maxDistance;
+		double rayBruteMs = BestOfMs(5, [&]()
+			{
+				bruteNearest = maxDistance;
+				for (const BoundingBox& box : boxes)
+				{
+					float distance;
+					if (SpatialMath::IntersectsRay(box, origin, direction, bruteNearest, distance))
+						bruteNearest = std::min(bruteNearest, distance);
+				}
+			});
+		checks.Check(treeNearest == bruteNearest, "ray cast finds the same nearest box as brute force");
+
+		// One in a hundred entities hops up a little, most stay inside their fat boxes
+		start = std::chrono::high_resolution_clock::now();
+		unsigned int reinserts = 0;
+		for (unsigned int i = 0; i < count; i += 100)
+		{
+			boxes[i].Center.y += 0.3f;
+			reinserts += tree.Update(MakeEntity(i, 0), boxes[i]) ? 1 : 0;
+		}
+		double moveMs = ElapsedMs(start);
+
+		printf("%8u %9.1f %7d | %7zu %7.3f/%-9.3f | %7zu %7.3f/%-9.3f | %7.1f %7.3f/%-9.3f | %.3f, %u\n",
+			count, buildMs, tree.GetHeight(),
+			frustumFound, frustumTreeMs, frustumBruteMs,
+			sphereFound, sphereTreeMs, sphereBruteMs,
+			treeNearest, rayTreeMs, rayBruteMs,
+			moveMs, reinserts);
+	}
+
+	printf("\n");
+	return checks.Report("AABBTree");
+}
@@ -0,0 +1,229 @@
+// Checks that the SSE and AVX2 cull kernels give exactly the scalar kernel's
+// answer on random boxes and planes, then times each one in bounds per nanosecond
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/BatchCullTest.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o BatchCullTest
+// - Usage: BatchCullTest [trials] [bounds], defaults to 300 random trials and 1000000 bounds to time
+// - Kernels the CPU lacks are skipped, the tool exits with 1 on any bit that differs
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../BatchCull.h"
+#include "../EntityRegistry.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <bitset>
+
+using namespace DirectX;
+
+// Annonymous namespace for random scenes
+namespace
+{
+	// Guard word written past the end of each mask, kernels mustn't touch it
+	const unsigned int MaskGuard = 0xdeadbeef;
+
+	// Any camera anywhere, from narrow to wide and short to long
+	Frustum RandomFrustum(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+		XMMATRIX view = XMMatrixLookToLH(
+			XMVectorSet(spread(random) * 50.0f, spread(random) * 10.0f, spread(random) * 50.0f, 1.0f),
+			XMVector3Normalize(XMVectorSet(spread(random), spread(random) * 0.3f, spread(random), 0.0f)),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(
+			0.5f + 0.75f * (spread(random) + 1.0f), 1.0f + spread(random) * 0.7f, 0.1f, 50.0f + 100.0f * (spread(random) + 1.0f));
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		return Frustum(viewProjection);
+	}
+
+	std::vector<int> GetSupportedKernels()
+	{
+		std::vector<int> kernels;
+		for (int kernel : { CULL_KERNEL_SCALAR, CULL_KERNEL_SSE, CULL_KERNEL_AVX2 })
+		{
+			if (BatchCull::IsKernelSupported(kernel))
+				kernels.push_back(kernel);
+		}
+		return kernels;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int trials = argc > 1 ? std::max(1, atoi(argv[1])) : 300;
+	unsigned int benchCount = argc > 2 ? (unsigned int)std::max(32, atoi(argv[2])) : 1000000;
+	JobSystem::Initialize();
+
+	std::vector<int> kernels = GetSupportedKernels();
+	printf("Best kernel: %s, %zu of 3 supported\n", BatchCull::GetKernelName(BatchCull::GetBestKernel()), kernels.size());
+
+	CheckCounter checks;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+
+	// Random boxes against random plane sets, some boxes touching a plane
+	// exactly and some flat to a point, where rounding would show first
+	unsigned long long tested = 0;
+	unsigned long long passed = 0;
+	unsigned int kernelMismatches = 0;
+	unsigned int frustumMismatches = 0;
+	unsigned int overruns = 0;
+	for (int trial = 0; trial < trials; trial++)
+	{
+		unsigned int count = 1 + random() % 3000;
+		Frustum frustum = RandomFrustum(random);
+		unsigned int planeMask = trial % 3 == 0 ? FRUSTUM_ALL_PLANES & ~(1u << FRUSTUM_NEAR) : FRUSTUM_ALL_PLANES;
+		bool swept = trial % 2 == 1;
+		CullPlanes planes;
+		planes.AddFrustum(frustum, planeMask);
+		if (swept)
+			planes.AddSweptFrustum(RandomFrustum(random), XMFLOAT3(spread(random) * 30.0f, spread(random) * 30.0f, spread(random) * 30.0f));
+
+		BoundsSoA bounds;
+		bounds.Resize(count);
+		std::vector<BoundingBox> boxes(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			BoundingBox box(
+				XMFLOAT3(spread(random) * 100.0f, spread(random) * 30.0f, spread(random) * 100.0f),
+				XMFLOAT3((spread(random) + 1.0f) * 3.0f, (spread(random) + 1.0f) * 3.0f, (spread(random) + 1.0f) * 3.0f));
+			if (i % 7 == 0)
+			{
+				XMFLOAT4 plane = planes.planes[random() % planes.count];
+				float distance = plane.x * box.Center.x + plane.y * box.Center.y + plane.z * box.Center.z + plane.w;
+				box.Center = XMFLOAT3(box.Center.x - plane.x * distance, box.Center.y - plane.y * distance, box.Center.z - plane.z * distance);
+			}
+			if (i % 11 == 0)
+				box.Extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			boxes[i] = box;
+			bounds.Set(i, box);
+		}
+
+		// Starts on any batch, as jobs splitting the range would
+		unsigned int start = (random() % 4) * CULL_BATCH_SIZE;
+		if (start >= count)
+			start = 0;
+		unsigned int words = (count - start + 31) / 32;
+
+		std::vector<std::vector<unsigned int>> masks;
+		for (int kernel : kernels)
+		{
+			masks.emplace_back(words + 1, MaskGuard);
+			BatchCull::Test(kernel, bounds, planes, start, count, masks.back().data());
+			if (masks.back()[words] != MaskGuard)
+				overruns++;
+		}
+		for (size_t k = 1; k < masks.size(); k++)
+		{
+			for (unsigned int word = 0; word < words; word++)
+				kernelMismatches += masks[k][word] != masks[0][word];
+		}
+		for (unsigned int word = 0; word < words; word++)
+			passed += std::bitset<32>(masks[0][word]).count();
+
+		// Frustum only sets must also match the single box test
+		if (!swept)
+		{
+			for (unsigned int i = start; i < count; i++)
+			{
+				bool inside = (masks[0][(i - start) / 32] >> ((i - start) % 32)) & 1;
+				frustumMismatches += inside != frustum.Intersects(boxes[i], planeMask);
+			}
+		}
+		tested += count - start;
+	}
+	printf("Random trials: %d, %llu boxes, %llu passed\n", trials, tested, passed);
+	checks.Check(kernelMismatches == 0, "every kernel matches scalar bit for bit");
+	checks.Check(frustumMismatches == 0, "scalar matches Frustum::Intersects()");
+	checks.Check(overruns == 0, "no kernel writes past the mask");
+
+	// The registry's cull gives the same list with any kernel, with entities churning
+	EntityRegistry registry;
+	std::unique_ptr<Mesh> cube = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+	std::vector<Entity> entities;
+	auto place = [&](Entity entity) { registry.GetTransform(entity)->SetPosition(spread(random) * 100.0f, spread(random) * 5.0f, spread(random) * 100.0f); };
+	for (int i = 0; i < 20000; i++)
+	{
+		entities.push_back(registry.Create(cube.get(), material.get()));
+		place(entities.back());
+	}
+	unsigned int registryMismatches = 0;
+	std::vector<unsigned int> visible;
+	std::vector<unsigned int> reference;
+	for (int frame = 0; frame < 30; frame++)
+	{
+		for (int i = 0; i < 300; i++)
+		{
+			Entity& entity = entities[random() % entities.size()];
+			registry.Destroy(entity);
+			entity = registry.Create(cube.get(), material.get());
+			place(entity);
+		}
+		for (int i = 0; i < 500; i++)
+			place(entities[random() % entities.size()]);
+		registry.UpdateBounds();
+
+		Frustum frustum = RandomFrustum(random);
+		reference.clear();
+		for (unsigned int i = 0; i < (unsigned int)registry.Count(); i++)
+		{
+			if (frustum.Intersects(registry.GetAllBounds()[i]))
+				reference.push_back(i);
+		}
+		for (int kernel : kernels)
+		{
+			registry.SetCullKernel(kernel);
+			registry.CullFrustum(frustum, visible);
+			registryMismatches += visible != reference;
+		}
+		registry.EndFrame();
+	}
+	checks.Check(registryMismatches == 0, "registry culls the same with every kernel");
+
+	// Timing, a camera frustum and the shadow caster set of a frustum and its sweep
+	BoundsSoA bounds;
+	bounds.Resize(benchCount);
+	std::vector<BoundingBox> boxes(benchCount);
+	for (unsigned int i = 0; i < benchCount; i++)
+	{
+		boxes[i] = BoundingBox(XMFLOAT3(spread(random) * 300.0f, spread(random) * 5.0f, spread(random) * 300.0f), XMFLOAT3(0.5f, 0.5f, 0.5f));
+		bounds.Set(i, boxes[i]);
+	}
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(1.5f, 16.0f / 9.0f, 0.01f, 1000.0f);
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+	Frustum frustum(viewProjection);
+	CullPlanes camera;
+	camera.AddFrustum(frustum);
+	CullPlanes shadow;
+	shadow.AddFrustum(frustum, FRUSTUM_ALL_PLANES & ~(1u << FRUSTUM_NEAR));
+	shadow.AddSweptFrustum(frustum, XMFLOAT3(5.0f, -20.0f, 5.0f));
+
+	printf("\n%-16s %7s %12s %12s\n", "Kernel", "Planes", "Bounds/ns", "ms per 1M");
+	std::vector<unsigned int> mask(benchCount / 32 + 1);
+	for (const CullPlanes* planes : { &camera, &shadow })
+	{
+		for (int kernel : kernels)
+		{
+			double ms = BestOfMs(20, [&]() { BatchCull::Test(kernel, bounds, *planes, 0, benchCount, mask.data()); });
+			printf("%-16s %7u %12.2f %12.3f\n", BatchCull::GetKernelName(kernel), planes->count, benchCount / (ms * 1e6), ms * 1e6 / benchCount);
+		}
+	}
+
+	// What culling cost before, a box at a time out of an array of boxes
+	std::vector<unsigned char> inside(benchCount);
+	double ms = BestOfMs(20, [&]()
+		{
+			for (unsigned int i = 0; i < benchCount; i++)
+				inside[i] = frustum.Contains(boxes[i]) != DISJOINT;
+		});
+	printf("%-16s %7u %12.2f %12.3f\n\n", "Frustum, AoS", FRUSTUM_PLANE_COUNT, benchCount / (ms * 1e6), ms * 1e6 / benchCount);
+
+	JobSystem::ShutDown();
+	return checks.Report("BatchCull");
+}
@@ -0,0 +1,128 @@
+// Times working out world view projection matrices on the CPU for 100K draws,
+// each kernel on its own and inside EntityRegistry::BuildDrawList()
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/BatchTransformBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o BatchTransformBench
+// - Usage: BatchTransformBench [draws] [runs], defaults to 100000 draws, the best run is reported
+// - Kernels the CPU lacks are skipped, the tool exits with 1 if any result differs
+//   from the scalar kernel's by a single bit, or strays from XMMatrixMultiply()
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../BatchTransform.h"
+#include "../BatchCull.h"
+#include "../EntityRegistry.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+	JobSystem::Initialize();
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> spread(-2.0f, 2.0f);
+	CheckCounter checks;
+
+	// Random matrices in the draw list itself, so the strides are the real ones
+	std::vector<DrawItem> items(count);
+	for (DrawItem& item : items)
+	{
+		for (int i = 0; i < 16; i++)
+			(&item.world.m[0][0])[i] = spread(random);
+	}
+	XMFLOAT4X4 viewProjection;
+	XMFLOAT4X4 shadowViewProjection;
+	for (int i = 0; i < 16; i++)
+	{
+		(&viewProjection.m[0][0])[i] = spread(random);
+		(&shadowViewProjection.m[0][0])[i] = spread(random);
+	}
+
+	// What each draw did before, one DirectXMath multiply per matrix
+	std::vector<XMFLOAT4X4> reference(count);
+	double referenceMs = BestOfMs(runs, [&]()
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				XMStoreFloat4x4(&items[i].worldViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&items[i].world), XMLoadFloat4x4(&viewProjection)));
+				XMStoreFloat4x4(&items[i].shadowWorldViewProjection, XMMatrixMultiply(XMLoadFloat4x4(&items[i].world), XMLoadFloat4x4(&shadowViewProjection)));
+			}
+		});
+	for (unsigned int i = 0; i < count; i++)
+		reference[i] = items[i].worldViewProjection;
+
+	printf("%u draws, a view and a shadow matrix each, best of %d runs\n\n", count, runs);
+	printf("%-18s %10s %14s\n", "Kernel", "ms", "ns per matrix");
+	printf("%-18s %10.3f %14.2f\n", "XMMatrixMultiply", referenceMs, referenceMs * 1e6 / (2.0 * count));
+
+	std::vector<XMFLOAT4X4> scalar(count);
+	unsigned int differ = 0;
+	float worstError = 0.0f;
+	for (int kernel : { CULL_KERNEL_SCALAR, CULL_KERNEL_SSE, CULL_KERNEL_AVX2 })
+	{
+		if (!BatchCull::IsKernelSupported(kernel))
+			continue;
+
+		double ms = BestOfMs(runs, [&]()
+			{
+				BatchTransform::Multiply(kernel, &items[0].world, sizeof(DrawItem), viewProjection, &items[0].worldViewProjection, sizeof(DrawItem), count);
+				BatchTransform::Multiply(kernel, &items[0].world, sizeof(DrawItem), shadowViewProjection, &items[0].shadowWorldViewProjection, sizeof(DrawItem), count);
+			});
+		printf("%-18s %10.3f %14.2f\n", BatchCull::GetKernelName(kernel), ms, ms * 1e6 / (2.0 * count));
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (kernel == CULL_KERNEL_SCALAR)
+				scalar[i] = items[i].worldViewProjection;
+			else
+				differ += memcmp(&scalar[i], &items[i].worldViewProjection, sizeof(XMFLOAT4X4)) != 0;
+
+			for (int element = 0; element < 16; element++)
+				worstError = std::max(worstError, fabsf((&items[i].worldViewProjection.m[0][0])[element] - (&reference[i].m[0][0])[element]));
+		}
+	}
+	printf("Largest difference from XMMatrixMultiply: %g\n", worstError);
+	checks.Check(differ == 0, "every kernel matches scalar bit for bit");
+	checks.Check(worstError < 1e-4f, "kernels agree with XMMatrixMultiply");
+
+	// The whole draw list, with and without the shadow matrix
+	std::unique_ptr<Mesh> cube = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+	EntityRegistry registry;
+	registry.Reserve(count);
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Transform* transform = registry.GetTransform(registry.Create(cube.get(), material.get()));
+		transform->SetPosition(spread(random) * 100.0f, spread(random) * 10.0f, spread(random) * 100.0f);
+		transform->SetRotation(spread(random), spread(random), spread(random));
+		indices.push_back(i);
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	std::vector<DrawItem> drawList;
+	printf("\n%-18s %14s %14s\n", "BuildDrawList", "ms", "+ shadow ms");
+	for (int kernel : { CULL_KERNEL_SCALAR, CULL_KERNEL_SSE, CULL_KERNEL_AVX2 })
+	{
+		if (!BatchCull::IsKernelSupported(kernel))
+			continue;
+
+		registry.SetCullKernel(kernel);
+		double viewMs = BestOfMs(runs, [&]() { registry.BuildDrawList(indices, viewProjection, nullptr, drawList); });
+		double shadowMs = BestOfMs(runs, [&]() { registry.BuildDrawList(indices, viewProjection, &shadowViewProjection, drawList); });
+		printf("%-18s %14.3f %14.3f\n", BatchCull::GetKernelName(kernel), viewMs, shadowMs);
+	}
+	printf("\n");
+
+	JobSystem::ShutDown();
+	return checks.Report("BatchTransform");
+}
@@ -0,0 +1,156 @@
+// Stress test for entity spawn and despawn churn, swapping the oldest entities
+// for new ones at a steady rate and counting heap allocations along the way
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/ChurnBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o ChurnBench
+// - Usage: ChurnBench [entities] [churn a second] [seconds], defaults to 100000 entities
+//   swapping 100000 a second for 2 simulated seconds at 60 frames a second
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Every heap allocation in the program goes through here to be counted
+static std::atomic<unsigned long long> allocationCount{ 0 };
+
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+// Annonymous namespace for the old layout
+namespace
+{
+	// What GameEntity used to be, each component behind its own shared_ptr
+	struct LegacyEntity
+	{
+		LegacyEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) :
+			transform(std::make_shared<Transform>()), mesh(mesh), material(material) {}
+
+		std::shared_ptr<Transform> transform;
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Material> material;
+	};
+
+	struct ChurnResult
+	{
+		double ms = 0.0;
+		double worstFrameMs = 0.0;
+		unsigned long long allocations = 0;
+	};
+
+	// Runs the frames, churn() swaps the given number of entities
+	template <typename Churn>
+	ChurnResult RunFrames(int frames, unsigned int perFrame, Churn churn)
+	{
+		ChurnResult result;
+		unsigned long long allocationsBefore = allocationCount.load();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			churn(perFrame);
+			double ms = ElapsedMs(start);
+			result.ms += ms;
+			result.worstFrameMs = std::max(result.worstFrameMs, ms);
+		}
+		result.allocations = allocationCount.load() - allocationsBefore;
+		return result;
+	}
+
+	void PrintResult(const char* name, const ChurnResult& result, int frames, unsigned int perFrame)
+	{
+		double perSecond = (double)frames * perFrame / (result.ms / 1000.0);
+		printf("%-30s %9.3f %9.3f %14.0f %12llu\n", name, result.ms / frames, result.worstFrameMs, perSecond, result.allocations);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	unsigned int perSecond = argc > 2 ? (unsigned int)std::max(1, atoi(argv[2])) : 100000;
+	int seconds = argc > 3 ? std::max(1, atoi(argv[3])) : 2;
+	int frames = seconds * 60;
+	unsigned int perFrame = std::max(1u, perSecond / 60);
+
+	std::shared_ptr<Mesh> mesh = MakeBoxMesh();
+	std::shared_ptr<Material> material = MakeMaterial();
+
+	printf("%u entities, %u swapped a frame over %d frames\n", count, perFrame, frames);
+	printf("%-30s %9s %9s %14s %12s\n", "", "Avg ms", "Worst ms", "Swaps/second", "Allocations");
+
+	// Old layout, the oldest entity erased from the front and a new one allocated
+	{
+		std::vector<std::shared_ptr<LegacyEntity>> entities;
+		for (unsigned int i = 0; i < count; i++)
+			entities.push_back(std::make_shared<LegacyEntity>(mesh, material));
+
+		ChurnResult result = RunFrames(frames, perFrame, [&](unsigned int swaps)
+			{
+				for (unsigned int s = 0; s < swaps; s++)
+				{
+					XMFLOAT3 position = entities.front()->transform->GetPosition();
+					entities.erase(entities.begin());
+					entities.push_back(std::make_shared<LegacyEntity>(mesh, material));
+					entities.back()->transform->SetPosition(position);
+				}
+			});
+		PrintResult("vector<shared_ptr<GameEntity>>", result, frames, perFrame);
+	}
+
+	// Registry, destroying frees a slot that the next create picks straight back up
+	{
+		EntityRegistry registry;
+		registry.Reserve(count);
+		std::vector<Entity> entities;
+		for (unsigned int i = 0; i < count; i++)
+			entities.push_back(registry.Create(mesh.get(), material.get()));
+		registry.UpdateBounds();
+		registry.EndFrame();
+
+		size_t cursor = 0;
+		unsigned int staleCaught = 0;
+		auto churn = [&](unsigned int swaps)
+			{
+				for (unsigned int s = 0; s < swaps; s++)
+				{
+					Entity old = entities[cursor];
+					XMFLOAT3 position = registry.GetTransform(old)->GetPosition();
+					registry.Destroy(old);
+
+					Entity entity = registry.Create(mesh.get(), material.get());
+					registry.GetTransform(entity)->SetPosition(position);
+					entities[cursor] = entity;
+					cursor = (cursor + 1) % entities.size();
+
+					// The old handle points at a reused slot now, and has to be seen as dead
+					if (!registry.IsAlive(old))
+						staleCaught++;
+				}
+				registry.UpdateBounds();
+				registry.EndFrame();
+			};
+
+		// One frame first, so the journal and free list reach their steady size
+		churn(perFrame);
+		staleCaught = 0;
+
+		ChurnResult result = RunFrames(frames, perFrame, churn);
+		PrintResult("EntityRegistry", result, frames, perFrame);
+		printf("\nStale handles caught: %u of %u, live entities: %zu\n", staleCaught, frames * perFrame, registry.Count());
+		if (staleCaught != frames * perFrame || result.allocations != 0)
+			return 1;
+	}
+	return 0;
+}
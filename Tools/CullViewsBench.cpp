@@ -0,0 +1,88 @@
+// Times culling several views at once with CullViews() against one
+// CullFrustum() per view, for one to eight views over the same entities
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/CullViewsBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o CullViewsBench
+// - Usage: CullViewsBench [entities] [runs], defaults to 100000 entities, the best run is reported
+// - Each view's mask must hold exactly what CullFrustum() finds, the tool exits with 1 if not
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include "../BatchCull.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 30;
+	JobSystem::Initialize();
+
+	std::unique_ptr<Mesh> cube = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+	EntityRegistry registry;
+	registry.Reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Transform* transform = registry.GetTransform(registry.Create(cube.get(), material.get()));
+		transform->SetPosition(spread(random) * 300.0f, spread(random) * 30.0f, spread(random) * 300.0f);
+		transform->SetRotation(spread(random), spread(random), spread(random));
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	// Cameras near each other looking different ways, like a main view,
+	// a picture in picture, a minimap and the faces of a reflection probe
+	Frustum frustums[CULL_MAX_VIEWS];
+	CullPlanes planes[CULL_MAX_VIEWS];
+	for (int view = 0; view < CULL_MAX_VIEWS; view++)
+	{
+		float yaw = view * 0.4f;
+		XMMATRIX viewMatrix = XMMatrixLookToLH(XMVectorSet(view * 5.0f, 5.0f, 0.0f, 1.0f), XMVectorSet(cosf(yaw), -0.1f, sinf(yaw), 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(60.0f + view * 8.0f), 16.0f / 9.0f, 0.1f, 250.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(viewMatrix, projection));
+		frustums[view] = Frustum(viewProjection);
+		planes[view].AddFrustum(frustums[view]);
+	}
+
+	CheckCounter checks;
+	ViewMasks masks;
+	std::vector<unsigned int> separate[CULL_MAX_VIEWS];
+	std::vector<unsigned int> shared;
+	unsigned int mismatches = 0;
+	printf("%u entities, best of %d runs\n\n", count, runs);
+	printf("%5s %14s %14s %9s %12s\n", "Views", "Separate ms", "CullViews ms", "Speedup", "Visible");
+	for (unsigned int viewCount = 1; viewCount <= CULL_MAX_VIEWS; viewCount++)
+	{
+		double separateMs = BestOfMs(runs, [&]()
+			{
+				for (unsigned int view = 0; view < viewCount; view++)
+					registry.CullFrustum(frustums[view], separate[view]);
+			});
+		double sharedMs = BestOfMs(runs, [&]() { registry.CullViews(planes, viewCount, masks); });
+
+		unsigned int visible = 0;
+		for (unsigned int view = 0; view < viewCount; view++)
+		{
+			masks.GetIndices(view, shared);
+			std::sort(separate[view].begin(), separate[view].end());
+			mismatches += shared != separate[view];
+			visible += masks.CountVisible(view);
+		}
+		printf("%5u %14.3f %14.3f %8.2fx %12u\n", viewCount, separateMs, sharedMs, separateMs / sharedMs, visible);
+	}
+	printf("\n");
+	checks.Check(mismatches == 0, "every view's mask matches CullFrustum()");
+
+	JobSystem::ShutDown();
+	return checks.Report("CullViews");
+}
@@ -0,0 +1,106 @@
+// Times building the draw list from the entity registry against the
+// vector of shared_ptr entities the game used to keep
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/DrawListBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o DrawListBench
+// - Usage: DrawListBench [entities] [runs], defaults to 100000 entities, the best run is reported
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Annonymous namespace for the old layout
+namespace
+{
+	// What GameEntity used to be, each component behind its own shared_ptr
+	// and the entity itself behind another
+	class LegacyEntity
+	{
+	public:
+		LegacyEntity(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) :
+			transform(std::make_shared<Transform>()), mesh(mesh), material(material) {}
+
+		std::shared_ptr<Transform> GetTransform() { return transform; }
+		std::shared_ptr<Mesh> GetMesh() { return mesh; }
+		std::shared_ptr<Material> GetMaterial() { return material; }
+
+	private:
+		std::shared_ptr<Transform> transform;
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Material> material;
+	};
+
+	// Draw list the way the old loop gathered it, getters copying shared_ptrs
+	void BuildLegacyDrawList(std::vector<std::shared_ptr<LegacyEntity>>& entities, std::vector<DrawItem>& drawList)
+	{
+		drawList.resize(entities.size());
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			DrawItem& item = drawList[i];
+			item.entity = (Entity)i;
+			item.mesh = entities[i]->GetMesh().get();
+			item.material = entities[i]->GetMaterial().get();
+			item.world = entities[i]->GetTransform()->GetWorldMatrix();
+			item.worldInvTranspose = entities[i]->GetTransform()->GetWorldInverseTransposeMatrix();
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+
+	// A handful of meshes and materials shared by every entity, like the game
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::shared_ptr<Material>> materials;
+	for (int i = 0; i < 4; i++)
+	{
+		meshes.push_back(MakeBoxMesh());
+		materials.push_back(MakeMaterial());
+	}
+
+	// Both layouts get the same entities in the same places, the old one allocated
+	// back to back, its best case, a long running game scatters them much more
+	std::vector<std::shared_ptr<LegacyEntity>> legacy;
+	EntityRegistry registry;
+	registry.Reserve(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 position((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+		std::shared_ptr<Mesh> mesh = meshes[i % meshes.size()];
+		std::shared_ptr<Material> material = materials[i / 7 % materials.size()];
+
+		legacy.push_back(std::make_shared<LegacyEntity>(mesh, material));
+		legacy.back()->GetTransform()->SetPosition(position);
+
+		Entity entity = registry.Create(mesh.get(), material.get());
+		registry.GetTransform(entity)->SetPosition(position);
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	// World matrices are worked out on first use, so warm both up before timing
+	std::vector<DrawItem> drawList;
+	BuildLegacyDrawList(legacy, drawList);
+	registry.BuildDrawList(drawList);
+
+	printf("%u entities, best of %d runs\n", count, runs);
+	double legacyMs = BestOfMs(runs, [&]() { BuildLegacyDrawList(legacy, drawList); });
+	printf("%-34s %8.3f ms\n", "vector<shared_ptr<GameEntity>>", legacyMs);
+
+	double registryMs = BestOfMs(runs, [&]() { registry.BuildDrawList(drawList); });
+	printf("%-34s %8.3f ms  %.2fx\n", "EntityRegistry, 1 thread", registryMs, legacyMs / registryMs);
+
+	JobSystem::Initialize();
+	double parallelMs = BestOfMs(runs, [&]() { registry.BuildDrawList(drawList); });
+	printf("%-34s %8.3f ms  %.2fx\n", "EntityRegistry, all threads", parallelMs, legacyMs / parallelMs);
+	printf("Worker threads: %u\n", JobSystem::GetThreadCount());
+	JobSystem::ShutDown();
+	return 0;
+}
@@ -0,0 +1,94 @@
+// Replays a frame capture on the null backend and reports where the CPU time went
+// - Only needs the command list code, nothing here touches Direct3D, so it builds
+//   on any platform, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I. Tools/FrameReplay.cpp FrameCapture.cpp CommandList.cpp NullBackend.cpp RenderStateCache.cpp -o FrameReplay
+// - Usage: FrameReplay <capture.fcap> [runs], timings are averaged over the runs
+#include "../FrameCapture.h"
+#include "../NullBackend.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("Usage: %s <capture.fcap> [runs]\n", argv[0]);
+		return 1;
+	}
+	int runs = argc > 2 ? std::max(1, atoi(argv[2])) : 1;
+
+	FrameCapture capture;
+	if (!capture.Load(argv[1]))
+	{
+		printf("Couldn't read %s, missing or from another version\n", argv[1]);
+		return 1;
+	}
+
+	printf("Frame %llu: %u lists, %u commands, %u resources, %.1f KB\n",
+		capture.frame, capture.GetListCount(), capture.GetCommandCount(), capture.GetResourceCount(), capture.GetFileSize() / 1024.0);
+
+	// Every run starts from a fresh backend, so the cache filters the same calls each time
+	FrameReplayTimings timings;
+	std::vector<double> commandMicroseconds(capture.GetCommandCount());
+	double totalTypeMs[RENDER_COMMAND_COUNT] = {};
+	double totalMs = 0.0;
+	NullBackend backend;
+	for (int run = 0; run < runs; run++)
+	{
+		backend.Reset();
+		capture.Replay(backend, false, timings);
+		totalMs += timings.totalMs;
+		for (unsigned int type = 0; type < RENDER_COMMAND_COUNT; type++)
+			totalTypeMs[type] += timings.typeMs[type];
+		for (size_t i = 0; i < commandMicroseconds.size(); i++)
+			commandMicroseconds[i] += timings.commandMicroseconds[i];
+	}
+
+	printf("Null backend: %u draws, %llu instances, %llu indices, %.1f KB uploaded\n",
+		backend.GetDrawCount(), backend.GetInstanceCount(), backend.GetIndexCount(), backend.GetUploadedBytes() / 1024.0);
+	printf("State calls: %u, %u of them redundant\n", backend.GetStateCount(), backend.GetRedundantCount());
+	if (backend.GetErrorCount() > 0)
+		printf("Errors: %u, first: %s\n", backend.GetErrorCount(), backend.GetFirstError());
+	printf("Replay: %.3f ms a run over %d runs\n\n", totalMs / runs, runs);
+
+	// Types with the most time first
+	unsigned int types[RENDER_COMMAND_COUNT];
+	for (unsigned int type = 0; type < RENDER_COMMAND_COUNT; type++)
+		types[type] = type;
+	std::sort(types, types + RENDER_COMMAND_COUNT, [&](unsigned int a, unsigned int b) { return totalTypeMs[a] > totalTypeMs[b]; });
+
+	printf("%-22s %8s %10s %10s\n", "Command", "Count", "Total ms", "Each us");
+	for (unsigned int type : types)
+	{
+		unsigned int count = timings.typeCounts[type];
+		if (count == 0)
+			continue;
+		double ms = totalTypeMs[type] / runs;
+		printf("%-22s %8u %10.3f %10.3f\n", CommandList::GetTypeName(type), count, ms, ms * 1000.0 / count);
+	}
+
+	// Single slowest commands, found by their place in the capture
+	std::vector<unsigned int> order(commandMicroseconds.size());
+	for (unsigned int i = 0; i < (unsigned int)order.size(); i++)
+		order[i] = i;
+	unsigned int shown = std::min(10u, (unsigned int)order.size());
+	std::partial_sort(order.begin(), order.begin() + shown, order.end(), [&](unsigned int a, unsigned int b) { return commandMicroseconds[a] > commandMicroseconds[b]; });
+
+	printf("\nSlowest commands\n");
+	for (unsigned int i = 0; i < shown; i++)
+	{
+		// Work out which list the command sits in
+		unsigned int index = order[i];
+		unsigned int list = 0;
+		while (index >= capture.GetList(list).Count())
+			index -= capture.GetList(list++).Count();
+		const RenderCommand& command = capture.GetList(list).GetCommands()[index];
+
+		printf("list %u command %6u %-22s object %5u %10.3f us\n",
+			list, index, CommandList::GetTypeName(command.type), (unsigned int)(uintptr_t)command.object, commandMicroseconds[order[i]] / runs);
+	}
+	return 0;
+}
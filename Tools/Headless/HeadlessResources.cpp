@@ -0,0 +1,133 @@
+// CPU-only definitions of Mesh and Material for the tools in Tools/, built in place
+// of Mesh.cpp and Material.cpp, which need a Direct3D device
+// - Meshes keep everything the engine reads back on the CPU, bounds, positions,
+//   indices and vertices if asked to keep them, but never make buffers, so the buffer getters return
+//   stand-in pointers that are only good for telling meshes apart in commands
+// - Materials keep their color and sort ids, shaders are whatever was passed in,
+//   usually null
+// - Sort ids are handed out the same way the real classes do it
+#include "../../Mesh.h"
+#include "../../Material.h"
+#include "../../RenderQueue.h"
+#include <mutex>
+
+using namespace DirectX;
+
+// Annonymous namespace for handing out sort ids
+namespace
+{
+	SortIdAllocator meshSortIds;
+	SortIdAllocator materialSortIds;
+
+	std::vector<std::pair<SimpleVertexShader*, SimplePixelShader*>> shaderPairs;
+	std::mutex shaderPairMutex;
+
+	unsigned int GetShaderPairId(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+	{
+		std::lock_guard<std::mutex> lock(shaderPairMutex);
+		std::pair<SimpleVertexShader*, SimplePixelShader*> pair(vertexShader, pixelShader);
+		for (unsigned int i = 0; i < shaderPairs.size(); i++)
+		{
+			if (shaderPairs[i] == pair)
+				return i;
+		}
+
+		shaderPairs.push_back(pair);
+		return (unsigned int)shaderPairs.size() - 1;
+	}
+}
+
+Mesh::Mesh(Vertex* vertices, size_t numVertices, unsigned int* indices, size_t numIndices, const char* meshName, bool keepVertices)
+{
+	this->numVertices = (unsigned int)numVertices;
+	this->numIndices = (unsigned int)numIndices;
+	this->meshName = meshName;
+	sortId = meshSortIds.Allocate();
+
+	BoundingBox::CreateFromPoints(localBounds, numVertices, &vertices[0].Position, sizeof(Vertex));
+
+	positions.resize(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+		positions[i] = vertices[i].Position;
+	cpuIndices.assign(indices, indices + numIndices);
+	if (keepVertices)
+		cpuVertices.assign(vertices, vertices + numVertices);
+
+	// Addresses inside the mesh stand in for its buffers
+	vertexBuffer = (ID3D11Buffer*)&positions;
+	indexBuffer = (ID3D11Buffer*)&cpuIndices;
+}
+
+Mesh::~Mesh()
+{
+	meshSortIds.Release(sortId);
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() { return vertexBuffer; }
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetIndexBuffer() { return indexBuffer; }
+unsigned int Mesh::GetVertexCount() { return numVertices; }
+unsigned int Mesh::GetIndexCount() { return numIndices; }
+const char* Mesh::GetMeshName() { return meshName; }
+DirectX::BoundingBox Mesh::GetBounds() { return localBounds; }
+unsigned int Mesh::GetSortId() { return sortId; }
+const std::vector<DirectX::XMFLOAT3>& Mesh::GetPositions() { return positions; }
+const std::vector<unsigned int>& Mesh::GetIndices() { return cpuIndices; }
+const std::vector<Vertex>& Mesh::GetVertices() { return cpuVertices; }
+
+void Mesh::Draw(CommandList& commands)
+{
+	commands.SetVertexBuffer(0, vertexBuffer.Get(), sizeof(Vertex));
+	commands.SetIndexBuffer(indexBuffer.Get());
+	commands.DrawIndexed(numIndices);
+}
+
+void Mesh::DrawInstanced(CommandList& commands, unsigned int instanceCount, unsigned int startInstance)
+{
+	commands.SetVertexBuffer(0, vertexBuffer.Get(), sizeof(Vertex));
+	commands.SetIndexBuffer(indexBuffer.Get());
+	commands.DrawIndexedInstanced(numIndices, instanceCount, startInstance);
+}
+
+Material::Material(DirectX::XMFLOAT4 colorTint, std::shared_ptr<SimpleVertexShader> vShader, std::shared_ptr<SimplePixelShader> pShader, DirectX::XMFLOAT2 scale, DirectX::XMFLOAT2 offset, float roughness)
+{
+	this->colorTint = colorTint;
+	this->vShader = vShader;
+	this->pShader = pShader;
+	this->scale = scale;
+	this->offset = offset;
+	this->roughness = roughness;
+	sortId = materialSortIds.Allocate();
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+}
+
+Material::~Material()
+{
+	materialSortIds.Release(sortId);
+}
+
+DirectX::XMFLOAT4 Material::GetColor() { return colorTint; }
+std::shared_ptr<SimpleVertexShader> Material::GetVertexShader() { return vShader; }
+std::shared_ptr<SimplePixelShader> Material::GetPixelShader() { return pShader; }
+std::shared_ptr<SimpleVertexShader> Material::GetInstancedVertexShader() { return instancedVShader; }
+DirectX::XMFLOAT2 Material::GetScale() { return scale; }
+DirectX::XMFLOAT2 Material::GetOffset() { return offset; }
+std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>>& Material::GetSRVs() { return textureSRVs; }
+unsigned int Material::GetSortId() { return sortId; }
+unsigned int Material::GetShaderSortId() { return shaderSortId; }
+
+void Material::SetColor(DirectX::XMFLOAT4 newColor) { colorTint = newColor; }
+void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader)
+{
+	vShader = vertexShader;
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+	instancedVShader = nullptr;
+}
+
+void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader)
+{
+	pShader = pixelShader;
+	shaderSortId = GetShaderPairId(vShader.get(), pShader.get());
+}
+void Material::SetInstancedVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader) { instancedVShader = vertexShader; }
+void Material::SetScale(DirectX::XMFLOAT2 scale) { this->scale = scale; }
+void Material::SetOffset(DirectX::XMFLOAT2 offset) { this->offset = offset; }
@@ -0,0 +1,67 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <cmath>
+#include <DirectXMath.h>
+#include "../../Mesh.h"
+#include "../../Material.h"
+
+// Tools that use the registry build the engine's CPU side with the stand-in
+// Direct3D headers in this folder and HeadlessResources.cpp in place of Mesh.cpp
+// and Material.cpp, so they run anywhere, and only need DirectXMath on the include
+// path (github.com/microsoft/DirectXMath, plus sal.h from DirectX-Headers off Windows)
+
+// Unit cube around the origin, sides of length one
+inline std::unique_ptr<Mesh> MakeBoxMesh(const char* name = "Box")
+{
+	Vertex vertices[8] = {};
+	for (int i = 0; i < 8; i++)
+		vertices[i].Position = DirectX::XMFLOAT3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+
+	unsigned int indices[36] = {
+		0, 2, 1, 1, 2, 3,
+		4, 5, 6, 5, 7, 6,
+		0, 1, 4, 1, 5, 4,
+		2, 6, 3, 3, 6, 7,
+		0, 4, 2, 2, 4, 6,
+		1, 3, 5, 3, 7, 5 };
+	return std::make_unique<Mesh>(vertices, 8, indices, 36, name);
+}
+
+// UV sphere of radius one, the same one the game builds its LOD chain from
+inline std::unique_ptr<Mesh> MakeSphereMesh(int slices = 32, const char* name = "Sphere")
+{
+	int stacks = slices / 2;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	for (int stack = 0; stack <= stacks; stack++)
+	{
+		float phi = DirectX::XM_PI * stack / stacks;
+		for (int slice = 0; slice <= slices; slice++)
+		{
+			float theta = DirectX::XM_2PI * slice / slices;
+			Vertex vertex = {};
+			vertex.Position = DirectX::XMFLOAT3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+			vertices.push_back(vertex);
+		}
+	}
+	for (int stack = 0; stack < stacks; stack++)
+	{
+		for (int slice = 0; slice < slices; slice++)
+		{
+			unsigned int a = stack * (slices + 1) + slice;
+			unsigned int c = a + slices + 1;
+			if (stack > 0)
+				indices.insert(indices.end(), { a, a + 1, c });
+			if (stack < stacks - 1)
+				indices.insert(indices.end(), { a + 1, c + 1, c });
+		}
+	}
+	return std::make_unique<Mesh>(vertices.data(), vertices.size(), indices.data(), indices.size(), name);
+}
+
+// Material without shaders, only its color and sort ids matter headless
+inline std::unique_ptr<Material> MakeMaterial(DirectX::XMFLOAT4 color = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f))
+{
+	return std::make_unique<Material>(color, nullptr, nullptr, DirectX::XMFLOAT2(1.0f, 1.0f), DirectX::XMFLOAT2(0.0f, 0.0f), 0.5f);
+}
@@ -0,0 +1,12 @@
+#pragma once
+// Stand-in for the few Windows types the engine's headers name, so the CPU side
+// of the engine builds on other platforms for the tools in this folder
+// - Declarations only, nothing here can actually talk to Windows
+typedef void* HWND;
+typedef long long LPARAM;
+typedef unsigned long long WPARAM;
+typedef unsigned short WORD;
+typedef unsigned int UINT;
+typedef long HRESULT;
+typedef const wchar_t* LPCWSTR;
+typedef const char* LPCSTR;
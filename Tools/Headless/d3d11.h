@@ -0,0 +1,31 @@
+#pragma once
+#include "Windows.h"
+
+// Stand-in for the Direct3D 11 header, every interface is left incomplete,
+// headless tools only ever carry them around as null or stand-in pointers
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11DomainShader;
+struct ID3D11HullShader;
+struct ID3D11GeometryShader;
+struct ID3D11ComputeShader;
+struct ID3D11SamplerState;
+struct ID3D11ShaderResourceView;
+struct ID3D11UnorderedAccessView;
+struct ID3D11RenderTargetView;
+struct ID3D11DepthStencilView;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+struct ID3D10Blob;
+typedef ID3D10Blob ID3DBlob;
+
+enum D3D_CBUFFER_TYPE
+{
+	D3D11_CT_CBUFFER = 0,
+	D3D11_CT_TBUFFER = 1
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+
+// Stand-in for WRL's ComPtr, without reference counting since headless
+// tools never hold a real COM object
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template <typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() = default;
+			ComPtr(std::nullptr_t) {}
+			template <typename U>
+			ComPtr(U* other) : pointer(other) {}
+
+			T* Get() const { return pointer; }
+			T* const* GetAddressOf() const { return &pointer; }
+			T** GetAddressOf() { return &pointer; }
+			T** ReleaseAndGetAddressOf() { pointer = nullptr; return &pointer; }
+			void Reset() { pointer = nullptr; }
+
+			T* operator->() const { return pointer; }
+			explicit operator bool() const { return pointer != nullptr; }
+
+		private:
+			T* pointer = nullptr;
+		};
+	}
+}
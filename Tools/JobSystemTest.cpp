@@ -0,0 +1,227 @@
+// Checks the job system at several thread counts, then times how it scales
+// - Only needs the job system, so it builds on any platform, from the repository's root with:
+//   g++ -std=c++20 -O2 -I. Tools/JobSystemTest.cpp JobSystem.cpp -pthread -o JobSystemTest
+// - Usage: JobSystemTest [max threads], defaults to 16, or the core count if that's higher
+// - Exits with 1 if any check failed
+#include "ToolHelpers.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Annonymous namespace for the checks and workloads
+namespace
+{
+	// Total threads including the calling one, a single thread runs without workers
+	void StartJobs(unsigned int threads)
+	{
+		if (threads > 1)
+			JobSystem::Initialize(threads - 1);
+	}
+
+	void StopJobs(unsigned int threads)
+	{
+		if (threads > 1)
+			JobSystem::ShutDown();
+	}
+
+	void CheckWait(CheckCounter& checks)
+	{
+		// Many tiny jobs on one counter, all of them done once Wait() returns
+		JobCounter counter;
+		std::atomic<long long> sum{ 0 };
+		for (int i = 0; i < 100000; i++)
+			JobSystem::Run([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }, &counter);
+		JobSystem::Wait(&counter);
+		checks.Check(counter.IsDone(), "counter is done after Wait()");
+		checks.Check(sum.load() == 4999950000LL, "every job ran exactly once before Wait() returned");
+
+		// Waiting on nothing, or on a counter nobody used, returns right away
+		JobCounter unused;
+		JobSystem::Wait(&unused);
+		JobSystem::Wait(nullptr);
+		checks.Check(unused.IsDone(), "unused counter is done");
+	}
+
+	void CheckDependencies(CheckCounter& checks)
+	{
+		// A chain, each job held back until the one before finished
+		bool chainInOrder = true;
+		for (int repeat = 0; repeat < 200; repeat++)
+		{
+			const int length = 8;
+			JobCounter counters[length];
+			std::atomic<int> stage{ 0 };
+			for (int i = 0; i < length; i++)
+			{
+				JobSystem::Run([&, i]()
+					{
+						if (stage.load() != i)
+							chainInOrder = false;
+						std::this_thread::yield();
+						stage.store(i + 1);
+					}, &counters[i], i > 0 ? &counters[i - 1] : nullptr);
+			}
+			JobSystem::Wait(&counters[length - 1]);
+			if (stage.load() != length)
+				chainInOrder = false;
+		}
+		checks.Check(chainInOrder, "dependent jobs start only after their dependency finished");
+
+		// Many jobs parked on one counter are all released when it finishes
+		JobCounter first;
+		JobCounter rest;
+		std::atomic<bool> firstDone{ false };
+		std::atomic<int> startedEarly{ 0 };
+		std::atomic<int> ran{ 0 };
+		JobSystem::Run([&]()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				firstDone.store(true);
+			}, &first);
+		for (int i = 0; i < 1000; i++)
+		{
+			JobSystem::Run([&]()
+				{
+					if (!firstDone.load())
+						startedEarly++;
+					ran++;
+				}, &rest, &first);
+		}
+		JobSystem::Wait(&rest);
+		checks.Check(ran.load() == 1000, "every job waiting on a counter runs");
+		checks.Check(startedEarly.load() == 0, "no waiting job starts before its dependency is done");
+
+		// Depending on a counter that is already done runs straight away
+		JobCounter after;
+		std::atomic<int> late{ 0 };
+		JobSystem::Run([&]() { late++; }, &after, &first);
+		JobSystem::Wait(&after);
+		checks.Check(late.load() == 1, "job depending on a finished counter still runs");
+	}
+
+	void CheckParallelFor(CheckCounter& checks)
+	{
+		// Every index visited exactly once, for awkward counts and grains
+		const unsigned int counts[] = { 1, 2, 3, 17, 1000, 65537 };
+		const unsigned int grains[] = { 0, 1, 7, 4096 };
+		bool exactlyOnce = true;
+		for (unsigned int count : counts)
+		{
+			for (unsigned int grain : grains)
+			{
+				std::vector<std::atomic<int>> visits(count);
+				JobSystem::ParallelFor(count, [&](unsigned int start, unsigned int end)
+					{
+						for (unsigned int i = start; i < end; i++)
+							visits[i]++;
+					}, grain);
+				for (auto& visit : visits)
+					exactlyOnce = exactlyOnce && visit.load() == 1;
+			}
+		}
+		checks.Check(exactlyOnce, "ParallelFor visits every index exactly once");
+
+		bool emptyRan = false;
+		JobSystem::ParallelFor(0, [&](unsigned int, unsigned int) { emptyRan = true; });
+		checks.Check(!emptyRan, "ParallelFor over nothing never calls the job");
+
+		// Nested loops, the waiting thread keeps running jobs so nothing deadlocks
+		std::atomic<long long> total{ 0 };
+		JobSystem::ParallelFor(64, [&](unsigned int start, unsigned int end)
+			{
+				for (unsigned int outer = start; outer < end; outer++)
+				{
+					JobSystem::ParallelFor(1000, [&](unsigned int innerStart, unsigned int innerEnd)
+						{
+							total += innerEnd - innerStart;
+						});
+				}
+			});
+		checks.Check(total.load() == 64000, "nested ParallelFor covers every inner index");
+
+		// Jobs queued from a thread the system doesn't own
+		std::atomic<int> outsideRan{ 0 };
+		std::thread outside([&]()
+			{
+				JobCounter counter;
+				for (int i = 0; i < 10000; i++)
+					JobSystem::Run([&]() { outsideRan++; }, &counter);
+				JobSystem::Wait(&counter);
+			});
+		outside.join();
+		checks.Check(outsideRan.load() == 10000, "jobs queued from an outside thread all run");
+	}
+
+	// Enough math per item that the loop is bound by the cores, not memory
+	float HeavyItem(unsigned int i)
+	{
+		float value = (float)i;
+		for (int step = 0; step < 64; step++)
+			value = std::sqrt(value * 1.0001f + 1.0f);
+		return value;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	unsigned int maxThreads = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : std::max(16u, cores);
+
+	std::vector<unsigned int> threadCounts;
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	if (threadCounts.back() != maxThreads)
+		threadCounts.push_back(maxThreads);
+
+	CheckCounter checks;
+	for (unsigned int threads : threadCounts)
+	{
+		StartJobs(threads);
+		char what[64];
+		snprintf(what, sizeof(what), "thread count is %u", threads);
+		checks.Check(JobSystem::GetThreadCount() == threads, what);
+		CheckWait(checks);
+		CheckDependencies(checks);
+		CheckParallelFor(checks);
+		StopJobs(threads);
+	}
+	int result = checks.Report("JobSystem");
+
+	// Scaling, a loop split with ParallelFor and a flood of tiny jobs
+	printf("\n%u cores\n", cores);
+	printf("%8s %12s %9s %16s\n", "Threads", "Loop ms", "Speedup", "Tiny jobs/ms");
+	const unsigned int items = 1 << 20;
+	std::vector<float> output(items);
+	double singleMs = 0.0;
+	for (unsigned int threads : threadCounts)
+	{
+		StartJobs(threads);
+		double loopMs = BestOfMs(5, [&]()
+			{
+				JobSystem::ParallelFor(items, [&](unsigned int start, unsigned int end)
+					{
+						for (unsigned int i = start; i < end; i++)
+							output[i] = HeavyItem(i);
+					});
+			});
+		if (threads == 1)
+			singleMs = loopMs;
+
+		const int tinyJobs = 100000;
+		double tinyMs = BestOfMs(3, [&]()
+			{
+				JobCounter counter;
+				std::atomic<int> ran{ 0 };
+				for (int i = 0; i < tinyJobs; i++)
+					JobSystem::Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				JobSystem::Wait(&counter);
+			});
+		StopJobs(threads);
+
+		printf("%8u %12.3f %8.2fx %16.0f\n", threads, loopMs, singleMs / loopMs, tinyJobs / tinyMs);
+	}
+	return result;
+}
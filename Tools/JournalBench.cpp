@@ -0,0 +1,96 @@
+// Times keeping world bounds up to date on a mostly static scene, walking only
+// the transform journal against rescanning every entity each frame
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/JournalBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o JournalBench
+// - Usage: JournalBench [entities] [frames], defaults to 100000 entities over 100 frames
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include <cstdlib>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Annonymous namespace for the full rescan
+namespace
+{
+	// What every consumer had to do before the journal, with nothing
+	// saying which transforms changed, all of them get looked at
+	void RescanBounds(EntityRegistry& registry, std::vector<BoundingBox>& bounds)
+	{
+		size_t count = registry.Count();
+		Transform* transforms = registry.GetTransforms();
+		Mesh** meshes = registry.GetMeshes();
+		bounds.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			XMFLOAT4X4 world = transforms[i].GetWorldMatrix();
+			meshes[i]->GetBounds().Transform(bounds[i], XMLoadFloat4x4(&world));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 100;
+
+	std::unique_ptr<Mesh> mesh = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+
+	EntityRegistry registry;
+	registry.Reserve(count);
+	std::vector<Entity> entities;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		entities.push_back(registry.Create(mesh.get(), material.get()));
+		registry.GetTransform(entities.back())->SetPosition((float)(i % 100), (float)(i / 100 % 100), (float)(i / 10000));
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	printf("%u entities, %d frames, average ms a frame\n", count, frames);
+	printf("%8s %10s %10s %10s\n", "Moving", "Rescan", "Journal", "Speedup");
+
+	std::vector<BoundingBox> rescanned;
+	const float movingShares[] = { 0.0f, 0.001f, 0.01f, 0.1f, 1.0f };
+	for (float share : movingShares)
+	{
+		// The same entities move in both runs, spread over the whole scene
+		unsigned int moving = (unsigned int)(count * share);
+		unsigned int step = moving > 0 ? count / moving : count;
+		auto moveSome = [&](int frame)
+			{
+				for (unsigned int m = 0; m < moving; m++)
+				{
+					Transform* transform = registry.GetTransform(entities[m * step]);
+					XMFLOAT3 position = transform->GetPosition();
+					transform->SetPosition(position.x, position.y + (frame & 1 ? 0.1f : -0.1f), position.z);
+				}
+			};
+
+		double rescanMs = 0.0;
+		double journalMs = 0.0;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			moveSome(frame);
+			auto start = std::chrono::high_resolution_clock::now();
+			RescanBounds(registry, rescanned);
+			rescanMs += ElapsedMs(start);
+			registry.EndFrame();
+
+			moveSome(frame);
+			start = std::chrono::high_resolution_clock::now();
+			registry.UpdateBounds();
+			journalMs += ElapsedMs(start);
+			registry.EndFrame();
+		}
+
+		rescanMs /= frames;
+		journalMs /= frames;
+		printf("%7.1f%% %10.3f %10.3f %9.1fx\n", share * 100.0f, rescanMs, journalMs, rescanMs / std::max(journalMs, 1e-6));
+	}
+	return 0;
+}
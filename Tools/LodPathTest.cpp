@@ -0,0 +1,207 @@
+// Flies a camera out from a grid of spheres and back along a recorded path,
+// checking the level each one picks and that hysteresis keeps them from popping
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/LodPathTest.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o LodPathTest
+// - Usage: LodPathTest [frames], defaults to 2000 frames for the whole path
+// - Exits with 1 if a level is ever too coarse for the pixel error, or an entity
+//   switches back to the level it just left within a second of the path
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include "../LodChain.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Annonymous namespace for the scene and the path
+namespace
+{
+	// Out to 400 units away and back, with the small shake of a hand held camera
+	XMFLOAT3 GetPathPosition(int frame, int frames)
+	{
+		float t = (float)frame / frames;
+		float away = t < 0.5f ? t * 2.0f : (1.0f - t) * 2.0f;
+		return XMFLOAT3(13.5f, 2.0f, -5.0f - 395.0f * away + 0.3f * sinf(frame * 1.7f));
+	}
+
+	// Level changes, and changes straight back to the level an entity just left
+	struct LodChanges
+	{
+		unsigned int changes = 0;
+		unsigned int pops = 0;
+	};
+
+	// Tracks each entity's level over the frames SelectLods() runs
+	class LodTracker
+	{
+	public:
+		// Switching back within this many frames counts as a pop
+		static const int PopFrames = 60;
+
+		LodTracker(size_t count) : levels(count, 0), previous(count, 0), changedFrame(count, -PopFrames - 1) {}
+
+		void Update(EntityRegistry& registry, const std::vector<Entity>& entities, int frame, LodChanges& result)
+		{
+			for (size_t i = 0; i < entities.size(); i++)
+			{
+				unsigned int level = registry.GetLod(entities[i]);
+				if (level == levels[i])
+					continue;
+
+				result.changes++;
+				if (level == previous[i] && frame - changedFrame[i] <= PopFrames)
+					result.pops++;
+				previous[i] = levels[i];
+				levels[i] = level;
+				changedFrame[i] = frame;
+			}
+		}
+
+	private:
+		std::vector<unsigned int> levels;
+		std::vector<unsigned int> previous;
+		std::vector<int> changedFrame;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	int frames = argc > 1 ? std::max(2, atoi(argv[1])) : 2000;
+	JobSystem::Initialize();
+
+	// The game's chain, 32 slices around down to 4
+	LodChain chain;
+	std::vector<std::unique_ptr<Mesh>> levels;
+	const int slices[] = { 32, 16, 8, 4 };
+	for (int slice : slices)
+	{
+		levels.push_back(MakeSphereMesh(slice));
+		float dip = slice == slices[0] ? 0.0f : sinf(XM_PI / slice);
+		chain.AddLevel(levels.back().get(), dip * dip);
+	}
+
+	// Ten by ten spheres three units apart
+	EntityRegistry registry;
+	std::unique_ptr<Material> material = MakeMaterial();
+	std::vector<Entity> entities;
+	std::vector<unsigned int> indices;
+	for (unsigned int i = 0; i < 100; i++)
+	{
+		Entity entity = registry.Create(levels[0].get(), material.get());
+		registry.GetTransform(entity)->SetPosition((i % 10) * 3.0f, 0.0f, (i / 10) * 3.0f);
+		registry.SetLodChain(entity, &chain);
+		entities.push_back(entity);
+		indices.push_back(i);
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	// 720 lines and a 90 degree field of view
+	float projectionScale = 720.0f / (2.0f * tanf(XMConvertToRadians(90.0f) * 0.5f));
+
+	CheckCounter checks;
+	LodSettings settings;
+	auto trianglesOf = [&](Entity entity) { return chain.GetMesh(registry.GetLod(entity))->GetIndexCount() / 3; };
+
+	// Along the path, every level must keep its error on screen under the threshold
+	LodTracker tracker(entities.size());
+	LodChanges changes;
+	unsigned int tooCoarse = 0;
+	unsigned int nearTriangles = 0;
+	unsigned int farTriangles = 0;
+	printf("%6s %8s %9s  %s\n", "Frame", "Z", "Triangles", "Entities per level");
+	for (int frame = 0; frame < frames; frame++)
+	{
+		XMFLOAT3 camera = GetPathPosition(frame, frames);
+		registry.SelectLods(camera, projectionScale, settings, indices);
+		tracker.Update(registry, entities, frame, changes);
+
+		unsigned int triangles = 0;
+		unsigned int perLevel[LOD_MAX_LEVELS] = {};
+		for (Entity entity : entities)
+		{
+			unsigned int level = registry.GetLod(entity);
+			triangles += trianglesOf(entity);
+			perLevel[level]++;
+
+			// Nearest point of the bounds, as SelectLods() measures it
+			BoundingBox bounds = *registry.GetBounds(entity);
+			float dx = std::max(0.0f, fabsf(camera.x - bounds.Center.x) - bounds.Extents.x);
+			float dy = std::max(0.0f, fabsf(camera.y - bounds.Center.y) - bounds.Extents.y);
+			float dz = std::max(0.0f, fabsf(camera.z - bounds.Center.z) - bounds.Extents.z);
+			float distance = std::max(sqrtf(dx * dx + dy * dy + dz * dz), 0.0001f);
+			if (chain.GetError(level) * projectionScale / distance > settings.pixelError * 1.0001f)
+				tooCoarse++;
+		}
+
+		if (frame == 0)
+			nearTriangles = triangles;
+		if (frame == frames / 2)
+			farTriangles = triangles;
+		if (frame % (frames / 10) == 0)
+			printf("%6d %8.1f %9u  %u / %u / %u / %u\n", frame, camera.z, triangles, perLevel[0], perLevel[1], perLevel[2], perLevel[3]);
+	}
+	printf("%u level changes, %u back and forth\n", changes.changes, changes.pops);
+	checks.Check(tooCoarse == 0, "no level is too coarse for the pixel error");
+	checks.Check(changes.pops == 0, "no popping along the path");
+	checks.Check(farTriangles * 4 < nearTriangles, "far away draws far fewer triangles");
+
+	// Without hysteresis the shake alone flips entities sitting on a switch distance
+	settings.hysteresis = 0.0f;
+	for (Entity entity : entities)
+		registry.SetLodChain(entity, &chain);
+	LodTracker noHysteresisTracker(entities.size());
+	LodChanges noHysteresis;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		registry.SelectLods(GetPathPosition(frame, frames), projectionScale, settings, indices);
+		noHysteresisTracker.Update(registry, entities, frame, noHysteresis);
+	}
+	printf("Without hysteresis: %u level changes, %u back and forth\n", noHysteresis.changes, noHysteresis.pops);
+
+	// Hovering around a switch distance only switches once with hysteresis
+	for (float hysteresis : { 0.0f, 0.25f, 0.5f })
+	{
+		settings.hysteresis = hysteresis;
+		for (Entity entity : entities)
+			registry.SetLodChain(entity, &chain);
+		LodTracker hoverTracker(entities.size());
+		LodChanges hover;
+		for (int frame = 0; frame < 1000; frame++)
+		{
+			registry.SelectLods(XMFLOAT3(13.5f, 2.0f, -160.0f + 2.0f * sinf(frame * 0.3f)), projectionScale, settings, indices);
+			hoverTracker.Update(registry, entities, frame, hover);
+		}
+		printf("Hovering with hysteresis %.2f: %u level changes, %u back and forth\n", hysteresis, hover.changes, hover.pops);
+		if (hysteresis == LOD_DEFAULT_HYSTERESIS)
+			checks.Check(hover.pops == 0, "no popping while hovering with the default hysteresis");
+	}
+
+	// Each step of bias should only ever take detail away
+	unsigned int lastTriangles = ~0u;
+	bool fewer = true;
+	settings.hysteresis = LOD_DEFAULT_HYSTERESIS;
+	for (float bias : { -1.0f, 0.0f, 1.0f, 2.0f })
+	{
+		settings.bias = bias;
+		for (Entity entity : entities)
+			registry.SetLodChain(entity, &chain);
+		registry.SelectLods(XMFLOAT3(13.5f, 2.0f, -60.0f), projectionScale, settings, indices);
+		unsigned int triangles = 0;
+		for (Entity entity : entities)
+			triangles += trianglesOf(entity);
+		printf("Bias %+.0f: %u triangles 60 units away\n", bias, triangles);
+		fewer = fewer && triangles <= lastTriangles;
+		lastTriangles = triangles;
+	}
+	checks.Check(fewer, "more bias never adds triangles");
+	printf("\n");
+
+	JobSystem::ShutDown();
+	return checks.Report("LOD path");
+}
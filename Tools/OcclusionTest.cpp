@@ -0,0 +1,187 @@
+// Checks the CPU occlusion buffer on a synthetic scene, a wall standing on a big
+// floor with boxes scattered around and behind it, and times a frame of it
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/OcclusionTest.cpp Tools/Headless/HeadlessResources.cpp
+//       OcclusionBuffer.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o OcclusionTest
+// - Usage: OcclusionTest [boxes] [frames], defaults to 100000 boxes over 100 frames
+// - A box may only be culled if every point of it sampled on a grid really is behind
+//   an occluder, going by rays from the eye, the tool exits with 1 if any isn't
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../OcclusionBuffer.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Annonymous namespace for the scene and the reference test
+namespace
+{
+	// Occluders are the unit box scaled and moved into place
+	struct Occluder
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 scale;
+	};
+
+	XMFLOAT4X4 GetWorld(const Occluder& occluder)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixMultiply(
+			XMMatrixScaling(occluder.scale.x, occluder.scale.y, occluder.scale.z),
+			XMMatrixTranslation(occluder.position.x, occluder.position.y, occluder.position.z)));
+		return world;
+	}
+
+	// Does the segment from the eye to the point pass through the box before reaching the point
+	bool SegmentHits(const BoundingBox& box, XMFLOAT3 eye, XMFLOAT3 point)
+	{
+		float start = 0.0f;
+		float end = 0.999f;
+		float origin[3] = { eye.x, eye.y, eye.z };
+		float direction[3] = { point.x - eye.x, point.y - eye.y, point.z - eye.z };
+		float center[3] = { box.Center.x, box.Center.y, box.Center.z };
+		float extents[3] = { box.Extents.x, box.Extents.y, box.Extents.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float low = center[axis] - extents[axis];
+			float high = center[axis] + extents[axis];
+			if (std::abs(direction[axis]) < 1e-9f)
+			{
+				if (origin[axis] < low || origin[axis] > high)
+					return false;
+				continue;
+			}
+			float a = (low - origin[axis]) / direction[axis];
+			float b = (high - origin[axis]) / direction[axis];
+			start = std::max(start, std::min(a, b));
+			end = std::min(end, std::max(a, b));
+			if (start > end)
+				return false;
+		}
+		return true;
+	}
+
+	// Whether some sampled point of the box is on screen and not behind any occluder
+	// - The depth buffer is coarse, so occluders are grown by a pixel's width at the
+	//   point's distance, an edge pixel the rasterizer covered isn't a false cull
+	bool ReallyVisible(const BoundingBox& box, XMFLOAT3 eye, const XMFLOAT4X4& viewProjection, const std::vector<BoundingBox>& occluders, float pixelAngle)
+	{
+		for (int sample = 0; sample < 125; sample++)
+		{
+			XMFLOAT3 point(
+				box.Center.x + box.Extents.x * (sample % 5 / 2.0f - 1.0f),
+				box.Center.y + box.Extents.y * (sample / 5 % 5 / 2.0f - 1.0f),
+				box.Center.z + box.Extents.z * (sample / 25 / 2.0f - 1.0f));
+
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&point), XMLoadFloat4x4(&viewProjection)));
+			if (clip.z < 0.0f || clip.z > clip.w || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w)
+				continue;
+
+			XMFLOAT3 toPoint(point.x - eye.x, point.y - eye.y, point.z - eye.z);
+			float grow = std::sqrt(toPoint.x * toPoint.x + toPoint.y * toPoint.y + toPoint.z * toPoint.z) * pixelAngle;
+			bool hidden = false;
+			for (BoundingBox occluder : occluders)
+			{
+				occluder.Extents = XMFLOAT3(occluder.Extents.x + grow, occluder.Extents.y + grow, occluder.Extents.z + grow);
+				hidden = hidden || SegmentHits(occluder, eye, point);
+			}
+			if (!hidden)
+				return true;
+		}
+		return false;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 100;
+	JobSystem::Initialize();
+
+	std::unique_ptr<Mesh> cube = MakeBoxMesh();
+	XMFLOAT3 eye(0.0f, 2.0f, -5.0f);
+	float fov = XM_PIDIV2 * 0.8f;
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(eye.x, eye.y, eye.z, 1.0f), XMVectorSet(0.0f, -0.1f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(fov, 16.0f / 9.0f, 0.1f, 500.0f);
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+	float pixelAngle = std::tan(fov / 2) * 2.0f / OCCLUSION_HEIGHT;
+
+	// A wall across the view and a floor like the scene's scaled cube, its top at y = -2
+	const Occluder occluders[] = {
+		{ XMFLOAT3(0.0f, 3.0f, 10.0f), XMFLOAT3(20.0f, 10.0f, 1.0f) },
+		{ XMFLOAT3(0.0f, -12.0f, 0.0f), XMFLOAT3(400.0f, 20.0f, 400.0f) } };
+	std::vector<BoundingBox> occluderBounds;
+	for (const Occluder& occluder : occluders)
+		occluderBounds.push_back(BoundingBox(occluder.position, XMFLOAT3(occluder.scale.x / 2, occluder.scale.y / 2, occluder.scale.z / 2)));
+
+	// Boxes spread out behind the wall, some above and beside it, some under the floor
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+	std::vector<BoundingBox> boxes;
+	for (unsigned int i = 0; i < count; i++)
+		boxes.push_back(BoundingBox(XMFLOAT3(spread(random) * 60.0f, spread(random) * 8.0f + 1.0f, spread(random) * 60.0f + 40.0f), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+
+	CheckCounter checks;
+	OcclusionBuffer occlusion;
+
+	// Nothing drawn, nothing hidden
+	occlusion.Begin(viewProjection);
+	occlusion.Rasterize();
+	bool anyHidden = false;
+	for (unsigned int i = 0; i < std::min(count, 1000u); i++)
+		anyHidden = anyHidden || !occlusion.IsVisible(boxes[i]);
+	checks.Check(!anyHidden, "an empty buffer hides nothing");
+
+	// A frame is filling the buffer and testing every box
+	double rasterizeMs = 0.0;
+	double testMs = 0.0;
+	std::vector<char> visible(count);
+	for (int frame = 0; frame < frames; frame++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		occlusion.Begin(viewProjection);
+		for (const Occluder& occluder : occluders)
+			occlusion.AddOccluder(cube.get(), GetWorld(occluder));
+		occlusion.Rasterize();
+		rasterizeMs += ElapsedMs(start);
+
+		start = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < count; i++)
+			visible[i] = occlusion.IsVisible(boxes[i]);
+		testMs += ElapsedMs(start);
+	}
+
+	unsigned int culled = 0;
+	unsigned int falseCulls = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (visible[i])
+			continue;
+		culled++;
+		if (ReallyVisible(boxes[i], eye, viewProjection, occluderBounds, pixelAngle))
+		{
+			if (falseCulls++ < 5)
+				printf("Culled a visible box at %.2f %.2f %.2f\n", boxes[i].Center.x, boxes[i].Center.y, boxes[i].Center.z);
+		}
+	}
+	checks.Check(falseCulls == 0, "nothing visible is culled");
+	checks.Check(culled > count / 10, "the wall and floor hide a good share of the boxes");
+
+	// Right behind the middle of the wall is hidden, right in front of it isn't
+	checks.Check(!occlusion.IsVisible(BoundingBox(XMFLOAT3(0.0f, 3.0f, 14.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))), "box right behind the wall is culled");
+	checks.Check(occlusion.IsVisible(BoundingBox(XMFLOAT3(0.0f, 3.0f, 7.0f), XMFLOAT3(1.0f, 1.0f, 1.0f))), "box in front of the wall is visible");
+	checks.Check(occlusion.IsVisible(BoundingBox(eye, XMFLOAT3(1.0f, 1.0f, 1.0f))), "box through the near plane is visible");
+
+	printf("%u boxes, %u occluder triangles\n", count, occlusion.GetTriangleCount());
+	printf("Culled %.1f%% (%u), %u wrongly\n", 100.0 * culled / count, culled, falseCulls);
+	printf("Per frame: %.3f ms rasterizing, %.3f ms testing, %.3f ms total\n\n", rasterizeMs / frames, testMs / frames, (rasterizeMs + testMs) / frames);
+
+	JobSystem::ShutDown();
+	return checks.Report("OcclusionBuffer");
+}
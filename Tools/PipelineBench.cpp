@@ -0,0 +1,160 @@
+// Times whole frames through the frame pipeline, with the render stage recording
+// every draw and playing it on the null backend, first with updating and drawing
+// one after another, then with drawing moved onto the render thread
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/PipelineBench.cpp Tools/Headless/HeadlessResources.cpp
+//       FramePipeline.cpp RenderPacket.cpp EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp
+//       SpatialGrid.cpp SpatialIndex.cpp BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp
+//       JobSystem.cpp CommandList.cpp NullBackend.cpp RenderStateCache.cpp
+//       ImGui/imgui.cpp ImGui/imgui_draw.cpp ImGui/imgui_tables.cpp ImGui/imgui_widgets.cpp -pthread -o PipelineBench
+// - Usage: PipelineBench [entities] [frames], defaults to 100000 entities over 120 frames
+// - With both stages about as long, the threaded frame should come close to
+//   the longer of the two, rather than their sum, given a spare core
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../FramePipeline.h"
+#include "../NullBackend.h"
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+using namespace DirectX;
+
+// Annonymous namespace for the two stages
+namespace
+{
+	// Addresses standing in for the Direct3D objects a frame binds
+	int targetStandIn;
+	int depthStandIn;
+	int vertexShaderStandIn;
+	int constantsStandIn;
+
+	struct Scene
+	{
+		EntityRegistry registry;
+		std::vector<Entity> entities;
+		std::vector<unsigned int> visible;
+		XMFLOAT4X4 viewProjection;
+	};
+
+	// Everything Game::Draw() does on the main thread, minus the UI
+	void Update(Scene& scene, RenderPacket& packet, int frame)
+	{
+		// A tenth of the scene bobs up and down
+		for (size_t i = 0; i < scene.entities.size(); i += 10)
+		{
+			Transform* transform = scene.registry.GetTransform(scene.entities[i]);
+			XMFLOAT3 position = transform->GetPosition();
+			transform->SetPosition(position.x, position.y + (frame & 1 ? 0.1f : -0.1f), position.z);
+		}
+
+		scene.registry.UpdateBounds();
+		scene.registry.CullFrustum(Frustum(scene.viewProjection), scene.visible);
+		scene.registry.BuildDrawList(scene.visible, scene.viewProjection, nullptr, packet.drawList);
+		packet.viewProjection = scene.viewProjection;
+		scene.registry.EndFrame();
+	}
+
+	// Everything Game::Render() does, recorded and played on the null backend
+	struct Renderer
+	{
+		CommandList commands;
+		NullBackend backend;
+		std::atomic<unsigned int> errors{ 0 };
+
+		void Render(RenderPacket& packet)
+		{
+			const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			commands.Reset();
+			commands.ClearTarget((ID3D11RenderTargetView*)&targetStandIn, clearColor);
+			commands.ClearDepth((ID3D11DepthStencilView*)&depthStandIn, 1.0f);
+			commands.SetTargets((ID3D11RenderTargetView*)&targetStandIn, (ID3D11DepthStencilView*)&depthStandIn);
+			commands.SetViewport(1280.0f, 720.0f);
+			commands.SetTopology(RENDER_TOPOLOGY_TRIANGLE_LIST);
+			commands.BindShader(RENDER_STAGE_VERTEX, (ISimpleShader*)&vertexShaderStandIn);
+
+			// Per object constants, then the mesh's buffers and the draw
+			for (const DrawItem& item : packet.drawList)
+			{
+				commands.UpdateConstants((ID3D11Buffer*)&constantsStandIn, &item.world, sizeof(XMFLOAT4X4) * 3);
+				item.mesh->Draw(commands);
+			}
+
+			backend.Reset();
+			backend.Execute(commands);
+			errors += backend.GetErrorCount();
+		}
+	};
+
+	struct PipelineResult
+	{
+		double frameMs = 0.0;
+		double updateMs = 0.0;
+		double renderMs = 0.0;
+	};
+
+	PipelineResult RunFrames(Scene& scene, FramePipeline& pipeline, int frames)
+	{
+		PipelineResult result;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			RenderPacket& packet = pipeline.BeginFrame();
+			auto updateStart = std::chrono::high_resolution_clock::now();
+			Update(scene, packet, frame);
+			result.updateMs += ElapsedMs(updateStart);
+			result.renderMs += pipeline.GetRenderMs();
+			pipeline.Submit();
+		}
+		pipeline.Flush();
+		result.frameMs = ElapsedMs(start) / frames;
+		result.updateMs /= frames;
+		result.renderMs /= frames;
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 120;
+
+	std::unique_ptr<Mesh> mesh = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+
+	// A grid of boxes in front of a camera that sees about half of them
+	Scene scene;
+	scene.registry.Reserve(count);
+	unsigned int side = (unsigned int)std::ceil(std::sqrt((double)count));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		scene.entities.push_back(scene.registry.Create(mesh.get(), material.get()));
+		scene.registry.GetTransform(scene.entities.back())->SetPosition((i % side) * 2.0f - side, 0.0f, (i / side) * 2.0f);
+	}
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 20.0f, -10.0f, 0.0f), XMVectorSet(0.0f, -0.3f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, side * 2.0f);
+	XMStoreFloat4x4(&scene.viewProjection, XMMatrixMultiply(view, projection));
+
+	Renderer renderer;
+	FramePipeline pipeline;
+	pipeline.SetRenderer([&](RenderPacket& packet) { renderer.Render(packet); });
+
+	// A couple of frames first so every list and packet has grown to size
+	RunFrames(scene, pipeline, 2);
+	printf("%u entities, %zu drawn, %d frames, average ms\n", count, scene.visible.size(), frames);
+	printf("%-10s %10s %10s %10s\n", "", "Frame", "Update", "Render");
+
+	PipelineResult serial = RunFrames(scene, pipeline, frames);
+	printf("%-10s %10.3f %10.3f %10.3f\n", "Serial", serial.frameMs, serial.updateMs, serial.renderMs);
+
+	pipeline.SetThreaded(true);
+	PipelineResult threaded = RunFrames(scene, pipeline, frames);
+	pipeline.SetThreaded(false);
+	printf("%-10s %10.3f %10.3f %10.3f\n", "Threaded", threaded.frameMs, threaded.updateMs, threaded.renderMs);
+
+	printf("\nThreaded frame: %.2fx the serial one, ideal with a spare core: %.2fx\n",
+		threaded.frameMs / serial.frameMs, std::max(serial.updateMs, serial.renderMs) / serial.frameMs);
+	printf("Null backend: %u draws a frame, %u errors\n", renderer.backend.GetDrawCount(), renderer.errors.load());
+	return renderer.errors.load() == 0 ? 0 : 1;
+}
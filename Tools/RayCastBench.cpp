@@ -0,0 +1,106 @@
+// Times picking a triangle with EntityRegistry::RayCast() through each kind of
+// scene index, on a field of spheres seen from above like the editor camera
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/RayCastBench.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o RayCastBench
+// - Usage: RayCastBench [entities] [rays], defaults to 100000 entities and 2000 rays
+// - Sorting every bounds the ray enters is the reference, the tool exits with 1
+//   if either index picks another entity or distance for any ray
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include "../SpatialIndex.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 100000;
+	unsigned int rayCount = argc > 2 ? (unsigned int)std::max(1, atoi(argv[2])) : 2000;
+	JobSystem::Initialize();
+
+	// Squashed and turned spheres on a square grid three units apart
+	std::unique_ptr<Mesh> sphere = MakeSphereMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+	EntityRegistry registry;
+	registry.Reserve(count);
+	int side = (int)ceil(sqrt((double)count));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		Transform* transform = registry.GetTransform(registry.Create(sphere.get(), material.get()));
+		transform->SetPosition((float)((int)i % side - side / 2) * 3.0f, spread(random) * 0.5f, (float)((int)i / side) * 3.0f + 5.0f);
+		float scale = 0.6f + 0.2f * (spread(random) + 1.0f);
+		transform->SetScale(scale, scale * (1.0f + 0.3f * spread(random)), scale);
+		transform->SetRotation(spread(random), spread(random), spread(random));
+	}
+	registry.UpdateBounds();
+	registry.EndFrame();
+
+	// Rays through random points on the screen of a camera looking down over the field
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 12.0f, -10.0f, 1.0f), XMVector3Normalize(XMVectorSet(0.0f, -0.35f, 1.0f, 0.0f)), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(90.0f), 16.0f / 9.0f, 0.01f, 1000.0f);
+	XMMATRIX unproject = XMMatrixInverse(nullptr, XMMatrixMultiply(view, projection));
+	std::vector<XMFLOAT3> origins(rayCount);
+	std::vector<XMFLOAT3> directions(rayCount);
+	for (unsigned int i = 0; i < rayCount; i++)
+	{
+		float x = spread(random);
+		float y = spread(random);
+		XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(x, y, 0.0f, 1.0f), unproject);
+		XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(x, y, 1.0f, 1.0f), unproject);
+		XMStoreFloat3(&origins[i], nearPoint);
+		XMStoreFloat3(&directions[i], XMVector3Normalize(XMVectorSubtract(farPoint, nearPoint)));
+	}
+
+	CheckCounter checks;
+	std::vector<RayHit> reference(rayCount);
+	const char* names[] = { "None (sorted)", "AABB tree", "Grid" };
+	printf("%u entities, %u triangles each, %u rays\n\n", count, sphere->GetIndexCount() / 3, rayCount);
+	printf("%-14s %6s %10s %10s %10s\n", "Index", "Hits", "Wrong", "Each us", "Worst us");
+	for (int type : { SPATIAL_INDEX_NONE, SPATIAL_INDEX_TREE, SPATIAL_INDEX_GRID })
+	{
+		registry.SetSpatialIndex(type);
+
+		// A few frames so the grid can settle on its cell size
+		for (int frame = 0; frame < 5; frame++)
+		{
+			registry.UpdateBounds();
+			registry.EndFrame();
+		}
+
+		unsigned int hits = 0;
+		unsigned int wrong = 0;
+		double totalUs = 0.0;
+		double worstUs = 0.0;
+		for (unsigned int i = 0; i < rayCount; i++)
+		{
+			RayHit hit;
+			auto start = std::chrono::high_resolution_clock::now();
+			bool found = registry.RayCast(origins[i], directions[i], 1000.0f, hit);
+			double us = ElapsedMs(start) * 1000.0;
+			totalUs += us;
+			worstUs = std::max(worstUs, us);
+			hits += found;
+
+			if (type == SPATIAL_INDEX_NONE)
+				reference[i] = hit;
+			else if (hit.entity != reference[i].entity || fabsf(hit.distance - reference[i].distance) > 1e-4f)
+				wrong++;
+		}
+		printf("%-14s %6u %10u %10.2f %10.2f\n", names[type], hits, wrong, totalUs / rayCount, worstUs);
+		if (type != SPATIAL_INDEX_NONE)
+			checks.Check(wrong == 0, "index picks match the sorted reference");
+	}
+	printf("\n");
+
+	JobSystem::ShutDown();
+	return checks.Report("RayCast");
+}
@@ -0,0 +1,168 @@
+// Times recording the opaque pass split into slices, one command list per slice,
+// from one to sixteen threads, the way Game::Render() records with deferred contexts
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/RecordBench.cpp Tools/Headless/HeadlessResources.cpp
+//       RenderQueue.cpp JobSystem.cpp CommandList.cpp NullBackend.cpp RenderStateCache.cpp -pthread -o RecordBench
+// - Usage: RecordBench [draws] [max threads] [runs], defaults to 20000 draws, 16 threads and
+//   the best of 20 runs
+// - Every slice is checked on a freshly reset null backend, like a deferred context that
+//   starts with nothing bound, the tool exits with 1 if any of them couldn't be played
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../NullBackend.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <algorithm>
+
+using namespace DirectX;
+
+// Annonymous namespace for the recorded pass
+namespace
+{
+	// Addresses standing in for the Direct3D objects the pass binds
+	int targetStandIn;
+	int depthStandIn;
+	int vertexShaderStandIn;
+	int pixelShaderStandIn;
+	int textureStandIn;
+	int samplerStandIn;
+	int materialConstantsStandIn;
+	int objectConstantsStandIn;
+
+	// What each draw uploads, the same four matrices as the PerObject buffer
+	struct ObjectConstants
+	{
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 worldInvTranspose;
+		XMFLOAT4X4 worldViewProjection;
+		XMFLOAT4X4 shadowWorldViewProjection;
+	};
+
+	struct Draw
+	{
+		Mesh* mesh;
+		Material* material;
+		ObjectConstants constants;
+	};
+
+	// Everything a slice needs before its first draw, a deferred context has nothing bound
+	void SetMainPass(CommandList& list, bool topology)
+	{
+		list.SetViewport(1280.0f, 720.0f);
+		list.SetTargets((ID3D11RenderTargetView*)&targetStandIn, (ID3D11DepthStencilView*)&depthStandIn);
+		if (topology)
+			list.SetTopology(RENDER_TOPOLOGY_TRIANGLE_LIST);
+		list.SetRasterizerState(nullptr);
+		list.BindShader(RENDER_STAGE_VERTEX, (ISimpleShader*)&vertexShaderStandIn);
+		list.BindShader(RENDER_STAGE_PIXEL, (ISimpleShader*)&pixelShaderStandIn);
+		list.BindSampler(RENDER_STAGE_PIXEL, 0, (ID3D11SamplerState*)&samplerStandIn);
+	}
+
+	// Draws sorted by material, so the material's constants and texture only change between runs
+	void RecordRange(CommandList& list, const std::vector<Draw>& draws, unsigned int start, unsigned int end)
+	{
+		Material* bound = nullptr;
+		for (unsigned int i = start; i < end; i++)
+		{
+			const Draw& draw = draws[i];
+			if (draw.material != bound)
+			{
+				XMFLOAT4 color = draw.material->GetColor();
+				list.BindTexture(RENDER_STAGE_PIXEL, 0, (ID3D11ShaderResourceView*)&textureStandIn);
+				list.UpdateConstants((ID3D11Buffer*)&materialConstantsStandIn, &color, sizeof(XMFLOAT4));
+				bound = draw.material;
+			}
+			list.UpdateConstants((ID3D11Buffer*)&objectConstantsStandIn, &draw.constants, sizeof(ObjectConstants));
+			draw.mesh->Draw(list);
+		}
+	}
+
+	// Every slice on its own backend, reset first as a deferred context would be
+	unsigned int CountErrors(std::vector<CommandList>& lists, unsigned int count)
+	{
+		NullBackend backend;
+		unsigned int errors = 0;
+		for (unsigned int slice = 0; slice < count; slice++)
+		{
+			backend.Reset();
+			backend.Execute(lists[slice]);
+			errors += backend.GetErrorCount();
+		}
+		return errors;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int drawCount = argc > 1 ? (unsigned int)std::max(1, atoi(argv[1])) : 20000;
+	unsigned int maxThreads = argc > 2 ? (unsigned int)std::clamp(atoi(argv[2]), 1, 64) : 16;
+	int runs = argc > 3 ? std::max(1, atoi(argv[3])) : 20;
+
+	// A few meshes and materials, in the order a sorted draw list would have them
+	std::vector<std::unique_ptr<Mesh>> meshes;
+	std::vector<std::unique_ptr<Material>> materials;
+	for (int i = 0; i < 8; i++)
+	{
+		meshes.push_back(i % 2 ? MakeBoxMesh() : MakeSphereMesh(8 + i * 4));
+		materials.push_back(MakeMaterial(XMFLOAT4(i / 8.0f, 0.5f, 1.0f, 1.0f)));
+	}
+	std::vector<Draw> draws(drawCount);
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		draws[i].material = materials[i * materials.size() / drawCount].get();
+		draws[i].mesh = meshes[i % meshes.size()].get();
+		XMStoreFloat4x4(&draws[i].constants.world, XMMatrixTranslation((float)i, 0.0f, 0.0f));
+	}
+
+	CheckCounter checks;
+	std::vector<CommandList> lists(maxThreads);
+
+	// Without a topology of their own, slices can't be played on a deferred context
+	lists[0].Reset();
+	SetMainPass(lists[0], false);
+	RecordRange(lists[0], draws, 0, std::min(drawCount, 16u));
+	checks.Check(CountErrors(lists, 1) > 0, "a slice without a topology is caught");
+
+	printf("%u draws, best of %d runs, one slice per thread\n\n", drawCount, runs);
+	printf("%7s %12s %9s %10s %10s\n", "Threads", "Record ms", "Speedup", "Commands", "KB");
+	double singleMs = 0.0;
+	unsigned int errors = 0;
+	for (unsigned int threads = 1; threads <= maxThreads; threads++)
+	{
+		if (threads > 1)
+			JobSystem::Initialize(threads - 1);
+
+		double ms = BestOfMs(runs, [&]()
+			{
+				JobSystem::ParallelFor(threads, [&](unsigned int start, unsigned int end)
+					{
+						for (unsigned int slice = start; slice < end; slice++)
+						{
+							CommandList& list = lists[slice];
+							list.Reset();
+							SetMainPass(list, true);
+							RecordRange(list, draws, drawCount * slice / threads, drawCount * (slice + 1) / threads);
+						}
+					}, 1);
+			});
+		if (threads == 1)
+			singleMs = ms;
+
+		unsigned int commands = 0;
+		size_t bytes = 0;
+		for (unsigned int slice = 0; slice < threads; slice++)
+		{
+			commands += lists[slice].Count();
+			bytes += lists[slice].GetMemoryUsed();
+		}
+		errors += CountErrors(lists, threads);
+		printf("%7u %12.3f %8.2fx %10u %10.1f\n", threads, ms, singleMs / ms, commands, bytes / 1024.0);
+
+		if (threads > 1)
+			JobSystem::ShutDown();
+	}
+	printf("\n");
+	checks.Check(errors == 0, "every slice plays on a context with nothing bound");
+
+	return checks.Report("Recording");
+}
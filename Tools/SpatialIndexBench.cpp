@@ -0,0 +1,258 @@
+// Runs the AABB tree and the spatial grid through the same frames for several
+// motion profiles, and says which index costs less per frame for each
+// - Only needs the index and frustum code, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -I. Tools/SpatialIndexBench.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp Frustum.cpp -o SpatialIndexBench
+// - Usage: SpatialIndexBench [entities] [frames], defaults to 100000 entities over 30 frames
+// - A frame updates whatever moved, tunes the grid, then runs a frustum query
+//   and a neighbour query around each of a hundred entities
+// - The tool exits with 1 if either index misses an entity the frustum holds, or
+//   if the grid's queries are no faster than testing every one of its cells
+#include "ToolHelpers.h"
+#include "../AABBTree.h"
+#include "../SpatialGrid.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Annonymous namespace for the motion profiles
+namespace
+{
+	struct MotionProfile
+	{
+		const char* name;
+
+		// Share of entities moved each frame, and how far they go
+		float movingShare;
+		bool travels;
+	};
+
+	struct FrameCost
+	{
+		double updateMs = 0.0;
+		double queryMs = 0.0;
+		size_t found = 0;
+
+		// Quickest frame of queries, steadier than the average for comparing against
+		double bestQueryMs = 1e30;
+
+		// Entities the last frame's frustum holds that the index didn't hand back
+		size_t missed = 0;
+	};
+
+	struct Scene
+	{
+		std::vector<BoundingBox> boxes;
+		std::vector<XMFLOAT3> velocities;
+		float side;
+		Frustum frustum;
+	};
+
+	// Bobbing stays within a tree leaf's fat box, travelling crosses the scene
+	void Move(Scene& scene, const MotionProfile& profile, int frame, std::vector<unsigned int>& moved)
+	{
+		moved.clear();
+		unsigned int count = (unsigned int)scene.boxes.size();
+		unsigned int moving = (unsigned int)(count * profile.movingShare);
+		unsigned int step = moving > 0 ? count / moving : count;
+		for (unsigned int m = 0; m < moving; m++)
+		{
+			unsigned int i = m * step;
+			BoundingBox& box = scene.boxes[i];
+			if (profile.travels)
+			{
+				XMFLOAT3& velocity = scene.velocities[i];
+				box.Center.x += velocity.x;
+				box.Center.z += velocity.z;
+				if (std::abs(box.Center.x) > scene.side / 2)
+					velocity.x = -velocity.x;
+				if (std::abs(box.Center.z) > scene.side / 2)
+					velocity.z = -velocity.z;
+			}
+			else
+				box.Center.y += frame & 1 ? 0.05f : -0.05f;
+			moved.push_back(i);
+		}
+	}
+
+	FrameCost RunFrames(ISpatialIndex& index, SpatialGrid* grid, Scene scene, const MotionProfile& profile, int frames)
+	{
+		index.Clear();
+		for (unsigned int i = 0; i < scene.boxes.size(); i++)
+			index.Insert(MakeEntity(i, 0), scene.boxes[i]);
+		if (grid)
+			grid->Tune();
+
+		FrameCost cost;
+		std::vector<unsigned int> moved;
+		std::vector<Entity> results;
+		for (int frame = 0; frame < frames; frame++)
+		{
+			Move(scene, profile, frame, moved);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			for (unsigned int i : moved)
+				index.Update(MakeEntity(i, 0), scene.boxes[i]);
+			if (grid)
+				grid->Tune();
+			cost.updateMs += ElapsedMs(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			index.QueryFrustum(scene.frustum, results);
+			cost.found += results.size();
+			for (unsigned int n = 0; n < 100; n++)
+			{
+				index.QuerySphere(scene.boxes[n * (scene.boxes.size() / 100)].Center, 5.0f, results);
+				cost.found += results.size();
+			}
+			double queryMs = ElapsedMs(start);
+			cost.queryMs += queryMs;
+			cost.bestQueryMs = std::min(cost.bestQueryMs, queryMs);
+		}
+
+		// Loose candidates are fine, missing anything isn't
+		index.QueryFrustum(scene.frustum, results);
+		std::vector<bool> returned(scene.boxes.size());
+		for (Entity entity : results)
+			returned[EntityIndex(entity)] = true;
+		for (unsigned int i = 0; i < scene.boxes.size(); i++)
+			cost.missed += !returned[i] && scene.frustum.Intersects(scene.boxes[i]);
+
+		cost.updateMs /= frames;
+		cost.queryMs /= frames;
+		return cost;
+	}
+
+	// Same frame of queries by testing every occupied cell's loose box in turn, the
+	// way the grid answered them before it looked cells up by their coordinates
+	double TimeCellScan(const Scene& scene, float cellSize)
+	{
+		struct ScanCell
+		{
+			int x, y, z;
+			XMFLOAT3 reach;
+			std::vector<unsigned int> members;
+			BoundingBox box;
+		};
+
+		std::unordered_map<unsigned long long, unsigned int> lookup;
+		std::vector<ScanCell> cells;
+		for (unsigned int i = 0; i < scene.boxes.size(); i++)
+		{
+			const BoundingBox& box = scene.boxes[i];
+			int x = (int)floorf(box.Center.x / cellSize);
+			int y = (int)floorf(box.Center.y / cellSize);
+			int z = (int)floorf(box.Center.z / cellSize);
+			unsigned long long key = ((unsigned long long)(x + (1 << 20)) << 42) | ((unsigned long long)(y + (1 << 20)) << 21) | (unsigned long long)(z + (1 << 20));
+			auto it = lookup.find(key);
+			if (it == lookup.end())
+			{
+				it = lookup.emplace(key, (unsigned int)cells.size()).first;
+				cells.push_back({ x, y, z, XMFLOAT3(0, 0, 0), {}, BoundingBox() });
+			}
+
+			ScanCell& cell = cells[it->second];
+			cell.members.push_back(i);
+			cell.reach = XMFLOAT3(std::max(cell.reach.x, box.Extents.x), std::max(cell.reach.y, box.Extents.y), std::max(cell.reach.z, box.Extents.z));
+		}
+
+		float half = cellSize * 0.5f;
+		for (ScanCell& cell : cells)
+		{
+			cell.box = BoundingBox(
+				XMFLOAT3((cell.x + 0.5f) * cellSize, (cell.y + 0.5f) * cellSize, (cell.z + 0.5f) * cellSize),
+				XMFLOAT3(half + cell.reach.x, half + cell.reach.y, half + cell.reach.z));
+		}
+
+		std::vector<Entity> results;
+		return BestOfMs(3, [&]()
+			{
+				results.clear();
+				for (const ScanCell& cell : cells)
+				{
+					if (scene.frustum.Contains(cell.box) != DISJOINT)
+					{
+						for (unsigned int i : cell.members)
+							results.push_back(MakeEntity(i, 0));
+					}
+				}
+
+				for (unsigned int n = 0; n < 100; n++)
+				{
+					results.clear();
+					XMFLOAT3 center = scene.boxes[n * (scene.boxes.size() / 100)].Center;
+					for (const ScanCell& cell : cells)
+					{
+						if (SpatialMath::IntersectsSphere(cell.box, center, 5.0f))
+						{
+							for (unsigned int i : cell.members)
+								results.push_back(MakeEntity(i, 0));
+						}
+					}
+				}
+			});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(100, atoi(argv[1])) : 100000;
+	int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 30;
+
+	// Unit boxes scattered over a square about three boxes apart, each with its own heading
+	Scene scene;
+	std::mt19937 random(1);
+	scene.side = std::sqrt((float)count) * 3.0f;
+	std::uniform_real_distribution<float> spread(-scene.side / 2, scene.side / 2);
+	std::uniform_real_distribution<float> speed(-0.5f, 0.5f);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		scene.boxes.push_back(BoundingBox(XMFLOAT3(spread(random), 0.0f, spread(random)), XMFLOAT3(0.5f, 0.5f, 0.5f)));
+		scene.velocities.push_back(XMFLOAT3(speed(random), 0.0f, speed(random)));
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 10.0f, -scene.side / 2, 0.0f), XMVectorSet(0.0f, -0.2f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 300.0f);
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+	scene.frustum = Frustum(viewProjection);
+
+	const MotionProfile profiles[] = {
+		{ "Static", 0.0f, false },
+		{ "1% bobbing", 0.01f, false },
+		{ "10% bobbing", 0.1f, false },
+		{ "1% travelling", 0.01f, true },
+		{ "10% travelling", 0.1f, true },
+		{ "50% travelling", 0.5f, true },
+		{ "Swarm, all travelling", 1.0f, true } };
+
+	printf("%u entities, %d frames, average ms a frame\n", count, frames);
+	printf("%-22s | %-25s | %-25s | %-9s | %s\n", "", "Tree: update, query", "Grid: update, query", "Cell scan", "Better");
+
+	CheckCounter checks;
+	AABBTree tree;
+	SpatialGrid grid;
+	for (const MotionProfile& profile : profiles)
+	{
+		FrameCost treeCost = RunFrames(tree, nullptr, scene, profile, frames);
+		FrameCost gridCost = RunFrames(grid, &grid, scene, profile, frames);
+		double scanMs = TimeCellScan(scene, grid.GetCellSize());
+		double treeMs = treeCost.updateMs + treeCost.queryMs;
+		double gridMs = gridCost.updateMs + gridCost.queryMs;
+
+		printf("%-22s | %7.3f %7.3f = %7.3f | %7.3f %7.3f = %7.3f | %9.3f | %s %.2fx\n", profile.name,
+			treeCost.updateMs, treeCost.queryMs, treeMs,
+			gridCost.updateMs, gridCost.queryMs, gridMs, scanMs,
+			treeMs <= gridMs ? "Tree" : "Grid", std::max(treeMs, gridMs) / std::max(std::min(treeMs, gridMs), 1e-6));
+
+		// Both hand back loose candidates, so they can differ, but never by missing anything
+		checks.Check(treeCost.found > 0 && gridCost.found > 0, "both indexes find entities");
+		checks.Check(treeCost.missed == 0 && gridCost.missed == 0, "neither index misses an entity in the frustum");
+		checks.Check(gridCost.bestQueryMs < scanMs, "grid queries beat testing every cell");
+	}
+	printf("\nGrid cell size after the last run: %.2f, %u cells\n\n", grid.GetCellSize(), grid.GetCellCount());
+	return checks.Report("SpatialIndex");
+}
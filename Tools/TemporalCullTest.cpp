@@ -0,0 +1,147 @@
+// Follows a camera path through a busy scene and checks each frame that
+// CullFrustumTemporal() keeps every entity CullFrustum() finds visible
+// - Builds headless, from the repository's root with something like:
+//   g++ -std=c++20 -O2 -I<DirectXMath> -ITools/Headless -I. Tools/TemporalCullTest.cpp Tools/Headless/HeadlessResources.cpp
+//       EntityRegistry.cpp Transform.cpp TransformJournal.cpp Frustum.cpp AABBTree.cpp SpatialGrid.cpp SpatialIndex.cpp
+//       BatchCull.cpp BatchTransform.cpp OcclusionBuffer.cpp LodChain.cpp RenderQueue.cpp JobSystem.cpp CommandList.cpp -pthread -o TemporalCullTest
+// - Usage: TemporalCullTest [entities] [frames], defaults to 100000 entities over 2000 frames
+// - The path walks slowly, runs, turns, jumps somewhere else and changes its field of view,
+//   while a share of the entities move and some are replaced, the tool exits with 1
+//   on any frame where an entity the full test keeps is culled, or if temporal culling
+//   takes longer than the full test over the whole path
+#include "ToolHelpers.h"
+#include "Headless/HeadlessResources.h"
+#include "../EntityRegistry.h"
+#include "../JobSystem.h"
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Annonymous namespace for the camera path
+namespace
+{
+	struct PathCamera
+	{
+		XMFLOAT3 eye = XMFLOAT3(0.0f, 5.0f, 0.0f);
+		float yaw = 0.0f;
+		float pitch = 0.0f;
+		float fieldOfView = 90.0f;
+
+		Frustum GetFrustum() const
+		{
+			XMVECTOR direction = XMVectorSet(cosf(pitch) * cosf(yaw), sinf(pitch), cosf(pitch) * sinf(yaw), 0.0f);
+			XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), direction, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(fieldOfView), 16.0f / 9.0f, 0.1f, 250.0f);
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+			return Frustum(viewProjection);
+		}
+	};
+
+	// Walks for 300 frames then runs for 300, always turning a little,
+	// jumps every 500 frames and zooms in or out every 700
+	void StepPath(PathCamera& camera, int frame, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+		float speed = (frame / 300) % 2 ? 0.3f : 0.02f;
+		camera.yaw += 0.004f + spread(random) * 0.002f;
+		camera.pitch = 0.2f * sinf(frame * 0.01f);
+		camera.eye.x += speed * cosf(camera.yaw);
+		camera.eye.z += speed * sinf(camera.yaw);
+		if (frame % 500 == 499)
+		{
+			camera.eye = XMFLOAT3(spread(random) * 200.0f, spread(random) * 10.0f, spread(random) * 200.0f);
+			camera.yaw = spread(random) * 3.0f;
+		}
+		if (frame % 700 == 350)
+			camera.fieldOfView = camera.fieldOfView == 90.0f ? 60.0f : 90.0f;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int count = argc > 1 ? (unsigned int)std::max(100, atoi(argv[1])) : 100000;
+	int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 2000;
+	JobSystem::Initialize();
+
+	std::unique_ptr<Mesh> cube = MakeBoxMesh();
+	std::unique_ptr<Material> material = MakeMaterial();
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> spread(-1.0f, 1.0f);
+	EntityRegistry registry;
+	registry.Reserve(count);
+	std::vector<Entity> entities;
+	auto spawn = [&]()
+		{
+			Entity entity = registry.Create(cube.get(), material.get());
+			registry.GetTransform(entity)->SetPosition(spread(random) * 300.0f, spread(random) * 30.0f, spread(random) * 300.0f);
+			registry.GetTransform(entity)->SetRotation(spread(random), spread(random), spread(random));
+			return entity;
+		};
+	for (unsigned int i = 0; i < count; i++)
+		entities.push_back(spawn());
+
+	CheckCounter checks;
+	PathCamera camera;
+	std::vector<unsigned int> full;
+	std::vector<unsigned int> temporal;
+	std::vector<unsigned int> missing;
+	int badFrames = 0;
+	unsigned long long falseCulls = 0;
+	unsigned long long extra = 0;
+	double fullMs = 0.0;
+	double temporalMs = 0.0;
+	double skipped = 0.0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		StepPath(camera, frame, random);
+
+		// One in a hundred entities shuffles about, and one is replaced now and then
+		for (unsigned int i = 0; i < count / 100; i++)
+		{
+			Transform* transform = registry.GetTransform(entities[random() % count]);
+			XMFLOAT3 position = transform->GetPosition();
+			transform->SetPosition(position.x + spread(random) * 0.5f, position.y, position.z + spread(random) * 0.5f);
+		}
+		if (frame % 100 == 50)
+		{
+			Entity& entity = entities[random() % count];
+			registry.Destroy(entity);
+			entity = spawn();
+		}
+
+		Frustum frustum = camera.GetFrustum();
+		registry.UpdateBounds();
+		auto start = std::chrono::high_resolution_clock::now();
+		registry.CullFrustum(frustum, full);
+		fullMs += ElapsedMs(start);
+		start = std::chrono::high_resolution_clock::now();
+		registry.CullFrustumTemporal(frustum, camera.eye, temporal);
+		temporalMs += ElapsedMs(start);
+		skipped += registry.GetTemporalSkipShare();
+
+		// Keeping more than the full test is allowed, culling something it keeps isn't
+		std::sort(full.begin(), full.end());
+		std::sort(temporal.begin(), temporal.end());
+		missing.clear();
+		std::set_difference(full.begin(), full.end(), temporal.begin(), temporal.end(), std::back_inserter(missing));
+		if (!missing.empty() && badFrames++ < 5)
+			printf("Frame %d: %zu entities culled that the full test keeps\n", frame, missing.size());
+		falseCulls += missing.size();
+		extra += temporal.size() + missing.size() - full.size();
+
+		registry.EndFrame();
+	}
+
+	printf("%u entities over %d frames, %zu visible on the last\n", count, frames, full.size());
+	printf("Wrongly culled: %llu on %d frames, kept extra: %llu\n", falseCulls, badFrames, extra);
+	printf("Full test %.3f ms, temporal %.3f ms a frame, %.1f%% of tests skipped\n\n", fullMs / frames, temporalMs / frames, 100.0 * skipped / frames);
+	checks.Check(falseCulls == 0, "temporal culling never drops a visible entity");
+	checks.Check(temporalMs <= fullMs, "temporal culling is no slower than the full test");
+
+	JobSystem::ShutDown();
+	return checks.Report("Temporal culling");
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+// Timing and checking shared by the tests and benchmarks in this folder
+
+// Milliseconds since a time point
+inline double ElapsedMs(std::chrono::high_resolution_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Runs a piece of work several times and keeps the fastest, so a stray
+// context switch doesn't end up in the numbers
+template <typename Work>
+double BestOfMs(int runs, Work work)
+{
+	double best = 1e30;
+	for (int run = 0; run < runs; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		work();
+		double ms = ElapsedMs(start);
+		if (ms < best)
+			best = ms;
+	}
+	return best;
+}
+
+// Counts failed checks for tests, printing each one as it happens
+struct CheckCounter
+{
+	unsigned int checks = 0;
+	unsigned int failures = 0;
+
+	void Check(bool passed, const char* what)
+	{
+		checks++;
+		if (!passed)
+		{
+			failures++;
+			printf("FAILED: %s\n", what);
+		}
+	}
+
+	// Exit code for main()
+	int Report(const char* name)
+	{
+		printf("%s: %u of %u checks passed\n", name, checks - failures, checks);
+		return failures == 0 ? 0 : 1;
+	}
+};
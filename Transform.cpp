@@ -7,14 +7,16 @@ using namespace DirectX;
 /// Creates new transform class
 /// </summary>
 Transform::Transform() :
-	dirtyMatrices(false),
-	dirtyVectors(false),
 	position(0.0f, 0.0f, 0.0f),
 	pitchYawRoll(0.0f, 0.0f, 0.0f),
 	scale(1.0f, 1.0f, 1.0f),
 	up(0.0f, 1.0f, 0.0f),
 	right(1.0f, 0.0f, 0.0f),
-	forward(0.0f, 0.0f, 1.0f)
+	forward(0.0f, 0.0f, 1.0f),
+	dirtyMatrices(false),
+	dirtyVectors(false),
+	journal(nullptr),
+	journalId(0)
 {
 	// Initialize world matrix as identity
 	XMStoreFloat4x4(&m4World, XMMatrixIdentity());
@@ -32,7 +34,7 @@ void Transform::SetPosition(float x, float y, float z)
 	position.x = x;
 	position.y = y;
 	position.z = z;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -42,7 +44,7 @@ void Transform::SetPosition(float x, float y, float z)
 void Transform::SetPosition(DirectX::XMFLOAT3 position)
 {
 	this->position = position;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -56,7 +58,7 @@ void Transform::SetRotation(float pitch, float yaw, float roll)
 	pitchYawRoll.x = pitch;
 	pitchYawRoll.y = yaw;
 	pitchYawRoll.z = roll;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 	dirtyVectors = true;
 }
 
@@ -67,7 +69,7 @@ void Transform::SetRotation(float pitch, float yaw, float roll)
 void Transform::SetRotation(DirectX::XMFLOAT3 rotation)
 {
 	this->pitchYawRoll = rotation;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 	dirtyVectors = true;
 }
 
@@ -82,7 +84,7 @@ void Transform::SetScale(float x, float y, float z)
 	scale.x = x;
 	scale.y = y;
 	scale.z = z;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -92,7 +94,7 @@ void Transform::SetScale(float x, float y, float z)
 void Transform::SetScale(DirectX::XMFLOAT3 scale)
 {
 	this->scale = scale;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 // Getters
@@ -141,7 +143,7 @@ void Transform::MoveAbsolute(float x, float y, float z)
 	position.x += x;
 	position.y += y;
 	position.z += z;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -176,7 +178,7 @@ void Transform::MoveRelative(float x, float y, float z)
 	XMStoreFloat3(&position, XMLoadFloat3(&position) + finalOffset);
 
 	// Update matrices
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -200,7 +202,7 @@ void Transform::Rotate(float pitch, float yaw, float roll)
 	pitchYawRoll.x += pitch;
 	pitchYawRoll.y += yaw;
 	pitchYawRoll.z += roll;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 	dirtyVectors = true;
 }
 
@@ -225,7 +227,7 @@ void Transform::Scale(float x, float y, float z)
 	scale.x += x;
 	scale.y += y;
 	scale.z += z;
-	dirtyMatrices = true;
+	MarkMatricesDirty();
 }
 
 /// <summary>
@@ -238,6 +240,27 @@ void Transform::Scale(DirectX::XMFLOAT3 scale)
 	Scale(scale.x, scale.y, scale.z);
 }
 
+/// <summary>
+/// Hooks this transform up to a journal so changes can be tracked
+/// </summary>
+/// <param name="journal">Journal to report to, or null to stop reporting</param>
+/// <param name="journalId">Entity recorded in the journal</param>
+void Transform::SetJournal(TransformJournal* journal, Entity journalId)
+{
+	this->journal = journal;
+	this->journalId = journalId;
+}
+
+/// <summary>
+/// Flags the matrices for rebuilding and records the change
+/// </summary>
+void Transform::MarkMatricesDirty()
+{
+	dirtyMatrices = true;
+	if (journal)
+		journal->Record(journalId);
+}
+
 /// <summary>
 /// Cleans up both matrices whenever data is changed
 /// </summary>
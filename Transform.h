@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include "TransformJournal.h"
 
 //Provides a world matrix to be used in rendering
 class Transform
@@ -36,10 +37,14 @@ public:
 	void Scale(float x, float y, float z);
 	void Scale(DirectX::XMFLOAT3 scale);
 
+	//Reports matrix changes to a journal under the given entity
+	void SetJournal(TransformJournal* journal, Entity journalId);
+
 private:
 	//Methods to update dirty matrices
 	void CleanMatrices();
 	void CleanVectors();
+	void MarkMatricesDirty();
 
 	//Raw data
 	DirectX::XMFLOAT3 position;
@@ -56,4 +61,8 @@ private:
 	//State of matrices and vectors
 	bool dirtyMatrices;
 	bool dirtyVectors;
+
+	//Optional journal that is told about changes
+	TransformJournal* journal;
+	Entity journalId;
 };
\ No newline at end of file
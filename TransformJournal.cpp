@@ -0,0 +1,41 @@
+#include "TransformJournal.h"
+
+/// <summary>
+/// Adds an entity to this frame's list if it is not already there
+/// </summary>
+/// <param name="entity">Handle of the changed entity</param>
+void TransformJournal::Record(Entity entity)
+{
+	unsigned int index = EntityIndex(entity);
+	unsigned int word = index >> 6;
+	uint64_t mask = 1ull << (index & 63);
+
+	// Grow the bitset the first time a high id shows up
+	if (word >= bits.size())
+		bits.resize(word + 1, 0);
+
+	if (bits[word] & mask)
+		return;
+
+	bits[word] |= mask;
+	changed.push_back(entity);
+}
+
+const std::vector<Entity>& TransformJournal::GetChanged() { return changed; }
+
+bool TransformJournal::WasChanged(Entity entity)
+{
+	unsigned int index = EntityIndex(entity);
+	unsigned int word = index >> 6;
+	return word < bits.size() && (bits[word] & (1ull << (index & 63))) != 0;
+}
+
+/// <summary>
+/// Resets the journal for the next frame in O(changed)
+/// </summary>
+void TransformJournal::Clear()
+{
+	for (Entity entity : changed)
+		bits[EntityIndex(entity) >> 6] = 0;
+	changed.clear();
+}
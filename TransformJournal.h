@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Entity.h"
+
+// Records which entities had their transform changed during a frame
+// - Each entity is only recorded once, duplicates are filtered with a
+//   bitset over the entity's slot index
+// - Because of that an entry really stands for a slot, if the slot is
+//   destroyed and reused within the frame the first handle is the one listed
+// - Consumers only read the list, so any number of systems can walk it
+// - Cleared once at the end of the frame after every consumer has run
+// - Recording is not thread safe, move transforms from one thread at a time
+class TransformJournal
+{
+public:
+	// Called by transforms whenever their matrices become dirty
+	void Record(Entity entity);
+
+	// Reading the journal
+	const std::vector<Entity>& GetChanged();
+	bool WasChanged(Entity entity);
+
+	// Only touches the bits that were set this frame
+	void Clear();
+
+private:
+	std::vector<uint64_t> bits;
+	std::vector<Entity> changed;
+};
@@ -7,7 +7,7 @@ SamplerState BasicSampler : register(s0);
 
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
-cbuffer ExternalData : register(b0)
+cbuffer PerMaterial : register(b1)
 {
     float4 colorTint;
     float2 scale;
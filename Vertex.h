@@ -13,4 +13,15 @@ struct Vertex
 	DirectX::XMFLOAT2 UV;
 	DirectX::XMFLOAT3 Normal;
 	DirectX::XMFLOAT3 Tangent;
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// Per instance data for instanced draws, read from a second
+// vertex buffer, must match the "_PER_INSTANCE" inputs of
+// VertexShaderInstanced.hlsl, rows in the order stored here
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4X4 WorldInvTranspose;
+};
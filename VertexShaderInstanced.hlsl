@@ -0,0 +1,52 @@
+#include "ShaderHeader.hlsli"
+
+// Uploaded once per frame, every instance is moved into the
+// camera's and the light's clip space by the same matrices
+cbuffer PerFrame : register(b0)
+{
+    float4x4 viewProjection;
+    float4x4 shadowViewProjection;
+}
+
+// One vertex of the mesh plus the matrices of the instance it belongs to
+// - Instance data comes from a second vertex buffer, a row per element,
+//   the "_PER_INSTANCE" semantics tell SimpleShader to step it once per instance
+struct InstancedVertexShaderInput
+{
+    float3 localPosition : POSITION;
+    float2 uv : TEXCOORD;
+    float3 normal : NORMAL;
+    float3 tangent : TANGENT;
+    float4 world0 : WORLD_PER_INSTANCE0;
+    float4 world1 : WORLD_PER_INSTANCE1;
+    float4 world2 : WORLD_PER_INSTANCE2;
+    float4 world3 : WORLD_PER_INSTANCE3;
+    float4 worldInvTranspose0 : WORLDINVTRANSPOSE_PER_INSTANCE0;
+    float4 worldInvTranspose1 : WORLDINVTRANSPOSE_PER_INSTANCE1;
+    float4 worldInvTranspose2 : WORLDINVTRANSPOSE_PER_INSTANCE2;
+    float4 worldInvTranspose3 : WORLDINVTRANSPOSE_PER_INSTANCE3;
+};
+
+// Same output as VertexShader.hlsl, for many entities sharing a mesh and material at once
+VertexToPixel main(InstancedVertexShaderInput input)
+{
+    VertexToPixel output;
+
+    // Rows arrive as the CPU stored them rather than transposed like constant
+    // buffers are, so the vector goes on the left of these two
+    float4x4 world = float4x4(input.world0, input.world1, input.world2, input.world3);
+    float4x4 worldInvTranspose = float4x4(input.worldInvTranspose0, input.worldInvTranspose1, input.worldInvTranspose2, input.worldInvTranspose3);
+
+    // Precise to match ShadowInstancedVS.hlsl's depth exactly for the pre-pass
+    precise float4 worldPosition = mul(float4(input.localPosition, 1.0f), world);
+    precise float4 screenPosition = mul(viewProjection, worldPosition);
+    output.screenPosition = screenPosition;
+    output.worldPosition = worldPosition.xyz;
+
+    output.uv = input.uv;
+    output.normal = mul(input.normal, (float3x3)worldInvTranspose);
+    output.tangent = mul(input.tangent, (float3x3)world);
+
+    output.shadowMapPos = mul(shadowViewProjection, worldPosition);
+    return output;
+}
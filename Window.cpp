@@ -300,10 +300,12 @@ LRESULT Window::ProcessMessage(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lPara
 		windowWidth = LOWORD(lParam);
 		windowHeight = HIWORD(lParam);
 
-		// Let other systems know
-		Graphics::ResizeBuffers(windowWidth, windowHeight);
+		// Let other systems know, the game goes first so
+		// it can finish any frames still being drawn with
+		// the old buffers before they are resized
 		if(onResize)
 			onResize();
+		Graphics::ResizeBuffers(windowWidth, windowHeight);
 
 		return 0;
 
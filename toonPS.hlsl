@@ -12,15 +12,21 @@ SamplerComparisonState ShadowSampler : register(s2);
 // Texture for shadows
 Texture2D ShadowMap : register(t4);
 
-cbuffer ExternalData : register(b0)
+// Camera and lights, uploaded once a frame
+cbuffer PerFrame : register(b0)
+{
+    float3 cameraPosition;
+    float3 ambientLight;
+    Light lights[5];
+};
+
+// Uploaded when the material changes
+cbuffer PerMaterial : register(b1)
 {
     float4 colorTint;
     float2 scale;
     float2 offset;
     float roughness;
-    float3 cameraPosition;
-    Light lights[5];
-    float3 ambientLight;
 };
 
 float4 main(VertexToPixel input) : SV_TARGET